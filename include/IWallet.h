@@ -185,6 +185,10 @@ public:
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const = 0;
+  // Only blocks holding wallet transactions, and in them only transactions touching one of addresses (any, if empty).
+  // Returns false if the first block is unknown.
+  virtual bool getTransactions(const Crypto::Hash& blockHash, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const = 0;
+  virtual bool getTransactions(uint32_t blockIndex, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const = 0;
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const = 0;
   virtual uint32_t getBlockCount() const  = 0;
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const = 0;
@@ -22,10 +22,12 @@
 #endif
 
 #include <boost/program_options.hpp>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <mutex>
 #include <random>
+#include <System/Timer.h>
 
 #include "Common/int-util.h"
 #include "Common/Base58.h"
@@ -61,6 +63,13 @@ namespace po = boost::program_options;
 
 std::mutex outputMutex;
 
+// consecutive spend keys a worker derives from one random key
+const size_t KEYS_BATCH_SIZE = 256;
+// Base58 encodes an address in blocks of 8 bytes, each one giving 11 characters
+const size_t BASE58_BLOCK_SIZE = 8;
+const size_t BASE58_ENCODED_BLOCK_SIZE = 11;
+const int SPEED_REPORT_INTERVAL = 10; // seconds
+
 namespace command_line
 {
   const command_line::arg_descriptor<std::string> arg_prefix = {"prefix", "Specify the address prefix"};
@@ -136,79 +145,129 @@ bool is_valid_prefix(const std::string& prefix, Currency& currency) {
     return true;
 }
 
+// The leading characters of an address depend on its leading 8-byte blocks only. The ones made of the
+// address tag and the spend key are checked by encoding just these blocks, before any view key is derived.
+class PrefixMatcher {
+public:
+    PrefixMatcher(const std::string& prefix, uint64_t tag) : m_prefix(prefix), m_data(Tools::get_varint_data(tag)) {
+        m_tagSize = m_data.size();
+        size_t spendBlocks = (m_tagSize + sizeof(Crypto::PublicKey)) / BASE58_BLOCK_SIZE;
+        size_t prefixBlocks = (prefix.size() + BASE58_ENCODED_BLOCK_SIZE - 1) / BASE58_ENCODED_BLOCK_SIZE;
+        size_t tagBlocks = (m_tagSize + BASE58_BLOCK_SIZE - 1) / BASE58_BLOCK_SIZE;
+        size_t blocks = std::max(std::min(spendBlocks, prefixBlocks), tagBlocks);
+        m_spendBytes = blocks * BASE58_BLOCK_SIZE - m_tagSize;
+        m_checkedLength = std::min(prefix.size(), blocks * BASE58_ENCODED_BLOCK_SIZE);
+    }
+
+    // false if no address with this spend key starts with the prefix
+    bool spendKeyMatches(const Crypto::PublicKey& spendPublicKey) {
+        m_data.replace(m_tagSize, std::string::npos, reinterpret_cast<const char*>(&spendPublicKey), m_spendBytes);
+        return Tools::Base58::encode(m_data).compare(0, m_checkedLength, m_prefix, 0, m_checkedLength) == 0;
+    }
+
+private:
+    const std::string& m_prefix;
+    std::string m_data;
+    size_t m_tagSize;
+    size_t m_spendBytes;
+    size_t m_checkedLength;
+};
+
 bool check_address_prefix(const std::string& prefix, Currency& currency, const po::variables_map& vm, AccountKeys& _keys) {
-    MevaCoin::AccountPublicAddress publicKeys;
-    if (secret_key_to_public_key(_keys.spendSecretKey, publicKeys.spendPublicKey)) {
-        AccountBase::generateViewFromSpend(_keys.spendSecretKey, _keys.viewSecretKey, publicKeys.viewPublicKey);
-        std::string address = currency.accountAddressAsString(publicKeys);
-        if ((address.substr(0, prefix.length()) == prefix)) {
-            std::lock_guard<std::mutex> guard(outputMutex);
-
-            std::string found = "\n";
-
-            found += "Address:   " + address + "\n";
-            found += "Spend key: " + Common::podToHex(_keys.spendSecretKey) + "\n";
-            found += "View key:  " + Common::podToHex(_keys.viewSecretKey) + "\n";
-
-            std::string electrum_words;
-            std::string lang = "English";
-            Crypto::ElectrumWords::bytes_to_words(_keys.spendSecretKey, electrum_words, lang);
-            Crypto::SecretKey second;
-            keccak((uint8_t*)&_keys.spendSecretKey, sizeof(Crypto::SecretKey), (uint8_t*)&second, sizeof(Crypto::SecretKey));
-            sc_reduce32((uint8_t*)&second);
-            bool success = memcmp(second.data, _keys.viewSecretKey.data, sizeof(Crypto::SecretKey)) == 0;
-            if (success)
-            {
-                seedFormater(electrum_words);
-                found += "Mnemonic:  ";
-                found += electrum_words + "\n";
-            }
+    MevaCoin::AccountPublicAddress& publicKeys = _keys.address;
+    AccountBase::generateViewFromSpend(_keys.spendSecretKey, _keys.viewSecretKey, publicKeys.viewPublicKey);
+    std::string address = currency.accountAddressAsString(publicKeys);
+    if ((address.substr(0, prefix.length()) == prefix)) {
+        std::lock_guard<std::mutex> guard(outputMutex);
 
-            std::cout << SuccessMsg(found) << ENDL;
+        std::string found = "\n";
 
-            if (!command_line::get_arg(vm, command_line::arg_file).empty()) {
-                std::string filename = command_line::get_arg(vm, command_line::arg_file);
-                std::ofstream ofs;
-                ofs.open(filename + ".txt", std::ofstream::out | std::ofstream::app);
-                ofs << found;
-                ofs.close();
-            }
+        found += "Address:   " + address + "\n";
+        found += "Spend key: " + Common::podToHex(_keys.spendSecretKey) + "\n";
+        found += "View key:  " + Common::podToHex(_keys.viewSecretKey) + "\n";
 
-            return true;
+        std::string electrum_words;
+        std::string lang = "English";
+        Crypto::ElectrumWords::bytes_to_words(_keys.spendSecretKey, electrum_words, lang);
+        Crypto::SecretKey second;
+        keccak((uint8_t*)&_keys.spendSecretKey, sizeof(Crypto::SecretKey), (uint8_t*)&second, sizeof(Crypto::SecretKey));
+        sc_reduce32((uint8_t*)&second);
+        bool success = memcmp(second.data, _keys.viewSecretKey.data, sizeof(Crypto::SecretKey)) == 0;
+        if (success)
+        {
+            seedFormater(electrum_words);
+            found += "Mnemonic:  ";
+            found += electrum_words + "\n";
         }
+
+        std::cout << SuccessMsg(found) << ENDL;
+
+        if (!command_line::get_arg(vm, command_line::arg_file).empty()) {
+            std::string filename = command_line::get_arg(vm, command_line::arg_file);
+            std::ofstream ofs;
+            ofs.open(filename + ".txt", std::ofstream::out | std::ofstream::app);
+            ofs << found;
+            ofs.close();
+        }
+
+        return true;
     }
 
     return false;
 }
 
-void prefix_worker(const std::string& prefix, Currency& currency, const po::variables_map& vm, int threads, int threadId, volatile int& found, int count) {
-    bool found_needed = false;
-    while (!found_needed) {
-        AccountKeys keys;
-        Crypto::SecretKey second;
-        Crypto::generate_keys(keys.address.spendPublicKey, keys.spendSecretKey);
-        keccak((uint8_t*)&keys.spendSecretKey, sizeof(Crypto::SecretKey), (uint8_t*)&second, sizeof(Crypto::SecretKey));
-        Crypto::generate_deterministic_keys(keys.address.viewPublicKey, keys.viewSecretKey, second);
+// Spend keys are taken in runs of consecutive secret keys, so each public key costs a point addition instead
+// of a scalar multiplication; the view key is only derived for spend keys that can give the prefix.
+void prefix_worker(const std::string& prefix, Currency& currency, const po::variables_map& vm, std::atomic<int>& found, int count, std::atomic<uint64_t>& attempts) {
+    PrefixMatcher matcher(prefix, currency.publicAddressBase58Prefix());
+    std::vector<Crypto::SecretKey> spendSecretKeys(KEYS_BATCH_SIZE);
+    std::vector<Crypto::PublicKey> spendPublicKeys(KEYS_BATCH_SIZE);
+    while (found < count) {
+        Crypto::PublicKey firstPublicKey;
+        Crypto::SecretKey firstSecretKey;
+        Crypto::generate_keys(firstPublicKey, firstSecretKey);
+        Crypto::generate_consecutive_keys(firstSecretKey, KEYS_BATCH_SIZE, spendSecretKeys.data(), spendPublicKeys.data());
+
+        for (size_t i = 0; i < KEYS_BATCH_SIZE; ++i) {
+            if (!matcher.spendKeyMatches(spendPublicKeys[i])) {
+                continue;
+            }
 
-        if (check_address_prefix(prefix, currency, vm, keys)) {
-            found++;
+            AccountKeys keys;
+            keys.spendSecretKey = spendSecretKeys[i];
+            keys.address.spendPublicKey = spendPublicKeys[i];
+            if (check_address_prefix(prefix, currency, vm, keys)) {
+                found++;
+            }
         }
 
-        if (found >= count) {
-            found_needed = true;
-        }
+        attempts += KEYS_BATCH_SIZE;
+    }
+}
+
+void report_speed(const std::atomic<uint64_t>* attempts, std::vector<uint64_t>& lastAttempts, double seconds) {
+    std::string perThread;
+    uint64_t total = 0;
+    for (size_t i = 0; i < lastAttempts.size(); ++i) {
+        uint64_t current = attempts[i];
+        uint64_t speed = static_cast<uint64_t>((current - lastAttempts[i]) / seconds);
+        perThread += (i == 0 ? "" : ", ") + std::to_string(speed);
+        total += speed;
+        lastAttempts[i] = current;
     }
 
-    return;
+    std::lock_guard<std::mutex> guard(outputMutex);
+    std::cout << InformationMsg("Speed: " + std::to_string(total) + " keys/s (per thread: " + perThread + ")") << std::endl;
 }
 
 bool find_prefix(const po::variables_map& vm, Currency& currency, System::Dispatcher& dispatcher) {
     std::string prefix = command_line::get_arg(vm, command_line::arg_prefix);
     int count = command_line::get_arg(vm, command_line::arg_count);
     int threads = std::max(1, command_line::get_arg(vm, command_line::arg_threads));
-    int found = 0;
+    std::atomic<int> found(0);
+    std::unique_ptr<std::atomic<uint64_t>[]> attempts(new std::atomic<uint64_t>[threads]());
 
-    if ((prefix.substr(0, 1) != "K") || prefix.length() > 95 || prefix.length() < 2) {
+    if (prefix.length() > 95 || prefix.length() < 2) {
         std::cerr << WarningMsg("Invalid address prefix!") << std::endl;
         return false;
     }
@@ -225,11 +284,23 @@ bool find_prefix(const po::variables_map& vm, Currency& currency, System::Dispat
     for (int i = 0; i < threads; i++) {
         m_workers.emplace_back(
                new System::RemoteContext<void>(dispatcher, [&, i]() {
-                   prefix_worker(prefix, currency, vm, threads, i, found, count);
+                   prefix_worker(prefix, currency, vm, found, count, attempts[i]);
                })
         );
     }
 
+    System::Timer timer(dispatcher);
+    std::vector<uint64_t> lastAttempts(threads, 0);
+    auto lastReport = std::chrono::steady_clock::now();
+    while (found < count) {
+        timer.sleep(std::chrono::seconds(1));
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - lastReport;
+        if (found < count && elapsed.count() >= SPEED_REPORT_INTERVAL) {
+            report_speed(attempts.get(), lastAttempts, elapsed.count());
+            lastReport = std::chrono::steady_clock::now();
+        }
+    }
+
     m_workers.clear();
     return found != 0;
 }
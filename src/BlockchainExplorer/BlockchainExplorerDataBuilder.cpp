@@ -238,7 +238,9 @@ if (!m_core.getBlockReward(
 }
 
 bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& transaction, TransactionDetails& transactionDetails, uint64_t timestamp) {
-  Crypto::Hash hash = getObjectHash(transaction);
+  Crypto::Hash hash;
+  size_t size;
+  getObjectHash(transaction, hash, size);
   transactionDetails.hash = hash;
   transactionDetails.version = transaction.version;
   transactionDetails.timestamp = timestamp;
@@ -261,7 +263,7 @@ bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& tr
       transactionDetails.timestamp = block.timestamp;
     }
   }
-  transactionDetails.size = getObjectBinarySize(transaction);
+  transactionDetails.size = size;
   transactionDetails.unlockTime = transaction.unlockTime;
   transactionDetails.totalOutputsAmount = get_outs_money_amount(transaction);
 
@@ -0,0 +1,34 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <streambuf>
+
+namespace Common {
+
+// Read-only std::streambuf over a memory block. Unlike std::stringstream it does not copy the data,
+// the block must outlive the stream.
+class MemoryStreamBuffer : public std::streambuf {
+public:
+  MemoryStreamBuffer(const void* buffer, size_t bufferSize) {
+    char* begin = const_cast<char*>(static_cast<const char*>(buffer));
+    setg(begin, begin, begin + bufferSize);
+  }
+};
+
+}
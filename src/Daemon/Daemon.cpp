@@ -337,6 +337,11 @@ Common::Console::Color::BrightCyan);
     }
     logger(INFO) << "Core initialized OK";
 
+    // Incoming blocks are verified on this thread, so this is the scratchpad proof of work checks use
+    if (Crypto::y_slow_hash_prepare()) {
+      logger(INFO) << "Proof of work scratchpad: " << Crypto::thread_scratchpad_report();
+    }
+
     if (command_line::has_arg(vm, arg_rollback)) {
       std::string rollback_str = command_line::get_arg(vm, arg_rollback);
       if (!rollback_str.empty()) {
@@ -0,0 +1,226 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "HttpCompression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace MevaCoin {
+
+namespace {
+
+std::string trim(const std::string& s) {
+  size_t first = s.find_first_not_of(" \t");
+  if (first == std::string::npos) {
+    return std::string();
+  }
+
+  size_t last = s.find_last_not_of(" \t");
+  return s.substr(first, last - first + 1);
+}
+
+std::string toLower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return s;
+}
+
+double parseQuality(const std::string& params) {
+  size_t pos = params.find("q=");
+  if (pos == std::string::npos) {
+    return 1.0;
+  }
+
+  return std::strtod(params.c_str() + pos + 2, nullptr);
+}
+
+#ifdef HAVE_ZLIB
+// 15 bits of window, +16 selects the gzip wrapper, +32 detects gzip or zlib on input
+const int ZLIB_WINDOW_BITS = 15;
+const int GZIP_WINDOW_BITS = ZLIB_WINDOW_BITS + 16;
+const int AUTO_WINDOW_BITS = ZLIB_WINDOW_BITS + 32;
+#endif
+
+}
+
+bool isHttpCompressionSupported() {
+#ifdef HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+HttpContentEncoding selectContentEncoding(const std::string& acceptEncoding) {
+  if (!isHttpCompressionSupported()) {
+    return HttpContentEncoding::Identity;
+  }
+
+  double gzipQuality = -1;
+  double deflateQuality = -1;
+  double anyQuality = 0;
+
+  size_t start = 0;
+  while (start <= acceptEncoding.size()) {
+    size_t end = acceptEncoding.find(',', start);
+    if (end == std::string::npos) {
+      end = acceptEncoding.size();
+    }
+
+    std::string item = acceptEncoding.substr(start, end - start);
+    size_t paramsPos = item.find(';');
+    std::string coding = toLower(trim(item.substr(0, paramsPos)));
+    double quality = paramsPos == std::string::npos ? 1.0 : parseQuality(item.substr(paramsPos + 1));
+
+    if (coding == "gzip" || coding == "x-gzip") {
+      gzipQuality = quality;
+    } else if (coding == "deflate") {
+      deflateQuality = quality;
+    } else if (coding == "*") {
+      anyQuality = quality;
+    }
+
+    start = end + 1;
+  }
+
+  if (gzipQuality < 0) {
+    gzipQuality = anyQuality;
+  }
+
+  if (deflateQuality < 0) {
+    deflateQuality = anyQuality;
+  }
+
+  if (gzipQuality > 0 && gzipQuality >= deflateQuality) {
+    return HttpContentEncoding::Gzip;
+  }
+
+  if (deflateQuality > 0) {
+    return HttpContentEncoding::Deflate;
+  }
+
+  return HttpContentEncoding::Identity;
+}
+
+bool parseContentEncoding(const std::string& contentEncoding, HttpContentEncoding& encoding) {
+  std::string coding = toLower(trim(contentEncoding));
+  if (coding.empty() || coding == "identity") {
+    encoding = HttpContentEncoding::Identity;
+  } else if (coding == "gzip" || coding == "x-gzip") {
+    encoding = HttpContentEncoding::Gzip;
+  } else if (coding == "deflate") {
+    encoding = HttpContentEncoding::Deflate;
+  } else {
+    return false;
+  }
+
+  return encoding == HttpContentEncoding::Identity || isHttpCompressionSupported();
+}
+
+const char* getContentEncodingName(HttpContentEncoding encoding) {
+  switch (encoding) {
+  case HttpContentEncoding::Gzip:
+    return "gzip";
+  case HttpContentEncoding::Deflate:
+    return "deflate";
+  default:
+    return "identity";
+  }
+}
+
+bool compressHttpContent(const std::string& data, HttpContentEncoding encoding, std::string& compressed) {
+#ifdef HAVE_ZLIB
+  if (encoding == HttpContentEncoding::Identity || data.size() > std::numeric_limits<uInt>::max()) {
+    return false;
+  }
+
+  z_stream strm = {};
+  int windowBits = encoding == HttpContentEncoding::Gzip ? GZIP_WINDOW_BITS : ZLIB_WINDOW_BITS;
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  // the gzip header and trailer are not included in deflateBound()
+  compressed.resize(deflateBound(&strm, static_cast<uLong>(data.size())) + 18);
+
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  strm.avail_in = static_cast<uInt>(data.size());
+  strm.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+  strm.avail_out = static_cast<uInt>(compressed.size());
+
+  int ret = deflate(&strm, Z_FINISH);
+  compressed.resize(strm.total_out);
+  deflateEnd(&strm);
+
+  return ret == Z_STREAM_END;
+#else
+  return false;
+#endif
+}
+
+bool decompressHttpContent(const std::string& data, HttpContentEncoding encoding, std::string& decompressed, size_t maxSize) {
+  if (encoding == HttpContentEncoding::Identity) {
+    decompressed = data;
+    return true;
+  }
+
+#ifdef HAVE_ZLIB
+  if (data.size() > std::numeric_limits<uInt>::max()) {
+    return false;
+  }
+
+  z_stream strm = {};
+  if (inflateInit2(&strm, AUTO_WINDOW_BITS) != Z_OK) {
+    return false;
+  }
+
+  strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  strm.avail_in = static_cast<uInt>(data.size());
+
+  decompressed.clear();
+  char chunk[64 * 1024];
+  int ret = Z_OK;
+  while (ret == Z_OK) {
+    strm.next_out = reinterpret_cast<Bytef*>(chunk);
+    strm.avail_out = sizeof(chunk);
+
+    ret = inflate(&strm, Z_NO_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END) {
+      break;
+    }
+
+    decompressed.append(chunk, sizeof(chunk) - strm.avail_out);
+    if (decompressed.size() > maxSize) {
+      ret = Z_MEM_ERROR;
+      break;
+    }
+  }
+
+  inflateEnd(&strm);
+  return ret == Z_STREAM_END;
+#else
+  return false;
+#endif
+}
+
+}
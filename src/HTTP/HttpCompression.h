@@ -0,0 +1,45 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace MevaCoin {
+
+enum class HttpContentEncoding {
+  Identity,
+  Gzip,
+  Deflate
+};
+
+// False when built without zlib; every encoding then degrades to Identity.
+bool isHttpCompressionSupported();
+
+// Picks the preferred supported encoding from an Accept-Encoding header value.
+HttpContentEncoding selectContentEncoding(const std::string& acceptEncoding);
+
+// Maps a Content-Encoding header value, returns false for unsupported codings.
+bool parseContentEncoding(const std::string& contentEncoding, HttpContentEncoding& encoding);
+
+const char* getContentEncodingName(HttpContentEncoding encoding);
+
+bool compressHttpContent(const std::string& data, HttpContentEncoding encoding, std::string& compressed);
+bool decompressHttpContent(const std::string& data, HttpContentEncoding encoding, std::string& decompressed, size_t maxSize);
+
+}
@@ -246,6 +246,40 @@ std::error_code InProcessNode::doGetTransactionOutsGlobalIndices(const Crypto::H
   return std::error_code();
 }
 
+void InProcessNode::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices,
+    const Callback& callback)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (state != INITIALIZED) {
+    lock.unlock();
+    callback(make_error_code(MevaCoin::error::NOT_INITIALIZED));
+    return;
+  }
+
+  ioService.post(
+    std::bind(&InProcessNode::getTransactionsOutsGlobalIndicesAsync,
+      this,
+      std::cref(transactionHashes),
+      std::ref(outsGlobalIndices),
+      callback
+    )
+  );
+}
+
+void InProcessNode::getTransactionsOutsGlobalIndicesAsync(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices,
+    const Callback& callback)
+{
+  outsGlobalIndices.clear();
+  outsGlobalIndices.resize(transactionHashes.size());
+
+  std::error_code ec;
+  for (size_t i = 0; i < transactionHashes.size() && !ec; ++i) {
+    ec = doGetTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices[i]);
+  }
+
+  callback(ec);
+}
+
 void InProcessNode::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
     std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback)
 {
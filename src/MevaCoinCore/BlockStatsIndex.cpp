@@ -0,0 +1,174 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BlockStatsIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+#include "Serialization/ISerializer.h"
+#include "Serialization/SerializationOverloads.h"
+
+namespace MevaCoin {
+
+namespace {
+
+// Exact floor average without summing the raw values, which could overflow on long ranges
+class SummaryBuilder {
+public:
+  explicit SummaryBuilder(uint64_t count) : m_count(count), m_min(std::numeric_limits<uint64_t>::max()), m_max(0), m_quotients(0), m_remainders(0) {
+  }
+
+  void add(uint64_t value) {
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_quotients += value / m_count;
+    m_remainders += value % m_count;
+  }
+
+  BlockStatsSummary summary() const {
+    return { m_min, m_max, m_quotients + m_remainders / m_count };
+  }
+
+private:
+  uint64_t m_count;
+  uint64_t m_min;
+  uint64_t m_max;
+  uint64_t m_quotients;
+  uint64_t m_remainders;
+};
+
+}
+
+void BlockStatsIndex::push(uint64_t timestamp, uint64_t blockSize, difficulty_type cumulativeDifficulty, uint64_t alreadyGeneratedCoins, uint32_t transactionsCount) {
+  m_timestamps.push_back(timestamp);
+  m_blockSizes.push_back(blockSize);
+  m_cumulativeDifficulties.push_back(cumulativeDifficulty);
+  m_generatedCoins.push_back(alreadyGeneratedCoins);
+  m_transactionsCounts.push_back(transactionsCount);
+}
+
+void BlockStatsIndex::pop() {
+  assert(!m_timestamps.empty());
+
+  m_timestamps.pop_back();
+  m_blockSizes.pop_back();
+  m_cumulativeDifficulties.pop_back();
+  m_generatedCoins.pop_back();
+  m_transactionsCounts.pop_back();
+}
+
+void BlockStatsIndex::clear() {
+  m_timestamps.clear();
+  m_blockSizes.clear();
+  m_cumulativeDifficulties.clear();
+  m_generatedCoins.clear();
+  m_transactionsCounts.clear();
+}
+
+void BlockStatsIndex::reserve(size_t size) {
+  m_timestamps.reserve(size);
+  m_blockSizes.reserve(size);
+  m_cumulativeDifficulties.reserve(size);
+  m_generatedCoins.reserve(size);
+  m_transactionsCounts.reserve(size);
+}
+
+bool BlockStatsIndex::get(uint32_t height, BlockStats& stats) const {
+  if (height >= size()) {
+    return false;
+  }
+
+  stats.timestamp = m_timestamps[height];
+  stats.blockSize = m_blockSizes[height];
+  stats.difficulty = difficulty(height);
+  stats.alreadyGeneratedCoins = m_generatedCoins[height];
+  stats.reward = reward(height);
+  stats.transactionsCount = m_transactionsCounts[height];
+
+  return true;
+}
+
+std::vector<BlockStatsRange> BlockStatsIndex::getRanges(uint32_t startHeight, uint32_t endHeight, uint32_t maxRanges) const {
+  std::vector<BlockStatsRange> ranges;
+  if (startHeight > endHeight || endHeight >= size() || maxRanges == 0) {
+    return ranges;
+  }
+
+  uint64_t count = static_cast<uint64_t>(endHeight) - startHeight + 1;
+  uint64_t rangesCount = std::min<uint64_t>(maxRanges, count);
+  ranges.reserve(static_cast<size_t>(rangesCount));
+
+  for (uint64_t r = 0; r < rangesCount; ++r) {
+    uint32_t first = static_cast<uint32_t>(startHeight + count * r / rangesCount);
+    uint32_t last = static_cast<uint32_t>(startHeight + count * (r + 1) / rangesCount - 1);
+    uint64_t length = static_cast<uint64_t>(last) - first + 1;
+
+    SummaryBuilder blockSize(length);
+    SummaryBuilder blockDifficulty(length);
+    SummaryBuilder blockReward(length);
+    SummaryBuilder transactionsCount(length);
+    for (uint32_t height = first; height <= last; ++height) {
+      blockSize.add(m_blockSizes[height]);
+      blockDifficulty.add(difficulty(height));
+      blockReward.add(reward(height));
+      transactionsCount.add(m_transactionsCounts[height]);
+    }
+
+    BlockStatsRange range;
+    range.startHeight = first;
+    range.endHeight = last;
+    range.startTimestamp = m_timestamps[first];
+    range.endTimestamp = m_timestamps[last];
+    range.alreadyGeneratedCoins = m_generatedCoins[last];
+    range.blockSize = blockSize.summary();
+    range.difficulty = blockDifficulty.summary();
+    range.reward = blockReward.summary();
+    range.transactionsCount = transactionsCount.summary();
+    ranges.push_back(range);
+  }
+
+  return ranges;
+}
+
+void BlockStatsIndex::serialize(ISerializer& s) {
+  serializeAsBinary(m_timestamps, "timestamps", s);
+  serializeAsBinary(m_blockSizes, "block_sizes", s);
+  serializeAsBinary(m_cumulativeDifficulties, "cumulative_difficulties", s);
+  serializeAsBinary(m_generatedCoins, "generated_coins", s);
+  serializeAsBinary(m_transactionsCounts, "transactions_counts", s);
+
+  if (s.type() == ISerializer::INPUT) {
+    size_t count = m_timestamps.size();
+    if (m_blockSizes.size() != count || m_cumulativeDifficulties.size() != count ||
+        m_generatedCoins.size() != count || m_transactionsCounts.size() != count) {
+      throw std::runtime_error("Inconsistent block stats columns");
+    }
+  }
+}
+
+difficulty_type BlockStatsIndex::difficulty(uint32_t height) const {
+  return height == 0 ? m_cumulativeDifficulties[0] : m_cumulativeDifficulties[height] - m_cumulativeDifficulties[height - 1];
+}
+
+uint64_t BlockStatsIndex::reward(uint32_t height) const {
+  return height == 0 ? m_generatedCoins[0] : m_generatedCoins[height] - m_generatedCoins[height - 1];
+}
+
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MevaCoinCore/Difficulty.h"
+
+namespace MevaCoin {
+
+class ISerializer;
+
+struct BlockStats {
+  uint64_t timestamp;
+  uint64_t blockSize;
+  difficulty_type difficulty;
+  uint64_t alreadyGeneratedCoins;
+  uint64_t reward;
+  uint32_t transactionsCount;
+};
+
+struct BlockStatsSummary {
+  uint64_t min;
+  uint64_t max;
+  uint64_t avg;
+};
+
+// Downsampled stats of the heights [startHeight, endHeight]
+struct BlockStatsRange {
+  uint32_t startHeight;
+  uint32_t endHeight;
+  uint64_t startTimestamp;
+  uint64_t endTimestamp;
+  uint64_t alreadyGeneratedCoins;
+  BlockStatsSummary blockSize;
+  BlockStatsSummary difficulty;
+  BlockStatsSummary reward;
+  BlockStatsSummary transactionsCount;
+};
+
+// Per-height chart data of the main chain kept in columns, so stats queries
+// never have to load blocks from the swapped blocks storage.
+class BlockStatsIndex {
+public:
+  void push(uint64_t timestamp, uint64_t blockSize, difficulty_type cumulativeDifficulty, uint64_t alreadyGeneratedCoins, uint32_t transactionsCount);
+  void pop();
+  void clear();
+  void reserve(size_t size);
+
+  uint32_t size() const {
+    return static_cast<uint32_t>(m_timestamps.size());
+  }
+
+  bool get(uint32_t height, BlockStats& stats) const;
+
+  // Splits [startHeight, endHeight] into at most maxRanges buckets of equal length
+  std::vector<BlockStatsRange> getRanges(uint32_t startHeight, uint32_t endHeight, uint32_t maxRanges) const;
+
+  void serialize(ISerializer& s);
+
+private:
+  difficulty_type difficulty(uint32_t height) const;
+  uint64_t reward(uint32_t height) const;
+
+  std::vector<uint64_t> m_timestamps;
+  std::vector<uint64_t> m_blockSizes;
+  std::vector<uint64_t> m_cumulativeDifficulties;
+  std::vector<uint64_t> m_generatedCoins;
+  std::vector<uint32_t> m_transactionsCounts;
+};
+
+}
@@ -20,6 +20,7 @@
 #include "Blockchain.h"
 
 #include <algorithm>
+#include <memory>
 #include <numeric>
 #include <cstdio>
 #include <cmath>
@@ -52,6 +53,12 @@ std::string appendPath(const std::string& path, const std::string& fileName) {
   return result;
 }
 
+// prepared ring members are about 2.5 KB each
+const size_t RING_KEY_CACHE_SIZE = 8192;
+const size_t VERIFIED_TRANSACTION_CACHE_SIZE = 65536;
+// blocks whose transactions are hashed together while rebuilding the cache
+const uint32_t REBUILD_CACHE_HASH_BATCH = 256;
+
 }
 
 namespace std {
@@ -64,7 +71,7 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 4
+#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 5
 #define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
 
 namespace MevaCoin {
@@ -185,6 +192,9 @@ public:
     logger(INFO) << operation << "hashing blobs...";
     s(m_bs.m_blobs, "hashing_blobs");
 
+    logger(INFO) << operation << "block stats...";
+    s(m_bs.m_blockStats, "block_stats");
+
     auto dur = std::chrono::steady_clock::now() - start;
 
     logger(INFO) << "Serialization time: " << std::chrono::duration_cast<std::chrono::milliseconds>(dur).count() << "ms";
@@ -301,6 +311,8 @@ logger(logger, "Blockchain"),
 m_currency(currency),
 m_tx_pool(tx_pool),
 m_current_block_cumul_sz_limit(0),
+m_ringKeyCache(RING_KEY_CACHE_SIZE),
+m_verifiedTransactions(VERIFIED_TRANSACTION_CACHE_SIZE),
 m_upgradeDetectorV2(currency, m_blocks, BLOCK_MAJOR_VERSION_2, logger),
 m_upgradeDetectorV3(currency, m_blocks, BLOCK_MAJOR_VERSION_3, logger),
 m_upgradeDetectorV4(currency, m_blocks, BLOCK_MAJOR_VERSION_4, logger),
@@ -453,7 +465,7 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    pushBlock(m_currency.genesisBlock(), get_block_hash(m_currency.genesisBlock()), bvc);
+    pushBlock(CachedBlock(m_currency.genesisBlock()), bvc);
     if (bvc.m_verification_failed) {
       logger(ERROR, BRIGHT_RED) << "Failed to add genesis block to blockchain";
       return false;
@@ -543,16 +555,34 @@ void Blockchain::rebuildCache() {
   m_multisignatureOutputs.clear();
   m_blobs.clear();
   m_blobs.reserve(m_blocks.size());
+  m_blockStats.clear();
+  m_blockStats.reserve(m_blocks.size());
+  std::vector<BinaryArray> transactionBlobs;
+  std::vector<Crypto::Hash> transactionHashes;
+  size_t nextTransactionHash = 0;
   for (uint32_t b = 0; b < m_blocks.size(); ++b) {
     if (b % 1000 == 0) {
       logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
     }
+    if (b % REBUILD_CACHE_HASH_BATCH == 0) {
+      uint32_t end = std::min(b + REBUILD_CACHE_HASH_BATCH, static_cast<uint32_t>(m_blocks.size()));
+      transactionBlobs.clear();
+      for (uint32_t i = b; i < end; ++i) {
+        for (const TransactionEntry& transaction : m_blocks[i].transactions) {
+          transactionBlobs.push_back(toBinaryArray(transaction.tx));
+        }
+      }
+
+      getBinaryArrayHashes(transactionBlobs, transactionHashes);
+      nextTransactionHash = 0;
+    }
+
     const BlockEntry& block = m_blocks[b];
     Crypto::Hash blockHash = get_block_hash(block.bl);
     m_blockIndex.push(blockHash);
     for (uint16_t t = 0; t < block.transactions.size(); ++t) {
       const TransactionEntry& transaction = block.transactions[t];
-      Crypto::Hash transactionHash = getObjectHash(transaction.tx);
+      const Crypto::Hash& transactionHash = transactionHashes[nextTransactionHash++];
       TransactionIndex transactionIndex = { b, t };
       m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
 
@@ -586,6 +616,8 @@ void Blockchain::rebuildCache() {
     }
     m_blobs.push_back(ba);
 
+    m_blockStats.push(blk.timestamp, block.block_cumulative_size, block.cumulative_difficulty, block.already_generated_coins,
+      static_cast<uint32_t>(blk.transactionHashes.size()));
   }
 
   std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
@@ -628,6 +660,7 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   m_timestampIndex.clear();
   m_generatedTransactionsIndex.clear();
   m_orphanBlocksIndex.clear();
+  m_blockStats.clear();
 
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   addNewBlock(b, bvc);
@@ -830,7 +863,7 @@ bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain,
   for (auto &bl : original_chain) {
     block_verification_context bvc =
       boost::value_initialized<block_verification_context>();
-    bool r = pushBlock(bl, get_block_hash(bl), bvc);
+    bool r = pushBlock(CachedBlock(bl), bvc);
     if (!(r && bvc.m_added_to_main_chain)) {
       logger(ERROR, BRIGHT_RED) << "PANIC!!! failed to add (again) block while "
         "chain switching during the rollback!";
@@ -965,7 +998,7 @@ bool Blockchain::switch_to_alternative_blockchain(const std::list<Crypto::Hash>&
     const auto& ch_ent_h = *alt_ch_iter;
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
     const Block& b = m_alternative_chains[ch_ent_h].bl;
-    bool r = pushBlock(b, get_block_hash(b), bvc);
+    bool r = pushBlock(CachedBlock(b), bvc);
     if (!r || !bvc.m_added_to_main_chain) {
       logger(INFO, BRIGHT_WHITE) << "Failed to switch to alternative blockchain";
       rollback_blockchain_switching(disconnected_chain, split_height);
@@ -1209,6 +1242,19 @@ bool Blockchain::getBlockLongHash(Crypto::cn_context& context, const Block& b, C
   if (!get_signed_block_hashing_blob(b, pot))
     return false;
 
+  return getPotLongHash(b, pot, res, alt_chain, no_blobs);
+}
+
+bool Blockchain::getBlockLongHash(const Block& b, const BinaryArray& signedHashingBlob, BinaryArray& pot, Crypto::Hash& res) {
+  assert(b.majorVersion >= MevaCoin::BLOCK_MAJOR_VERSION_5);
+  std::list<Crypto::Hash> dummy_alt_chain;
+
+  pot.assign(signedHashingBlob.begin(), signedHashingBlob.end());
+  return getPotLongHash(b, pot, res, dummy_alt_chain, false);
+}
+
+// pot holds the signed hashing blob of b on entry
+bool Blockchain::getPotLongHash(const Block& b, BinaryArray& pot, Crypto::Hash& res, const std::list<Crypto::Hash>& alt_chain, bool no_blobs) {
   Crypto::Hash hash_1, hash_2;
   uint32_t currentHeight = boost::get<BaseInput>(b.baseTransaction.inputs[0]).blockIndex;
   uint32_t maxHeight = std::min<uint32_t>(getCurrentBlockchainHeight() - 1, currentHeight - 1 - static_cast<uint32_t>(m_currency.minedMoneyUnlockWindow()));
@@ -1702,18 +1748,24 @@ uint64_t Blockchain::blockCumulativeDifficulty(size_t i) {
 
 bool Blockchain::getblockEntry(size_t i, uint64_t& block_cumulative_size, difficulty_type& difficulty, uint64_t& already_generated_coins, uint64_t& reward, uint64_t& transactions_count, uint64_t& timestamp) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::get_block_entry()"; return false; }
+  BlockStats stats;
+  if (!m_blockStats.get(static_cast<uint32_t>(i), stats)) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::get_block_entry()"; return false; }
 
-  block_cumulative_size = m_blocks[i].block_cumulative_size;
-  difficulty = m_blocks[i].cumulative_difficulty - m_blocks[i - 1].cumulative_difficulty;
-  already_generated_coins = m_blocks[i].already_generated_coins;
-  reward = m_blocks[i].already_generated_coins - m_blocks[i - 1].already_generated_coins;
-  timestamp = m_blocks[i].bl.timestamp;
-  transactions_count = m_blocks[i].bl.transactionHashes.size();
+  block_cumulative_size = stats.blockSize;
+  difficulty = stats.difficulty;
+  already_generated_coins = stats.alreadyGeneratedCoins;
+  reward = stats.reward;
+  timestamp = stats.timestamp;
+  transactions_count = stats.transactionsCount;
 
   return true;
 }
 
+std::vector<BlockStatsRange> Blockchain::getBlockStatsRanges(uint32_t startHeight, uint32_t endHeight, uint32_t maxRanges) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  return m_blockStats.getRanges(startHeight, endHeight, maxRanges);
+}
+
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
@@ -1846,10 +1898,21 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
   if (tail)
     tail->id = getTailId(tail->height);
 
-  bool res = checkTransactionInputs(tx, &max_used_block_height);
+  CachedTransaction cachedTransaction(tx);
+  bool ringSignaturesChecked = false;
+  bool res = checkTransactionInputs(cachedTransaction, &max_used_block_height, true, &ringSignaturesChecked);
   if (!res) return false;
   if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
   get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+
+  BlockInfo maxUsedBlock;
+  maxUsedBlock.height = max_used_block_height;
+  maxUsedBlock.id = max_used_block_id;
+  // inputs accepted inside the checkpoint zone were never checked, they must not let pushBlock skip the check later
+  if (ringSignaturesChecked) {
+    m_verifiedTransactions.add(cachedTransaction.getTransactionHash(), maxUsedBlock);
+  }
+
   return true;
 }
 
@@ -1865,24 +1928,28 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
   return false;
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
-  Crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
-}
-
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const CachedTransaction& cachedTransaction, uint32_t* pmax_used_block_height, bool checkRingSignatures, bool* pringSignaturesChecked) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
-  Crypto::Hash transactionHash = getObjectHash(tx);
+  if (pringSignaturesChecked) {
+    *pringSignaturesChecked = false;
+  }
+
+  const Transaction& tx = cachedTransaction.getTransaction();
+  const Crypto::Hash& tx_prefix_hash = cachedTransaction.getTransactionPrefixHash();
+  const Crypto::Hash& transactionHash = cachedTransaction.getTransactionHash();
+  // ring signatures of all key inputs are checked together once everything else passed
+  std::vector<std::vector<std::shared_ptr<const Crypto::RingKey>>> ringKeys;
+  std::vector<size_t> ringInputs;
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
     if (txin.type() == typeid(KeyInput)) {
 
       const KeyInput& in_to_key = boost::get<KeyInput>(txin);
-      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << getObjectHash(tx); return false; }
+      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << transactionHash; return false; }
 
       if (have_tx_keyimg_as_spent(in_to_key.keyImage)) {
         logger(DEBUGGING) <<
@@ -1891,11 +1958,17 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
       }
 
       if (!isInCheckpointZone(getCurrentBlockchainHeight())) {
-        if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+        std::vector<std::shared_ptr<const Crypto::RingKey>> inputRingKeys;
+        if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], checkRingSignatures ? &inputRingKeys : nullptr, pmax_used_block_height)) {
           logger(INFO, BRIGHT_WHITE) <<
             "Failed to check input in transaction " << transactionHash;
           return false;
         }
+
+        if (!inputRingKeys.empty()) {
+          ringKeys.push_back(std::move(inputRingKeys));
+          ringInputs.push_back(inputIndex);
+        }
       }
 
       ++inputIndex;
@@ -1913,6 +1986,32 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
     }
   }
 
+  std::vector<std::vector<const Crypto::RingKey*>> ringKeyPointers(ringKeys.size());
+  std::vector<Crypto::RingSignatureCheck> ringChecks;
+  for (size_t i = 0; i < ringKeys.size(); ++i) {
+    for (const auto& key : ringKeys[i]) {
+      ringKeyPointers[i].push_back(key.get());
+    }
+
+    const KeyInput& in_to_key = boost::get<KeyInput>(tx.inputs[ringInputs[i]]);
+    ringChecks.push_back(Crypto::RingSignatureCheck{ &tx_prefix_hash, &in_to_key.keyImage, ringKeyPointers[i].data(), ringKeys[i].size(), tx.signatures[ringInputs[i]].data() });
+  }
+
+  std::unique_ptr<bool[]> ringResults(new bool[ringChecks.size()]);
+  Crypto::check_ring_signatures(ringChecks.data(), ringChecks.size(), ringResults.get());
+  for (size_t i = 0; i < ringChecks.size(); ++i) {
+    if (!ringResults[i]) {
+      logger(ERROR) << "Failed to check ring signature for keyImage: " << *ringChecks[i].image;
+      logger(INFO, BRIGHT_WHITE) <<
+        "Failed to check input in transaction " << transactionHash;
+      return false;
+    }
+  }
+
+  if (pringSignaturesChecked) {
+    *pringSignaturesChecked = !ringChecks.empty();
+  }
+
   return true;
 }
 
@@ -1947,7 +2046,7 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t height)
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, std::vector<std::shared_ptr<const Crypto::RingKey>>* ringKeys, uint32_t* pmax_related_block_height) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   struct outputs_visitor {
@@ -1999,15 +2098,20 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
   }
 
   if (!(sig.size() == output_keys.size())) { logger(ERROR, BRIGHT_RED) << "internal error: tx signatures count=" << sig.size() << " mismatch with outputs keys count for inputs=" << output_keys.size(); return false; }
-  if (isInCheckpointZone(getCurrentBlockchainHeight())) {
+  if (ringKeys == nullptr || isInCheckpointZone(getCurrentBlockchainHeight())) {
     return true;
   }
 
-  bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
-  if (!check_tx_ring_signature) {
-    logger(ERROR) << "Failed to check ring signature for keyImage: " << txin.keyImage;
+  ringKeys->resize(output_keys.size());
+  for (size_t i = 0; i < output_keys.size(); ++i) {
+    (*ringKeys)[i] = m_ringKeyCache.get(*output_keys[i]);
+    if (!(*ringKeys)[i]) {
+      logger(ERROR) << "Invalid output key in ring for keyImage: " << txin.keyImage;
+      return false;
+    }
   }
-  return check_tx_ring_signature;
+
+  return true;
 }
 
 uint64_t Blockchain::get_adjusted_time() {
@@ -2136,13 +2240,8 @@ bool Blockchain::update_next_cumulative_size_limit() {
 }
 
 bool Blockchain::addNewBlock(const Block& bl, block_verification_context& bvc) {
-  Crypto::Hash id;
-  if (!get_block_hash(bl, id)) {
-    logger(ERROR, BRIGHT_RED) <<
-      "Failed to get block hash, possible block has invalid format";
-    bvc.m_verification_failed = true;
-    return false;
-  }
+  CachedBlock cachedBlock(bl);
+  const Crypto::Hash& id = cachedBlock.getBlockHash();
 
   bool add_result;
 
@@ -2166,7 +2265,7 @@ bool Blockchain::addNewBlock(const Block& bl, block_verification_context& bvc) {
       bvc.m_added_to_main_chain = false;
       add_result = handle_alternative_block(bl, id, bvc);
     } else {
-      add_result = pushBlock(bl, id, bvc);
+      add_result = pushBlock(cachedBlock, bvc);
       if (add_result) {
         sendMessage(BlockchainMessage(NewBlockMessage(id)));
       }
@@ -2184,14 +2283,14 @@ const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIn
   return m_blocks[index.block].transactions[index.transaction];
 }
 
-bool Blockchain::pushBlock(const Block& blockData, const Crypto::Hash& id, block_verification_context& bvc) {
-  std::vector<Transaction> transactions;
-  if (!loadTransactions(blockData, transactions)) {
+bool Blockchain::pushBlock(const CachedBlock& block, block_verification_context& bvc) {
+  std::vector<CachedTransaction> transactions;
+  if (!loadTransactions(block.getBlock(), transactions)) {
     bvc.m_verification_failed = true;
     return false;
   }
 
-  if (!pushBlock(blockData, transactions, id, bvc)) {
+  if (!pushBlock(block, transactions, bvc)) {
     saveTransactions(transactions);
     return false;
   }
@@ -2199,9 +2298,12 @@ bool Blockchain::pushBlock(const Block& blockData, const Crypto::Hash& id, block
   return true;
 }
 
-bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, const Crypto::Hash& blockHash, block_verification_context& bvc) {
+bool Blockchain::pushBlock(const CachedBlock& cachedBlock, const std::vector<CachedTransaction>& transactions, block_verification_context& bvc) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
+  const Block& blockData = cachedBlock.getBlock();
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
+
   auto blockProcessingStart = std::chrono::steady_clock::now();
 
   if (m_blockIndex.hasBlock(blockHash)) {
@@ -2289,7 +2391,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     return false;
   }
 
-  Crypto::Hash minerTransactionHash = getObjectHash(blockData.baseTransaction);
+  const Crypto::Hash& minerTransactionHash = cachedBlock.getBaseTransactionHash();
 
   BlockEntry block;
   block.bl = blockData;
@@ -2304,13 +2406,16 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
-    size_t blob_size = 0;
-    uint64_t fee = 0;
-    block.transactions.back().tx = transactions[i];
+    block.transactions.back().tx = transactions[i].getTransaction();
+
+    size_t blob_size = transactions[i].getTransactionBinarySize();
+    uint64_t fee = transactions[i].getTransactionFee();
 
-    blob_size = toBinaryArray(block.transactions.back().tx).size();
-    fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    // ring signatures proven when the transaction entered the pool stay valid while
+    // the newest block its rings use is still in the main chain
+    bool ringSignaturesChecked = m_verifiedTransactions.takeIfInChain(tx_id, static_cast<uint32_t>(m_blocks.size()),
+      [this](uint32_t height) { return getBlockIdByHeight(height); });
+    if (!checkTransactionInputs(transactions[i], nullptr, !ringSignaturesChecked)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verification_failed = true;
@@ -2350,7 +2455,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
   }
 
-  pushBlock(block, blockHash);
+  pushBlock(block, cachedBlock);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
@@ -2379,18 +2484,18 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   return true;
 }
 
-bool Blockchain::pushBlock(BlockEntry& block, const Crypto::Hash& blockHash) {
+bool Blockchain::pushBlock(BlockEntry& block, const CachedBlock& cachedBlock) {
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
   m_blocks.push_back(block);
   m_blockIndex.push(blockHash);
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
 
-  BinaryArray ba;
   const Block& blk = block.bl;
-  if (!get_block_hashing_blob(blk, ba)) {
-      logger(ERROR, BRIGHT_RED) << "Failed to get_block_hashing_blob of block " << blockHash;
-  }
-  m_blobs.push_back(ba);
+  m_blobs.push_back(cachedBlock.getBlockHashingBinaryArray());
+
+  m_blockStats.push(blk.timestamp, block.block_cumulative_size, block.cumulative_difficulty, block.already_generated_coins,
+    static_cast<uint32_t>(blk.transactionHashes.size()));
 
   assert(m_blockIndex.size() == m_blocks.size());
 
@@ -2404,9 +2509,10 @@ void Blockchain::popBlock() {
     return;
   }
 
-  std::vector<Transaction> transactions(m_blocks.back().transactions.size() - 1);
+  std::vector<CachedTransaction> transactions;
+  transactions.reserve(m_blocks.back().transactions.size() - 1);
   for (size_t i = 0; i < m_blocks.back().transactions.size() - 1; ++i) {
-    transactions[i] = m_blocks.back().transactions[1 + i].tx;
+    transactions.emplace_back(m_blocks.back().transactions[1 + i].tx);
   }
 
   saveTransactions(transactions);
@@ -2684,6 +2790,7 @@ void Blockchain::removeLastBlock() {
   m_blocks.pop_back();
   m_blockIndex.pop();
   m_blobs.pop_back();
+  m_blockStats.pop();
 
   assert(m_blockIndex.size() == m_blocks.size());
 }
@@ -2862,30 +2969,36 @@ bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
-bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions) {
-  transactions.resize(block.transactionHashes.size());
+bool Blockchain::loadTransactions(const Block& block, std::vector<CachedTransaction>& transactions) {
+  transactions.clear();
+  transactions.reserve(block.transactionHashes.size());
   size_t transactionSize;
   uint64_t fee;
   for (size_t i = 0; i < block.transactionHashes.size(); ++i) {
-    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], transactionSize, fee)) {
+    Transaction transaction;
+    if (!m_tx_pool.take_tx(block.transactionHashes[i], transaction, transactionSize, fee)) {
       tx_verification_context context;
       for (size_t j = 0; j < i; ++j) {
-        if (!m_tx_pool.add_tx(transactions[i - 1 - j], context, true)) {
+        const CachedTransaction& taken = transactions[i - 1 - j];
+        if (!m_tx_pool.add_tx(taken.getTransaction(), taken.getTransactionHash(), taken.getTransactionBinarySize(), context, true)) {
           throw std::runtime_error("Blockchain::loadTransactions, failed to add transaction to pool");
         }
       }
 
       return false;
     }
+
+    transactions.emplace_back(std::move(transaction), block.transactionHashes[i], transactionSize);
   }
 
   return true;
 }
 
-void Blockchain::saveTransactions(const std::vector<Transaction>& transactions) {
+void Blockchain::saveTransactions(const std::vector<CachedTransaction>& transactions) {
   tx_verification_context context;
   for (size_t i = 0; i < transactions.size(); ++i) {
-    if (!m_tx_pool.add_tx(transactions[transactions.size() - 1 - i], context, true)) {
+    const CachedTransaction& transaction = transactions[transactions.size() - 1 - i];
+    if (!m_tx_pool.add_tx(transaction.getTransaction(), transaction.getTransactionHash(), transaction.getTransactionBinarySize(), context, true)) {
       logger(WARNING, BRIGHT_YELLOW) << "Blockchain::saveTransactions, failed to add transaction to pool";
     }
   }
@@ -26,12 +26,17 @@
 #include "Common/Util.h"
 #include "Checkpoints/Checkpoints.h"
 #include "MevaCoinCore/BlockIndex.h"
+#include "MevaCoinCore/BlockStatsIndex.h"
+#include "MevaCoinCore/CachedBlock.h"
+#include "MevaCoinCore/CachedTransaction.h"
 #include "MevaCoinCore/Currency.h"
 #include "MevaCoinCore/IBlockchainStorageObserver.h"
 #include "MevaCoinCore/ITransactionValidator.h"
 #include "MevaCoinCore/SwappedVector.h"
 #include "MevaCoinCore/UpgradeDetector.h"
 #include "MevaCoinCore/MevaCoinFormatUtils.h"
+#include "MevaCoinCore/RingKeyCache.h"
+#include "MevaCoinCore/VerifiedTransactionCache.h"
 #include "MevaCoinCore/TransactionPool.h"
 #include "MevaCoinCore/BlockchainIndices.h"
 
@@ -117,6 +122,7 @@ namespace MevaCoin {
     uint64_t blockDifficulty(size_t i);
     uint64_t blockCumulativeDifficulty(size_t i);
     bool getblockEntry(size_t i, uint64_t& block_cumulative_size, difficulty_type& difficulty, uint64_t& already_generated_coins, uint64_t& reward, uint64_t& transactions_count, uint64_t& timestamp);
+    std::vector<BlockStatsRange> getBlockStatsRanges(uint32_t startHeight, uint32_t endHeight, uint32_t maxRanges);
     bool getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight);
     bool getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins);
     bool getBlockSize(const Crypto::Hash& hash, size_t& size);
@@ -214,6 +220,8 @@ namespace MevaCoin {
 
     bool checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork);
     bool getBlockLongHash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res);
+    // for v5+ blocks whose signed hashing blob is already serialized, pot is reused between calls
+    bool getBlockLongHash(const Block& b, const BinaryArray& signedHashingBlob, BinaryArray& pot, Crypto::Hash& res);
 
   private:
 
@@ -291,6 +299,9 @@ namespace MevaCoin {
     MultisignatureOutputsContainer m_multisignatureOutputs;
 
     hashing_blobs_container m_blobs;
+    BlockStatsIndex m_blockStats;
+    RingKeyCache m_ringKeyCache;
+    VerifiedTransactionCache m_verifiedTransactions;
 
     UpgradeDetector m_upgradeDetectorV2;
     UpgradeDetector m_upgradeDetectorV3;
@@ -314,6 +325,7 @@ namespace MevaCoin {
     bool handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage = true);
     bool checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork, const std::list<Crypto::Hash>& alt_chain, bool no_blobs = false);
     bool getBlockLongHash(Crypto::cn_context& context, const Block& b, Crypto::Hash& res, const std::list<Crypto::Hash>& alt_chain, bool no_blobs = false);
+    bool getPotLongHash(const Block& b, BinaryArray& pot, Crypto::Hash& res, const std::list<Crypto::Hash>& alt_chain, bool no_blobs);
     bool prevalidate_miner_transaction(const Block& b, uint32_t height);
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
     bool validate_block_signature(const Block& b, const Crypto::Hash& id, uint32_t height);
@@ -331,13 +343,13 @@ namespace MevaCoin {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_cumulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
+    // checks everything but the ring signature, ringKeys receives the prepared ring unless it is null or the ring does not need checking
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, std::vector<std::shared_ptr<const Crypto::RingKey>>* ringKeys, uint32_t* pmax_related_block_height = NULL);
+    bool checkTransactionInputs(const CachedTransaction& tx, uint32_t* pmax_used_block_height = NULL, bool checkRingSignatures = true, bool* pringSignaturesChecked = NULL);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
-    bool pushBlock(const Block& blockData, const Crypto::Hash& id, block_verification_context& bvc);
-    bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, const Crypto::Hash& blockHash, block_verification_context& bvc);
-    bool pushBlock(BlockEntry& block, const Crypto::Hash& blockHash);
+    bool pushBlock(const CachedBlock& block, block_verification_context& bvc);
+    bool pushBlock(const CachedBlock& cachedBlock, const std::vector<CachedTransaction>& transactions, block_verification_context& bvc);
+    bool pushBlock(BlockEntry& block, const CachedBlock& cachedBlock);
     void popBlock();
     bool pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex);
     void popTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash);
@@ -350,8 +362,8 @@ namespace MevaCoin {
     bool storeBlockchainIndices();
     bool loadBlockchainIndices();
 
-    bool loadTransactions(const Block& block, std::vector<Transaction>& transactions);
-    void saveTransactions(const std::vector<Transaction>& transactions);
+    bool loadTransactions(const Block& block, std::vector<CachedTransaction>& transactions);
+    void saveTransactions(const std::vector<CachedTransaction>& transactions);
 
     void sendMessage(const BlockchainMessage& message);
 
@@ -0,0 +1,86 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "CachedBlock.h"
+
+#include "Common/Varint.h"
+#include "MevaCoinConfig.h"
+#include "MevaCoinFormatUtils.h"
+#include "MevaCoinTools.h"
+
+namespace MevaCoin {
+
+CachedBlock::CachedBlock(const Block& block) : m_block(block) {
+}
+
+const Block& CachedBlock::getBlock() const {
+  return m_block;
+}
+
+const Crypto::Hash& CachedBlock::getBlockHash() const {
+  if (!m_blockHash.is_initialized()) {
+    BinaryArray blob = getBlockHashingBinaryArray();
+
+    // The header of block version 1 differs from headers of blocks starting from v.2
+    if (BLOCK_MAJOR_VERSION_2 == m_block.majorVersion || BLOCK_MAJOR_VERSION_3 == m_block.majorVersion) {
+      BinaryArray parentBlob;
+      auto serializer = makeParentBlockSerializer(m_block, true, false);
+      toBinaryArray(serializer, parentBlob);
+      blob.insert(blob.end(), parentBlob.begin(), parentBlob.end());
+    }
+
+    m_blockHash = getObjectHash(blob);
+  }
+
+  return m_blockHash.get();
+}
+
+const BinaryArray& CachedBlock::getBlockHashingBinaryArray() const {
+  if (!m_blockHashingBinaryArray.is_initialized()) {
+    BinaryArray blob = toBinaryArray(static_cast<const BlockHeader&>(m_block));
+    const Crypto::Hash& treeHash = getTransactionTreeHash();
+    blob.insert(blob.end(), treeHash.data, treeHash.data + sizeof(treeHash));
+    auto transactionCount = Common::asBinaryArray(Tools::get_varint_data(m_block.transactionHashes.size() + 1));
+    blob.insert(blob.end(), transactionCount.begin(), transactionCount.end());
+    m_blockHashingBinaryArray = std::move(blob);
+  }
+
+  return m_blockHashingBinaryArray.get();
+}
+
+const Crypto::Hash& CachedBlock::getTransactionTreeHash() const {
+  if (!m_transactionTreeHash.is_initialized()) {
+    std::vector<Crypto::Hash> transactionHashes;
+    transactionHashes.reserve(m_block.transactionHashes.size() + 1);
+    transactionHashes.push_back(getBaseTransactionHash());
+    transactionHashes.insert(transactionHashes.end(), m_block.transactionHashes.begin(), m_block.transactionHashes.end());
+    m_transactionTreeHash = get_tx_tree_hash(transactionHashes);
+  }
+
+  return m_transactionTreeHash.get();
+}
+
+const Crypto::Hash& CachedBlock::getBaseTransactionHash() const {
+  if (!m_baseTransactionHash.is_initialized()) {
+    m_baseTransactionHash = getObjectHash(m_block.baseTransaction);
+  }
+
+  return m_baseTransactionHash.get();
+}
+
+}
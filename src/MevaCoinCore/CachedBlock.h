@@ -0,0 +1,48 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include "MevaCoinCore/MevaCoinBasic.h"
+
+namespace MevaCoin {
+
+// A block with the hashes and hashing blob derived from it, each computed on
+// first use and kept; the base transaction is serialized once for all of them.
+class CachedBlock {
+public:
+  explicit CachedBlock(const Block& block);
+
+  const Block& getBlock() const;
+  const Crypto::Hash& getBlockHash() const;
+  // the blob miners hash, also kept by the chain for fast mining
+  const BinaryArray& getBlockHashingBinaryArray() const;
+  const Crypto::Hash& getTransactionTreeHash() const;
+  const Crypto::Hash& getBaseTransactionHash() const;
+
+private:
+  Block m_block;
+  mutable boost::optional<BinaryArray> m_blockHashingBinaryArray;
+  mutable boost::optional<Crypto::Hash> m_blockHash;
+  mutable boost::optional<Crypto::Hash> m_transactionTreeHash;
+  mutable boost::optional<Crypto::Hash> m_baseTransactionHash;
+};
+
+}
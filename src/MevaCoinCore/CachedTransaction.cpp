@@ -0,0 +1,79 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "CachedTransaction.h"
+
+#include "MevaCoinTools.h"
+
+namespace MevaCoin {
+
+CachedTransaction::CachedTransaction(Transaction&& transaction) : m_transaction(std::move(transaction)) {
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction) : m_transaction(transaction) {
+}
+
+CachedTransaction::CachedTransaction(Transaction&& transaction, const Crypto::Hash& transactionHash, size_t transactionBinarySize) :
+  m_transaction(std::move(transaction)), m_transactionHash(transactionHash), m_transactionBinarySize(transactionBinarySize) {
+}
+
+const Transaction& CachedTransaction::getTransaction() const {
+  return m_transaction;
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionHash() const {
+  if (!m_transactionHash.is_initialized()) {
+    m_transactionHash = getBinaryArrayHash(getTransactionBinaryArray());
+  }
+
+  return m_transactionHash.get();
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionPrefixHash() const {
+  if (!m_transactionPrefixHash.is_initialized()) {
+    m_transactionPrefixHash = getObjectHash(static_cast<const TransactionPrefix&>(m_transaction));
+  }
+
+  return m_transactionPrefixHash.get();
+}
+
+const BinaryArray& CachedTransaction::getTransactionBinaryArray() const {
+  if (!m_transactionBinaryArray.is_initialized()) {
+    m_transactionBinaryArray = toBinaryArray(m_transaction);
+  }
+
+  return m_transactionBinaryArray.get();
+}
+
+size_t CachedTransaction::getTransactionBinarySize() const {
+  if (!m_transactionBinarySize.is_initialized()) {
+    m_transactionBinarySize = getTransactionBinaryArray().size();
+  }
+
+  return m_transactionBinarySize.get();
+}
+
+uint64_t CachedTransaction::getTransactionFee() const {
+  if (!m_transactionFee.is_initialized()) {
+    m_transactionFee = getInputAmount(m_transaction) - getOutputAmount(m_transaction);
+  }
+
+  return m_transactionFee.get();
+}
+
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include "MevaCoinCore/MevaCoinBasic.h"
+
+namespace MevaCoin {
+
+// A transaction with its blob, hashes and fee, each computed on first use and
+// kept, so a transaction passed along the pool and the chain is serialized and
+// hashed once instead of at every step.
+class CachedTransaction {
+public:
+  explicit CachedTransaction(Transaction&& transaction);
+  explicit CachedTransaction(const Transaction& transaction);
+  // for transactions whose hash and blob size are already known, e.g. from the pool
+  CachedTransaction(Transaction&& transaction, const Crypto::Hash& transactionHash, size_t transactionBinarySize);
+
+  const Transaction& getTransaction() const;
+  const Crypto::Hash& getTransactionHash() const;
+  const Crypto::Hash& getTransactionPrefixHash() const;
+  const BinaryArray& getTransactionBinaryArray() const;
+  size_t getTransactionBinarySize() const;
+  // inputs minus outputs, meaningless for a coinbase transaction
+  uint64_t getTransactionFee() const;
+
+private:
+  Transaction m_transaction;
+  mutable boost::optional<BinaryArray> m_transactionBinaryArray;
+  mutable boost::optional<Crypto::Hash> m_transactionHash;
+  mutable boost::optional<Crypto::Hash> m_transactionPrefixHash;
+  mutable boost::optional<size_t> m_transactionBinarySize;
+  mutable boost::optional<uint64_t> m_transactionFee;
+};
+
+}
@@ -172,6 +172,10 @@ bool Core::getblockEntry(uint32_t height, uint64_t& block_cumulative_size, diffi
   return m_blockchain.getblockEntry(static_cast<size_t>(height), block_cumulative_size, difficulty, already_generated_coins, reward, transactions_count, timestamp);
 }
 
+std::vector<BlockStatsRange> Core::getBlockStatsRanges(uint32_t startHeight, uint32_t endHeight, uint32_t maxRanges) {
+  return m_blockchain.getBlockStatsRanges(startHeight, endHeight, maxRanges);
+}
+
 std::time_t Core::getStartTime() const {
   return start_time;
 }
@@ -866,6 +870,10 @@ bool Core::getBlockLongHash(Crypto::cn_context &context, const Block& b, Crypto:
   return m_blockchain.getBlockLongHash(context, b, res);
 }
 
+bool Core::getBlockLongHash(const Block& b, const BinaryArray& signedHashingBlob, BinaryArray& scratch, Crypto::Hash& res) {
+  return m_blockchain.getBlockLongHash(b, signedHashingBlob, scratch, res);
+}
+
 //void Core::get_all_known_block_ids(std::list<Crypto::Hash> &main, std::list<Crypto::Hash> &alt, std::list<Crypto::Hash> &invalid) {
 //  m_blockchain.get_all_known_block_ids(main, alt, invalid);
 //}
@@ -60,6 +60,7 @@ namespace MevaCoin {
      virtual bool handle_block_found(Block& b) override;
      virtual bool get_block_template(Block& b, const AccountKeys& acc, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) override;
      virtual bool getBlockLongHash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res) override;
+     virtual bool getBlockLongHash(const Block& b, const BinaryArray& signedHashingBlob, BinaryArray& scratch, Crypto::Hash& res) override;
 
      bool addObserver(ICoreObserver* observer) override;
      bool removeObserver(ICoreObserver* observer) override;
@@ -150,6 +151,7 @@ namespace MevaCoin {
        uint32_t& totalBlockCount, uint32_t& startBlockIndex) override;
      bool get_stat_info(core_stat_info& st_inf) override;
      virtual bool getblockEntry(uint32_t height, uint64_t& block_cumulative_size, difficulty_type& difficulty, uint64_t& already_generated_coins, uint64_t& reward, uint64_t& transactions_count, uint64_t& timestamp) override;
+     std::vector<BlockStatsRange> getBlockStatsRanges(uint32_t startHeight, uint32_t endHeight, uint32_t maxRanges);
 
      virtual bool get_tx_outputs_gindexs(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) override;
      Crypto::Hash get_tail_id();
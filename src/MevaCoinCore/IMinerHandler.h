@@ -25,6 +25,8 @@ namespace MevaCoin {
     virtual bool handle_block_found(Block& b) = 0;
     virtual bool get_block_template(Block& b, const AccountKeys& acc, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) = 0;
     virtual bool getBlockLongHash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res) = 0;
+    // v5+ long hash from an already signed hashing blob, scratch keeps its capacity between calls
+    virtual bool getBlockLongHash(const Block& b, const BinaryArray& signedHashingBlob, BinaryArray& scratch, Crypto::Hash& res) = 0;
 
   protected:
     ~IMinerHandler(){};
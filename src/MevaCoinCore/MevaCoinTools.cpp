@@ -43,6 +43,20 @@ Crypto::Hash getBinaryArrayHash(const BinaryArray& binaryArray) {
   return hash;
 }
 
+void getBinaryArrayHashes(const std::vector<BinaryArray>& binaryArrays, std::vector<Crypto::Hash>& hashes) {
+  std::vector<const void*> data;
+  std::vector<size_t> lengths;
+  data.reserve(binaryArrays.size());
+  lengths.reserve(binaryArrays.size());
+  for (const BinaryArray& binaryArray : binaryArrays) {
+    data.push_back(binaryArray.data());
+    lengths.push_back(binaryArray.size());
+  }
+
+  hashes.resize(binaryArrays.size());
+  Crypto::cn_fast_hash_multi(data.data(), lengths.data(), binaryArrays.size(), hashes.data());
+}
+
 uint64_t getInputAmount(const Transaction& transaction) {
   uint64_t amount = 0;
   for (auto& input : transaction.inputs) {
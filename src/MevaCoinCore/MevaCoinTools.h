@@ -29,6 +29,8 @@ namespace MevaCoin {
 
 void getBinaryArrayHash(const BinaryArray& binaryArray, Crypto::Hash& hash);
 Crypto::Hash getBinaryArrayHash(const BinaryArray& binaryArray);
+// hashes independent arrays together, which is several times faster than one by one
+void getBinaryArrayHashes(const std::vector<BinaryArray>& binaryArrays, std::vector<Crypto::Hash>& hashes);
 
 template<class T>
 bool toBinaryArray(const T& object, BinaryArray& binaryArray) {
@@ -18,6 +18,7 @@
 
 #include "Miner.h"
 
+#include <cstring>
 #include <future>
 #include <numeric>
 #include <sstream>
@@ -37,6 +38,7 @@
 #include "Serialization/SerializationTools.h"
 
 #include "MevaCoinFormatUtils.h"
+#include "MevaCoinTools.h"
 #include "TransactionExtra.h"
 
 using namespace Logging;
@@ -48,9 +50,7 @@ namespace MevaCoin
     m_currency(currency),
     logger(log, "miner"),
     m_stop(true),
-    m_template(boost::value_initialized<Block>()),
     m_template_no(0),
-    m_diffic(0),
     m_handler(handler),
     m_pausers_count(0),
     m_threads_total(0),
@@ -72,29 +72,74 @@ namespace MevaCoin
   }
   //-----------------------------------------------------------------------------------------------------
   bool miner::set_block_template(const Block& bl, const difficulty_type& di) {
-    std::lock_guard<decltype(m_template_lock)> lk(m_template_lock);
-
-    m_template = bl;
+    Block block = bl;
 
-    if (m_template.majorVersion == BLOCK_MAJOR_VERSION_2 || m_template.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    if (block.majorVersion == BLOCK_MAJOR_VERSION_2 || block.majorVersion == BLOCK_MAJOR_VERSION_3) {
       MevaCoin::TransactionExtraMergeMiningTag mm_tag;
       mm_tag.depth = 0;
-      if (!MevaCoin::get_aux_block_header_hash(m_template, mm_tag.merkleRoot)) {
+      if (!MevaCoin::get_aux_block_header_hash(block, mm_tag.merkleRoot)) {
         return false;
       }
 
-      m_template.parentBlock.baseTransaction.extra.clear();
-      if (!MevaCoin::appendMergeMiningTagToExtra(m_template.parentBlock.baseTransaction.extra, mm_tag)) {
+      block.parentBlock.baseTransaction.extra.clear();
+      if (!MevaCoin::appendMergeMiningTagToExtra(block.parentBlock.baseTransaction.extra, mm_tag)) {
         return false;
       }
     }
 
-    m_diffic = di;
+    auto context = make_mining_context(block, di);
+    if (!context) {
+      return false;
+    }
+
+    std::lock_guard<decltype(m_template_lock)> lk(m_template_lock);
+    m_context = std::move(context);
     ++m_template_no;
     m_starter_nonce = Random::randomValue<uint32_t>();
     return true;
   }
   //-----------------------------------------------------------------------------------------------------
+  std::shared_ptr<const miner::mining_context> miner::make_mining_context(const Block& bl, const difficulty_type& diffic) const {
+    auto context = std::make_shared<mining_context>();
+    context->block = bl;
+    context->difficulty = diffic;
+    context->nonce_offset = 0;
+    context->unsigned_blob_size = 0;
+    context->eph_keys_valid = false;
+
+    if (bl.majorVersion < BLOCK_MAJOR_VERSION_5) {
+      return context;
+    }
+
+    BinaryArray header;
+    if (!toBinaryArray(static_cast<const BlockHeader&>(bl), header) || !get_block_hashing_blob(bl, context->hashing_blob)) {
+      logger(ERROR) << "get_block_hashing_blob for signature failed.";
+      return nullptr;
+    }
+
+    // the nonce is the last field of the header, which starts the hashing blob
+    context->nonce_offset = header.size() - sizeof(bl.nonce);
+    context->unsigned_blob_size = context->hashing_blob.size();
+    context->hashing_blob.resize(context->unsigned_blob_size + sizeof(Crypto::Signature));
+
+    try {
+      Crypto::PublicKey txPublicKey = getTransactionPublicKeyFromExtra(bl.baseTransaction.extra);
+      Crypto::KeyDerivation derivation;
+      if (Crypto::generate_key_derivation(txPublicKey, m_mine_account.viewSecretKey, derivation)) {
+        Crypto::derive_secret_key(derivation, 0, m_mine_account.spendSecretKey, context->eph_sec_key);
+        context->eph_pub_key = boost::get<KeyOutput>(bl.baseTransaction.outputs[0].target).key;
+        context->eph_keys_valid = true;
+      } else {
+        logger(WARNING) << "failed to generate_key_derivation for block signature";
+      }
+    }
+    catch (std::exception& e) {
+      logger(WARNING) << "Signing block failed: " << e.what();
+    }
+
+    return context;
+  }
+  //-----------------------------------------------------------------------------------------------------
   bool miner::on_block_chain_update() {
     if (!is_mining()) {
       return true;
@@ -404,10 +449,15 @@ namespace MevaCoin
   bool miner::worker_thread(uint32_t th_local_index)
   {
     logger(INFO) << "Miner thread was started ["<< th_local_index << "]";
+    if (Crypto::y_slow_hash_prepare()) {
+      logger(INFO) << "Miner thread [" << th_local_index << "] scratchpad: " << Crypto::thread_scratchpad_report();
+    }
     uint32_t nonce = m_starter_nonce + th_local_index;
-    difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     Crypto::cn_context context;
+    std::shared_ptr<const mining_context> mc;
+    BinaryArray hashing_blob;
+    BinaryArray pot;
     Block b;
 
     while(!m_stop)
@@ -420,15 +470,18 @@ namespace MevaCoin
 
       if(local_template_ver != m_template_no) {
         std::unique_lock<std::mutex> lk(m_template_lock);
-        b = m_template;
-        local_diff = m_diffic;
+        mc = m_context;
+        local_template_ver = m_template_no;
         lk.unlock();
 
-        local_template_ver = m_template_no;
+        if (mc) {
+          b = mc->block;
+          hashing_blob = mc->hashing_blob;
+        }
         nonce = m_starter_nonce + th_local_index;
       }
 
-      if(!local_template_ver)//no any set_block_template call
+      if(!mc)//no any set_block_template call
       {
         logger(TRACE) << "Block template not set yet";
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
@@ -437,43 +490,30 @@ namespace MevaCoin
 
       b.nonce = nonce;
 
-      // step 1: sing the block
+      Crypto::Hash pow;
       if (b.majorVersion >= MevaCoin::BLOCK_MAJOR_VERSION_5) {
-        BinaryArray ba;
-        if (!get_block_hashing_blob(b, ba)) {
-          logger(ERROR) << "get_block_hashing_blob for signature failed.";
+        if (!mc->eph_keys_valid) {
           m_stop = true;
+          continue;
         }
-        Crypto::Hash h = Crypto::cn_fast_hash(ba.data(), ba.size());
-        try {
-          Crypto::PublicKey txPublicKey = getTransactionPublicKeyFromExtra(b.baseTransaction.extra);
-          Crypto::KeyDerivation derivation;
-          if (!Crypto::generate_key_derivation(txPublicKey, m_mine_account.viewSecretKey, derivation)) {
-            logger(WARNING) << "failed to generate_key_derivation for block signature";
-            m_stop = true;
-          }
-          Crypto::SecretKey ephSecKey;
-          Crypto::derive_secret_key(derivation, 0, m_mine_account.spendSecretKey, ephSecKey);
-          Crypto::PublicKey ephPubKey = boost::get<KeyOutput>(b.baseTransaction.outputs[0].target).key;
 
-          Crypto::generate_signature(h, ephPubKey, ephSecKey, b.signature);
-        }
-        catch (std::exception& e) {
-          logger(WARNING) << "Signing block failed: " << e.what();
-          m_stop = true;
-        }
-      }
+        // step 1: sign the block, only the nonce changed in the hashing blob
+        std::memcpy(hashing_blob.data() + mc->nonce_offset, &nonce, sizeof(nonce));
+        Crypto::Hash h = Crypto::cn_fast_hash(hashing_blob.data(), mc->unsigned_blob_size);
+        Crypto::generate_signature(h, mc->eph_pub_key, mc->eph_sec_key, b.signature);
+        std::memcpy(hashing_blob.data() + mc->unsigned_blob_size, &b.signature, sizeof(b.signature));
 
-      // step 2: get long hash
-      Crypto::Hash pow;
-      if (!m_stop) {
-        if (!m_handler.getBlockLongHash(context, b, pow)) {
+        // step 2: get long hash
+        if (!m_handler.getBlockLongHash(b, hashing_blob, pot, pow)) {
           logger(ERROR) << "getBlockLongHash failed.";
           m_stop = true;
         }
+      } else if (!m_handler.getBlockLongHash(context, b, pow)) {
+        logger(ERROR) << "getBlockLongHash failed.";
+        m_stop = true;
       }
 
-      if (!m_stop && check_hash(pow, local_diff)) {
+      if (!m_stop && check_hash(pow, mc->difficulty)) {
         // we lucky!
         ++m_config.current_extra_message_index;
 
@@ -485,7 +525,7 @@ namespace MevaCoin
         }
 
         logger(INFO, GREEN) << "Found block for difficulty "
-                            << local_diff
+                            << mc->difficulty
                             << " at height " << bh
                             << " v. " << (int)b.majorVersion << "\r\n"
                             << "POW: " << Common::podToHex(pow) << "\r\n"
@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -57,6 +58,20 @@ namespace MevaCoin {
     void do_print_hashrate(bool do_hr);
 
   private:
+    // Everything about a block template that does not change with the nonce
+    struct mining_context
+    {
+      Block block;
+      difficulty_type difficulty;
+      BinaryArray hashing_blob; // v5+: the hashing blob followed by room for the signature
+      size_t nonce_offset;
+      size_t unsigned_blob_size;
+      Crypto::PublicKey eph_pub_key;
+      Crypto::SecretKey eph_sec_key;
+      bool eph_keys_valid;
+    };
+
+    std::shared_ptr<const mining_context> make_mining_context(const Block& bl, const difficulty_type& diffic) const;
     bool worker_thread(uint32_t th_local_index);
     bool request_block_template();
     void merge_hr(bool do_log = false);
@@ -74,10 +89,9 @@ namespace MevaCoin {
 
     std::atomic<bool> m_stop;
     std::mutex m_template_lock;
-    Block m_template;
+    std::shared_ptr<const mining_context> m_context;
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
-    difficulty_type m_diffic;
 
     std::atomic<uint32_t> m_threads_total;
     std::atomic<int32_t> m_pausers_count;
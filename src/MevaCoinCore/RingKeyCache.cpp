@@ -0,0 +1,86 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "RingKeyCache.h"
+
+#include <algorithm>
+
+namespace MevaCoin {
+
+RingKeyCache::RingKeyCache(size_t capacity) : m_shardCapacity(std::max<size_t>(1, capacity / SHARD_COUNT)) {
+}
+
+std::shared_ptr<const Crypto::RingKey> RingKeyCache::get(const Crypto::PublicKey& key) {
+  Shard& shard = shardFor(key);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      return it->second->second;
+    }
+  }
+
+  // preparing takes two square roots, don't hold the shard meanwhile
+  auto prepared = std::make_shared<Crypto::RingKey>();
+  if (!Crypto::prepare_ring_key(key, *prepared)) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto inserted = shard.index.emplace(key, shard.entries.end());
+  if (!inserted.second) {
+    // another thread got there first
+    shard.entries.splice(shard.entries.begin(), shard.entries, inserted.first->second);
+    return inserted.first->second->second;
+  }
+
+  shard.entries.emplace_front(key, std::move(prepared));
+  inserted.first->second = shard.entries.begin();
+  if (shard.entries.size() > m_shardCapacity) {
+    shard.index.erase(shard.entries.back().first);
+    shard.entries.pop_back();
+  }
+
+  return shard.entries.front().second;
+}
+
+size_t RingKeyCache::size() const {
+  size_t result = 0;
+  for (const Shard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    result += shard.entries.size();
+  }
+
+  return result;
+}
+
+void RingKeyCache::clear() {
+  for (Shard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.clear();
+    shard.index.clear();
+  }
+}
+
+RingKeyCache::Shard& RingKeyCache::shardFor(const Crypto::PublicKey& key) {
+  // output keys are uniformly distributed already
+  return m_shards[key.data[0] % SHARD_COUNT];
+}
+
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace MevaCoin {
+
+// Prepared ring members (the decompressed output key and its hash_to_ec point)
+// of the most recently checked rings. Popular decoys show up in many rings, and
+// the same transaction is checked again when its block arrives, so most members
+// are prepared only once. An entry depends on nothing but the key, so it never
+// needs invalidating. Safe to use from several threads at once.
+class RingKeyCache {
+public:
+  explicit RingKeyCache(size_t capacity);
+
+  // Returns nullptr if the key is not a valid point
+  std::shared_ptr<const Crypto::RingKey> get(const Crypto::PublicKey& key);
+
+  size_t size() const;
+  void clear();
+
+private:
+  static const size_t SHARD_COUNT = 16;
+
+  typedef std::list<std::pair<Crypto::PublicKey, std::shared_ptr<const Crypto::RingKey>>> Entries;
+
+  // Least recently used entries are at the back
+  struct Shard {
+    mutable std::mutex mutex;
+    Entries entries;
+    std::unordered_map<Crypto::PublicKey, Entries::iterator> index;
+  };
+
+  Shard& shardFor(const Crypto::PublicKey& key);
+
+  size_t m_shardCapacity;
+  std::array<Shard, SHARD_COUNT> m_shards;
+};
+
+}
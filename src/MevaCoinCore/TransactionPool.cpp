@@ -425,7 +425,7 @@ namespace MevaCoin {
       }
 
       tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
-      if (!m_core.check_tx_fee(txd.tx, getObjectHash(txd.tx), txd.blobSize, tvc, m_core.getCurrentBlockchainHeight())) {
+      if (!m_core.check_tx_fee(txd.tx, txd.id, txd.blobSize, tvc, m_core.getCurrentBlockchainHeight())) {
         logger(DEBUGGING) << "Transaction " << txd.id << " not included to block template because fee is insufficient";
         continue;
       }
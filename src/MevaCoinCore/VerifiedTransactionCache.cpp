@@ -0,0 +1,67 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "VerifiedTransactionCache.h"
+
+namespace MevaCoin {
+
+VerifiedTransactionCache::VerifiedTransactionCache(size_t capacity) : m_capacity(capacity) {
+}
+
+void VerifiedTransactionCache::add(const Crypto::Hash& transactionHash, const BlockInfo& maxUsedBlock) {
+  auto it = m_transactions.find(transactionHash);
+  if (it != m_transactions.end()) {
+    it->second.maxUsedBlock = maxUsedBlock;
+    return;
+  }
+
+  auto order = m_order.insert(m_order.end(), transactionHash);
+  m_transactions.emplace(transactionHash, Entry{ maxUsedBlock, order });
+  while (m_order.size() > m_capacity) {
+    m_transactions.erase(m_order.front());
+    m_order.pop_front();
+  }
+}
+
+bool VerifiedTransactionCache::take(const Crypto::Hash& transactionHash, BlockInfo& maxUsedBlock) {
+  auto it = m_transactions.find(transactionHash);
+  if (it == m_transactions.end()) {
+    return false;
+  }
+
+  maxUsedBlock = it->second.maxUsedBlock;
+  m_order.erase(it->second.order);
+  m_transactions.erase(it);
+  return true;
+}
+
+bool VerifiedTransactionCache::takeIfInChain(const Crypto::Hash& transactionHash, uint32_t chainSize, const std::function<Crypto::Hash(uint32_t)>& blockIdByHeight) {
+  BlockInfo maxUsedBlock;
+  return take(transactionHash, maxUsedBlock) && maxUsedBlock.height < chainSize && blockIdByHeight(maxUsedBlock.height) == maxUsedBlock.id;
+}
+
+size_t VerifiedTransactionCache::size() const {
+  return m_transactions.size();
+}
+
+void VerifiedTransactionCache::clear() {
+  m_transactions.clear();
+  m_order.clear();
+}
+
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "MevaCoinCore/ITransactionValidator.h"
+
+namespace MevaCoin {
+
+// Transactions whose ring signatures passed when they entered the pool, with
+// the newest block their rings reference. As long as that block stays in the
+// main chain the rings resolve to the same outputs, so the signatures need no
+// second check when the transaction arrives in a block. Not thread safe.
+class VerifiedTransactionCache {
+public:
+  explicit VerifiedTransactionCache(size_t capacity);
+
+  void add(const Crypto::Hash& transactionHash, const BlockInfo& maxUsedBlock);
+  // Removes the entry of the transaction, returns false if there is none
+  bool take(const Crypto::Hash& transactionHash, BlockInfo& maxUsedBlock);
+  // Removes the entry of the transaction, returns true if there was one and its block
+  // is still the block at that height of a chain of chainSize blocks
+  bool takeIfInChain(const Crypto::Hash& transactionHash, uint32_t chainSize, const std::function<Crypto::Hash(uint32_t)>& blockIdByHeight);
+
+  size_t size() const;
+  void clear();
+
+private:
+  struct Entry {
+    BlockInfo maxUsedBlock;
+    std::list<Crypto::Hash>::iterator order;
+  };
+
+  size_t m_capacity;
+  std::unordered_map<Crypto::Hash, Entry> m_transactions;
+  // oldest first
+  std::list<Crypto::Hash> m_order;
+};
+
+}
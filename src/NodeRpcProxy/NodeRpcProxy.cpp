@@ -24,6 +24,7 @@
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <HTTP/HttpCompression.h>
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
 #include <System/ContextGroup.h>
@@ -33,6 +34,7 @@
 #include <System/Timer.h>
 #include <MevaCoinCore/TransactionApi.h>
 #include <Common/FormatTools.h>
+#include <Common/ScopeExit.h>
 #include <Common/StringTools.h>
 #include <MevaCoinCore/MevaCoinBasicImpl.h>
 #include <MevaCoinCore/MevaCoinFormatUtils.h>
@@ -62,6 +64,32 @@ std::error_code interpretResponseStatus(const std::string& status) {
   return std::error_code();
 }
 
+// how long the daemon may hold a wait_for_changes request
+const uint32_t LONG_POLL_TIMEOUT = 30000;
+// how long to poll at the regular interval after the daemon refused a long-poll as busy
+const std::chrono::seconds LONG_POLL_BUSY_BACKOFF(30);
+
+// upper bound for a decompressed response, guards against compression bombs
+const size_t MAX_DECOMPRESSED_RESPONSE_SIZE = 512 * 1024 * 1024;
+
+std::string decodeResponseBody(const httplib::Response& rsp) {
+  HttpContentEncoding encoding;
+  if (!parseContentEncoding(rsp.get_header_value("Content-Encoding"), encoding)) {
+    throw std::runtime_error("Unsupported response content encoding");
+  }
+
+  if (encoding == HttpContentEncoding::Identity) {
+    return rsp.body;
+  }
+
+  std::string body;
+  if (!decompressHttpContent(rsp.body, encoding, body, MAX_DECOMPRESSED_RESPONSE_SIZE)) {
+    throw std::runtime_error("Failed to decompress response");
+  }
+
+  return body;
+}
+
 }
 
 NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort, const std::string &daemon_path, const bool &daemon_ssl) :
@@ -95,6 +123,9 @@ NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort,
   std::stringstream userAgent;
   userAgent << "NodeRpcProxy";
   m_requestHeaders = { {"User-Agent", userAgent.str()}, { "Connection", "keep-alive" } };
+  if (isHttpCompressionSupported()) {
+    m_requestHeaders.emplace("Accept-Encoding", "gzip, deflate");
+  }
 
   resetInternalState();
 }
@@ -131,6 +162,7 @@ void NodeRpcProxy::resetInternalState() {
   lastLocalBlockHeaderInfo.difficulty = 0;
   lastLocalBlockHeaderInfo.reward = 0;
   m_knownTxs.clear();
+  m_pushedChangesAvailable = false;
 }
 
 void NodeRpcProxy::init(const INode::Callback& callback) {
@@ -165,6 +197,9 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    if (m_changesEvent != nullptr) {
+      m_changesEvent->set();
+    }
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -188,9 +223,13 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     m_httpClient->enable_server_certificate_verification(false);
     m_httpClient->set_connection_timeout(1000);
     m_httpClient->set_keep_alive(true);
+    // responses are decoded in place, httplib itself is built without zlib
+    m_httpClient->set_decompress(false);
     Event httpEvent(dispatcher);
     m_httpEvent = &httpEvent;
     m_httpEvent->set();
+    Event changesEvent(dispatcher);
+    m_changesEvent = &changesEvent;
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -201,17 +240,26 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
+    {
+      std::lock_guard<std::mutex> lock(m_watcherMutex);
+      m_watcherStop = false;
+    }
+    m_watcherThread = std::thread([this] { watchNodeChanges(); });
+    Tools::ScopeExit watcherGuard([this] { stopWatchingNodeChanges(); });
+
     contextGroup.spawn([this]() {
-      Timer pullTimer(*m_dispatcher);
       while (!m_stop) {
         updateNodeStatus();
+        publishWatchedState();
         if (!m_stop) {
-          pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+          m_changesEvent->wait();
+          m_changesEvent->clear();
         }
       }
     });
 
     contextGroup.wait();
+    stopWatchingNodeChanges();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
   } catch (std::exception&) {
@@ -221,11 +269,163 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
   m_context_group = nullptr;
   m_httpClient = nullptr;
   m_httpEvent = nullptr;
+  m_changesEvent = nullptr;
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
 
+void NodeRpcProxy::watchNodeChanges() {
+  httplib::Client httpClient(m_node_url);
+  httpClient.enable_server_certificate_verification(false);
+  httpClient.set_connection_timeout(1000);
+  httpClient.set_read_timeout(std::chrono::milliseconds(LONG_POLL_TIMEOUT + m_rpcTimeout));
+  httpClient.set_keep_alive(true);
+  httpClient.set_decompress(false);
+
+  {
+    std::lock_guard<std::mutex> lock(m_watcherMutex);
+    if (m_watcherStop) {
+      return;
+    }
+    m_watcherClient = &httpClient;
+  }
+
+  COMMAND_RPC_WAIT_FOR_CHANGES::request req = AUTO_VAL_INIT(req);
+  req.timeout = LONG_POLL_TIMEOUT;
+  std::string rpc_url = m_daemon_path + "wait_for_changes.bin";
+  bool longPollSupported = true;
+  std::chrono::steady_clock::time_point busyUntil;
+  uint64_t servedRevision = 0;
+
+  for (;;) {
+    uint64_t revision;
+    {
+      // wait for the update loop to take in the previous answer, the next request asks about what it knows now
+      std::unique_lock<std::mutex> lock(m_watcherMutex);
+      m_watcherCv.wait_for(lock, std::chrono::milliseconds(m_pullInterval), [&] { return m_watcherStop || m_watchedRevision != servedRevision; });
+      if (m_watcherStop) {
+        m_watcherClient = nullptr;
+        break;
+      }
+
+      revision = m_watchedRevision;
+      req.tailBlockId = m_watchedTailBlock;
+      req.knownTxsIds = m_watchedKnownTxs;
+    }
+
+    bool pollAnswered = false;
+    if (longPollSupported && std::chrono::steady_clock::now() >= busyUntil) {
+      try {
+        const auto rsp = httpClient.Post(rpc_url.c_str(), m_requestHeaders, storeToBinaryKeyValue(req), "application/octet-stream");
+        if (rsp && rsp->status == 404) {
+          // older daemon, keep polling at the regular interval
+          longPollSupported = false;
+        } else if (rsp && rsp->status == 200) {
+          COMMAND_RPC_WAIT_FOR_CHANGES::response res = AUTO_VAL_INIT(res);
+          if (loadFromBinaryKeyValue(res, decodeResponseBody(*rsp))) {
+            if (res.status == CORE_RPC_STATUS_OK) {
+              std::lock_guard<std::mutex> lock(m_watcherMutex);
+              m_pushedChanges = std::move(res);
+              m_pushedRevision = revision;
+              m_pushedChangesAvailable = true;
+              pollAnswered = true;
+            } else if (res.status == CORE_RPC_STATUS_BUSY) {
+              // retrying at once would add a request per interval on top of the regular polling
+              busyUntil = std::chrono::steady_clock::now() + LONG_POLL_BUSY_BACKOFF;
+            }
+          }
+        }
+      } catch (const std::exception&) {
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(m_watcherMutex);
+    if (!pollAnswered) {
+      m_watcherCv.wait_for(lock, std::chrono::milliseconds(m_pullInterval), [this] { return m_watcherStop; });
+    }
+
+    if (m_watcherStop) {
+      m_watcherClient = nullptr;
+      break;
+    }
+
+    servedRevision = revision;
+    lock.unlock();
+
+    // a timed out wait still triggers an update, it refreshes the node info
+    m_dispatcher->remoteSpawn([this] {
+      if (m_changesEvent != nullptr) {
+        m_changesEvent->set();
+      }
+    });
+  }
+}
+
+void NodeRpcProxy::publishWatchedState() {
+  std::vector<Crypto::Hash> knownTxs = getKnownTxsVector();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Crypto::Hash tailBlock = lastLocalBlockHeaderInfo.hash;
+  lock.unlock();
+
+  {
+    std::lock_guard<std::mutex> watcherLock(m_watcherMutex);
+    m_watchedTailBlock = tailBlock;
+    m_watchedKnownTxs = std::move(knownTxs);
+    ++m_watchedRevision;
+  }
+
+  m_watcherCv.notify_all();
+}
+
+bool NodeRpcProxy::takePushedChanges(COMMAND_RPC_WAIT_FOR_CHANGES::response& changes) {
+  std::lock_guard<std::mutex> lock(m_watcherMutex);
+  if (!m_pushedChangesAvailable) {
+    return false;
+  }
+
+  m_pushedChangesAvailable = false;
+  // an answer to a request made before the last update may miss what that update learned
+  if (m_pushedRevision != m_watchedRevision) {
+    return false;
+  }
+
+  changes = std::move(m_pushedChanges);
+  return true;
+}
+
+void NodeRpcProxy::stopWatchingNodeChanges() {
+  {
+    std::lock_guard<std::mutex> lock(m_watcherMutex);
+    m_watcherStop = true;
+    if (m_watcherClient != nullptr) {
+      m_watcherClient->stop();
+    }
+  }
+  m_watcherCv.notify_all();
+
+  if (m_watcherThread.joinable()) {
+    m_watcherThread.join();
+  }
+}
+
 void NodeRpcProxy::updateNodeStatus() {
+  COMMAND_RPC_WAIT_FOR_CHANGES::response pushed;
+  if (takePushedChanges(pushed) && pushed.isTailBlockActual) {
+    // the long-poll answer carries the pool changes, no need to ask for them again
+    updateBlockchainStatus();
+    std::vector<std::unique_ptr<ITransactionReader>> addedTxs;
+    for (const auto& tpi : pushed.addedTxs) {
+      addedTxs.push_back(createTransactionPrefix(tpi.txPrefix, tpi.txHash));
+    }
+
+    if (!addedTxs.empty() || !pushed.deletedTxsIds.empty()) {
+      updatePoolState(addedTxs, pushed.deletedTxsIds);
+      m_observerManager.notify(&INodeObserver::poolChanged);
+    }
+
+    return;
+  }
+
   bool updateBlockchain = true;
   while (updateBlockchain) {
     updateBlockchainStatus();
@@ -531,6 +731,18 @@ void NodeRpcProxy::getTransactionOutsGlobalIndices(const Crypto::Hash& transacti
     std::ref(outsGlobalIndices)), callback);
 }
 
+void NodeRpcProxy::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doGetTransactionsOutsGlobalIndices, this, std::cref(transactionHashes),
+    std::ref(outsGlobalIndices)), callback);
+}
+
 void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
   uint32_t& startHeight, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
@@ -775,6 +987,52 @@ std::error_code NodeRpcProxy::doGetTransactionOutsGlobalIndices(const Crypto::Ha
   return ec;
 }
 
+std::error_code NodeRpcProxy::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                                 std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.resize(transactionHashes.size());
+
+  for (size_t begin = 0; m_bulkGlobalIndicesSupported && begin < transactionHashes.size(); begin += MAX_TRANSACTIONS_PER_INDEXES_REQUEST) {
+    size_t end = std::min(transactionHashes.size(), begin + MAX_TRANSACTIONS_PER_INDEXES_REQUEST);
+    MevaCoin::COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request req = AUTO_VAL_INIT(req);
+    MevaCoin::COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response rsp = AUTO_VAL_INIT(rsp);
+    req.txids.assign(transactionHashes.begin() + begin, transactionHashes.begin() + end);
+
+    int httpStatus;
+    std::error_code ec = binaryCommand("get_txs_o_indexes.bin", req, rsp, httpStatus);
+    if (httpStatus == 404) {
+      // daemons without the bulk method, fall back to a request per transaction
+      m_bulkGlobalIndicesSupported = false;
+      break;
+    }
+
+    if (ec) {
+      return ec;
+    }
+
+    if (rsp.status != CORE_RPC_STATUS_OK || rsp.indexes.size() != req.txids.size()) {
+      return make_error_code(error::REQUEST_ERROR);
+    }
+
+    for (size_t i = 0; i < rsp.indexes.size(); ++i) {
+      outsGlobalIndices[begin + i] = std::move(rsp.indexes[i].o_indexes);
+    }
+
+    if (end == transactionHashes.size()) {
+      return std::error_code();
+    }
+  }
+
+  for (size_t i = 0; i < transactionHashes.size(); ++i) {
+    std::error_code ec = doGetTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices[i]);
+    if (ec) {
+      return ec;
+    }
+  }
+
+  return std::error_code();
+}
+
 std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
         std::vector<MevaCoin::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   MevaCoin::COMMAND_RPC_QUERY_BLOCKS_LITE::request req = AUTO_VAL_INIT(req);
@@ -985,15 +1243,23 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
 
 template <typename Request, typename Response>
 std::error_code NodeRpcProxy::binaryCommand(const std::string& comm, const Request& req, Response& res) {
+  int httpStatus;
+  return binaryCommand(comm, req, res, httpStatus);
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::binaryCommand(const std::string& comm, const Request& req, Response& res, int& httpStatus) {
   std::error_code ec;
   std::string rpc_url = this->m_daemon_path + comm;
+  httpStatus = 0;
   try {
     EventLock eventLock(*m_httpEvent);
 
     const auto rsp = m_httpClient->Post(rpc_url.c_str(), m_requestHeaders, storeToBinaryKeyValue(req), "application/octet-stream");
     if (rsp) {
+      httpStatus = rsp->status;
       if (rsp->status == 200) {
-        if (!loadFromBinaryKeyValue(res, rsp->body)) {
+        if (!loadFromBinaryKeyValue(res, decodeResponseBody(*rsp))) {
           throw std::runtime_error("Failed to parse binary response");
         }
       }
@@ -1019,7 +1285,7 @@ std::error_code NodeRpcProxy::jsonCommand(const std::string& comm, const Request
     const auto rsp = m_httpClient->Post(rpc_url.c_str(), m_requestHeaders, storeToJson(req), "application/json");
     if (rsp) {
       if (rsp->status == 200) {
-        if (!loadFromJson(res, rsp->body)) {
+        if (!loadFromJson(res, decodeResponseBody(*rsp))) {
           throw std::runtime_error("Failed to parse JSON response");
         }
       }
@@ -1049,7 +1315,7 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
     const auto rsp = m_httpClient->Post(rpc_url.c_str(), m_requestHeaders, jsReq.getBody(), "application/json");
     if (rsp) {
       if (rsp->status == 200) {
-        jsRes.parse(rsp->body);
+        jsRes.parse(decodeResponseBody(*rsp));
 
         JsonRpc::JsonRpcError err;
         if (jsRes.getError(err)) {
@@ -85,6 +85,7 @@ public:
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override;
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<MevaCoin::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override;
@@ -123,6 +124,10 @@ private:
   std::vector<Crypto::Hash> getKnownTxsVector() const;
   void pullNodeStatusAndScheduleTheNext();
   void updateNodeStatus();
+  void watchNodeChanges();
+  void stopWatchingNodeChanges();
+  void publishWatchedState();
+  bool takePushedChanges(COMMAND_RPC_WAIT_FOR_CHANGES::response& changes);
   void updateBlockchainStatus();
   bool updatePoolStatus();
   void updatePeerCount(size_t peerCount);
@@ -135,6 +140,8 @@ private:
     std::vector<MevaCoin::block_complete_entry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash,
                                                     std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                     std::vector<std::vector<uint32_t>>& outsGlobalIndices);
   std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
     std::vector<MevaCoin::BlockShortEntry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
@@ -152,6 +159,8 @@ private:
   template <typename Request, typename Response>
   std::error_code binaryCommand(const std::string& comm, const Request& req, Response& res);
   template <typename Request, typename Response>
+  std::error_code binaryCommand(const std::string& comm, const Request& req, Response& res, int& httpStatus);
+  template <typename Request, typename Response>
   std::error_code jsonCommand(const std::string& comm, const Request& req, Response& res);
   template <typename Request, typename Response>
   std::error_code jsonRpcCommand(const std::string& method, const Request& req, Response& res);
@@ -178,6 +187,22 @@ private:
 
   httplib::Headers m_requestHeaders;
   System::Event* m_httpEvent = nullptr;
+  System::Event* m_changesEvent = nullptr;
+
+  // long-poll watcher, wakes the status update loop on new blocks and pool changes
+  std::thread m_watcherThread;
+  std::mutex m_watcherMutex;
+  std::condition_variable m_watcherCv;
+  httplib::Client* m_watcherClient = nullptr;
+  bool m_watcherStop = false;
+  // what the update loop knows, the watcher asks the daemon about changes against it
+  uint64_t m_watchedRevision = 0;
+  Crypto::Hash m_watchedTailBlock = Crypto::Hash();
+  std::vector<Crypto::Hash> m_watchedKnownTxs;
+  // the latest long-poll answer, valid while m_watchedRevision equals m_pushedRevision
+  COMMAND_RPC_WAIT_FOR_CHANGES::response m_pushedChanges;
+  uint64_t m_pushedRevision = 0;
+  bool m_pushedChangesAvailable = false;
 
   uint64_t m_pullInterval;
 
@@ -203,6 +228,8 @@ private:
   BlockHeaderInfo lastLocalBlockHeaderInfo;
   //protect it with mutex if decided to add worker threads
   std::unordered_set<Crypto::Hash> m_knownTxs;
+  // cleared when the daemon is too old to serve get_txs_o_indexes.bin
+  bool m_bulkGlobalIndicesSupported = true;
 
   bool m_connected;
   bool m_initial;
@@ -184,28 +184,13 @@ Crypto::Hash parseHash(const std::string& hashString, Logging::LoggerRef logger)
   return hash;
 }
 
-std::vector<MevaCoin::TransactionsInBlockInfo> filterTransactions(
-  const std::vector<MevaCoin::TransactionsInBlockInfo>& blocks,
-  const TransactionsInBlockInfoFilter& filter) {
-
-  std::vector<MevaCoin::TransactionsInBlockInfo> result;
-
-  for (const auto& block: blocks) {
-    MevaCoin::TransactionsInBlockInfo item;
-    item.blockHash = block.blockHash;
-
-    for (const auto& transaction: block.transactions) {
-      if (transaction.transaction.state != MevaCoin::WalletTransactionState::DELETED && filter.checkTransaction(transaction)) {
-        item.transactions.push_back(transaction);
-      }
-    }
-
-    if (!block.transactions.empty()) {
-      result.push_back(std::move(item));
-    }
+void filterTransactions(std::vector<MevaCoin::TransactionsInBlockInfo>& blocks, const TransactionsInBlockInfoFilter& filter) {
+  for (auto& block: blocks) {
+    auto& transactions = block.transactions;
+    transactions.erase(std::remove_if(transactions.begin(), transactions.end(), [&filter](const MevaCoin::WalletTransactionWithTransfers& transaction) {
+      return transaction.transaction.state == MevaCoin::WalletTransactionState::DELETED || !filter.checkTransaction(transaction);
+    }), transactions.end());
   }
-
-  return result;
 }
 
 PaymentService::TransactionRpcInfo convertTransactionWithTransfersToTransactionRpcInfo(
@@ -1639,46 +1624,40 @@ void WalletService::replaceWithNewWallet(const Crypto::SecretKey& viewSecretKey)
   inited = true;
 }
 
-std::vector<MevaCoin::TransactionsInBlockInfo> WalletService::getTransactions(const Crypto::Hash& blockHash, size_t blockCount) const {
-  std::vector<MevaCoin::TransactionsInBlockInfo> result = wallet.getTransactions(blockHash, blockCount);
-  if (result.empty()) {
+std::vector<MevaCoin::TransactionsInBlockInfo> WalletService::getTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
+  std::vector<MevaCoin::TransactionsInBlockInfo> result;
+  if (!wallet.getTransactions(blockHash, blockCount, std::vector<std::string>(filter.addresses.begin(), filter.addresses.end()), result)) {
     throw std::system_error(make_error_code(MevaCoin::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
   }
 
+  filterTransactions(result, filter);
   return result;
 }
 
-std::vector<MevaCoin::TransactionsInBlockInfo> WalletService::getTransactions(uint32_t firstBlockIndex, size_t blockCount) const {
-  std::vector<MevaCoin::TransactionsInBlockInfo> result = wallet.getTransactions(firstBlockIndex, blockCount);
-  if (result.empty()) {
+std::vector<MevaCoin::TransactionsInBlockInfo> WalletService::getTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
+  std::vector<MevaCoin::TransactionsInBlockInfo> result;
+  if (!wallet.getTransactions(firstBlockIndex, blockCount, std::vector<std::string>(filter.addresses.begin(), filter.addresses.end()), result)) {
     throw std::system_error(make_error_code(MevaCoin::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
   }
 
+  filterTransactions(result, filter);
   return result;
 }
 
 std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<MevaCoin::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
-  std::vector<MevaCoin::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
+  return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(getTransactions(blockHash, blockCount, filter));
 }
 
 std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<MevaCoin::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
-  std::vector<MevaCoin::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
+  return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(getTransactions(firstBlockIndex, blockCount, filter));
 }
 
 std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<MevaCoin::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
-  std::vector<MevaCoin::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions);
+  return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(getTransactions(blockHash, blockCount, filter));
 }
 
 std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<MevaCoin::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
-  std::vector<MevaCoin::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions);
+  return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(getTransactions(firstBlockIndex, blockCount, filter));
 }
 
 } //namespace PaymentService
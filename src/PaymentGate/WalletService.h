@@ -128,8 +128,8 @@ private:
   void replaceWithNewWallet(const Crypto::SecretKey& viewSecretKey);
   void replaceWithNewWallet(const Crypto::SecretKey& viewSecretKey, const uint32_t scanHeight);
 
-  std::vector<MevaCoin::TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t blockCount) const;
-  std::vector<MevaCoin::TransactionsInBlockInfo> getTransactions(uint32_t firstBlockIndex, size_t blockCount) const;
+  std::vector<MevaCoin::TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
+  std::vector<MevaCoin::TransactionsInBlockInfo> getTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
 
   std::vector<TransactionHashesInBlockRpcInfo> getRpcTransactionHashes(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
   std::vector<TransactionHashesInBlockRpcInfo> getRpcTransactionHashes(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
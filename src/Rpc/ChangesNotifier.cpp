@@ -0,0 +1,83 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "ChangesNotifier.h"
+
+namespace MevaCoin {
+
+ChangesNotifier::ChangesNotifier(size_t maxWaiters) :
+  m_maxWaiters(maxWaiters),
+  m_waiters(0),
+  m_revision(0),
+  m_stopped(false) {
+}
+
+uint64_t ChangesNotifier::revision() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_revision;
+}
+
+ChangesNotifier::WaitResult ChangesNotifier::waitForChange(uint64_t revision, std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_stopped) {
+    return WaitResult::Stopped;
+  }
+
+  if (m_revision != revision) {
+    return WaitResult::Changed;
+  }
+
+  if (m_waiters >= m_maxWaiters) {
+    return WaitResult::Busy;
+  }
+
+  ++m_waiters;
+  bool changed = m_changed.wait_for(lock, timeout, [&] { return m_stopped || m_revision != revision; });
+  --m_waiters;
+
+  if (m_stopped) {
+    return WaitResult::Stopped;
+  }
+
+  return changed ? WaitResult::Changed : WaitResult::TimedOut;
+}
+
+void ChangesNotifier::notify() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_revision;
+  }
+
+  m_changed.notify_all();
+}
+
+void ChangesNotifier::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+
+  m_changed.notify_all();
+}
+
+size_t ChangesNotifier::waiters() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_waiters;
+}
+
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace MevaCoin {
+
+// Parks RPC threads until the next block or pool change. Each parked request keeps
+// its http worker, so the number of waiters is capped and callers over the cap are
+// told to poll instead.
+class ChangesNotifier {
+public:
+  enum class WaitResult {
+    Changed,
+    TimedOut,
+    Busy,
+    Stopped
+  };
+
+  explicit ChangesNotifier(size_t maxWaiters);
+
+  // Take the revision before reading the state a wait depends on, a change made in
+  // between then ends the wait at once
+  uint64_t revision() const;
+  WaitResult waitForChange(uint64_t revision, std::chrono::milliseconds timeout);
+
+  void notify();
+  void stop();
+
+  size_t waiters() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_changed;
+  const size_t m_maxWaiters;
+  size_t m_waiters;
+  uint64_t m_revision;
+  bool m_stopped;
+};
+
+}
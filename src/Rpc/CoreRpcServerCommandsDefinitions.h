@@ -157,6 +157,42 @@ struct COMMAND_RPC_GET_POOL_CHANGES_LITE {
   };
 };
 
+//-----------------------------------------------
+// Long-poll: returns as soon as the tail block differs from the one known to the
+// caller or the pool differs from the transactions it knows, carrying the pool
+// changes along, or when the timeout expires with nothing changed
+struct COMMAND_RPC_WAIT_FOR_CHANGES {
+  struct request {
+    Crypto::Hash tailBlockId;
+    std::vector<Crypto::Hash> knownTxsIds;
+    uint32_t timeout; // milliseconds
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tailBlockId)
+      serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+      KV_MEMBER(timeout)
+    }
+  };
+
+  struct response {
+    Crypto::Hash tailBlockId;
+    uint32_t height;
+    bool isTailBlockActual;
+    std::vector<TransactionPrefixInfo> addedTxs;
+    std::vector<Crypto::Hash> deletedTxsIds;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tailBlockId)
+      KV_MEMBER(height)
+      KV_MEMBER(isTailBlockActual)
+      KV_MEMBER(addedTxs)
+      serializeAsBinary(deletedTxsIds, "deletedTxsIds", s);
+      KV_MEMBER(status)
+    }
+  };
+};
+
 //-----------------------------------------------
 struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES {
   
@@ -179,6 +215,39 @@ struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES {
   };
 };
 //-----------------------------------------------
+struct transaction_global_outputs_indexes {
+  std::vector<uint32_t> o_indexes;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(o_indexes)
+  }
+};
+
+// the daemon refuses larger requests, clients split theirs
+const size_t MAX_TRANSACTIONS_PER_INDEXES_REQUEST = 10000;
+
+struct COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES {
+
+  struct request {
+    std::vector<Crypto::Hash> txids;
+
+    void serialize(ISerializer &s) {
+      serializeAsBinary(txids, "txids", s);
+    }
+  };
+
+  // indexes are in the order of requested transactions
+  struct response {
+    std::vector<transaction_global_outputs_indexes> indexes;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(indexes)
+      KV_MEMBER(status)
+    }
+  };
+};
+//-----------------------------------------------
 struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request {
   std::vector<uint64_t> amounts;
   uint64_t outs_count;
@@ -1342,6 +1411,42 @@ struct block_stats_entry {
   }
 };
 
+struct block_stats_summary {
+  uint64_t min;
+  uint64_t max;
+  uint64_t avg;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(min)
+    KV_MEMBER(max)
+    KV_MEMBER(avg)
+  }
+};
+
+struct block_stats_bucket {
+  uint32_t start_height;
+  uint32_t end_height;
+  uint64_t start_timestamp;
+  uint64_t end_timestamp;
+  uint64_t already_generated_coins;
+  block_stats_summary block_size;
+  block_stats_summary difficulty;
+  block_stats_summary reward;
+  block_stats_summary transactions_count;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(start_height)
+    KV_MEMBER(end_height)
+    KV_MEMBER(start_timestamp)
+    KV_MEMBER(end_timestamp)
+    KV_MEMBER(already_generated_coins)
+    KV_MEMBER(block_size)
+    KV_MEMBER(difficulty)
+    KV_MEMBER(reward)
+    KV_MEMBER(transactions_count)
+  }
+};
+
 struct COMMAND_RPC_GET_STATS_BY_HEIGHTS {
   struct request {
     std::vector<uint32_t> heights;
@@ -1368,20 +1473,24 @@ struct COMMAND_RPC_GET_STATS_BY_HEIGHTS_RANGE {
   struct request {
     uint32_t start_height;
     uint32_t end_height;
+    uint32_t buckets = 0; // optional, when set the range is downsampled into min/max/avg buckets
 
     void serialize(ISerializer& s) {
       KV_MEMBER(start_height);
       KV_MEMBER(end_height);
+      KV_MEMBER(buckets);
     }
   };
 
   struct response {
     std::vector<block_stats_entry> stats;
+    std::vector<block_stats_bucket> buckets;
     double duration;
     std::string status;
 
     void serialize(ISerializer& s) {
       KV_MEMBER(stats);
+      KV_MEMBER(buckets);
       KV_MEMBER(duration);
       KV_MEMBER(status);
     }
@@ -1438,4 +1547,58 @@ struct COMMAND_RPC_CHECK_PAYMENT_BY_PAYMENT_ID {
   };
 };
 
+struct payment_check_request {
+  std::string payment_id;
+  std::string view_key;
+  std::string address;
+  uint64_t amount = 0;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(payment_id)
+    KV_MEMBER(view_key)
+    KV_MEMBER(address)
+    KV_MEMBER(amount)
+  }
+};
+
+struct payment_check_result {
+  std::string payment_id;
+  std::string address;
+  std::string status;
+  std::string error;
+  std::vector<Crypto::Hash> transaction_hashes;
+  uint64_t received_amount = 0;
+  uint32_t confirmations = 0;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(payment_id)
+    KV_MEMBER(address)
+    KV_MEMBER(status)
+    KV_MEMBER(error)
+    KV_MEMBER(transaction_hashes)
+    KV_MEMBER(received_amount)
+    KV_MEMBER(confirmations)
+  }
+};
+
+struct COMMAND_RPC_CHECK_PAYMENTS {
+  struct request {
+    std::vector<payment_check_request> payments;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(payments)
+    }
+  };
+
+  struct response {
+    std::vector<payment_check_result> payments;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(payments)
+      KV_MEMBER(status)
+    }
+  };
+};
+
 }
@@ -0,0 +1,191 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PaymentScanner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "MevaCoinCore/TransactionExtra.h"
+
+namespace MevaCoin {
+
+namespace {
+
+// several chunks per thread so a batch with a few heavy transactions is still spread evenly
+const size_t CHUNKS_PER_THREAD = 4;
+
+}
+
+PaymentScanner::PaymentScanner(size_t threadCount, size_t derivationCacheSize) : m_stopped(false), m_cacheSize(derivationCacheSize) {
+  m_threads.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_threads.emplace_back(&PaymentScanner::workerThread, this);
+  }
+}
+
+PaymentScanner::~PaymentScanner() {
+  stop();
+}
+
+void PaymentScanner::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_tasksMutex);
+    m_stopped = true;
+  }
+  m_tasksCv.notify_all();
+
+  for (auto& thread : m_threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  m_threads.clear();
+}
+
+void PaymentScanner::scan(std::vector<PaymentScanJob>& jobs) {
+  if (jobs.empty()) {
+    return;
+  }
+
+  if (m_threads.empty()) {
+    for (auto& job : jobs) {
+      scanJob(job);
+    }
+
+    return;
+  }
+
+  size_t chunks = std::min(jobs.size(), m_threads.size() * CHUNKS_PER_THREAD);
+  std::mutex doneMutex;
+  std::condition_variable doneCv;
+  size_t remaining = chunks;
+
+  {
+    std::lock_guard<std::mutex> lock(m_tasksMutex);
+    if (m_stopped) {
+      throw std::runtime_error("Payment scanner is stopped");
+    }
+
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      size_t begin = jobs.size() * chunk / chunks;
+      size_t end = jobs.size() * (chunk + 1) / chunks;
+      m_tasks.emplace_back([this, &jobs, &doneMutex, &doneCv, &remaining, begin, end] {
+        for (size_t i = begin; i < end; ++i) {
+          scanJob(jobs[i]);
+        }
+
+        // notify under the lock, the waiting thread owns the condition variable
+        std::lock_guard<std::mutex> lock(doneMutex);
+        --remaining;
+        doneCv.notify_one();
+      });
+    }
+  }
+
+  m_tasksCv.notify_all();
+
+  std::unique_lock<std::mutex> lock(doneMutex);
+  doneCv.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+void PaymentScanner::workerThread() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_tasksMutex);
+      m_tasksCv.wait(lock, [this] { return m_stopped || !m_tasks.empty(); });
+      // drain queued tasks even when stopping, somebody is waiting for them
+      if (m_tasks.empty()) {
+        return;
+      }
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+void PaymentScanner::scanJob(PaymentScanJob& job) {
+  job.received = 0;
+  job.derivationFailed = false;
+
+  try {
+    Crypto::PublicKey transactionPublicKey = getTransactionPublicKeyFromExtra(job.transaction->extra);
+
+    Crypto::KeyDerivation derivation;
+    if (!getDerivation(transactionPublicKey, job.viewSecretKey, derivation)) {
+      job.derivationFailed = true;
+      return;
+    }
+
+    size_t keyIndex = 0;
+    for (const TransactionOutput& output : job.transaction->outputs) {
+      if (output.target.type() == typeid(KeyOutput)) {
+        Crypto::PublicKey outputKey;
+        if (Crypto::derive_public_key(derivation, keyIndex, job.spendPublicKey, outputKey) &&
+            outputKey == boost::get<KeyOutput>(output.target).key) {
+          job.received += output.amount;
+        }
+      }
+
+      ++keyIndex;
+    }
+  } catch (...) {
+    job.received = 0;
+    job.derivationFailed = true;
+  }
+}
+
+bool PaymentScanner::getDerivation(const Crypto::PublicKey& transactionPublicKey, const Crypto::SecretKey& viewSecretKey, Crypto::KeyDerivation& derivation) {
+  DerivationCacheKey key{ transactionPublicKey, viewSecretKey };
+
+  if (m_cacheSize != 0) {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    auto it = m_derivationsIndex.find(key);
+    if (it != m_derivationsIndex.end()) {
+      m_derivations.splice(m_derivations.begin(), m_derivations, it->second);
+      derivation = it->second->second;
+      return true;
+    }
+  }
+
+  if (!Crypto::generate_key_derivation(transactionPublicKey, viewSecretKey, derivation)) {
+    return false;
+  }
+
+  if (m_cacheSize != 0) {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    // another thread may have computed it meanwhile
+    if (m_derivationsIndex.count(key) == 0) {
+      m_derivations.emplace_front(key, derivation);
+      m_derivationsIndex.emplace(key, m_derivations.begin());
+
+      if (m_derivations.size() > m_cacheSize) {
+        m_derivationsIndex.erase(m_derivations.back().first);
+        m_derivations.pop_back();
+      }
+    }
+  }
+
+  return true;
+}
+
+}
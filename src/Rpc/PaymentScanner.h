@@ -0,0 +1,93 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "MevaCoinCore/MevaCoinBasic.h"
+
+namespace MevaCoin {
+
+// Outputs of one transaction checked against one (view key, spend public key) pair
+struct PaymentScanJob {
+  const Transaction* transaction = nullptr;
+  Crypto::SecretKey viewSecretKey;
+  Crypto::PublicKey spendPublicKey;
+
+  bool derivationFailed = false;
+  uint64_t received = 0;
+};
+
+// Runs view key output scanning of payment checks on its own worker threads,
+// so the RPC threads only wait for the result instead of doing the curve math.
+// Key derivations are cached per (transaction public key, view key), merchants
+// poll the same transactions with the same keys over and over.
+class PaymentScanner {
+public:
+  PaymentScanner(size_t threadCount, size_t derivationCacheSize);
+  ~PaymentScanner();
+
+  // Blocks until all jobs are scanned
+  void scan(std::vector<PaymentScanJob>& jobs);
+  void stop();
+
+private:
+  struct DerivationCacheKey {
+    Crypto::PublicKey transactionPublicKey;
+    Crypto::SecretKey viewSecretKey;
+
+    bool operator==(const DerivationCacheKey& other) const {
+      return transactionPublicKey == other.transactionPublicKey && viewSecretKey == other.viewSecretKey;
+    }
+  };
+
+  struct DerivationCacheKeyHasher {
+    size_t operator()(const DerivationCacheKey& key) const {
+      return std::hash<Crypto::PublicKey>()(key.transactionPublicKey) ^ std::hash<Crypto::SecretKey>()(key.viewSecretKey);
+    }
+  };
+
+  typedef std::list<std::pair<DerivationCacheKey, Crypto::KeyDerivation>> DerivationList;
+
+  void workerThread();
+  void scanJob(PaymentScanJob& job);
+  bool getDerivation(const Crypto::PublicKey& transactionPublicKey, const Crypto::SecretKey& viewSecretKey, Crypto::KeyDerivation& derivation);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_tasksMutex;
+  std::condition_variable m_tasksCv;
+  std::deque<std::function<void()>> m_tasks;
+  bool m_stopped;
+
+  // LRU, most recently used in front
+  std::mutex m_cacheMutex;
+  size_t m_cacheSize;
+  DerivationList m_derivations;
+  std::unordered_map<DerivationCacheKey, DerivationList::iterator, DerivationCacheKeyHasher> m_derivationsIndex;
+};
+
+}
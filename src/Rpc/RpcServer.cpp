@@ -25,6 +25,7 @@
 #include <future>
 #include <boost/uuid/uuid_io.hpp>
 #include <unordered_map>
+#include <unordered_set>
 #include <time.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid.hpp>
@@ -38,6 +39,7 @@
 #include "Common/Math.h"
 #include "Common/FormatTools.h"
 #include "Common/StringTools.h"
+#include "HTTP/HttpCompression.h"
 #include "MevaCoinCore/TransactionUtils.h"
 #include "MevaCoinCore/MevaCoinTools.h"
 #include "MevaCoinCore/MevaCoinFormatUtils.h"
@@ -55,6 +57,9 @@
 #undef ERROR
 
 const uint32_t MAX_NUMBER_OF_BLOCKS_PER_STATS_REQUEST = 10000;
+const uint32_t MAX_NUMBER_OF_BUCKETS_PER_STATS_REQUEST = 10000;
+const size_t MAX_NUMBER_OF_PAYMENT_CHECKS_PER_REQUEST = 1000;
+const size_t PAYMENT_DERIVATIONS_CACHE_SIZE = 100000;
 const uint64_t BLOCK_LIST_MAX_COUNT = 1000;
 
 const std::string program_name = boost::dll::program_location().filename().string();
@@ -70,6 +75,12 @@ namespace MevaCoin {
 
 namespace {
 
+// Parked long-polls hold an httplib worker each, so the pool gets one per allowed long-poll.
+// By default as many are allowed as there are regular workers, so both scale with the machine
+size_t getLongPollCount(const RpcServerConfig& config) {
+  return config.getMaxLongPolls() != 0 ? config.getMaxLongPolls() : CPPHTTPLIB_THREAD_POOL_COUNT;
+}
+
 template <typename T>
 static bool print_as_json(const T& obj) {
   std::cout << MevaCoin::storeToJson(obj) << ENDL;
@@ -150,16 +161,18 @@ RpcServer::HandlerFunction httpMethod(bool (RpcServer::*handler)(typename Comman
 std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction>> RpcServer::s_handlers = {
 
   // binary handlers
-  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), true } },
-  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), true } },
-  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), true } },
+  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), true, true } },
+  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), true, true } },
+  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), true, true } },
   { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), true } },
+  { "/get_txs_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_txs_indexes), true } },
   { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs_bin), true } },
-  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::on_get_pool_changes), true } },
-  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::on_get_pool_changes_lite), true } },
+  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::on_get_pool_changes), true, true } },
+  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::on_get_pool_changes_lite), true, true } },
+  { "/wait_for_changes.bin", { binMethod<COMMAND_RPC_WAIT_FOR_CHANGES>(&RpcServer::on_wait_for_changes), true } },
 
   // plain text/html handlers
-  { "/", { httpMethod<COMMAND_HTTP>(&RpcServer::on_get_index), true } },
+  { "/", { httpMethod<COMMAND_HTTP>(&RpcServer::on_get_index), true, true } },
   { "/supply", { httpMethod<COMMAND_HTTP>(&RpcServer::on_get_supply), false } },
   { "/paymentid", { httpMethod<COMMAND_HTTP>(&RpcServer::on_get_payment_id), true } },
 
@@ -168,28 +181,29 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true } },
   { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true } },
   { "/gettransactionspool", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_POOL_SHORT>(&RpcServer::on_get_transactions_pool_short), true } },
-  { "/gettransactionsinpool", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_POOL>(&RpcServer::on_get_transactions_pool), true } },
-  { "/getrawtransactionspool", { jsonMethod<COMMAND_RPC_GET_RAW_TRANSACTIONS_POOL>(&RpcServer::on_get_transactions_pool_raw), true } },
+  { "/gettransactionsinpool", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_POOL>(&RpcServer::on_get_transactions_pool), true, true } },
+  { "/getrawtransactionspool", { jsonMethod<COMMAND_RPC_GET_RAW_TRANSACTIONS_POOL>(&RpcServer::on_get_transactions_pool_raw), true, true } },
 
   // post json handlers
   { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
   { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TRANSACTION>(&RpcServer::on_send_raw_transaction), false } },
-  { "/getblocks", { jsonMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false } },
-  { "/queryblocks", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
-  { "/queryblockslite", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
+  { "/getblocks", { jsonMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false, true } },
+  { "/queryblocks", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false, true } },
+  { "/queryblockslite", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false, true } },
   { "/get_o_indexes", { jsonMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
   { "/getrandom_outs", { jsonMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_JSON>(&RpcServer::on_get_random_outs_json), false } },
-  { "/get_pool_changes", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::on_get_pool_changes), true } },
-  { "/get_pool_changes_lite", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::on_get_pool_changes_lite), true } },
+  { "/get_pool_changes", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::on_get_pool_changes), true, true } },
+  { "/get_pool_changes_lite", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::on_get_pool_changes_lite), true, true } },
+  { "/wait_for_changes", { jsonMethod<COMMAND_RPC_WAIT_FOR_CHANGES>(&RpcServer::on_wait_for_changes), true } },
   { "/get_block_details_by_height", { jsonMethod<COMMAND_RPC_GET_BLOCK_DETAILS_BY_HEIGHT>(&RpcServer::on_get_block_details_by_height), true } },
   { "/get_block_details_by_hash", { jsonMethod<COMMAND_RPC_GET_BLOCK_DETAILS_BY_HASH>(&RpcServer::on_get_block_details_by_hash), true } },
-  { "/get_blocks_details_by_heights", { jsonMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS>(&RpcServer::on_get_blocks_details_by_heights), true } },
-  { "/get_blocks_details_by_hashes", { jsonMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HASHES>(&RpcServer::on_get_blocks_details_by_hashes), true } },
+  { "/get_blocks_details_by_heights", { jsonMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS>(&RpcServer::on_get_blocks_details_by_heights), true, true } },
+  { "/get_blocks_details_by_hashes", { jsonMethod<COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HASHES>(&RpcServer::on_get_blocks_details_by_hashes), true, true } },
   { "/get_blocks_hashes_by_timestamps", { jsonMethod<COMMAND_RPC_GET_BLOCKS_HASHES_BY_TIMESTAMPS>(&RpcServer::on_get_blocks_hashes_by_timestamps), true } },
-  { "/get_transaction_details_by_hashes", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES>(&RpcServer::on_get_transactions_details_by_hashes), true } },
+  { "/get_transaction_details_by_hashes", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HASHES>(&RpcServer::on_get_transactions_details_by_hashes), true, true } },
   { "/get_transaction_details_by_hash", { jsonMethod<COMMAND_RPC_GET_TRANSACTION_DETAILS_BY_HASH>(&RpcServer::on_get_transaction_details_by_hash), true } },
-  { "/get_transaction_details_by_heights", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HEIGHTS>(&RpcServer::on_get_transactions_details_by_heights), true } },
-  { "/get_raw_transactions_by_heights", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_WITH_OUTPUT_GLOBAL_INDEXES_BY_HEIGHTS>(&RpcServer::on_get_transactions_with_output_global_indexes_by_heights), true } },
+  { "/get_transaction_details_by_heights", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_DETAILS_BY_HEIGHTS>(&RpcServer::on_get_transactions_details_by_heights), true, true } },
+  { "/get_raw_transactions_by_heights", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS_WITH_OUTPUT_GLOBAL_INDEXES_BY_HEIGHTS>(&RpcServer::on_get_transactions_with_output_global_indexes_by_heights), true, true } },
   { "/get_transaction_hashes_by_payment_id", { jsonMethod<COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID>(&RpcServer::on_get_transaction_hashes_by_paymentid), true } },
   
   // disabled in restricted rpc mode
@@ -201,7 +215,7 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
 
 
   // json rpc
-  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
+  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true, true } }
 };
 
 RpcServer::RpcServer(
@@ -223,7 +237,10 @@ RpcServer::RpcServer(
   m_restricted_rpc(m_config.isRestricted()),
   m_cors_domain(m_config.getCors()),
   m_fee_address(""),
-  m_fee_amount(0)
+  m_fee_amount(0),
+  m_changesNotifier(getLongPollCount(m_config)),
+  m_paymentScanner(m_config.getPaymentCheckThreads() != 0 ? m_config.getPaymentCheckThreads() : std::max(1u, std::thread::hardware_concurrency()),
+    PAYMENT_DERIVATIONS_CACHE_SIZE)
 {
   if (!m_config.getNodeFeeAddress().empty() && m_config.getNodeFeeAmount() != 0) {
     m_fee_address = m_config.getNodeFeeAddress();
@@ -247,24 +264,36 @@ RpcServer::RpcServer(
 
   https = new httplib::SSLServer(m_config.getChainFile().c_str(), m_config.getKeyFile().c_str());
 
+  // long-polling clients park a worker thread each, keep the default pool free for regular requests
+  size_t threadCount = CPPHTTPLIB_THREAD_POOL_COUNT + getLongPollCount(m_config);
+  http->new_task_queue = [threadCount] { return new httplib::ThreadPool(threadCount); };
+  https->new_task_queue = [threadCount] { return new httplib::ThreadPool(threadCount); };
+
   http->Get(".*", [this](const httplib::Request& req, httplib::Response& res) {
     processRequest(req, res);
+    compressResponse(req, res);
   });
 
   https->Get(".*", [this](const httplib::Request& req, httplib::Response& res) {
     processRequest(req, res);
+    compressResponse(req, res);
   });
 
   http->Post(".*", [this](const httplib::Request& req, httplib::Response& res) {
     processRequest(req, res);
+    compressResponse(req, res);
   });
 
   https->Post(".*", [this](const httplib::Request& req, httplib::Response& res) {
     processRequest(req, res);
+    compressResponse(req, res);
   });
+
+  m_core.addObserver(this);
 }
 
 RpcServer::~RpcServer() {
+  m_core.removeObserver(this);
   stop();
 }
 
@@ -284,6 +313,8 @@ void RpcServer::start() {
 }
 
 void RpcServer::stop() {
+  m_changesNotifier.stop();
+
   if (m_config.isEnabledSSL()) {
     https->stop();
   }
@@ -297,6 +328,8 @@ void RpcServer::stop() {
   }
 
   m_workers.clear();
+
+  m_paymentScanner.stop();
 }
 
 void RpcServer::listen(const std::string address, const uint16_t port) {
@@ -580,6 +613,35 @@ void RpcServer::processRequest(const httplib::Request& request, httplib::Respons
   }
 }
 
+void RpcServer::compressResponse(const httplib::Request& request, httplib::Response& response) {
+  if (!m_config.isEnabledCompression() || response.body.size() < m_config.getCompressionThreshold() ||
+      response.has_header("Content-Encoding")) {
+    return;
+  }
+
+  // only endpoints returning bulky, well compressible payloads opt in
+  auto it = s_handlers.find(request.path);
+  bool allowed = it != s_handlers.end() ? it->second.allowCompression :
+    Common::starts_with(request.path, "/api/") || Common::starts_with(request.path, "/explorer");
+  if (!allowed) {
+    return;
+  }
+
+  HttpContentEncoding encoding = selectContentEncoding(request.get_header_value("Accept-Encoding"));
+  if (encoding == HttpContentEncoding::Identity) {
+    return;
+  }
+
+  std::string compressed;
+  if (!compressHttpContent(response.body, encoding, compressed) || compressed.size() >= response.body.size()) {
+    return;
+  }
+
+  response.body = std::move(compressed);
+  response.set_header("Content-Encoding", getContentEncodingName(encoding));
+  response.set_header("Vary", "Accept-Encoding");
+}
+
 bool RpcServer::processJsonRpcRequest(const httplib::Request& request, httplib::Response& response) {
 
   using namespace JsonRpc;
@@ -632,6 +694,7 @@ bool RpcServer::processJsonRpcRequest(const httplib::Request& request, httplib::
       { "checktransactionproof", { makeMemberMethod(&RpcServer::on_check_transaction_proof), true } },
       { "checkreserveproof", { makeMemberMethod(&RpcServer::on_check_reserve_proof), true } },
       { "checkpayment", { makeMemberMethod(&RpcServer::on_check_payment), true } },
+      { "checkpayments", { makeMemberMethod(&RpcServer::on_check_payments), true } },
       { "validateaddress", { makeMemberMethod(&RpcServer::on_validate_address), true } },
       { "verifymessage", { makeMemberMethod(&RpcServer::on_verify_message), true } },
       { "submitblock", { makeMemberMethod(&RpcServer::on_submitblock), false } },
@@ -792,6 +855,25 @@ bool RpcServer::on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::
   return true;
 }
 
+bool RpcServer::on_get_txs_indexes(const COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response& res) {
+  if (req.txids.size() > MAX_TRANSACTIONS_PER_INDEXES_REQUEST) {
+    res.status = "Failed";
+    return false;
+  }
+
+  res.indexes.resize(req.txids.size());
+  for (size_t i = 0; i < req.txids.size(); ++i) {
+    if (!m_core.get_tx_outputs_gindexs(req.txids[i], res.indexes[i].o_indexes)) {
+      res.indexes.clear();
+      res.status = "Failed";
+      return true;
+    }
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::on_get_random_outs_bin(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
   res.status = "Failed";
   if (!m_core.get_random_outs_for_amounts(req, res)) {
@@ -851,6 +933,42 @@ bool RpcServer::on_get_pool_changes_lite(const COMMAND_RPC_GET_POOL_CHANGES_LITE
   return true;
 }
 
+bool RpcServer::on_wait_for_changes(const COMMAND_RPC_WAIT_FOR_CHANGES::request& req, COMMAND_RPC_WAIT_FOR_CHANGES::response& rsp) {
+  const uint32_t MAX_WAIT_TIMEOUT = 60000;
+
+  uint64_t revision = m_changesNotifier.revision();
+  rsp.isTailBlockActual = m_core.getPoolChangesLite(req.tailBlockId, req.knownTxsIds, rsp.addedTxs, rsp.deletedTxsIds);
+
+  if (rsp.isTailBlockActual && rsp.addedTxs.empty() && rsp.deletedTxsIds.empty()) {
+    auto result = m_changesNotifier.waitForChange(revision, std::chrono::milliseconds(std::min(req.timeout, MAX_WAIT_TIMEOUT)));
+    if (result == ChangesNotifier::WaitResult::Busy) {
+      // too many waiters, the client falls back to periodic polling
+      rsp.tailBlockId = req.tailBlockId;
+      rsp.height = 0;
+      rsp.status = CORE_RPC_STATUS_BUSY;
+      return true;
+    }
+
+    if (result == ChangesNotifier::WaitResult::Changed) {
+      rsp.isTailBlockActual = m_core.getPoolChangesLite(req.tailBlockId, req.knownTxsIds, rsp.addedTxs, rsp.deletedTxsIds);
+    }
+  }
+
+  rsp.tailBlockId = m_core.get_tail_id();
+  rsp.height = m_core.getCurrentBlockchainHeight() - 1;
+  rsp.status = CORE_RPC_STATUS_OK;
+
+  return true;
+}
+
+void RpcServer::blockchainUpdated() {
+  m_changesNotifier.notify();
+}
+
+void RpcServer::poolUpdated() {
+  m_changesNotifier.notify();
+}
+
 bool RpcServer::on_get_blocks_details_by_heights(const COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS::response& rsp) {
   try {
     if (req.blockHeights.size() > BLOCK_LIST_MAX_COUNT) {
@@ -1302,121 +1420,195 @@ bool RpcServer::on_get_transaction_hashes_by_paymentid(const COMMAND_RPC_GET_TRA
 }
 
 bool RpcServer::on_check_payment(const COMMAND_RPC_CHECK_PAYMENT_BY_PAYMENT_ID::request& req, COMMAND_RPC_CHECK_PAYMENT_BY_PAYMENT_ID::response& rsp) {
-  // get txs with requested payment id
-  std::vector<Crypto::Hash> transaction_hashes;
-  Crypto::Hash pid_hash;
-  if (!parse_hash256(req.payment_id, pid_hash)) {
-    throw JsonRpc::JsonRpcError{
-      CORE_RPC_ERROR_CODE_WRONG_PARAM,
-      "Failed to parse hex representation of payment id. Hex = " + req.payment_id + '.' };
-  }
-  try {
-    transaction_hashes = m_core.getTransactionHashesByPaymentId(pid_hash);
+  payment_check_request check;
+  check.payment_id = req.payment_id;
+  check.view_key = req.view_key;
+  check.address = req.address;
+  check.amount = req.amount;
+
+  payment_check_result result = checkPayments({ check }).front();
+  if (result.status == "error") {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM, result.error };
   }
-  catch (std::system_error& e) {
-    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, e.what() };
-    return false;
+
+  rsp.transaction_hashes = std::move(result.transaction_hashes);
+  rsp.received_amount = result.received_amount;
+  rsp.confirmations = result.confirmations;
+  rsp.status = result.status;
+
+  return true;
+}
+
+bool RpcServer::on_check_payments(const COMMAND_RPC_CHECK_PAYMENTS::request& req, COMMAND_RPC_CHECK_PAYMENTS::response& rsp) {
+  if (req.payments.size() > MAX_NUMBER_OF_PAYMENT_CHECKS_PER_REQUEST) {
+    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM,
+      "Too many payments to check, max. " + std::to_string(MAX_NUMBER_OF_PAYMENT_CHECKS_PER_REQUEST) + " per request" };
   }
-  catch (std::exception& e) {
+
+  try {
+    rsp.payments = checkPayments(req.payments);
+  } catch (std::exception& e) {
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Error: " + std::string(e.what()) };
-    return false;
   }
 
-  if (transaction_hashes.size() == 0) {
-    rsp.status = "not_found";
-    return true;
-  }
+  rsp.status = CORE_RPC_STATUS_OK;
+  return true;
+}
 
-  uint64_t received = 0;
+std::vector<payment_check_result> RpcServer::checkPayments(const std::vector<payment_check_request>& checks) {
+  struct ParsedCheck {
+    AccountPublicAddress address;
+    Crypto::SecretKey viewKey;
+    std::vector<Crypto::Hash> transactionHashes;
+  };
 
-  // parse address
-  MevaCoin::AccountPublicAddress address;
-  if (!m_core.currency().parseAccountAddressString(req.address, address)) {
-    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM, "Failed to parse address " + req.address + '.' };
-  }
-  // parse view key
-  Crypto::Hash view_key_hash;
-  size_t size;
-  if (!Common::fromHex(req.view_key, &view_key_hash, sizeof(view_key_hash), size) || size != sizeof(view_key_hash)) {
-    throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM, "Failed to parse private view key" };
-  }
-  Crypto::SecretKey viewKey = *(struct Crypto::SecretKey *) &view_key_hash;
+  std::vector<payment_check_result> results(checks.size());
+  std::vector<ParsedCheck> parsed(checks.size());
 
-  // fetch tx(s)
-  std::list<Crypto::Hash> missed_txs;
-  std::list<Transaction> txs;
-  m_core.getTransactions(transaction_hashes, txs, missed_txs, true);
+  // parse the checks and collect the transactions of all of them, so each is fetched once
+  std::vector<Crypto::Hash> transactionHashes;
+  std::unordered_set<Crypto::Hash> uniqueHashes;
+  for (size_t i = 0; i < checks.size(); ++i) {
+    const payment_check_request& check = checks[i];
+    payment_check_result& result = results[i];
+    result.payment_id = check.payment_id;
+    result.address = check.address;
+    result.status = "error";
 
-  if (missed_txs.size() != 0) {
-    throw JsonRpc::JsonRpcError{
-      CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
-      "Couldn't get transaction with hash: " + Common::podToHex(missed_txs.front()) + '.' };
-  }
+    Crypto::Hash paymentId;
+    if (!parse_hash256(check.payment_id, paymentId)) {
+      result.error = "Failed to parse hex representation of payment id. Hex = " + check.payment_id + '.';
+      continue;
+    }
 
-  for (const auto& tx : txs) {
-    // get tx pub key
-    Crypto::PublicKey txPubKey = getTransactionPublicKeyFromExtra(tx.extra);
+    if (!m_core.currency().parseAccountAddressString(check.address, parsed[i].address)) {
+      result.error = "Failed to parse address " + check.address + '.';
+      continue;
+    }
 
-    // obtain key derivation
-    Crypto::KeyDerivation derivation;
-    if (!Crypto::generate_key_derivation(txPubKey, viewKey, derivation))
-    {
-      throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM, "Failed to generate key derivation from supplied parameters" };
+    Crypto::Hash viewKeyHash;
+    size_t size;
+    if (!Common::fromHex(check.view_key, &viewKeyHash, sizeof(viewKeyHash), size) || size != sizeof(viewKeyHash)) {
+      result.error = "Failed to parse private view key";
+      continue;
     }
+    parsed[i].viewKey = *reinterpret_cast<Crypto::SecretKey*>(&viewKeyHash);
 
-    // look for outputs
-    size_t keyIndex(0);
-    std::vector<TransactionOutput> outputs;
-    try {
-      for (const TransactionOutput& o : tx.outputs) {
-        if (o.target.type() == typeid(KeyOutput)) {
-          const KeyOutput out_key = boost::get<KeyOutput>(o.target);
-          Crypto::PublicKey pubkey;
-          derive_public_key(derivation, keyIndex, address.spendPublicKey, pubkey);
-          if (pubkey == out_key.key) {
-            received += o.amount;
+    parsed[i].transactionHashes = m_core.getTransactionHashesByPaymentId(paymentId);
+    if (parsed[i].transactionHashes.empty()) {
+      result.status = "not_found";
+      continue;
+    }
 
-            // count confirmations only for actually paying tx
-            // and include only their hashes in responce
-            Crypto::Hash blockHash;
-            uint32_t blockHeight;
-            Crypto::Hash txHash = getObjectHash(tx);
-            if (std::find(rsp.transaction_hashes.begin(), rsp.transaction_hashes.end(), txHash) == rsp.transaction_hashes.end()) {
-              rsp.transaction_hashes.push_back(txHash);
-            }
-            if (m_core.getBlockContainingTx(txHash, blockHash, blockHeight)) {
-              uint32_t confirmations = m_protocolQuery.getObservedHeight() - blockHeight;
-              if  (rsp.confirmations < confirmations) {
-                   rsp.confirmations = confirmations;
-              }
-            }
-          }
-        }
-        ++keyIndex;
+    result.status.clear();
+    for (const auto& hash : parsed[i].transactionHashes) {
+      if (uniqueHashes.insert(hash).second) {
+        transactionHashes.push_back(hash);
       }
     }
-    catch (...)
-    {
-      throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Unknown error" };
-    }  
   }
 
-  rsp.received_amount = received;
+  std::list<Crypto::Hash> missedTransactions;
+  std::list<Transaction> transactions;
+  if (!transactionHashes.empty()) {
+    m_core.getTransactions(transactionHashes, transactions, missedTransactions, true);
+  }
 
-  if (received >= req.amount && rsp.confirmations > 0) {
-    rsp.status = "paid";
+  std::unordered_map<Crypto::Hash, const Transaction*> transactionsByHash;
+  for (const Transaction& transaction : transactions) {
+    transactionsByHash.emplace(getObjectHash(transaction), &transaction);
   }
-  else if (received > 0 && received < req.amount) {
-    rsp.status = "underpaid";
+
+  // one job per (check, transaction) pair, derivations are the expensive part
+  std::vector<PaymentScanJob> jobs;
+  std::vector<std::pair<size_t, Crypto::Hash>> jobOwners;
+  for (size_t i = 0; i < checks.size(); ++i) {
+    if (!results[i].status.empty()) {
+      continue;
+    }
+
+    for (const auto& hash : parsed[i].transactionHashes) {
+      auto it = transactionsByHash.find(hash);
+      if (it == transactionsByHash.end()) {
+        results[i].status = "error";
+        results[i].error = "Couldn't get transaction with hash: " + Common::podToHex(hash) + '.';
+        break;
+      }
+
+      PaymentScanJob job;
+      job.transaction = it->second;
+      job.viewSecretKey = parsed[i].viewKey;
+      job.spendPublicKey = parsed[i].address.spendPublicKey;
+      jobs.push_back(job);
+      jobOwners.emplace_back(i, hash);
+    }
   }
-  else if (rsp.confirmations == 0 && received >= req.amount) {
-    rsp.status = "pending";
+
+  m_paymentScanner.scan(jobs);
+
+  // count confirmations only for actually paying transactions
+  // and include only their hashes in response
+  std::unordered_map<Crypto::Hash, uint32_t> confirmationsByHash;
+  uint32_t observedHeight = m_protocolQuery.getObservedHeight();
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    payment_check_result& result = results[jobOwners[j].first];
+    const Crypto::Hash& transactionHash = jobOwners[j].second;
+    if (!result.status.empty()) {
+      continue;
+    }
+
+    if (jobs[j].derivationFailed) {
+      result.status = "error";
+      result.error = "Failed to generate key derivation from supplied parameters";
+      continue;
+    }
+
+    if (jobs[j].received == 0) {
+      continue;
+    }
+
+    result.received_amount += jobs[j].received;
+    result.transaction_hashes.push_back(transactionHash);
+
+    auto it = confirmationsByHash.find(transactionHash);
+    if (it == confirmationsByHash.end()) {
+      uint32_t confirmations = 0;
+      Crypto::Hash blockHash;
+      uint32_t blockHeight;
+      if (m_core.getBlockContainingTx(transactionHash, blockHash, blockHeight)) {
+        confirmations = observedHeight - blockHeight;
+      }
+
+      it = confirmationsByHash.emplace(transactionHash, confirmations).first;
+    }
+
+    result.confirmations = std::max(result.confirmations, it->second);
   }
-  else {
-    rsp.status = "unpaid";
+
+  for (size_t i = 0; i < checks.size(); ++i) {
+    payment_check_result& result = results[i];
+    if (!result.status.empty()) {
+      if (result.status == "error") {
+        result.transaction_hashes.clear();
+        result.received_amount = 0;
+        result.confirmations = 0;
+      }
+
+      continue;
+    }
+
+    if (result.received_amount >= checks[i].amount && result.confirmations > 0) {
+      result.status = "paid";
+    } else if (result.received_amount > 0 && result.received_amount < checks[i].amount) {
+      result.status = "underpaid";
+    } else if (result.confirmations == 0 && result.received_amount >= checks[i].amount) {
+      result.status = "pending";
+    } else {
+      result.status = "unpaid";
+    }
   }
 
-  return true;
+  return results;
 }
 
 //
@@ -2130,6 +2322,29 @@ bool RpcServer::on_get_stats_by_heights_range(const COMMAND_RPC_GET_STATS_BY_HEI
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_PARAM, "Wrong start and end heights" };
   }
 
+  if (req.buckets != 0) {
+    std::vector<BlockStatsRange> ranges = m_core.getBlockStatsRanges(min, max, std::min(req.buckets, MAX_NUMBER_OF_BUCKETS_PER_STATS_REQUEST));
+    res.buckets.reserve(ranges.size());
+    for (const BlockStatsRange& range : ranges) {
+      block_stats_bucket bucket;
+      bucket.start_height = range.startHeight;
+      bucket.end_height = range.endHeight;
+      bucket.start_timestamp = range.startTimestamp;
+      bucket.end_timestamp = range.endTimestamp;
+      bucket.already_generated_coins = range.alreadyGeneratedCoins;
+      bucket.block_size = { range.blockSize.min, range.blockSize.max, range.blockSize.avg };
+      bucket.difficulty = { range.difficulty.min, range.difficulty.max, range.difficulty.avg };
+      bucket.reward = { range.reward.min, range.reward.max, range.reward.avg };
+      bucket.transactions_count = { range.transactionsCount.min, range.transactionsCount.max, range.transactionsCount.avg };
+      res.buckets.push_back(bucket);
+    }
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+    res.duration = duration.count();
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+
   std::vector<block_stats_entry> stats;
 
   if (m_restricted_rpc) {
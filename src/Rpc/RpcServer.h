@@ -30,8 +30,11 @@
 #include "CoreRpcServerCommandsDefinitions.h"
 #include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
 #include "MevaCoinCore/Core.h"
+#include "MevaCoinCore/ICoreObserver.h"
 #include "Common/Math.h"
+#include "Rpc/ChangesNotifier.h"
 #include "Rpc/RpcServerConfig.h"
+#include "Rpc/PaymentScanner.h"
 #include "Rpc/JsonRpc.h"
 #include "System/Dispatcher.h"
 #include "System/RemoteContext.h"
@@ -43,7 +46,7 @@ class NodeServer;
 class BlockchainExplorer;
 class IMevaCoinProtocolQuery;
 
-class RpcServer {
+class RpcServer : public ICoreObserver {
 public:
   RpcServer(
     RpcServerConfig& config,
@@ -62,12 +65,17 @@ public:
   std::string getCorsDomain();
   size_t getRpcConnectionsCount();
 
+  // ICoreObserver
+  virtual void blockchainUpdated() override;
+  virtual void poolUpdated() override;
+
 private:
 
   template <class Handler>
   struct RpcHandler {
     const Handler handler;
     const bool allowBusyCore;
+    const bool allowCompression = false;
   };
 
   typedef void (RpcServer::* HandlerPtr)(const httplib::Request& request, httplib::Response& response);
@@ -75,15 +83,18 @@ private:
 
   void processRequest(const httplib::Request& request, httplib::Response& response);
   bool processJsonRpcRequest(const httplib::Request& request, httplib::Response& response);
+  void compressResponse(const httplib::Request& request, httplib::Response& response);
   
   // binary handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
   bool on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, COMMAND_RPC_QUERY_BLOCKS::response& res);
   bool on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::request& req, COMMAND_RPC_QUERY_BLOCKS_LITE::response& res);
   bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
+  bool on_get_txs_indexes(const COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response& res);
   bool on_get_random_outs_bin(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
   bool on_get_pool_changes(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp);
   bool on_get_pool_changes_lite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::request& req, COMMAND_RPC_GET_POOL_CHANGES_LITE::response& rsp);
+  bool on_wait_for_changes(const COMMAND_RPC_WAIT_FOR_CHANGES::request& req, COMMAND_RPC_WAIT_FOR_CHANGES::response& rsp);
 
   // http handlers
   bool on_get_index(const COMMAND_HTTP::request& req, COMMAND_HTTP::response& res);
@@ -148,12 +159,14 @@ private:
   bool on_get_stats_by_heights_range(const COMMAND_RPC_GET_STATS_BY_HEIGHTS_RANGE::request& req, COMMAND_RPC_GET_STATS_BY_HEIGHTS_RANGE::response& res);
   bool on_resolve_open_alias(const COMMAND_RPC_RESOLVE_OPEN_ALIAS::request& req, COMMAND_RPC_RESOLVE_OPEN_ALIAS::response& res);
   bool on_check_payment(const COMMAND_RPC_CHECK_PAYMENT_BY_PAYMENT_ID::request& req, COMMAND_RPC_CHECK_PAYMENT_BY_PAYMENT_ID::response& rsp);
+  bool on_check_payments(const COMMAND_RPC_CHECK_PAYMENTS::request& req, COMMAND_RPC_CHECK_PAYMENTS::response& rsp);
 
   void fill_block_header_response(const Block& blk, bool orphan_status, uint32_t height, const Crypto::Hash& hash, block_header_response& responce);
   void listen(const std::string address, const uint16_t port);
   void listen_ssl(const std::string address, const uint16_t port);
   bool isCoreReady();
   bool checkIncomingTransactionForFee(const BinaryArray& tx_blob);
+  std::vector<payment_check_result> checkPayments(const std::vector<payment_check_request>& checks);
 
 
   RpcServerConfig m_config;
@@ -176,6 +189,11 @@ private:
 
   std::list<std::thread> m_workers;
 
+  // long-poll waiters, see on_wait_for_changes
+  ChangesNotifier m_changesNotifier;
+
+  PaymentScanner m_paymentScanner;
+
 };
 
 }
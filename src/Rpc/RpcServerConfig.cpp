@@ -34,6 +34,9 @@ namespace MevaCoin {
     const uint16_t DEFAULT_RPC_SSL_PORT = RPC_DEFAULT_SSL_PORT;
     const std::string DEFAULT_RPC_CHAIN_FILE = std::string(RPC_DEFAULT_CHAIN_FILE);
     const std::string DEFAULT_RPC_KEY_FILE = std::string(RPC_DEFAULT_KEY_FILE);
+    const uint32_t DEFAULT_RPC_COMPRESSION_THRESHOLD = 1024;
+    const uint32_t DEFAULT_RPC_MAX_LONG_POLLS = 0;
+    const uint32_t DEFAULT_RPC_PAYMENT_CHECK_THREADS = 0;
 
     const command_line::arg_descriptor<std::string> arg_rpc_bind_ip     = { "rpc-bind-ip", "", DEFAULT_RPC_IP };
     const command_line::arg_descriptor<uint16_t>    arg_rpc_bind_port   = { "rpc-bind-port", "", DEFAULT_RPC_PORT };
@@ -47,6 +50,10 @@ namespace MevaCoin {
     const command_line::arg_descriptor<std::string> arg_set_fee_address = { "fee-address", "Sets fee address for light wallets.", "" };
     const command_line::arg_descriptor<std::string> arg_set_fee_amount  = { "fee-amount", "Sets flat rate fee for light wallets.", "" };
     const command_line::arg_descriptor<std::string> arg_set_view_key    = { "view-key", "Sets private view key to check for node's fee.", "" };
+    const command_line::arg_descriptor<bool>        arg_disable_compression   = { "rpc-disable-compression", "Never compress RPC responses", false };
+    const command_line::arg_descriptor<uint32_t>    arg_compression_threshold = { "rpc-compression-threshold", "Minimal RPC response size in bytes to be compressed", DEFAULT_RPC_COMPRESSION_THRESHOLD };
+    const command_line::arg_descriptor<uint32_t>    arg_max_long_polls        = { "rpc-max-long-polls", "Maximum number of wallets waiting for block and pool notifications at once, 0 for as many as there are RPC worker threads", DEFAULT_RPC_MAX_LONG_POLLS };
+    const command_line::arg_descriptor<uint32_t>    arg_payment_check_threads = { "rpc-payment-check-threads", "Number of threads scanning outputs for checkpayment(s) requests, 0 to use all CPU cores", DEFAULT_RPC_PAYMENT_CHECK_THREADS };
   }
 
 
@@ -61,7 +68,11 @@ namespace MevaCoin {
     nodeFeeAddress(""),
     nodeFeeAmountStr(""),
     nodeFeeViewKey(""),
-    bindPortSSL(RPC_DEFAULT_SSL_PORT)
+    bindPortSSL(RPC_DEFAULT_SSL_PORT),
+    enableCompression(true),
+    compressionThreshold(DEFAULT_RPC_COMPRESSION_THRESHOLD),
+    maxLongPolls(DEFAULT_RPC_MAX_LONG_POLLS),
+    paymentCheckThreads(DEFAULT_RPC_PAYMENT_CHECK_THREADS)
   {
   }
 
@@ -79,6 +90,10 @@ namespace MevaCoin {
   uint64_t RpcServerConfig::getNodeFeeAmount() const { return nodeFeeAmount; }
   std::string RpcServerConfig::getNodeFeeViewKey() const { return nodeFeeViewKey; }
   std::string RpcServerConfig::getContactInfo() const { return contactInfo; }
+  bool RpcServerConfig::isEnabledCompression() const { return enableCompression; }
+  uint32_t RpcServerConfig::getCompressionThreshold() const { return compressionThreshold; }
+  uint32_t RpcServerConfig::getMaxLongPolls() const { return maxLongPolls; }
+  uint32_t RpcServerConfig::getPaymentCheckThreads() const { return paymentCheckThreads; }
 
   void RpcServerConfig::initOptions(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_rpc_bind_ip);
@@ -93,6 +108,10 @@ namespace MevaCoin {
     command_line::add_arg(desc, arg_set_fee_address);
     command_line::add_arg(desc, arg_set_fee_amount);
     command_line::add_arg(desc, arg_set_view_key);
+    command_line::add_arg(desc, arg_disable_compression);
+    command_line::add_arg(desc, arg_compression_threshold);
+    command_line::add_arg(desc, arg_max_long_polls);
+    command_line::add_arg(desc, arg_payment_check_threads);
   }
 
   void RpcServerConfig::init(const boost::program_options::variables_map& vm)  {
@@ -144,6 +163,19 @@ namespace MevaCoin {
       nodeFeeViewKey = command_line::get_arg(vm, arg_set_view_key);
     }
 
+    if (command_line::has_arg(vm, arg_disable_compression)) {
+      enableCompression = !command_line::get_arg(vm, arg_disable_compression);
+    }
+    if (command_line::has_arg(vm, arg_compression_threshold)) {
+      compressionThreshold = command_line::get_arg(vm, arg_compression_threshold);
+    }
+    if (command_line::has_arg(vm, arg_max_long_polls)) {
+      maxLongPolls = command_line::get_arg(vm, arg_max_long_polls);
+    }
+    if (command_line::has_arg(vm, arg_payment_check_threads)) {
+      paymentCheckThreads = command_line::get_arg(vm, arg_payment_check_threads);
+    }
+
     if (command_line::has_arg(vm, arg_rpc_bind_ssl_enable)) {
       enableSSL = command_line::get_arg(vm, arg_rpc_bind_ssl_enable);
     }
@@ -45,6 +45,10 @@ public:
   uint64_t    getNodeFeeAmount() const;
   std::string getNodeFeeViewKey() const;
   std::string getContactInfo() const;
+  bool        isEnabledCompression() const;
+  uint32_t    getCompressionThreshold() const;
+  uint32_t    getMaxLongPolls() const;
+  uint32_t    getPaymentCheckThreads() const;
 
 private:
   std::string m_data_dir;
@@ -62,6 +66,10 @@ private:
   std::string nodeFeeAmountStr;
   uint64_t    nodeFeeAmount = 0;
   std::string nodeFeeViewKey;
+  bool        enableCompression;
+  uint32_t    compressionThreshold;
+  uint32_t    maxLongPolls;
+  uint32_t    paymentCheckThreads;
 };
 
 }
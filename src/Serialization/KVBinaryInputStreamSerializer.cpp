@@ -11,7 +11,7 @@
 #include <cassert>
 #include <cstring>
 #include <stdexcept>
-#include <Common/StreamTools.h>
+#include <type_traits>
 #include "KVBinaryCommon.h"
 
 using namespace Common;
@@ -19,27 +19,23 @@ using namespace MevaCoin;
 
 namespace {
 
-template <typename T>
-T readPod(Common::IInputStream& s) {
-  T v;
-  read(s, &v, sizeof(T));
-  return v;
-}
-
-template <typename T, typename JsonT = T>
-JsonValue readPodJson(Common::IInputStream& s) {
-  JsonValue jv;
-  jv = static_cast<JsonT>(readPod<T>(s));
-  return jv;
+void checkAvailable(const char* pos, const char* end, size_t size) {
+  if (static_cast<size_t>(end - pos) < size) {
+    throw std::runtime_error("Unexpected end of binary storage");
+  }
 }
 
 template <typename T>
-JsonValue readIntegerJson(Common::IInputStream& s) {
-  return readPodJson<T, int64_t>(s);
+T readPod(const char*& pos, const char* end) {
+  checkAvailable(pos, end, sizeof(T));
+  T v;
+  memcpy(&v, pos, sizeof(T));
+  pos += sizeof(T);
+  return v;
 }
 
-size_t readVarint(Common::IInputStream& s) {
-  uint8_t b = read<uint8_t>(s);
+size_t readVarint(const char*& pos, const char* end) {
+  uint8_t b = readPod<uint8_t>(pos, end);
   uint8_t size_mask = b & PORTABLE_RAW_SIZE_MARK_MASK;
   size_t bytesLeft = 0;
 
@@ -61,7 +57,7 @@ size_t readVarint(Common::IInputStream& s) {
   size_t value = b;
 
   for (size_t i = 1; i <= bytesLeft; ++i) {
-    size_t n = read<uint8_t>(s);
+    size_t n = readPod<uint8_t>(pos, end);
     value |= n << (i * 8);
   }
 
@@ -69,128 +65,296 @@ size_t readVarint(Common::IInputStream& s) {
   return value;
 }
 
-std::string readString(Common::IInputStream& s) {
-  auto size = readVarint(s);
-  if (size > 100 * 1024 * 1024) {
-    throw std::runtime_error("string size is too big");
+// every serialized item takes at least one byte, so a count that exceeds
+// the rest of the buffer can be rejected before anything is allocated
+size_t readCount(const char*& pos, const char* end) {
+  size_t count = readVarint(pos, end);
+  if (count > static_cast<size_t>(end - pos)) {
+    throw std::runtime_error("Item count exceeds binary storage size");
+  }
+
+  return count;
+}
+
+StringView readName(const char*& pos, const char* end) {
+  uint8_t len = readPod<uint8_t>(pos, end);
+  checkAvailable(pos, end, len);
+  StringView name(pos, len);
+  pos += len;
+  return name;
+}
+
+size_t podSize(uint8_t type) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:
+  case BIN_KV_SERIALIZE_TYPE_UINT64:
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE:
+    return 8;
+  case BIN_KV_SERIALIZE_TYPE_INT32:
+  case BIN_KV_SERIALIZE_TYPE_UINT32:
+    return 4;
+  case BIN_KV_SERIALIZE_TYPE_INT16:
+  case BIN_KV_SERIALIZE_TYPE_UINT16:
+    return 2;
+  case BIN_KV_SERIALIZE_TYPE_INT8:
+  case BIN_KV_SERIALIZE_TYPE_UINT8:
+  case BIN_KV_SERIALIZE_TYPE_BOOL:
+    return 1;
+  default:
+    return 0;
   }
+}
+
+template <typename T>
+T loadPod(const char* data) {
+  T v;
+  memcpy(&v, data, sizeof(T));
+  return v;
+}
 
-  std::string str;
-  str.resize(size);
-  if (size) {
-    read(s, &str[0], size);
+template <typename T>
+T loadInteger(uint8_t type, const char* data) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  return static_cast<T>(loadPod<int64_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_INT32:  return static_cast<T>(loadPod<int32_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_INT16:  return static_cast<T>(loadPod<int16_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_INT8:   return static_cast<T>(loadPod<int8_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_UINT64: return static_cast<T>(loadPod<uint64_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_UINT32: return static_cast<T>(loadPod<uint32_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_UINT16: return static_cast<T>(loadPod<uint16_t>(data));
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  return static_cast<T>(loadPod<uint8_t>(data));
+  default:
+    throw std::runtime_error("Integer value expected");
   }
-  return str;
 }
 
-JsonValue readStringJson(Common::IInputStream& s) {
-  return JsonValue(readString(s));
 }
 
-void readName(Common::IInputStream& s, std::string& name) {
-  uint8_t len = readPod<uint8_t>(s);
-  if (len) {
-    name.resize(len);
-    read(s, &name[0], len);
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) {
+  char chunk[4096];
+  size_t readSize;
+  while ((readSize = strm.readSome(chunk, sizeof(chunk))) != 0) {
+    m_buffer.append(chunk, readSize);
   }
+
+  parse(m_buffer.data(), m_buffer.size());
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type);
-JsonValue loadSection(Common::IInputStream& stream);
-JsonValue loadEntry(Common::IInputStream& stream);
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType);
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(const void* data, size_t size) {
+  parse(static_cast<const char*>(data), size);
+}
 
+void KVBinaryInputStreamSerializer::parse(const char* data, size_t size) {
+  const char* pos = data;
+  const char* end = data + size;
 
-JsonValue loadSection(Common::IInputStream& stream) {
-  JsonValue sec(JsonValue::OBJECT);
-  size_t count = readVarint(stream);
-  std::string name;
+  auto hdr = readPod<KVBinaryStorageBlockHeader>(pos, end);
 
-  while (count--) {
-    readName(stream, name);
-    sec.insert(name, loadEntry(stream));
+  if (
+    hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
+    hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
+    throw std::runtime_error("Invalid binary storage signature");
+  }
+
+  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
+    throw std::runtime_error("Unknown binary storage format version");
   }
 
-  return sec;
+  loadSection(pos, end);
+  m_stack.push_back(Level{ 0, 1 });
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type) {
-  switch (type) {
-  case BIN_KV_SERIALIZE_TYPE_INT64:  return readIntegerJson<int64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT32:  return readIntegerJson<int32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT16:  return readIntegerJson<int16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT8:   return readIntegerJson<int8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT64: return readIntegerJson<uint64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT32: return readIntegerJson<uint32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT16: return readIntegerJson<uint16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readIntegerJson<uint8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return readPodJson<double>(stream);
-  case BIN_KV_SERIALIZE_TYPE_BOOL:   return JsonValue(read<uint8_t>(stream) != 0);
-  case BIN_KV_SERIALIZE_TYPE_STRING: return readStringJson(stream);
-  case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(stream);
-  case BIN_KV_SERIALIZE_TYPE_ARRAY:  return loadArray(stream, type);
-  default:
-    throw std::runtime_error("Unknown data type");
-    break;
+void KVBinaryInputStreamSerializer::loadSection(const char*& pos, const char* end) {
+  size_t index = m_entries.size();
+  size_t count = readCount(pos, end);
+  m_entries.push_back(Entry{ StringView::EMPTY, BIN_KV_SERIALIZE_TYPE_OBJECT, false, pos, count, 0 });
+
+  while (count--) {
+    StringView name = readName(pos, end);
+    uint8_t type = readPod<uint8_t>(pos, end);
+
+    if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
+      loadArray(pos, end, type & ~BIN_KV_SERIALIZE_FLAG_ARRAY, name);
+    } else {
+      loadValue(pos, end, type, name);
+    }
   }
+
+  m_entries[index].end = m_entries.size();
 }
 
-JsonValue loadEntry(Common::IInputStream& stream) {
-  uint8_t type = readPod<uint8_t>(stream);
+void KVBinaryInputStreamSerializer::loadValue(const char*& pos, const char* end, uint8_t type, StringView name) {
+  if (type == BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    size_t index = m_entries.size();
+    loadSection(pos, end);
+    m_entries[index].name = name;
+    return;
+  }
 
-  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
-    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
-    return loadArray(stream, type);
+  size_t size;
+  if (type == BIN_KV_SERIALIZE_TYPE_STRING) {
+    size = readVarint(pos, end);
+  } else {
+    size = podSize(type);
+    if (size == 0) {
+      throw std::runtime_error("Unknown data type");
+    }
   }
 
-  return loadValue(stream, type);
+  checkAvailable(pos, end, size);
+  m_entries.push_back(Entry{ name, type, false, pos, size, m_entries.size() + 1 });
+  pos += size;
 }
 
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType) {
-  JsonValue arr(JsonValue::ARRAY);
-  size_t count = readVarint(stream);
+void KVBinaryInputStreamSerializer::loadArray(const char*& pos, const char* end, uint8_t itemType, StringView name) {
+  size_t index = m_entries.size();
+  size_t count = readCount(pos, end);
+  m_entries.push_back(Entry{ name, itemType, true, pos, count, 0 });
 
   while (count--) {
-    arr.pushBack(loadValue(stream, itemType));
+    loadValue(pos, end, itemType, StringView::EMPTY);
   }
 
-  return arr;
+  m_entries[index].end = m_entries.size();
 }
 
+template <typename T>
+bool KVBinaryInputStreamSerializer::getNumber(Common::StringView name, T& v) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
+    return false;
+  }
+
+  if (entry->isArray) {
+    throw std::runtime_error("Numeric value expected");
+  }
 
-JsonValue parseBinary(Common::IInputStream& stream) {
-  auto hdr = readPod<KVBinaryStorageBlockHeader>(stream);
+  if (entry->type == BIN_KV_SERIALIZE_TYPE_DOUBLE) {
+    if (!std::is_floating_point<T>::value) {
+      throw std::runtime_error("Integer value expected");
+    }
 
-  if (
-    hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
-    hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
-    throw std::runtime_error("Invalid binary storage signature");
+    v = static_cast<T>(loadPod<double>(entry->data));
+  } else {
+    v = loadInteger<T>(entry->type, entry->data);
   }
 
-  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
-    throw std::runtime_error("Unknown binary storage format version");
+  return true;
+}
+
+ISerializer::SerializerType KVBinaryInputStreamSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool KVBinaryInputStreamSerializer::beginObject(Common::StringView name) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
+    return false;
   }
 
-  return loadSection(stream);
+  if (entry->isArray || entry->type != BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    throw std::runtime_error("Object expected");
+  }
+
+  size_t index = entry - m_entries.data();
+  m_stack.push_back(Level{ index, index + 1 });
+  return true;
 }
 
+void KVBinaryInputStreamSerializer::endObject() {
+  assert(m_stack.size() > 1);
+  m_stack.pop_back();
 }
 
-KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) : JsonInputValueSerializer(parseBinary(strm)) {
+bool KVBinaryInputStreamSerializer::beginArray(size_t& size, Common::StringView name) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  if (!entry->isArray) {
+    throw std::runtime_error("Array expected");
+  }
+
+  size_t index = entry - m_entries.data();
+  size = entry->size;
+  m_stack.push_back(Level{ index, index + 1 });
+  return true;
 }
 
-bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
-  std::string str;
+void KVBinaryInputStreamSerializer::endArray() {
+  assert(m_stack.size() > 1);
+  m_stack.pop_back();
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
 
-  if (!(*this)(str, name)) {
+bool KVBinaryInputStreamSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(double& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(bool& value, Common::StringView name) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
     return false;
   }
 
-  if (str.size() != size) {
+  if (entry->type != BIN_KV_SERIALIZE_TYPE_BOOL) {
+    throw std::runtime_error("Boolean value expected");
+  }
+
+  value = *entry->data != 0;
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::operator()(std::string& value, Common::StringView name) {
+  Common::StringView view;
+  if (!binaryView(view, name)) {
+    return false;
+  }
+
+  value.assign(view.getData(), view.getSize());
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
+  Common::StringView view;
+  if (!binaryView(view, name)) {
+    return false;
+  }
+
+  if (view.getSize() != size) {
     throw std::runtime_error("Binary block size mismatch");
   }
 
-  memcpy(value, str.data(), size);
+  memcpy(value, view.getData(), size);
   return true;
 }
 
@@ -198,3 +362,50 @@ bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringVie
   return (*this)(value, name); // load as string
 }
 
+bool KVBinaryInputStreamSerializer::binaryView(Common::StringView& value, Common::StringView name) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
+    return false;
+  }
+
+  if (entry->isArray || entry->type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("String value expected");
+  }
+
+  value = Common::StringView(entry->data, entry->size);
+  return true;
+}
+
+const KVBinaryInputStreamSerializer::Entry* KVBinaryInputStreamSerializer::getValue(Common::StringView name) {
+  assert(!m_stack.empty());
+  Level& level = m_stack.back();
+  const Entry& parent = m_entries[level.entry];
+
+  if (parent.isArray) {
+    if (level.cursor == parent.end) {
+      throw std::runtime_error("Array index out of range");
+    }
+
+    const Entry* entry = &m_entries[level.cursor];
+    level.cursor = entry->end;
+    return entry;
+  }
+
+  // fields are usually read in the order they were written, so the search
+  // starts right after the previously found field and wraps around
+  for (size_t i = level.cursor; i < parent.end; i = m_entries[i].end) {
+    if (m_entries[i].name == name) {
+      level.cursor = m_entries[i].end;
+      return &m_entries[i];
+    }
+  }
+
+  for (size_t i = level.entry + 1; i < level.cursor; i = m_entries[i].end) {
+    if (m_entries[i].name == name) {
+      level.cursor = m_entries[i].end;
+      return &m_entries[i];
+    }
+  }
+
+  return nullptr;
+}
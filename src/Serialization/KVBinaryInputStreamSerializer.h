@@ -17,18 +17,83 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
 #include <Common/IInputStream.h>
 #include "ISerializer.h"
-#include "JsonInputValueSerializer.h"
 
 namespace MevaCoin {
 
-class KVBinaryInputStreamSerializer : public JsonInputValueSerializer {
+// Reads the portable storage binary format straight from a contiguous buffer.
+// The body is indexed in a single pass into a flat table of entries pointing
+// into the buffer, so no intermediate value tree is built and blob fields are
+// copied at most once, directly into their destination.
+class KVBinaryInputStreamSerializer : public ISerializer {
 public:
+  // Drains the stream into an internal buffer.
   KVBinaryInputStreamSerializer(Common::IInputStream& strm);
+  // Works on the caller's buffer, which must outlive the serializer and any
+  // view returned by binaryView().
+  KVBinaryInputStreamSerializer(const void* data, size_t size);
+  virtual ~KVBinaryInputStreamSerializer() {}
 
+  virtual SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+
+  // Zero-copy access to a blob field: the view points into the source buffer.
+  bool binaryView(Common::StringView& value, Common::StringView name);
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  struct Entry {
+    Common::StringView name;
+    uint8_t type;
+    bool isArray;
+    const char* data;
+    size_t size; // payload length for strings, item count for objects and arrays
+    size_t end;  // index of the entry following this one and all its children
+  };
+
+  struct Level {
+    size_t entry;
+    size_t cursor;
+  };
+
+  void parse(const char* data, size_t size);
+  void loadSection(const char*& pos, const char* end);
+  void loadValue(const char*& pos, const char* end, uint8_t type, Common::StringView name);
+  void loadArray(const char*& pos, const char* end, uint8_t itemType, Common::StringView name);
+
+  const Entry* getValue(Common::StringView name);
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v);
+
+  std::string m_buffer;
+  std::vector<Entry> m_entries;
+  std::vector<Level> m_stack;
 };
 
 }
@@ -17,6 +17,7 @@
 // along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 #include <limits>
 
@@ -35,10 +36,10 @@ void writePod(IOutputStream& s, const T& value) {
 }
 
 template<class T>
-size_t packVarint(IOutputStream& s, uint8_t type_or, size_t pv) {
+size_t packVarint(uint8_t* out, uint8_t type_or, size_t pv) {
   T v = static_cast<T>(pv << 2);
   v |= type_or;
-  write(s, &v, sizeof(T));
+  memcpy(out, &v, sizeof(T));
   return sizeof(T);
 }
 
@@ -52,18 +53,34 @@ void writeElementName(IOutputStream& s, Common::StringView name) {
   write(s, name.getData(), len);
 }
 
-size_t writeArraySize(IOutputStream& s, size_t val) {
+size_t packArraySize(uint8_t* out, size_t val) {
   if (val <= 63) {
-    return packVarint<uint8_t>(s, PORTABLE_RAW_SIZE_MARK_BYTE, val);
+    return packVarint<uint8_t>(out, PORTABLE_RAW_SIZE_MARK_BYTE, val);
   } else if (val <= 16383) {
-    return packVarint<uint16_t>(s, PORTABLE_RAW_SIZE_MARK_WORD, val);
+    return packVarint<uint16_t>(out, PORTABLE_RAW_SIZE_MARK_WORD, val);
   } else if (val <= 1073741823) {
-    return packVarint<uint32_t>(s, PORTABLE_RAW_SIZE_MARK_DWORD, val);
+    return packVarint<uint32_t>(out, PORTABLE_RAW_SIZE_MARK_DWORD, val);
   } else {
     if (val > 4611686018427387903) {
       throw std::runtime_error("failed to pack varint - too big amount");
     }
-    return packVarint<uint64_t>(s, PORTABLE_RAW_SIZE_MARK_INT64, val);
+    return packVarint<uint64_t>(out, PORTABLE_RAW_SIZE_MARK_INT64, val);
+  }
+}
+
+size_t writeArraySize(IOutputStream& s, size_t val) {
+  uint8_t packed[sizeof(uint64_t)];
+  size_t size = packArraySize(packed, val);
+  write(s, packed, size);
+  return size;
+}
+
+void patchArraySize(std::vector<uint8_t>& buffer, size_t offset, size_t val) {
+  uint8_t packed[sizeof(uint64_t)];
+  size_t size = packArraySize(packed, val);
+  buffer[offset] = packed[0];
+  if (size > 1) {
+    buffer.insert(buffer.begin() + offset + 1, packed + 1, packed + size);
   }
 }
 
@@ -71,12 +88,11 @@ size_t writeArraySize(IOutputStream& s, size_t val) {
 
 namespace MevaCoin {
 
-KVBinaryOutputStreamSerializer::KVBinaryOutputStreamSerializer() {
-  beginObject(std::string());
+KVBinaryOutputStreamSerializer::KVBinaryOutputStreamSerializer() : m_stream(m_buffer) {
+  m_stack.push_back(Level(std::string(), 0));
 }
 
 void KVBinaryOutputStreamSerializer::dump(IOutputStream& target) {
-  assert(m_objectsStack.size() == 1);
   assert(m_stack.size() == 1);
 
   KVBinaryStorageBlockHeader hdr;
@@ -86,7 +102,7 @@ void KVBinaryOutputStreamSerializer::dump(IOutputStream& target) {
 
   Common::write(target, &hdr, sizeof(hdr));
   writeArraySize(target, m_stack.front().count);
-  write(target, stream().data(), stream().size());
+  write(target, m_buffer.data(), m_buffer.size());
 }
 
 ISerializer::SerializerType KVBinaryOutputStreamSerializer::type() const {
@@ -94,33 +110,24 @@ ISerializer::SerializerType KVBinaryOutputStreamSerializer::type() const {
 }
 
 bool KVBinaryOutputStreamSerializer::beginObject(Common::StringView name) {
-  checkArrayPreamble(BIN_KV_SERIALIZE_TYPE_OBJECT);
- 
-  m_stack.push_back(Level(name));
-  m_objectsStack.push_back(MemoryStream());
+  writeElementPrefix(BIN_KV_SERIALIZE_TYPE_OBJECT, name);
+
+  m_stack.push_back(Level(name, m_buffer.size()));
+  m_buffer.push_back(0);
 
   return true;
 }
 
 void KVBinaryOutputStreamSerializer::endObject() {
-  assert(m_objectsStack.size());
+  assert(m_stack.size() > 1);
 
-  auto level = std::move(m_stack.back());
+  const Level& level = m_stack.back();
+  patchArraySize(m_buffer, level.countOffset, level.count);
   m_stack.pop_back();
-
-  auto objStream = std::move(m_objectsStack.back());
-  m_objectsStack.pop_back();
-
-  auto& out = stream();
-
-  writeElementPrefix(BIN_KV_SERIALIZE_TYPE_OBJECT, level.name);
-
-  writeArraySize(out, level.count);
-  write(out, objStream.data(), objStream.size());
 }
 
 bool KVBinaryOutputStreamSerializer::beginArray(size_t& size, Common::StringView name) {
-  m_stack.push_back(Level(name, size));
+  m_stack.push_back(Level(name, size, 0));
   return true;
 }
 
@@ -244,9 +251,8 @@ void KVBinaryOutputStreamSerializer::checkArrayPreamble(uint8_t type) {
 }
 
 
-MemoryStream& KVBinaryOutputStreamSerializer::stream() {
-  assert(m_objectsStack.size());
-  return m_objectsStack.back();
+IOutputStream& KVBinaryOutputStreamSerializer::stream() {
+  return m_stream;
 }
 
 }
@@ -19,8 +19,8 @@
 
 #include <vector>
 #include <Common/IOutputStream.h>
+#include <Common/VectorOutputStream.h>
 #include "ISerializer.h"
-#include "MemoryStream.h"
 
 namespace MevaCoin {
 
@@ -62,8 +62,7 @@ private:
 
   void writeElementPrefix(uint8_t type, Common::StringView name);
   void checkArrayPreamble(uint8_t type);
-  void updateState(uint8_t type);
-  MemoryStream& stream();
+  Common::IOutputStream& stream();
 
   enum class State {
     Root,
@@ -76,22 +75,20 @@ private:
     State state;
     std::string name;
     size_t count;
+    size_t countOffset;
 
-    Level(Common::StringView nm) :
-      name(nm), state(State::Object), count(0) {}
-
-    Level(Common::StringView nm, size_t arraySize) :
-      name(nm), state(State::ArrayPrefix), count(arraySize) {}
-
-    Level(Level&& rv) {
-      state = rv.state;
-      name = std::move(rv.name);
-      count = rv.count;
-    }
+    Level(Common::StringView nm, size_t offset) :
+      name(nm), state(State::Object), count(0), countOffset(offset) {}
 
+    Level(Common::StringView nm, size_t arraySize, size_t offset) :
+      name(nm), state(State::ArrayPrefix), count(arraySize), countOffset(offset) {}
   };
 
-  std::vector<MemoryStream> m_objectsStack;
+  // all sections are written into one buffer; a section's item count is
+  // only known when it ends, so a single byte is reserved for it up front
+  // and widened in place in the rare case it does not fit
+  std::vector<uint8_t> m_buffer;
+  Common::VectorOutputStream m_stream;
   std::vector<Level> m_stack;
 };
 
@@ -19,6 +19,7 @@
 
 #include "BlockchainSynchronizer.h"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -38,6 +39,12 @@ using namespace Logging;
 namespace {
 
 const int RETRY_TIMEOUT = 5;
+// consumers further behind get their own requests, so the rest don't wait for them to scan the chain
+const uint32_t CATCH_UP_HEIGHT_GAP = 1000;
+
+bool isCatchingUp(uint32_t height, uint32_t topHeight) {
+  return height + CATCH_UP_HEIGHT_GAP < topHeight;
+}
 
 class TransactionReaderListFormatter {
 public:
@@ -138,6 +145,36 @@ std::vector<Crypto::Hash> BlockchainSynchronizer::getConsumerKnownBlocks(IBlockc
   return state->getKnownBlockHashes();
 }
 
+// unlike the getters above these may be called while synchronizing, the states change only under m_consumersMutex
+uint32_t BlockchainSynchronizer::getConsumerHeight(IBlockchainConsumer& consumer) const {
+  std::unique_lock<std::mutex> lk(m_consumersMutex);
+
+  auto it = m_consumers.find(&consumer);
+  if (it == m_consumers.end()) {
+    auto message = "Failed to get consumer height: not found";
+    m_logger(ERROR, BRIGHT_RED) << message << ", consumer " << &consumer;
+    throw std::invalid_argument(message);
+  }
+
+  return it->second->getHeight();
+}
+
+bool BlockchainSynchronizer::isConsumerCaughtUp(IBlockchainConsumer& consumer, IBlockchainConsumer& leader) const {
+  std::unique_lock<std::mutex> lk(m_consumersMutex);
+
+  auto it = m_consumers.find(&consumer);
+  auto leaderIt = m_consumers.find(&leader);
+  if (it == m_consumers.end() || leaderIt == m_consumers.end()) {
+    auto message = "Failed to compare consumers: not found";
+    m_logger(ERROR, BRIGHT_RED) << message << ", consumer " << &consumer << ", leader " << &leader;
+    throw std::invalid_argument(message);
+  }
+
+  const auto& blocks = it->second->getKnownBlockHashes();
+  const auto& leaderBlocks = leaderIt->second->getKnownBlockHashes();
+  return blocks.size() == leaderBlocks.size() && blocks.back() == leaderBlocks.back();
+}
+
 std::future<std::error_code> BlockchainSynchronizer::addUnconfirmedTransaction(const ITransactionReader& transaction) {
   m_logger(DEBUGGING, BRIGHT_WHITE) << "Adding unconfirmed transaction, hash " << transaction.getTransactionHash();
 
@@ -176,6 +213,24 @@ std::future<void> BlockchainSynchronizer::removeUnconfirmedTransaction(const Cry
   return future;
 }
 
+std::future<void> BlockchainSynchronizer::runBetweenSteps(std::function<void()>&& task) {
+  std::unique_lock<std::mutex> lock(m_stateMutex);
+
+  // right after start() the current state is still stopped, the working thread runs the task once it is up
+  if (m_futureState == State::stopped) {
+    auto message = "Failed to run task: not started";
+    m_logger(ERROR, BRIGHT_RED) << message;
+    throw std::runtime_error(message);
+  }
+
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  m_betweenStepsTasks.emplace_back(std::move(task), std::move(promise));
+  m_hasWork.notify_one();
+
+  return future;
+}
+
 std::error_code BlockchainSynchronizer::doAddUnconfirmedTransaction(const ITransactionReader& transaction) {
   std::unique_lock<std::mutex> lk(m_consumersMutex);
 
@@ -248,7 +303,34 @@ bool BlockchainSynchronizer::setFutureStateIf(State s, std::function<bool(void)>
   return false;
 }
 
+void BlockchainSynchronizer::runBetweenStepsTasks() {
+  std::unique_lock<std::mutex> lk(m_stateMutex);
+  if (m_betweenStepsTasks.empty()) {
+    return;
+  }
+
+  auto tasks = std::move(m_betweenStepsTasks);
+  m_betweenStepsTasks.clear();
+  lk.unlock();
+
+  // the tasks are free to use the synchronizer, so they run without the state lock
+  m_runningBetweenSteps = true;
+  for (auto& task : tasks) {
+    try {
+      task.first();
+      task.second.set_value();
+    } catch (...) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to run task between synchronization steps";
+      task.second.set_exception(std::current_exception());
+    }
+  }
+
+  m_runningBetweenSteps = false;
+}
+
 void BlockchainSynchronizer::actualizeFutureState() {
+  runBetweenStepsTasks();
+
   std::unique_lock<std::mutex> lk(m_stateMutex);
   if (m_currentState == State::stopped && (m_futureState == State::deleteOldTxs || m_futureState == State::blockchainSync)) { // start(), immideately attach observer
     m_node.addObserver(this);
@@ -310,7 +392,7 @@ void BlockchainSynchronizer::actualizeFutureState() {
   case State::idle:
     m_logger(DEBUGGING) << "Idle";
     m_hasWork.wait(lk, [this] {
-      return m_futureState != State::idle || !m_removeTransactionTasks.empty() || !m_addTransactionTasks.empty();
+      return m_futureState != State::idle || !m_removeTransactionTasks.empty() || !m_addTransactionTasks.empty() || !m_betweenStepsTasks.empty();
     });
     m_logger(DEBUGGING) << "Resume";
     lk.unlock();
@@ -379,6 +461,8 @@ void BlockchainSynchronizer::stop() {
   }
 
   workingThread.reset();
+  // a request still in flight keeps its buffers alive by itself
+  m_prefetchedBlocks.reset();
   m_logger(DEBUGGING, BRIGHT_WHITE) << "Stopped";
 }
 
@@ -398,15 +482,24 @@ void BlockchainSynchronizer::poolChanged() {
 }
 //--------------------------- FSM END ------------------------------------
 
-void BlockchainSynchronizer::getPoolUnionAndIntersection(std::unordered_set<Crypto::Hash>& poolUnion, std::unordered_set<Crypto::Hash>& poolIntersection) const {
+void BlockchainSynchronizer::getPoolUnionAndIntersection(std::unordered_set<Crypto::Hash>& poolUnion, std::unordered_set<Crypto::Hash>& poolIntersection, bool leadingOnly) const {
   std::unique_lock<std::mutex> lk(m_consumersMutex);
 
-  auto itConsumers = m_consumers.begin();
+  uint32_t topHeight = getTopHeight();
+  auto isSkipped = [leadingOnly, topHeight](const ConsumersMap::value_type& kv) {
+    return leadingOnly && isCatchingUp(kv.second->getHeight(), topHeight);
+  };
+
+  auto itConsumers = std::find_if_not(m_consumers.begin(), m_consumers.end(), isSkipped);
   poolUnion = itConsumers->first->getKnownPoolTxIds();
   poolIntersection = itConsumers->first->getKnownPoolTxIds();
   ++itConsumers;
 
   for (; itConsumers != m_consumers.end(); ++itConsumers) {
+    if (isSkipped(*itConsumers)) {
+      continue;
+    }
+
     const std::unordered_set<Crypto::Hash>& consumerKnownIds = itConsumers->first->getKnownPoolTxIds();
 
     poolUnion.insert(consumerKnownIds.begin(), consumerKnownIds.end());
@@ -423,6 +516,16 @@ void BlockchainSynchronizer::getPoolUnionAndIntersection(std::unordered_set<Cryp
   m_logger(DEBUGGING) << "Pool union size " << poolUnion.size() << ", intersection size " << poolIntersection.size();
 }
 
+/// \pre m_consumersMutex is locked
+uint32_t BlockchainSynchronizer::getTopHeight() const {
+  uint32_t topHeight = 0;
+  for (const auto& kv : m_consumers) {
+    topHeight = std::max(topHeight, kv.second->getHeight());
+  }
+
+  return topHeight;
+}
+
 BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistory() {
   GetBlocksRequest request;
   std::unique_lock<std::mutex> lk(m_consumersMutex);
@@ -430,21 +533,42 @@ BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistor
     return request;
   }
 
-  auto shortest = m_consumers.begin();
-  auto syncStart = shortest->first->getSyncStart();
-  auto it = shortest;
-  ++it;
-  for (; it != m_consumers.end(); ++it) {
+  uint32_t topHeight = getTopHeight();
+  auto isLagging = [topHeight](const ConsumersMap::value_type& kv) {
+    return isCatchingUp(kv.second->getHeight(), topHeight);
+  };
+
+  // a newly added consumer scanning from far back alternates with the rest instead of holding them back
+  if (std::any_of(m_consumers.begin(), m_consumers.end(), isLagging)) {
+    m_catchUpTurn = !m_catchUpTurn;
+    request.catchUp = m_catchUpTurn;
+    request.leadingOnly = !m_catchUpTurn;
+  }
+
+  auto shortest = m_consumers.end();
+  SynchronizationStart syncStart;
+  for (auto it = m_consumers.begin(); it != m_consumers.end(); ++it) {
+    if (isLagging(*it) != request.catchUp) {
+      continue;
+    }
+
+    auto consumerStart = it->first->getSyncStart();
+    if (shortest == m_consumers.end()) {
+      shortest = it;
+      syncStart = consumerStart;
+      continue;
+    }
+
     if (it->second->getHeight() < shortest->second->getHeight()) {
       shortest = it;
     }
 
-    auto consumerStart = it->first->getSyncStart();
     syncStart.timestamp = std::min(syncStart.timestamp, consumerStart.timestamp);
     syncStart.height = std::min(syncStart.height, consumerStart.height);
   }
 
-  m_logger(DEBUGGING) << "Shortest chain size " << shortest->second->getHeight();
+  assert(shortest != m_consumers.end());
+  m_logger(DEBUGGING) << "Shortest chain size " << shortest->second->getHeight() << (request.catchUp ? ", catching up" : "");
 
   request.knownBlocks = shortest->second->getShortHistory(m_node.getLastLocalBlockHeight());
   request.syncStart = syncStart;
@@ -462,20 +586,23 @@ void BlockchainSynchronizer::startBlockchainSync() {
 
   try {
     if (!req.knownBlocks.empty()) {
-      auto queryBlocksCompleted = std::promise<std::error_code>();
-      auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
-
-      m_node.queryBlocks(
-        std::move(req.knownBlocks),
-        req.syncStart.timestamp,
-        response.newBlocks,
-        response.startHeight,
-        [&queryBlocksCompleted](std::error_code ec) {
-          auto detachedPromise = std::move(queryBlocksCompleted);
-          detachedPromise.set_value(ec);
-        });
-
-      std::error_code ec = queryBlocksWaitFuture.get();
+      std::error_code ec;
+      if (!takePrefetchedBlocks(req, response)) {
+        auto queryBlocksCompleted = std::promise<std::error_code>();
+        auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
+
+        m_node.queryBlocks(
+          std::vector<Crypto::Hash>(req.knownBlocks),
+          req.syncStart.timestamp,
+          response.newBlocks,
+          response.startHeight,
+          [&queryBlocksCompleted](std::error_code ec) {
+            auto detachedPromise = std::move(queryBlocksCompleted);
+            detachedPromise.set_value(ec);
+          });
+
+        ec = queryBlocksWaitFuture.get();
+      }
 
       if (ec) {
         m_logger(ERROR, BRIGHT_RED) << "Failed to query blocks: " << ec << ", " << ec.message();
@@ -483,7 +610,8 @@ void BlockchainSynchronizer::startBlockchainSync() {
         m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, ec);
       } else {
         m_logger(DEBUGGING) << "Blocks received, start index " << response.startHeight << ", count " << response.newBlocks.size();
-        processBlocks(response);
+        prefetchBlocks(req, response);
+        processBlocks(req, response);
       }
     }
   } catch (const std::exception& e) {
@@ -493,7 +621,73 @@ void BlockchainSynchronizer::startBlockchainSync() {
   }
 }
 
-void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
+void BlockchainSynchronizer::prefetchBlocks(const GetBlocksRequest& request, const GetBlocksResponse& response) {
+  // Only a full batch is followed by more blocks. The batch size limit is the node's, so a batch is taken
+  // as full unless it reaches the top of the node chain; the next request after such one would get the
+  // common block only. Alternating requests of consumers far apart never continue each other
+  if (response.newBlocks.size() < 2 || request.leadingOnly || request.catchUp || checkIfShouldStop()) {
+    return;
+  }
+
+  uint32_t lastBlockHeight = response.startHeight + static_cast<uint32_t>(response.newBlocks.size()) - 1;
+  if (lastBlockHeight >= m_node.getLastLocalBlockHeight()) {
+    return;
+  }
+
+  // consumers are expected to end at the last received block once this batch is processed
+  auto prefetched = std::make_shared<PrefetchedBlocks>();
+  prefetched->anchorBlock = response.newBlocks.back().blockHash;
+  prefetched->timestamp = request.syncStart.timestamp;
+  m_prefetchedBlocksFuture = prefetched->completed.get_future();
+
+  std::vector<Crypto::Hash> knownBlocks;
+  knownBlocks.reserve(request.knownBlocks.size() + 1);
+  knownBlocks.push_back(prefetched->anchorBlock);
+  knownBlocks.insert(knownBlocks.end(), request.knownBlocks.begin(), request.knownBlocks.end());
+
+  m_logger(DEBUGGING) << "Prefetch blocks after " << prefetched->anchorBlock;
+
+  m_prefetchedBlocks = prefetched;
+  // the callback owns the buffers, so a discarded request may safely complete later
+  m_node.queryBlocks(
+    std::move(knownBlocks),
+    prefetched->timestamp,
+    prefetched->response.newBlocks,
+    prefetched->response.startHeight,
+    [prefetched](std::error_code ec) {
+      prefetched->completed.set_value(ec);
+    });
+}
+
+bool BlockchainSynchronizer::takePrefetchedBlocks(const GetBlocksRequest& request, GetBlocksResponse& response) {
+  if (!m_prefetchedBlocks) {
+    return false;
+  }
+
+  std::shared_ptr<PrefetchedBlocks> prefetched = std::move(m_prefetchedBlocks);
+
+  // detach, failed consumer update or new consumer: the speculative batch doesn't continue the common history
+  if (request.knownBlocks.front() != prefetched->anchorBlock || request.syncStart.timestamp != prefetched->timestamp) {
+    m_logger(DEBUGGING) << "Discard prefetched blocks after " << prefetched->anchorBlock;
+    return false;
+  }
+
+  std::error_code ec = m_prefetchedBlocksFuture.get();
+  if (ec) {
+    m_logger(DEBUGGING) << "Failed to prefetch blocks: " << ec << ", " << ec.message();
+    return false;
+  }
+
+  // nothing new at the time of the request, query again to pick up blocks arrived since then
+  if (prefetched->response.newBlocks.size() < 2) {
+    return false;
+  }
+
+  response = std::move(prefetched->response);
+  return true;
+}
+
+void BlockchainSynchronizer::processBlocks(const GetBlocksRequest& request, GetBlocksResponse& response) {
   m_logger(DEBUGGING) << "Process blocks, start index " << response.startHeight << ", count " << response.newBlocks.size();
 
   BlockchainInterval interval;
@@ -542,6 +736,12 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
       break;
 
     case UpdateConsumersResult::nothingChanged:
+      if (request.leadingOnly) {
+        // the leading consumers are at the top, they sync the pool before the consumers behind get the next request
+        m_catchUpAfterPoolSync = true;
+        break;
+      }
+
       if (m_node.getKnownBlockCount() != m_node.getLocalBlockCount()) {
         m_logger(DEBUGGING) << "Blockchain updated, resume blockchain synchronization";
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -551,6 +751,11 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
 
     case UpdateConsumersResult::addedNewBlocks:
       setFutureState(State::blockchainSync);
+      if (request.catchUp) {
+        // progress is reported for the consumers at the top
+        break;
+      }
+
       m_observerManager.notify(
         &IBlockchainSynchronizerObserver::synchronizationProgressUpdated,
         processedBlockCount,
@@ -579,6 +784,11 @@ BlockchainSynchronizer::UpdateConsumersResult BlockchainSynchronizer::updateCons
 
   uint32_t lastBlockIndex = std::numeric_limits<uint32_t>::max();
   for (auto& kv : m_consumers) {
+    if (kv.second->getHeight() < interval.startHeight) {
+      // far behind, continued by its own requests
+      continue;
+    }
+
     auto result = kv.second->checkInterval(interval);
 
     if (result.detachRequired) {
@@ -636,7 +846,7 @@ void BlockchainSynchronizer::removeOutdatedTransactions() {
 
   std::unordered_set<Crypto::Hash> unionPoolHistory;
   std::unordered_set<Crypto::Hash> ignored;
-  getPoolUnionAndIntersection(unionPoolHistory, ignored);
+  getPoolUnionAndIntersection(unionPoolHistory, ignored, false);
 
   GetPoolRequest request;
   request.knownTxIds.assign(unionPoolHistory.begin(), unionPoolHistory.end());
@@ -684,7 +894,8 @@ void BlockchainSynchronizer::startPoolSync() {
 
   std::unordered_set<Crypto::Hash> unionPoolHistory;
   std::unordered_set<Crypto::Hash> intersectedPoolHistory;
-  getPoolUnionAndIntersection(unionPoolHistory, intersectedPoolHistory);
+  // consumers catching up get the pool once they reach the rest
+  getPoolUnionAndIntersection(unionPoolHistory, intersectedPoolHistory, true);
 
   GetPoolRequest unionRequest;
   unionRequest.knownTxIds.assign(unionPoolHistory.begin(), unionPoolHistory.end());
@@ -740,6 +951,11 @@ void BlockchainSynchronizer::startPoolSync() {
       }
     }
   }
+
+  if (m_catchUpAfterPoolSync) {
+    m_catchUpAfterPoolSync = false;
+    setFutureState(State::blockchainSync);
+  }
 }
 
 std::error_code BlockchainSynchronizer::getPoolSymmetricDifferenceSync(GetPoolRequest&& request, GetPoolResponse& response) {
@@ -767,12 +983,17 @@ std::error_code BlockchainSynchronizer::processPoolTxs(GetPoolResponse& response
   std::error_code error;
   {
     std::unique_lock<std::mutex> lk(m_consumersMutex);
+    uint32_t topHeight = getTopHeight();
     for (auto& consumer : m_consumers) {
       if (checkIfShouldStop()) { //if stop, return immediately, without notification
         m_logger(WARNING, BRIGHT_YELLOW) << "Pool transactions processing is interrupted";
         return std::make_error_code(std::errc::interrupted);
       }
 
+      if (isCatchingUp(consumer.second->getHeight(), topHeight)) {
+        continue;
+      }
+
       error = consumer.first->onPoolUpdated(response.newTxs, response.deletedTxIds);
       if (error) {
         m_logger(ERROR, BRIGHT_RED) << "Failed to process pool transactions: " << error << ", " << error.message() << ", consumer " << consumer.first;
@@ -792,7 +1013,7 @@ std::error_code BlockchainSynchronizer::processPoolTxs(GetPoolResponse& response
 SynchronizationState* BlockchainSynchronizer::getConsumerSynchronizationState(IBlockchainConsumer* consumer) const {
   assert(consumer != nullptr);
 
-  if (!(checkIfStopped() && checkIfShouldStop())) {
+  if (!m_runningBetweenSteps && !(checkIfStopped() && checkIfShouldStop())) {
     auto message = "Failed to get consumer state: not stopped";
     m_logger(ERROR, BRIGHT_RED) << message << ", consumer " << consumer;
     throw std::runtime_error(message);
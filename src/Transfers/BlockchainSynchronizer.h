@@ -25,6 +25,7 @@
 #include "IStreamSerializable.h"
 
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <atomic>
 #include <future>
@@ -46,10 +47,15 @@ public:
   virtual bool removeConsumer(IBlockchainConsumer* consumer) override;
   virtual IStreamSerializable* getConsumerState(IBlockchainConsumer* consumer) const override;
   virtual std::vector<Crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer) const override;
+  virtual uint32_t getConsumerHeight(IBlockchainConsumer& consumer) const override;
+  virtual bool isConsumerCaughtUp(IBlockchainConsumer& consumer, IBlockchainConsumer& leader) const override;
 
   virtual std::future<std::error_code> addUnconfirmedTransaction(const ITransactionReader& transaction) override;
   virtual std::future<void> removeUnconfirmedTransaction(const Crypto::Hash& transactionHash) override;
 
+  // Runs the task on the working thread between two synchronization steps, when no consumer is being updated
+  std::future<void> runBetweenSteps(std::function<void()>&& task);
+
   virtual void start() override;
   virtual void stop() override;
 
@@ -70,12 +76,23 @@ private:
   };
 
   struct GetBlocksRequest {
-    GetBlocksRequest() {
+    GetBlocksRequest() : leadingOnly(false), catchUp(false) {
       syncStart.timestamp = 0;
       syncStart.height = 0;
     }
     SynchronizationStart syncStart;
     std::vector<Crypto::Hash> knownBlocks;
+    // consumers far behind the rest are served by every other request
+    bool leadingOnly;
+    bool catchUp;
+  };
+
+  // next batch of blocks, requested while the current one is processed by consumers
+  struct PrefetchedBlocks {
+    Crypto::Hash anchorBlock;
+    uint64_t timestamp;
+    GetBlocksResponse response;
+    std::promise<std::error_code> completed;
   };
 
   struct GetPoolResponse {
@@ -108,7 +125,9 @@ private:
   void startPoolSync();
   void startBlockchainSync();
 
-  void processBlocks(GetBlocksResponse& response);
+  void prefetchBlocks(const GetBlocksRequest& request, const GetBlocksResponse& response);
+  bool takePrefetchedBlocks(const GetBlocksRequest& request, GetBlocksResponse& response);
+  void processBlocks(const GetBlocksRequest& request, GetBlocksResponse& response);
   UpdateConsumersResult updateConsumers(const BlockchainInterval& interval, const std::vector<CompleteBlock>& blocks);
   std::error_code processPoolTxs(GetPoolResponse& response);
   std::error_code getPoolSymmetricDifferenceSync(GetPoolRequest&& request, GetPoolResponse& response);
@@ -119,14 +138,16 @@ private:
   bool setFutureState(State s); 
   bool setFutureStateIf(State s, std::function<bool(void)>&& pred);
 
+  void runBetweenStepsTasks();
   void actualizeFutureState();
   bool checkIfShouldStop() const;
   bool checkIfStopped() const;
 
   void workingProcedure();
 
+  uint32_t getTopHeight() const;
   GetBlocksRequest getCommonHistory();
-  void getPoolUnionAndIntersection(std::unordered_set<Crypto::Hash>& poolUnion, std::unordered_set<Crypto::Hash>& poolIntersection) const;
+  void getPoolUnionAndIntersection(std::unordered_set<Crypto::Hash>& poolUnion, std::unordered_set<Crypto::Hash>& poolIntersection, bool leadingOnly) const;
   SynchronizationState* getConsumerSynchronizationState(IBlockchainConsumer* consumer) const ;
 
   typedef std::map<IBlockchainConsumer*, std::shared_ptr<SynchronizationState>> ConsumersMap;
@@ -143,12 +164,19 @@ private:
   std::unique_ptr<std::thread> workingThread;
   std::list<std::pair<const ITransactionReader*, std::promise<std::error_code>>> m_addTransactionTasks;
   std::list<std::pair<const Crypto::Hash*, std::promise<void>>> m_removeTransactionTasks;
+  std::list<std::pair<std::function<void()>, std::promise<void>>> m_betweenStepsTasks;
+  std::shared_ptr<PrefetchedBlocks> m_prefetchedBlocks;
+  std::future<std::error_code> m_prefetchedBlocksFuture;
 
   mutable std::mutex m_consumersMutex;
   mutable std::mutex m_stateMutex;
   std::condition_variable m_hasWork;
 
   bool wasStarted = false;
+  // consumer states may be read by the tasks run between steps, the working thread doesn't change them meanwhile
+  std::atomic<bool> m_runningBetweenSteps{false};
+  bool m_catchUpTurn = false;
+  bool m_catchUpAfterPoolSync = false;
 };
 
 }
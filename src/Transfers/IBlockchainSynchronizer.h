@@ -73,6 +73,9 @@ public:
   virtual bool removeConsumer(IBlockchainConsumer* consumer) = 0;
   virtual IStreamSerializable* getConsumerState(IBlockchainConsumer* consumer) const = 0;
   virtual std::vector<Crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer) const = 0;
+  virtual uint32_t getConsumerHeight(IBlockchainConsumer& consumer) const = 0;
+  // true if the consumer has processed the same blocks as the leader
+  virtual bool isConsumerCaughtUp(IBlockchainConsumer& consumer, IBlockchainConsumer& leader) const = 0;
 
   virtual std::future<std::error_code> addUnconfirmedTransaction(const ITransactionReader& transaction) = 0;
   virtual std::future<void> removeUnconfirmedTransaction(const Crypto::Hash& transactionHash) = 0;
@@ -0,0 +1,117 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "OutputsScanner.h"
+
+#include <memory>
+
+#include "MevaCoinCore/MevaCoinBasic.h"
+
+namespace MevaCoin {
+
+void findMyOutputs(
+  const std::vector<const ITransactionReader*>& transactions,
+  const Crypto::SecretKey& viewSecretKey,
+  const std::unordered_set<Crypto::PublicKey>& spendKeys,
+  std::vector<OwnedOutputs>& outputs) {
+
+  size_t count = transactions.size();
+  outputs.clear();
+  outputs.resize(count);
+  if (count == 0) {
+    return;
+  }
+
+  std::vector<Crypto::PublicKey> transactionKeys(count);
+  for (size_t i = 0; i < count; ++i) {
+    transactionKeys[i] = transactions[i]->getTransactionPublicKey();
+  }
+
+  std::vector<Crypto::KeyDerivation> derivations(count);
+  std::unique_ptr<bool[]> derivationValid(new bool[count]);
+  Crypto::generate_key_derivations(transactionKeys.data(), count, viewSecretKey, derivations.data(), derivationValid.get());
+
+  // every output key of the batch with its derivation and key index
+  std::vector<Crypto::KeyDerivation> keyDerivations;
+  std::vector<size_t> keyIndexes;
+  std::vector<Crypto::PublicKey> keys;
+  std::vector<std::pair<size_t, uint32_t>> keyOutputs;
+
+  auto addKey = [&](size_t transaction, const Crypto::PublicKey& key, size_t keyIndex, size_t outputIndex) {
+    keyDerivations.push_back(derivations[transaction]);
+    keyIndexes.push_back(keyIndex);
+    keys.push_back(key);
+    keyOutputs.emplace_back(transaction, static_cast<uint32_t>(outputIndex));
+  };
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!derivationValid[i]) {
+      continue;
+    }
+
+    const ITransactionReader& tx = *transactions[i];
+    size_t keyIndex = 0;
+    size_t outputCount = tx.getOutputCount();
+
+    for (size_t idx = 0; idx < outputCount; ++idx) {
+      auto outType = tx.getOutputType(idx);
+
+      if (outType == TransactionTypes::OutputType::Key) {
+        uint64_t amount;
+        KeyOutput out;
+        tx.getOutput(idx, out, amount);
+        addKey(i, out.key, keyIndex, idx);
+        ++keyIndex;
+      } else if (outType == TransactionTypes::OutputType::Multisignature) {
+        uint64_t amount;
+        MultisignatureOutput out;
+        tx.getOutput(idx, out, amount);
+        for (const auto& key : out.keys) {
+          addKey(i, key, idx, idx);
+          ++keyIndex;
+        }
+      }
+    }
+  }
+
+  if (keys.empty()) {
+    return;
+  }
+
+  std::vector<Crypto::PublicKey> spendKeyCandidates(keys.size());
+  std::unique_ptr<bool[]> candidateValid(new bool[keys.size()]);
+  Crypto::underive_public_keys(keyDerivations.data(), keyIndexes.data(), keys.data(), keys.size(), spendKeyCandidates.data(), candidateValid.get());
+
+  for (size_t j = 0; j < keys.size(); ++j) {
+    if (candidateValid[j] && spendKeys.find(spendKeyCandidates[j]) != spendKeys.end()) {
+      outputs[keyOutputs[j].first][spendKeyCandidates[j]].push_back(keyOutputs[j].second);
+    }
+  }
+}
+
+void findMyOutputs(
+  const ITransactionReader& tx,
+  const Crypto::SecretKey& viewSecretKey,
+  const std::unordered_set<Crypto::PublicKey>& spendKeys,
+  OwnedOutputs& outputs) {
+
+  std::vector<OwnedOutputs> batchOutputs;
+  findMyOutputs({ &tx }, viewSecretKey, spendKeys, batchOutputs);
+  outputs = std::move(batchOutputs.front());
+}
+
+}
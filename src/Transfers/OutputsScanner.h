@@ -0,0 +1,49 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "ITransaction.h"
+
+namespace MevaCoin {
+
+// map { spend public key -> indexes of owned outputs }
+typedef std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>> OwnedOutputs;
+
+// Finds outputs of the transactions sent to any of spendKeys under one view key.
+// The whole batch goes through the curve at once: key derivations and underived
+// spend keys are compressed with a single field inversion per batch instead of
+// one per transaction and one per output.
+void findMyOutputs(
+  const std::vector<const ITransactionReader*>& transactions,
+  const Crypto::SecretKey& viewSecretKey,
+  const std::unordered_set<Crypto::PublicKey>& spendKeys,
+  std::vector<OwnedOutputs>& outputs);
+
+void findMyOutputs(
+  const ITransactionReader& tx,
+  const Crypto::SecretKey& viewSecretKey,
+  const std::unordered_set<Crypto::PublicKey>& spendKeys,
+  OwnedOutputs& outputs);
+
+}
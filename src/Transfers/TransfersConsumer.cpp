@@ -57,63 +57,8 @@ private:
   Crypto::Hash m_txHash;
 };
 
-void checkOutputKey(
-  const KeyDerivation& derivation,
-  const PublicKey& key,
-  size_t keyIndex,
-  size_t outputIndex,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  PublicKey spendKey;
-  underive_public_key(derivation, keyIndex, key, spendKey);
-
-  if (spendKeys.find(spendKey) != spendKeys.end()) {
-    outputs[spendKey].push_back(static_cast<uint32_t>(outputIndex));
-  }
-
-}
-
-void findMyOutputs(
-  const ITransactionReader& tx,
-  const SecretKey& viewSecretKey,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  auto txPublicKey = tx.getTransactionPublicKey();
-  KeyDerivation derivation;
-
-  if (!generate_key_derivation(txPublicKey, viewSecretKey, derivation)) {
-    return;
-  }
-
-  size_t keyIndex = 0;
-  size_t outputCount = tx.getOutputCount();
-
-  for (size_t idx = 0; idx < outputCount; ++idx) {
-
-    auto outType = tx.getOutputType(size_t(idx));
-
-    if (outType == TransactionTypes::OutputType::Key) {
-
-      uint64_t amount;
-      KeyOutput out;
-      tx.getOutput(idx, out, amount);
-      checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
-      ++keyIndex;
-
-    } else if (outType == TransactionTypes::OutputType::Multisignature) {
-
-      uint64_t amount;
-      MultisignatureOutput out;
-      tx.getOutput(idx, out, amount);
-      for (const auto& key : out.keys) {
-        checkOutputKey(derivation, key, idx, idx, spendKeys, outputs);
-        ++keyIndex;
-      }
-    }
-  }
-}
+// transactions scanned for owned outputs at once
+const size_t SCAN_BATCH_SIZE = 64;
 
 std::vector<Crypto::Hash> getBlockHashes(const MevaCoin::CompleteBlock* blocks, size_t count) {
   std::vector<Crypto::Hash> result;
@@ -177,6 +122,35 @@ void TransfersConsumer::getSubscriptions(std::vector<AccountPublicAddress>& subs
   }
 }
 
+void TransfersConsumer::moveSubscription(const AccountPublicAddress& address, TransfersConsumer& target) {
+  if (target.m_viewSecret != m_viewSecret) {
+    throw std::runtime_error("TransfersConsumer: view secret key mismatch");
+  }
+
+  auto it = m_subscriptions.find(address.spendPublicKey);
+  if (it == m_subscriptions.end()) {
+    throw std::runtime_error("TransfersConsumer: subscription not found");
+  }
+
+  if (target.m_subscriptions.count(address.spendPublicKey) != 0) {
+    throw std::runtime_error("TransfersConsumer: subscription already exists");
+  }
+
+  target.m_subscriptions.emplace(address.spendPublicKey, std::move(it->second));
+  target.m_spendKeys.insert(address.spendPublicKey);
+  // unconfirmed transactions of the container are deleted through the target from now on
+  target.m_poolTxs.insert(m_poolTxs.begin(), m_poolTxs.end());
+  target.updateSyncStart();
+
+  m_subscriptions.erase(it);
+  m_spendKeys.erase(address.spendPublicKey);
+  updateSyncStart();
+}
+
+const Crypto::SecretKey& TransfersConsumer::getViewSecretKey() const {
+  return m_viewSecret;
+}
+
 void TransfersConsumer::initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions) {
   for (auto itSubscriptions = m_subscriptions.begin(); itSubscriptions != m_subscriptions.end(); ++itSubscriptions) {
     std::vector<Crypto::Hash> unconfirmedTransactions;
@@ -227,7 +201,9 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
     bool isLastTransactionInBlock;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
+  struct PreprocessedTx : Tx, PreprocessInfo {
+    OwnedOutputs ownedOutputs;
+  };
 
   std::vector<PreprocessedTx> preprocessedTransactions;
   std::mutex preprocessedTransactionsMutex;
@@ -237,12 +213,13 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
     workers = 2;
   }
 
-  BlockingQueue<Tx> inputQueue(workers * 2);
+  BlockingQueue<std::vector<Tx>> inputQueue(workers * 2);
 
   std::atomic<bool> stopProcessing(false);
   std::atomic<size_t> emptyBlockCount(0);
 
   auto pushingThread = std::async(std::launch::async, [&] {
+    std::vector<Tx> batch;
     for (uint32_t i = 0; i < count && !stopProcessing; ++i) {
       const auto& block = blocks[i].block;
 
@@ -271,31 +248,45 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
 
         bool isLastTransactionInBlock = blockInfo.transactionIndex + 1 == blocks[i].transactions.size();
         Tx item = { blockInfo, tx.get(), isLastTransactionInBlock };
-        inputQueue.push(item);
+        batch.push_back(item);
+        if (batch.size() == SCAN_BATCH_SIZE) {
+          inputQueue.push(std::move(batch));
+          batch.clear();
+        }
+
         ++blockInfo.transactionIndex;
       }
     }
 
+    if (!batch.empty()) {
+      inputQueue.push(std::move(batch));
+    }
+
     inputQueue.close();
   });
 
+  // workers only scan for owned outputs, global indices of the whole batch are requested at once afterwards
   auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
-
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+    std::vector<Tx> batch;
+    std::vector<const ITransactionReader*> transactions;
+    std::vector<OwnedOutputs> ownedOutputs;
+    while (!stopProcessing && inputQueue.pop(batch)) {
+      transactions.clear();
+      for (const auto& item : batch) {
+        transactions.push_back(item.tx);
       }
 
+      findOwnedOutputs(transactions, ownedOutputs);
+
       std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
+      for (size_t i = 0; i < batch.size(); ++i) {
+        PreprocessedTx output;
+        static_cast<Tx&>(output) = batch[i];
+        output.ownedOutputs = std::move(ownedOutputs[i]);
+        preprocessedTransactions.push_back(std::move(output));
+      }
     }
-    return ec;
+    return std::error_code();
   };
 
   std::vector<std::future<std::error_code>> processingThreads;
@@ -317,6 +308,33 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
     }
   }
 
+  // sort by block height and transaction index in block
+  std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
+    return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
+  });
+
+  if (!processingError) {
+    std::vector<Crypto::Hash> ownedTransactionHashes;
+    std::vector<PreprocessedTx*> ownedTransactions;
+    for (auto& tx : preprocessedTransactions) {
+      if (!tx.ownedOutputs.empty()) {
+        ownedTransactionHashes.push_back(tx.tx->getTransactionHash());
+        ownedTransactions.push_back(&tx);
+      }
+    }
+
+    std::vector<std::vector<uint32_t>> globalIndices;
+    if (!ownedTransactionHashes.empty()) {
+      processingError = getGlobalIndices(ownedTransactionHashes, globalIndices);
+    }
+
+    for (size_t i = 0; i < ownedTransactions.size() && !processingError; ++i) {
+      PreprocessedTx& tx = *ownedTransactions[i];
+      tx.globalIdxs = std::move(globalIndices[i]);
+      processingError = createOwnedTransfers(tx.blockInfo, *tx.tx, tx.ownedOutputs, tx);
+    }
+  }
+
   if (processingError) {
     forEachSubscription([&](TransfersSubscription& sub) {
       sub.onError(processingError, startHeight);
@@ -328,11 +346,6 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-  // sort by block height and transaction index in block
-  std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-    return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-  });
-
   uint32_t processedBlockCount = static_cast<uint32_t>(emptyBlockCount);
   try {
     for (const auto& tx : preprocessedTransactions) {
@@ -536,30 +549,33 @@ std::error_code createTransfers(
   return std::error_code();
 }
 
-std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
-  std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
+void TransfersConsumer::findOwnedOutputs(const ITransactionReader& tx, OwnedOutputs& ownedOutputs) {
   try {
-    findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
+    findMyOutputs(tx, m_viewSecret, m_spendKeys, ownedOutputs);
   }
   catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to process transaction: " << e.what() << ", transaction hash " << Common::podToHex(tx.getTransactionHash());
-    return std::error_code();
+    ownedOutputs.clear();
   }
+}
 
-  if (outputs.empty()) {
-    return std::error_code();
+void TransfersConsumer::findOwnedOutputs(const std::vector<const ITransactionReader*>& transactions, std::vector<OwnedOutputs>& ownedOutputs) {
+  try {
+    findMyOutputs(transactions, m_viewSecret, m_spendKeys, ownedOutputs);
   }
-
-  std::error_code errorCode;
-  auto txHash = tx.getTransactionHash();
-  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
-    errorCode = getGlobalIndices(reinterpret_cast<const Hash&>(txHash), info.globalIdxs);
-    if (errorCode) {
-      return errorCode;
+  catch (const std::exception&) {
+    // rescan one by one to skip only the broken transaction
+    ownedOutputs.resize(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+      findOwnedOutputs(*transactions[i], ownedOutputs[i]);
     }
   }
+}
 
-  for (const auto& kv : outputs) {
+std::error_code TransfersConsumer::createOwnedTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  const OwnedOutputs& ownedOutputs, PreprocessInfo& info) {
+  std::error_code errorCode;
+  for (const auto& kv : ownedOutputs) {
     auto it = m_subscriptions.find(kv.first);
     if (it != m_subscriptions.end()) {
       auto& transfers = info.outputs[kv.first];
@@ -579,6 +595,26 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
   return std::error_code();
 }
 
+std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
+  OwnedOutputs outputs;
+  findOwnedOutputs(tx, outputs);
+  if (outputs.empty()) {
+    return std::error_code();
+  }
+
+  if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    std::vector<std::vector<uint32_t>> globalIndices;
+    std::error_code errorCode = getGlobalIndices({ tx.getTransactionHash() }, globalIndices);
+    if (errorCode) {
+      return errorCode;
+    }
+
+    info.globalIdxs = std::move(globalIndices.front());
+  }
+
+  return createOwnedTransfers(blockInfo, tx, outputs, info);
+}
+
 std::error_code TransfersConsumer::processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx) {
   PreprocessInfo info;
   auto ec = preprocessOutputs(blockInfo, tx, info);
@@ -643,7 +679,7 @@ void TransfersConsumer::processOutputs(const TransactionBlockInfo& blockInfo, Tr
   }
 }
 
-std::error_code TransfersConsumer::getGlobalIndices(const Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices) {
+std::error_code TransfersConsumer::getGlobalIndices(const std::vector<Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
   std::promise<std::error_code> prom;
   std::future<std::error_code> f = prom.get_future();
 
@@ -653,9 +689,14 @@ std::error_code TransfersConsumer::getGlobalIndices(const Hash& transactionHash,
   };
 
   outsGlobalIndices.clear();
-  m_node.getTransactionOutsGlobalIndices(transactionHash, outsGlobalIndices, cb);
+  m_node.getTransactionsOutsGlobalIndices(transactionHashes, outsGlobalIndices, cb);
+
+  std::error_code ec = f.get();
+  if (!ec && outsGlobalIndices.size() != transactionHashes.size()) {
+    ec = std::make_error_code(std::errc::invalid_argument);
+  }
 
-  return f.get();
+  return ec;
 }
 
 }
@@ -21,6 +21,7 @@
 
 #include "IBlockchainSynchronizer.h"
 #include "ITransfersSynchronizer.h"
+#include "OutputsScanner.h"
 #include "TransfersSubscription.h"
 #include "TypeHelpers.h"
 
@@ -45,6 +46,9 @@ public:
   bool removeSubscription(const AccountPublicAddress& address);
   ITransfersSubscription* getSubscription(const AccountPublicAddress& acc);
   void getSubscriptions(std::vector<AccountPublicAddress>& subscriptions);
+  // hands the subscription over to a consumer of the same view key which has processed the same blocks
+  void moveSubscription(const AccountPublicAddress& address, TransfersConsumer& target);
+  const Crypto::SecretKey& getViewSecretKey() const;
 
   void initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions);
   void addPublicKeysSeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
@@ -73,13 +77,17 @@ private:
     std::vector<uint32_t> globalIdxs;
   };
 
+  void findOwnedOutputs(const ITransactionReader& tx, OwnedOutputs& ownedOutputs);
+  void findOwnedOutputs(const std::vector<const ITransactionReader*>& transactions, std::vector<OwnedOutputs>& ownedOutputs);
+  std::error_code createOwnedTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+    const OwnedOutputs& ownedOutputs, PreprocessInfo& info);
   std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx);
   void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& sub, const ITransactionReader& tx,
     const std::vector<TransactionOutputInformationIn>& outputs, const std::vector<uint32_t>& globalIdxs, bool& contains, bool& updated);
 
-  std::error_code getGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code getGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices);
 
   void updateSyncStart();
 
@@ -26,6 +26,9 @@
 #include "Serialization/BinaryOutputStreamSerializer.h"
 #include "Serialization/SerializationOverloads.h"
 
+#include <algorithm>
+#include <ctime>
+
 using namespace Common;
 using namespace Crypto;
 using namespace Logging;
@@ -47,6 +50,30 @@ void serialize(TransactionInformation& ti, MevaCoin::ISerializer& s) {
 const uint32_t TRANSFERS_CONTAINER_STORAGE_VERSION = 0;
 
 namespace {
+  size_t getBalanceStateIndex(uint32_t state) {
+    switch (state) {
+    case ITransfersContainer::IncludeStateUnlocked:
+      return 0;
+    case ITransfersContainer::IncludeStateSoftLocked:
+      return 1;
+    default:
+      assert(state == ITransfersContainer::IncludeStateLocked);
+      return 2;
+    }
+  }
+
+  bool getBalanceTypeIndex(TransactionTypes::OutputType type, size_t& index) {
+    if (type == TransactionTypes::OutputType::Key) {
+      index = 0;
+    } else if (type == TransactionTypes::OutputType::Multisignature) {
+      index = 1;
+    } else {
+      return false;
+    }
+
+    return true;
+  }
+
   template<typename TIterator>
   class TransferIteratorList {
   public:
@@ -173,7 +200,9 @@ TransfersContainer::TransfersContainer(const Currency& currency, Logging::ILogge
   m_currentHeight(0),
   m_currency(currency),
   m_logger(logger, "TransfersContainer"),
-  m_transactionSpendableAge(transactionSpendableAge) {
+  m_transactionSpendableAge(transactionSpendableAge),
+  m_balanceTime(0) {
+  rebuildBalance();
 }
 
 bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx,
@@ -203,6 +232,7 @@ bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
 
     if (block.height != WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
       m_currentHeight = block.height;
+      updateBalanceLocks();
     }
 
     return added;
@@ -273,8 +303,8 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
 
     if (transferIsUnconfirmed) {
       auto result = m_unconfirmedTransfers.emplace(std::move(info));
-      (void)result; // Disable unused warning
       assert(result.second);
+      addBalance(*result.first);
     } else {
       if (info.type == TransactionTypes::OutputType::Key) {
         bool duplicate = false;
@@ -311,8 +341,8 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
       }
 
       auto result = m_availableTransfers.emplace(std::move(info));
-      (void)result; // Disable unused warning
       assert(result.second);
+      addBalance(*result.first);
     }
 
     if (info.type == TransactionTypes::OutputType::Key) {
@@ -395,6 +425,7 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       assert(spendingTransferIt->keyImage == input.keyImage);
       copyToSpent(block, tx, i, *spendingTransferIt);
       // erase from available outputs
+      removeBalance(*spendingTransferIt);
       outputDescriptorIndex.erase(spendingTransferIt);
       updateTransfersVisibility(input.keyImage);
 
@@ -408,6 +439,7 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       if (availableOutputIt != outputDescriptorIndex.end()) {
         copyToSpent(block, tx, i, *availableOutputIt);
         // erase from available outputs
+        removeBalance(*availableOutputIt);
         outputDescriptorIndex.erase(availableOutputIt);
 
         inputsAdded = true;
@@ -486,9 +518,10 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
         }
       }
 
+      removeBalance(*transferIt);
       auto result = m_availableTransfers.emplace(std::move(transfer));
-      (void)result; // Disable unused warning
       assert(result.second);
+      addBalance(*result.first);
 
       transferIt = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(transferIt);
 
@@ -524,9 +557,10 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
       unconfirmedTransfer.transactionIndex = 0;
       unconfirmedTransfer.globalOutputIndex = UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX;
 
+      removeBalance(*transferIt);
       auto result = m_unconfirmedTransfers.emplace(std::move(unconfirmedTransfer));
-      (void)result; // Disable unused warning
       assert(result.second);
+      addBalance(*result.first);
 
       transferIt = m_availableTransfers.get<ContainingTransactionIndex>().erase(transferIt);
 
@@ -564,6 +598,7 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
 
     auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
     assert(result.second);
+    addBalance(*result.first);
     it = spendingTransactionIndex.erase(it);
 
     if (result.first->type == TransactionTypes::OutputType::Key) {
@@ -573,6 +608,7 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
 
   auto unconfirmedTransfersRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
   for (auto it = unconfirmedTransfersRange.first; it != unconfirmedTransfersRange.second;) {
+    removeBalance(*it);
     if (it->type == TransactionTypes::OutputType::Key) {
       KeyImage keyImage = it->keyImage;
       it = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(it);
@@ -585,6 +621,7 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
   auto& transactionTransfersIndex = m_availableTransfers.get<ContainingTransactionIndex>();
   auto transactionTransfersRange = transactionTransfersIndex.equal_range(transactionHash);
   for (auto it = transactionTransfersRange.first; it != transactionTransfersRange.second;) {
+    removeBalance(*it);
     if (it->type == TransactionTypes::OutputType::Key) {
       KeyImage keyImage = it->keyImage;
       it = transactionTransfersIndex.erase(it);
@@ -650,6 +687,8 @@ std::vector<Hash> TransfersContainer::detach(uint32_t height) {
 
   // TODO: notification on detach
   m_currentHeight = height == 0 ? 0 : height - 1;
+  // soft locks depend on the height, which only goes back here
+  rebuildBalance();
 
   return deletedTransactions;
 }
@@ -683,6 +722,14 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   size_t spentCount = std::distance(spentRange.first, spentRange.second);
   assert(spentCount == 0 || spentCount == 1);
 
+  for (auto it = unconfirmedRange.first; it != unconfirmedRange.second; ++it) {
+    removeBalance(*it);
+  }
+
+  for (auto it = availableRange.first; it != availableRange.second; ++it) {
+    removeBalance(*it);
+  }
+
   if (spentCount > 0) {
     updateVisibility(unconfirmedIndex, unconfirmedRange, false);
     updateVisibility(availableIndex, availableRange, false);
@@ -701,6 +748,14 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   } else {
     updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1);
   }
+
+  for (auto it = unconfirmedRange.first; it != unconfirmedRange.second; ++it) {
+    addBalance(*it);
+  }
+
+  for (auto it = availableRange.first; it != availableRange.second; ++it) {
+    addBalance(*it);
+  }
 }
 
 bool TransfersContainer::advanceHeight(uint32_t height) {
@@ -708,6 +763,7 @@ bool TransfersContainer::advanceHeight(uint32_t height) {
 
   if (m_currentHeight <= height) {
     m_currentHeight = height;
+    updateBalanceLocks();
     return true;
   }
 
@@ -726,20 +782,26 @@ size_t TransfersContainer::transactionsCount() const {
 
 uint64_t TransfersContainer::balance(uint32_t flags) const {
   std::lock_guard<std::mutex> lk(m_mutex);
-  uint64_t amount = 0;
+  updateBalanceLocks();
 
-  for (const auto& t : m_availableTransfers) {
-    if (t.visible && isIncluded(t, flags)) {
-      amount += t.amount;
+  const uint32_t typeFlags[BALANCE_TYPE_COUNT] = { IncludeTypeKey, IncludeTypeMultisignature };
+  const uint32_t stateFlags[BALANCE_STATE_COUNT] = { IncludeStateUnlocked, IncludeStateSoftLocked, IncludeStateLocked };
+
+  uint64_t amount = 0;
+  for (size_t type = 0; type < BALANCE_TYPE_COUNT; ++type) {
+    if ((flags & typeFlags[type]) == 0) {
+      continue;
     }
-  }
 
-  if ((flags & IncludeStateLocked) != 0) {
-    for (const auto& t : m_unconfirmedTransfers) {
-      if (t.visible && isIncluded(t.type, IncludeStateLocked, flags)) {
-        amount += t.amount;
+    for (uint32_t state : stateFlags) {
+      if ((flags & state) != 0) {
+        amount += m_balances[getBalanceStateIndex(state)][type];
       }
     }
+
+    if ((flags & IncludeStateLocked) != 0) {
+      amount += m_unconfirmedBalances[type];
+    }
   }
 
   return amount;
@@ -934,6 +996,7 @@ void TransfersContainer::load(std::istream& in) {
   m_unconfirmedTransfers = std::move(unconfirmedTransfers);
   m_availableTransfers = std::move(availableTransfers);
   m_spentTransfers = std::move(spentTransfers);
+  rebuildBalance();
 
   // Repair the container if it was broken while handling addTransaction() in previous version of the code
   // Hope it isn't necessary anymore
@@ -1072,4 +1135,131 @@ bool TransfersContainer::isIncluded(TransactionTypes::OutputType type, uint32_t
     ((flags & state) != 0);
 }
 
+/**
+ * Mirrors isIncluded() at m_balanceTime, also returns the height or time the transfer leaves a lock state at.
+ */
+uint32_t TransfersContainer::getBalanceState(uint32_t blockHeight, uint64_t unlockTime, uint64_t& lockedUntil, bool& lockedByTime) const {
+  if (unlockTime < m_currency.maxBlockHeight()) {
+    uint64_t allowedDelta = m_currency.lockedTxAllowedDeltaBlocks();
+    uint64_t unlockHeight = unlockTime > allowedDelta ? unlockTime - allowedDelta : 0;
+    if (m_currentHeight < unlockHeight) {
+      lockedUntil = unlockHeight;
+      lockedByTime = false;
+      return IncludeStateLocked;
+    }
+  } else {
+    uint64_t allowedDelta = m_currency.lockedTxAllowedDeltaSeconds();
+    uint64_t unlockTimestamp = unlockTime > allowedDelta ? unlockTime - allowedDelta : 0;
+    if (m_balanceTime < unlockTimestamp) {
+      lockedUntil = unlockTimestamp;
+      lockedByTime = true;
+      return IncludeStateLocked;
+    }
+  }
+
+  if (m_currentHeight < blockHeight + m_transactionSpendableAge) {
+    lockedUntil = blockHeight + m_transactionSpendableAge;
+    lockedByTime = false;
+    return IncludeStateSoftLocked;
+  }
+
+  return IncludeStateUnlocked;
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::addBalance(const TransactionOutputInformationEx& transfer) {
+  size_t type;
+  if (!transfer.visible || !getBalanceTypeIndex(transfer.type, type)) {
+    return;
+  }
+
+  if (transfer.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    m_unconfirmedBalances[type] += transfer.amount;
+  } else {
+    addBalanceLock(transfer.amount, type, transfer.blockHeight, transfer.unlockTime);
+  }
+}
+
+/**
+ * \pre m_mutex is locked, lock states are up to date with m_currentHeight.
+ */
+void TransfersContainer::removeBalance(const TransactionOutputInformationEx& transfer) {
+  size_t type;
+  if (!transfer.visible || !getBalanceTypeIndex(transfer.type, type)) {
+    return;
+  }
+
+  if (transfer.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    assert(m_unconfirmedBalances[type] >= transfer.amount);
+    m_unconfirmedBalances[type] -= transfer.amount;
+    return;
+  }
+
+  uint64_t lockedUntil;
+  bool lockedByTime;
+  uint32_t state = getBalanceState(transfer.blockHeight, transfer.unlockTime, lockedUntil, lockedByTime);
+  assert(m_balances[getBalanceStateIndex(state)][type] >= transfer.amount);
+  m_balances[getBalanceStateIndex(state)][type] -= transfer.amount;
+
+  if (state != IncludeStateUnlocked) {
+    BalanceLock lock = { transfer.amount, type, state, transfer.blockHeight, transfer.unlockTime };
+    bool unscheduled = lockedByTime ? m_balanceLocks.unscheduleAtTime(lockedUntil, lock) : m_balanceLocks.unscheduleAtHeight(lockedUntil, lock);
+    (void)unscheduled; // Disable unused warning
+    assert(unscheduled);
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::addBalanceLock(uint64_t amount, size_t type, uint32_t blockHeight, uint64_t unlockTime) const {
+  uint64_t lockedUntil;
+  bool lockedByTime;
+  uint32_t state = getBalanceState(blockHeight, unlockTime, lockedUntil, lockedByTime);
+  m_balances[getBalanceStateIndex(state)][type] += amount;
+
+  if (state != IncludeStateUnlocked) {
+    BalanceLock lock = { amount, type, state, blockHeight, unlockTime };
+    if (lockedByTime) {
+      m_balanceLocks.scheduleAtTime(lockedUntil, lock);
+    } else {
+      m_balanceLocks.scheduleAtHeight(lockedUntil, lock);
+    }
+  }
+}
+
+/**
+ * Moves transfers whose lock has expired to their next state.
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::updateBalanceLocks() const {
+  m_balanceTime = std::max<uint64_t>(m_balanceTime, static_cast<uint64_t>(time(NULL)));
+
+  // a time lock can only turn into a height one, which the scheduler releases afterwards
+  m_balanceLocks.releaseDue(m_currentHeight, m_balanceTime, [this](const BalanceLock& lock) {
+    m_balances[getBalanceStateIndex(lock.state)][lock.type] -= lock.amount;
+    addBalanceLock(lock.amount, lock.type, lock.blockHeight, lock.unlockTime);
+  });
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::rebuildBalance() {
+  std::fill(&m_balances[0][0], &m_balances[0][0] + BALANCE_STATE_COUNT * BALANCE_TYPE_COUNT, 0);
+  std::fill(std::begin(m_unconfirmedBalances), std::end(m_unconfirmedBalances), 0);
+  m_balanceLocks.clear();
+  m_balanceTime = static_cast<uint64_t>(time(NULL));
+
+  for (const auto& transfer : m_unconfirmedTransfers) {
+    addBalance(transfer);
+  }
+
+  for (const auto& transfer : m_availableTransfers) {
+    addBalance(transfer);
+  }
+}
+
 }
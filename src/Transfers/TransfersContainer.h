@@ -37,6 +37,7 @@
 
 #include "ITransaction.h"
 #include "ITransfersContainer.h"
+#include "UnlockScheduler.h"
 
 namespace MevaCoin {
 
@@ -260,6 +261,22 @@ private:
     >
   > SpentTransfersMultiIndex;
 
+  // visible confirmed transfer waiting to leave its lock state
+  struct BalanceLock {
+    uint64_t amount;
+    size_t type;
+    uint32_t state;
+    uint32_t blockHeight;
+    uint64_t unlockTime;
+
+    bool operator==(const BalanceLock& other) const {
+      return amount == other.amount && type == other.type && state == other.state && blockHeight == other.blockHeight && unlockTime == other.unlockTime;
+    }
+  };
+
+  static const size_t BALANCE_STATE_COUNT = 3;
+  static const size_t BALANCE_TYPE_COUNT = 2;
+
 private:
   void addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx);
   bool addTransactionOutputs(const TransactionBlockInfo& block, const ITransactionReader& tx,
@@ -271,6 +288,13 @@ private:
   static bool isIncluded(TransactionTypes::OutputType type, uint32_t state, uint32_t flags);
   void updateTransfersVisibility(const Crypto::KeyImage& keyImage);
 
+  uint32_t getBalanceState(uint32_t blockHeight, uint64_t unlockTime, uint64_t& lockedUntil, bool& lockedByTime) const;
+  void addBalance(const TransactionOutputInformationEx& transfer);
+  void removeBalance(const TransactionOutputInformationEx& transfer);
+  void addBalanceLock(uint64_t amount, size_t type, uint32_t blockHeight, uint64_t unlockTime) const;
+  void updateBalanceLocks() const;
+  void rebuildBalance();
+
   void copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& tx, size_t inputIndex, const TransactionOutputInformationEx& output);
   void repair();
 
@@ -282,6 +306,14 @@ private:
 
   uint32_t m_currentHeight; // current height is needed to check if a transfer is unlocked
   size_t m_transactionSpendableAge;
+
+  // running totals of visible transfers, so balance() doesn't walk the transfers;
+  // confirmed ones move between lock states as the height and time advance
+  mutable uint64_t m_balances[BALANCE_STATE_COUNT][BALANCE_TYPE_COUNT];
+  uint64_t m_unconfirmedBalances[BALANCE_TYPE_COUNT];
+  mutable UnlockScheduler<BalanceLock> m_balanceLocks;
+  mutable uint64_t m_balanceTime;
+
   const MevaCoin::Currency& m_currency;
   mutable std::mutex m_mutex;
   Logging::LoggerRef m_logger;
@@ -20,6 +20,7 @@
 #include "TransfersSynchronizer.h"
 #include "TransfersConsumer.h"
 
+#include "Common/MemoryStreamBuffer.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "MevaCoinCore/MevaCoinBasicImpl.h"
@@ -31,7 +32,7 @@ using namespace Crypto;
 
 namespace MevaCoin {
 
-const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
+const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 1;
 
 TransfersSyncronizer::TransfersSyncronizer(const MevaCoin::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node) :
   m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node) {
@@ -42,12 +43,20 @@ TransfersSyncronizer::~TransfersSyncronizer() {
   for (const auto& kv : m_consumers) {
     m_sync.removeConsumer(kv.second.get());
   }
+
+  for (const auto& kv : m_catchUpConsumers) {
+    m_sync.removeConsumer(kv.second.get());
+  }
 }
 
 void TransfersSyncronizer::initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions) {
   for (auto it = m_consumers.begin(); it != m_consumers.end(); ++it) {
     it->second->initTransactionPool(uncommitedTransactions);
   }
+
+  for (auto it = m_catchUpConsumers.begin(); it != m_catchUpConsumers.end(); ++it) {
+    it->second->initTransactionPool(uncommitedTransactions);
+  }
 }
 
 ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubscription& acc) {
@@ -65,12 +74,58 @@ ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubsc
   return it->second->addSubscription(acc);
 }
 
+ITransfersSubscription& TransfersSyncronizer::addCatchUpSubscription(const AccountSubscription& acc) {
+  const auto& viewKey = acc.keys.address.viewPublicKey;
+  auto it = m_consumers.find(viewKey);
+  if (it == m_consumers.end() || m_sync.getConsumerHeight(*it->second) <= 1) {
+    // nothing scanned yet, there is nobody to keep up with
+    return addSubscription(acc);
+  }
+
+  // subscriptions added together share a consumer until it has scanned anything
+  auto range = m_catchUpConsumers.equal_range(viewKey);
+  auto catchUpIt = std::find_if(range.first, range.second, [this](const CatchUpConsumersContainer::value_type& kv) {
+    return m_sync.getConsumerHeight(*kv.second) <= 1;
+  });
+
+  TransfersConsumer& consumer = catchUpIt != range.second ? *catchUpIt->second : addCatchUpConsumer(viewKey, acc.keys.viewSecretKey);
+  return consumer.addSubscription(acc);
+}
+
+bool TransfersSyncronizer::hasCaughtUpSubscriptions() const {
+  return std::any_of(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [this](const CatchUpConsumersContainer::value_type& kv) {
+    return m_sync.isConsumerCaughtUp(*kv.second, *m_consumers.at(kv.first));
+  });
+}
+
+void TransfersSyncronizer::mergeCaughtUpSubscriptions() {
+  for (auto it = m_catchUpConsumers.begin(); it != m_catchUpConsumers.end();) {
+    if (m_sync.isConsumerCaughtUp(*it->second, *m_consumers.at(it->first))) {
+      it = mergeCatchUpConsumer(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 bool TransfersSyncronizer::removeSubscription(const AccountPublicAddress& acc) {
   auto it = m_consumers.find(acc.viewPublicKey);
   if (it == m_consumers.end())
     return false;
 
-  if (it->second->removeSubscription(acc)) {
+  auto range = m_catchUpConsumers.equal_range(acc.viewPublicKey);
+  auto catchUpIt = std::find_if(range.first, range.second, [&acc](const CatchUpConsumersContainer::value_type& kv) {
+    return kv.second->getSubscription(acc) != nullptr;
+  });
+
+  if (catchUpIt != range.second && catchUpIt->second->removeSubscription(acc)) {
+    m_sync.removeConsumer(catchUpIt->second.get());
+    m_catchUpConsumers.erase(catchUpIt);
+  }
+
+  // for an address of a catch-up consumer this only tells whether the main consumer has subscriptions,
+  // it follows the chain for the catch-up consumers even without them
+  if (it->second->removeSubscription(acc) && m_catchUpConsumers.count(acc.viewPublicKey) == 0) {
     m_sync.removeConsumer(it->second.get());
     m_consumers.erase(it);
 
@@ -84,11 +139,25 @@ void TransfersSyncronizer::getSubscriptions(std::vector<AccountPublicAddress>& s
   for (const auto& kv : m_consumers) {
     kv.second->getSubscriptions(subscriptions);
   }
+
+  for (const auto& kv : m_catchUpConsumers) {
+    kv.second->getSubscriptions(subscriptions);
+  }
 }
 
 ITransfersSubscription* TransfersSyncronizer::getSubscription(const AccountPublicAddress& acc) {
   auto it = m_consumers.find(acc.viewPublicKey);
-  return (it == m_consumers.end()) ? nullptr : it->second->getSubscription(acc);
+  if (it == m_consumers.end()) {
+    return nullptr;
+  }
+
+  ITransfersSubscription* subscription = it->second->getSubscription(acc);
+  auto range = m_catchUpConsumers.equal_range(acc.viewPublicKey);
+  for (auto catchUpIt = range.first; subscription == nullptr && catchUpIt != range.second; ++catchUpIt) {
+    subscription = catchUpIt->second->getSubscription(acc);
+  }
+
+  return subscription;
 }
 
 void TransfersSyncronizer::addPublicKeysSeen(const AccountPublicAddress& acc, const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey) {
@@ -108,6 +177,11 @@ std::vector<Crypto::Hash> TransfersSyncronizer::getViewKeyKnownBlocks(const Cryp
 }
 
 void TransfersSyncronizer::onBlocksAdded(IBlockchainConsumer* consumer, const std::vector<Crypto::Hash>& blockHashes) {
+  // subscribers follow the chain of the main consumer, catch-up consumers only report their transactions
+  if (isCatchUpConsumer(consumer)) {
+    return;
+  }
+
   auto it = findSubscriberForConsumer(consumer);
   if (it != m_subscribers.end()) {
     it->second->notify(&ITransfersSynchronizerObserver::onBlocksAdded, it->first, blockHashes);
@@ -115,6 +189,10 @@ void TransfersSyncronizer::onBlocksAdded(IBlockchainConsumer* consumer, const st
 }
 
 void TransfersSyncronizer::onBlockchainDetach(IBlockchainConsumer* consumer, uint32_t blockIndex) {
+  if (isCatchUpConsumer(consumer)) {
+    return;
+  }
+
   auto it = findSubscriberForConsumer(consumer);
   if (it != m_subscribers.end()) {
     it->second->notify(&ITransfersSynchronizerObserver::onBlockchainDetach, it->first, blockIndex);
@@ -164,51 +242,71 @@ void TransfersSyncronizer::save(std::ostream& os) {
 
   StdOutputStream stream(os);
   MevaCoin::BinaryOutputStreamSerializer s(stream);
-  s(const_cast<uint32_t&>(TRANSFERS_STORAGE_ARCHIVE_VERSION), "version");
+  // without catch-up consumers the state stays readable by version 0
+  uint32_t version = m_catchUpConsumers.empty() ? 0 : TRANSFERS_STORAGE_ARCHIVE_VERSION;
+  s(version, "version");
 
   size_t subscriptionCount = m_consumers.size();
 
   s.beginArray(subscriptionCount, "consumers");
 
   for (const auto& consumer : m_consumers) {
-    s.beginObject("");
-    s(const_cast<PublicKey&>(consumer.first), "view_key");
-
-    std::stringstream consumerState;
-    // synchronization state
-    m_sync.getConsumerState(consumer.second.get())->save(consumerState);
+    saveConsumer(s, consumer.first, *consumer.second);
+  }
 
-    std::string blob = consumerState.str();
-    s(blob, "state");
-    
-    std::vector<AccountPublicAddress> subscriptions;
-    consumer.second->getSubscriptions(subscriptions);
-    size_t subCount = subscriptions.size();
+  s.endArray();
 
-    s.beginArray(subCount, "subscriptions");
+  if (version >= 1) {
+    size_t catchUpCount = m_catchUpConsumers.size();
 
-    for (auto& addr : subscriptions) {
-      auto sub = consumer.second->getSubscription(addr);
-      if (sub != nullptr) {
-        s.beginObject("");
+    s.beginArray(catchUpCount, "catch_up_consumers");
 
-        std::stringstream subState;
-        assert(sub);
-        sub->getContainer().save(subState);
-        // store data block
-        std::string blob = subState.str();
-        s(addr, "address");
-        s(blob, "state");
-
-        s.endObject();
-      }
+    for (const auto& consumer : m_catchUpConsumers) {
+      saveConsumer(s, consumer.first, *consumer.second);
     }
 
     s.endArray();
-    s.endObject();
   }
 }
 
+void TransfersSyncronizer::saveConsumer(ISerializer& s, const PublicKey& viewKey, TransfersConsumer& consumer) {
+  s.beginObject("");
+  s(const_cast<PublicKey&>(viewKey), "view_key");
+
+  std::stringstream consumerState;
+  // synchronization state
+  m_sync.getConsumerState(&consumer)->save(consumerState);
+
+  std::string blob = consumerState.str();
+  s(blob, "state");
+
+  std::vector<AccountPublicAddress> subscriptions;
+  consumer.getSubscriptions(subscriptions);
+  size_t subCount = subscriptions.size();
+
+  s.beginArray(subCount, "subscriptions");
+
+  for (auto& addr : subscriptions) {
+    auto sub = consumer.getSubscription(addr);
+    if (sub != nullptr) {
+      s.beginObject("");
+
+      std::stringstream subState;
+      assert(sub);
+      sub->getContainer().save(subState);
+      // store data block
+      std::string blob = subState.str();
+      s(addr, "address");
+      s(blob, "state");
+
+      s.endObject();
+    }
+  }
+
+  s.endArray();
+  s.endObject();
+}
+
 namespace {
 std::string getObjectState(IStreamSerializable& obj) {
   std::stringstream stream;
@@ -217,7 +315,8 @@ std::string getObjectState(IStreamSerializable& obj) {
 }
 
 void setObjectState(IStreamSerializable& obj, const std::string& state) {
-  std::stringstream stream(state);
+  Common::MemoryStreamBuffer buffer(state.data(), state.size());
+  std::istream stream(&buffer);
   obj.load(stream);
 }
 
@@ -244,6 +343,8 @@ void TransfersSyncronizer::load(std::istream& is) {
   };
 
   std::vector<ConsumerState> updatedStates;
+  std::vector<TransfersConsumer*> catchUpConsumers;
+  std::vector<std::pair<AccountPublicAddress, std::string>> catchUpSubscriptionStates;
 
   try {
     size_t subscriptionCount = 0;
@@ -306,8 +407,77 @@ void TransfersSyncronizer::load(std::istream& is) {
 
     s.endArray();
 
+    if (version >= 1) {
+      size_t catchUpCount = 0;
+      s.beginArray(catchUpCount, "catch_up_consumers");
+
+      while (catchUpCount--) {
+        s.beginObject("");
+        PublicKey viewKey;
+        s(viewKey, "view_key");
+
+        std::string blob;
+        s(blob, "state");
+
+        std::vector<std::pair<AccountPublicAddress, std::string>> subscriptionStates;
+        size_t subCount = 0;
+        s.beginArray(subCount, "subscriptions");
+
+        while (subCount--) {
+          s.beginObject("");
+
+          AccountPublicAddress acc;
+          std::string state;
+
+          s(acc, "address");
+          s(state, "state");
+          subscriptionStates.emplace_back(acc, std::move(state));
+
+          s.endObject();
+        }
+
+        s.endArray();
+        s.endObject();
+
+        auto mainIt = m_consumers.find(viewKey);
+        if (mainIt == m_consumers.end()) {
+          m_logger(Logging::DEBUGGING) << "Consumer not found: " << viewKey;
+          continue;
+        }
+
+        // the wallet subscribes all addresses to the main consumer, the ones still catching up move out of it
+        TransfersConsumer* consumer = nullptr;
+        for (const auto& subscriptionState : subscriptionStates) {
+          auto sub = mainIt->second->getSubscription(subscriptionState.first);
+          if (sub == nullptr) {
+            m_logger(Logging::DEBUGGING) << "Subscription not found: " << m_currency.accountAddressAsString(subscriptionState.first);
+            continue;
+          }
+
+          if (consumer == nullptr) {
+            consumer = &addCatchUpConsumer(viewKey, mainIt->second->getViewSecretKey());
+            catchUpConsumers.push_back(consumer);
+            setObjectState(*m_sync.getConsumerState(consumer), blob);
+          }
+
+          catchUpSubscriptionStates.emplace_back(subscriptionState.first, getObjectState(sub->getContainer()));
+          mainIt->second->moveSubscription(subscriptionState.first, *consumer);
+          setObjectState(sub->getContainer(), subscriptionState.second);
+        }
+      }
+
+      s.endArray();
+    }
   } catch (...) {
     // rollback state
+    for (auto consumer : catchUpConsumers) {
+      auto it = std::find_if(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [consumer](const CatchUpConsumersContainer::value_type& kv) {
+        return kv.second.get() == consumer;
+      });
+
+      mergeCatchUpConsumer(it);
+    }
+
     for (const auto& consumerState : updatedStates) {
       auto consumer = m_consumers.find(consumerState.viewKey)->second.get();
       setObjectState(*m_sync.getConsumerState(consumer), consumerState.state);
@@ -315,22 +485,64 @@ void TransfersSyncronizer::load(std::istream& is) {
         setObjectState(consumer->getSubscription(sub.first)->getContainer(), sub.second);
       }
     }
+
+    for (const auto& sub : catchUpSubscriptionStates) {
+      setObjectState(getSubscription(sub.first)->getContainer(), sub.second);
+    }
     throw;
   }
 
 }
 
+TransfersConsumer& TransfersSyncronizer::addCatchUpConsumer(const PublicKey& viewPublicKey, const SecretKey& viewSecretKey) {
+  std::unique_ptr<TransfersConsumer> consumer(new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), viewSecretKey));
+
+  m_sync.addConsumer(consumer.get());
+  consumer->addObserver(this);
+  return *m_catchUpConsumers.emplace(viewPublicKey, std::move(consumer))->second;
+}
+
+TransfersSyncronizer::CatchUpConsumersContainer::iterator TransfersSyncronizer::mergeCatchUpConsumer(CatchUpConsumersContainer::iterator it) {
+  auto& mainConsumer = *m_consumers.at(it->first);
+
+  std::vector<AccountPublicAddress> subscriptions;
+  it->second->getSubscriptions(subscriptions);
+  for (const auto& address : subscriptions) {
+    it->second->moveSubscription(address, mainConsumer);
+  }
+
+  m_logger(Logging::DEBUGGING) << "Merged " << subscriptions.size() << " subscriptions of catch-up consumer, view key " << it->first;
+
+  m_sync.removeConsumer(it->second.get());
+  return m_catchUpConsumers.erase(it);
+}
+
+bool TransfersSyncronizer::isCatchUpConsumer(IBlockchainConsumer* consumer) const {
+  return std::any_of(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [consumer](const CatchUpConsumersContainer::value_type& kv) {
+    return kv.second.get() == consumer;
+  });
+}
+
 bool TransfersSyncronizer::findViewKeyForConsumer(IBlockchainConsumer* consumer, Crypto::PublicKey& viewKey) const {
   //since we have only couple of consumers linear complexity is fine
   auto it = std::find_if(m_consumers.begin(), m_consumers.end(), [consumer] (const ConsumersContainer::value_type& subscription) {
     return subscription.second.get() == consumer;
   });
 
-  if (it == m_consumers.end()) {
+  if (it != m_consumers.end()) {
+    viewKey = it->first;
+    return true;
+  }
+
+  auto catchUpIt = std::find_if(m_catchUpConsumers.begin(), m_catchUpConsumers.end(), [consumer](const CatchUpConsumersContainer::value_type& kv) {
+    return kv.second.get() == consumer;
+  });
+
+  if (catchUpIt == m_catchUpConsumers.end()) {
     return false;
   }
 
-  viewKey = it->first;
+  viewKey = catchUpIt->first;
   return true;
 }
 
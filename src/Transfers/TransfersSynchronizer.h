@@ -38,6 +38,7 @@ namespace MevaCoin {
  
 class TransfersConsumer;
 class INode;
+class ISerializer;
 
 class TransfersSyncronizer : public ITransfersSynchronizer, public IBlockchainConsumerObserver {
 public:
@@ -58,6 +59,13 @@ public:
 
   void addPublicKeysSeen(const AccountPublicAddress& acc, const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
 
+  // The subscription is scanned from its sync start by a consumer of its own, so the other subscriptions
+  // of the view key keep following the chain meanwhile. It joins them once both have processed the same blocks.
+  ITransfersSubscription& addCatchUpSubscription(const AccountSubscription& acc);
+  bool hasCaughtUpSubscriptions() const;
+  // blockchain synchronizer must be stopped
+  void mergeCaughtUpSubscriptions();
+
   // IStreamSerializable
   virtual void save(std::ostream& os) override;
   virtual void load(std::istream& in) override;
@@ -69,6 +77,10 @@ private:
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersConsumer>> ConsumersContainer;
   ConsumersContainer m_consumers;
 
+  // map { view public key -> consumers catching up with the one in m_consumers }
+  typedef std::unordered_multimap<Crypto::PublicKey, std::unique_ptr<TransfersConsumer>> CatchUpConsumersContainer;
+  CatchUpConsumersContainer m_catchUpConsumers;
+
   typedef Tools::ObserverManager<ITransfersSynchronizerObserver> SubscribersNotifier;
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<SubscribersNotifier>> SubscribersContainer;
   SubscribersContainer m_subscribers;
@@ -85,6 +97,11 @@ private:
   virtual void onTransactionUpdated(IBlockchainConsumer* consumer, const Crypto::Hash& transactionHash,
     const std::vector<ITransfersContainer*>& containers) override;
 
+  TransfersConsumer& addCatchUpConsumer(const Crypto::PublicKey& viewPublicKey, const Crypto::SecretKey& viewSecretKey);
+  CatchUpConsumersContainer::iterator mergeCatchUpConsumer(CatchUpConsumersContainer::iterator it);
+  bool isCatchUpConsumer(IBlockchainConsumer* consumer) const;
+  void saveConsumer(ISerializer& s, const Crypto::PublicKey& viewKey, TransfersConsumer& consumer);
+
   bool findViewKeyForConsumer(IBlockchainConsumer* consumer, Crypto::PublicKey& viewKey) const;
   SubscribersContainer::const_iterator findSubscriberForConsumer(IBlockchainConsumer* consumer) const;
 };
@@ -0,0 +1,119 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+namespace MevaCoin {
+
+// Items waiting for a block height or a timestamp, handed back in unlock order once due,
+// so nobody has to scan everything still locked to find what has just unlocked.
+template <typename T>
+class UnlockScheduler {
+public:
+  void scheduleAtHeight(uint64_t height, const T& item) {
+    m_heightQueue.emplace(height, item);
+  }
+
+  void scheduleAtTime(uint64_t timestamp, const T& item) {
+    m_timeQueue.emplace(timestamp, item);
+  }
+
+  bool unscheduleAtHeight(uint64_t height, const T& item) {
+    return unschedule(m_heightQueue, height, item);
+  }
+
+  bool unscheduleAtTime(uint64_t timestamp, const T& item) {
+    return unschedule(m_timeQueue, timestamp, item);
+  }
+
+  template <typename Predicate>
+  size_t unscheduleIf(Predicate predicate) {
+    return unscheduleIf(m_heightQueue, predicate) + unscheduleIf(m_timeQueue, predicate);
+  }
+
+  // Calls release(item) for everything due at the height and timestamp, time locks first.
+  // release may schedule the item again for a later point.
+  template <typename Release>
+  size_t releaseDue(uint64_t height, uint64_t timestamp, Release release) {
+    size_t released = releaseDue(m_timeQueue, timestamp, release);
+    return released + releaseDue(m_heightQueue, height, release);
+  }
+
+  bool empty() const {
+    return m_heightQueue.empty() && m_timeQueue.empty();
+  }
+
+  size_t size() const {
+    return m_heightQueue.size() + m_timeQueue.size();
+  }
+
+  void clear() {
+    m_heightQueue.clear();
+    m_timeQueue.clear();
+  }
+
+private:
+  typedef std::multimap<uint64_t, T> Queue;
+
+  static bool unschedule(Queue& queue, uint64_t key, const T& item) {
+    auto range = queue.equal_range(key);
+    auto it = std::find_if(range.first, range.second, [&item](const typename Queue::value_type& entry) { return entry.second == item; });
+    if (it == range.second) {
+      return false;
+    }
+
+    queue.erase(it);
+    return true;
+  }
+
+  template <typename Predicate>
+  static size_t unscheduleIf(Queue& queue, Predicate& predicate) {
+    size_t removed = 0;
+    for (auto it = queue.begin(); it != queue.end();) {
+      if (predicate(it->second)) {
+        it = queue.erase(it);
+        ++removed;
+      } else {
+        ++it;
+      }
+    }
+
+    return removed;
+  }
+
+  template <typename Release>
+  static size_t releaseDue(Queue& queue, uint64_t now, Release& release) {
+    size_t released = 0;
+    while (!queue.empty() && queue.begin()->first <= now) {
+      T item = std::move(queue.begin()->second);
+      queue.erase(queue.begin());
+      release(item);
+      ++released;
+    }
+
+    return released;
+  }
+
+  Queue m_heightQueue;
+  Queue m_timeQueue;
+};
+
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DecoyReservoir.h"
+
+#include <algorithm>
+
+#include "Common/ShuffleGenerator.h"
+#include "crypto/random.h"
+
+namespace MevaCoin {
+
+DecoyReservoir::DecoyReservoir(uint32_t maxAge) : m_maxAge(maxAge), m_generation(0) {
+}
+
+bool DecoyReservoir::hasAllOutputs(const OutsForAmount& outs, size_t requestedCount) {
+  // random outputs come in the order they are picked, all of them in index order
+  return outs.outs.size() < requestedCount || std::is_sorted(outs.outs.begin(), outs.outs.end(), [](const OutEntry& a, const OutEntry& b) {
+    return a.global_amount_index < b.global_amount_index;
+  });
+}
+
+void DecoyReservoir::add(const std::vector<OutsForAmount>& outs, size_t requestedCount, uint32_t height, uint64_t generation) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (generation != m_generation) {
+    return;
+  }
+
+  for (const auto& outsForAmount : outs) {
+    // rings of such an amount would split its few outputs between them
+    if (hasAllOutputs(outsForAmount, requestedCount)) {
+      continue;
+    }
+
+    // every output goes to a random place, so the reservoir stays shuffled
+    auto& reservoir = m_outs[outsForAmount.amount];
+    for (const auto& out : outsForAmount.outs) {
+      reservoir.push_back(Entry{ out, height });
+      std::swap(reservoir.back(), reservoir[Random::randomValue<size_t>(0, reservoir.size() - 1)]);
+    }
+  }
+}
+
+size_t DecoyReservoir::take(size_t count, uint32_t height, OutsForAmount& result) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_outs.find(result.amount);
+  if (it == m_outs.end()) {
+    return 0;
+  }
+
+  Outs& outs = it->second;
+  dropExpired(outs, height);
+
+  // refills may overlap, a ring must not get the same output twice
+  std::unordered_set<uint64_t> taken;
+  for (const auto& out : result.outs) {
+    taken.insert(out.global_amount_index);
+  }
+
+  std::vector<size_t> found;
+  ShuffleGenerator<size_t> generator(outs.size());
+  while (found.size() < count && !generator.empty()) {
+    size_t index = generator();
+    if (taken.insert(outs[index].out.global_amount_index).second) {
+      result.outs.push_back(outs[index].out);
+      found.push_back(index);
+    }
+  }
+
+  std::sort(found.begin(), found.end());
+  for (auto it = found.rbegin(); it != found.rend(); ++it) {
+    outs.erase(outs.begin() + *it);
+  }
+
+  return found.size();
+}
+
+size_t DecoyReservoir::available(uint64_t amount, uint32_t height) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_outs.find(amount);
+  if (it == m_outs.end()) {
+    return 0;
+  }
+
+  dropExpired(it->second, height);
+  return it->second.size();
+}
+
+void DecoyReservoir::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_outs.clear();
+  ++m_generation;
+}
+
+uint64_t DecoyReservoir::generation() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_generation;
+}
+
+bool DecoyReservoir::beginRefill(uint64_t amount) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_refills.insert(amount).second;
+}
+
+void DecoyReservoir::endRefill(uint64_t amount) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_refills.erase(amount);
+}
+
+void DecoyReservoir::dropExpired(Outs& outs, uint32_t height) const {
+  outs.erase(std::remove_if(outs.begin(), outs.end(), [this, height](const Entry& entry) { return entry.height + m_maxAge < height; }), outs.end());
+}
+
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+
+namespace MevaCoin {
+
+// Random outputs fetched from the daemon ahead of time, per amount, so transactions can take
+// their mixins locally. Every output is handed out once, in random order. Amounts the daemon
+// returned all its outputs of are not kept, see hasAllOutputs(). Outputs older than maxAge blocks are
+// dropped so the mix keeps the daemon's age distribution, and clear() after a rollback discards
+// everything, including refills still in flight, since their global indices may be gone.
+// Thread safe: refills are added from node callbacks.
+class DecoyReservoir {
+public:
+  typedef COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry OutEntry;
+  typedef COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount OutsForAmount;
+
+  explicit DecoyReservoir(uint32_t maxAge);
+
+  // The daemon returns all the outputs of an amount, in index order, if it has no more of them than requested
+  static bool hasAllOutputs(const OutsForAmount& outs, size_t requestedCount);
+
+  // requestedCount is the outs count of the request, height the wallet blockchain size when the outputs were requested,
+  // generation the value of generation() then
+  void add(const std::vector<OutsForAmount>& outs, size_t requestedCount, uint32_t height, uint64_t generation);
+  // Moves up to count distinct outputs of result.amount into result.outs, returns how many were taken
+  size_t take(size_t count, uint32_t height, OutsForAmount& result);
+  size_t available(uint64_t amount, uint32_t height);
+  void clear();
+  uint64_t generation() const;
+
+  // false if a refill of the amount is already running
+  bool beginRefill(uint64_t amount);
+  void endRefill(uint64_t amount);
+
+private:
+  struct Entry {
+    OutEntry out;
+    uint32_t height;
+  };
+
+  typedef std::deque<Entry> Outs;
+
+  void dropExpired(Outs& outs, uint32_t height) const;
+
+  const uint32_t m_maxAge;
+  mutable std::mutex m_mutex;
+  uint64_t m_generation;
+  std::unordered_map<uint64_t, Outs> m_outs;
+  std::unordered_set<uint64_t> m_refills;
+};
+
+}
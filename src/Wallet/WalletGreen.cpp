@@ -21,12 +21,14 @@
 #include "WalletGreen.h"
 
 #include <algorithm>
+#include <cstring>
 #include <ctime>
 #include <cassert>
 #include <fstream>
 #include <future>
 #include <numeric>
 #include <set>
+#include <sstream>
 #include <tuple>
 #include <utility>
 
@@ -75,6 +77,22 @@ using namespace Logging;
 
 namespace {
 
+// random outputs requested at once per amount for the decoy reservoir
+const uint64_t DECOY_RESERVOIR_BATCH = 64;
+// blocks after which unused decoys are dropped
+const uint32_t DECOY_RESERVOIR_MAX_AGE = 10;
+// the journal is compacted into a new snapshot once it outgrows the snapshot and this size
+const uint64_t JOURNAL_MIN_COMPACTION_SIZE = 64 * 1024;
+// zeroed suffix space left after a snapshot and added at once to the journal, so that journal records are written in place
+const uint64_t JOURNAL_MIN_RESERVE_SIZE = 64 * 1024;
+// the history region of a container suffix starts with its size
+const uint64_t HISTORY_HEADER_SIZE = sizeof(uint64_t);
+// the latest transactions stay resident with their extras and transfers, older ones are paged out a page at a time
+// once all of the page is deep enough in the blockchain not to be changed by a reorganization
+const size_t HISTORY_RESIDENT_TRANSACTION_COUNT = 1000;
+const size_t HISTORY_PAGE_SIZE = 256;
+const uint32_t HISTORY_CONFIRMATIONS = 720;
+
 void asyncRequestCompletion(System::Event& requestFinished) {
   requestFinished.set();
 }
@@ -151,6 +169,7 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_node(node),
   m_logger(logger, "WalletGreen/empty"),
   m_stopped(false),
+  m_journalCompactionFinished(m_dispatcher),
   m_blockchainSynchronizerStarted(false),
   m_blockchainSynchronizer(node, logger, currency.genesisBlockHash()),
   m_synchronizer(currency, logger, m_blockchainSynchronizer, node),
@@ -159,9 +178,22 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_state(WalletState::NOT_INITIALIZED),
   m_actualBalance(0),
   m_pendingBalance(0),
-  m_transactionSoftLockTime(transactionSoftLockTime)
+  m_transactionSoftLockTime(transactionSoftLockTime),
+  m_decoys(std::make_shared<DecoyReservoir>(DECOY_RESERVOIR_MAX_AGE))
 {
   m_upperTransactionSizeLimit = m_currency.maxTransactionSizeLimit();
+  m_containerDataHash = NULL_HASH;
+  m_journalBegin = 0;
+  m_journalEnd = 0;
+  m_journalGeneration = 0;
+  m_journalWriteScheduled = false;
+  m_journalCompactionStarted = false;
+  m_journalCompactionFinished.set();
+  m_historySize = 0;
+  m_historyResidentTransactionCount = HISTORY_RESIDENT_TRANSACTION_COUNT;
+  m_historyPageSize = HISTORY_PAGE_SIZE;
+  m_historyConfirmations = HISTORY_CONFIRMATIONS;
+  resetJournal(false);
   m_readyEvent.set();
 }
 
@@ -227,6 +259,9 @@ void WalletGreen::shutdown() {
 }
 
 void WalletGreen::doShutdown() {
+  // a compaction snapshot being serialized is dropped, but the worker has to be done with it
+  m_journalCompactionFinished.wait();
+
   if (m_walletsContainer.size() != 0) {
     m_synchronizer.unsubscribeConsumerNotifications(m_viewPublicKey, this);
   }
@@ -235,8 +270,13 @@ void WalletGreen::doShutdown() {
   m_blockchainSynchronizer.removeObserver(this);
 
   m_containerStorage.close();
+  m_containerDataHash = NULL_HASH;
+  resetJournal(false);
+  m_journalBegin = 0;
+  m_journalEnd = 0;
   m_walletsContainer.clear();
   clearCaches(true, true);
+  m_decoys->clear();
 
   std::queue<WalletEvent> noEvents;
   std::swap(m_events, noEvents);
@@ -245,9 +285,14 @@ void WalletGreen::doShutdown() {
 }
 
 void WalletGreen::clearCaches(bool clearTransactions, bool clearCachedData) {
+  if (clearTransactions || clearCachedData) {
+    resetJournal(false);
+  }
+
   if (clearTransactions) {
     m_transactions.clear();
     m_transfers.clear();
+    clearHistory();
   }
 
   if (clearCachedData) {
@@ -275,6 +320,7 @@ void WalletGreen::clearCaches(bool clearTransactions, bool clearCachedData) {
 
     m_uncommitedTransactions.clear();
     m_unlockTransactionsJob.clear();
+    m_timeUnlockJobs.clear();
     m_actualBalance = 0;
     m_pendingBalance = 0;
     m_fusionTxsCache.clear();
@@ -390,17 +436,50 @@ void WalletGreen::save(WalletSaveLevel saveLevel, const std::string& extra) {
   throwIfNotInitialized();
   throwIfStopped();
 
-  stopBlockchainSynchronizer();
+  // A journaled container gets a record of the changes, the synchronizer state is saved by the compaction in the background
+  if (saveLevel == WalletSaveLevel::SAVE_ALL && m_journalEnabled) {
+    try {
+      if (extra != m_extra) {
+        m_extra = extra;
+        m_journalChanges.extra = true;
+      }
+
+      writeJournalRecord();
+    } catch (const std::exception& e) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
+      throw;
+    }
+
+    m_logger(INFO, BRIGHT_WHITE) << "Container saved";
+    return;
+  }
+
+  // Wallet data is changed only by this dispatcher, so only the synchronizer state
+  // has to be taken with sync paused; the cache itself is written while it runs.
+  std::string transfersSynchronizerState;
+  if (saveLevel == WalletSaveLevel::SAVE_ALL) {
+    stopBlockchainSynchronizer();
+
+    try {
+      std::stringstream stream;
+      m_synchronizer.save(stream);
+      transfersSynchronizerState = stream.str();
+    } catch (const std::exception& e) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
+      startBlockchainSynchronizer();
+      throw;
+    }
+
+    startBlockchainSynchronizer();
+  }
 
   try {
-    saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+    saveWalletCache(m_containerStorage, m_key, saveLevel, extra, saveLevel == WalletSaveLevel::SAVE_ALL ? &transfersSynchronizerState : nullptr);
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
-    startBlockchainSynchronizer();
     throw;
   }
 
-  startBlockchainSynchronizer();
   m_logger(INFO, BRIGHT_WHITE) << "Container saved";
 }
 
@@ -595,7 +674,7 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
   assert(m_containerStorage.isOpened());
 
   BinaryArray contanerData;
-  loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
+  uint64_t journalBegin = loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
 
   WalletSerializerV2 s(
     *this,
@@ -608,41 +687,70 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
     m_unlockTransactionsJob,
     m_transactions,
     m_transfers,
+    m_historyPages,
     m_uncommitedTransactions,
     extra,
     m_transactionSoftLockTime
   );
 
+  uint8_t version = reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version;
   Common::MemoryInputStream containerStream(contanerData.data(), contanerData.size());
-  s.load(containerStream, reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version);
+  s.load(containerStream, version);
+  m_containerDataHash = Crypto::cn_fast_hash(contanerData.data(), contanerData.size());
+  m_historySize = getHistorySize(m_containerStorage);
+
+  uint64_t journalEnd = journalBegin;
+  if (version >= WalletSerializerV2::JOURNAL_VERSION) {
+    size_t recordCount = 0;
+    BinaryArray record;
+    for (;;) {
+      try {
+        if (!readContainerRecord(m_containerStorage, m_key, journalEnd, record)) {
+          break;
+        }
+      } catch (const std::runtime_error& e) {
+        // a record being written when the wallet was stopped, it and the space after it are dropped
+        m_logger(WARNING, BRIGHT_YELLOW) << "Container journal is cut at record " << recordCount << ": " << e.what();
+        std::fill(m_containerStorage.suffix() + journalEnd, m_containerStorage.suffix() + m_containerStorage.suffixSize(), 0);
+        m_containerStorage.flush();
+        break;
+      }
+
+      Common::MemoryInputStream recordStream(record.data(), record.size());
+      s.loadChanges(recordStream, version);
+      ++recordCount;
+    }
+
+    m_logger(DEBUGGING) << "Container journal replayed, record count " << recordCount;
+  }
+
+  m_extra = extra;
+  // records are appended in the current format only, an older container gets a snapshot with the next save
+  resetJournal(s.saveLevel() == WalletSaveLevel::SAVE_ALL && version >= WalletSerializerV2::DELTA_JOURNAL_VERSION);
+  m_journalBegin = journalBegin;
+  m_journalEnd = journalEnd;
+
   addedKeys = std::move(s.addedKeys());
   deletedKeys = std::move(s.deletedKeys());
+  restoreTimeUnlockJobs();
 
   m_logger(DEBUGGING) << "Container cache loaded";
 }
 
-void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra) {
+void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra,
+  const std::string* transfersSynchronizerState) {
   m_logger(DEBUGGING) << "Saving cache...";
 
+  bool ownStorage = &storage == &m_containerStorage;
+  // changes are journaled only over a snapshot with all the transactions, at the same ids
+  bool journaled = saveLevel == WalletSaveLevel::SAVE_ALL && std::none_of(m_transactions.begin(), m_transactions.end(),
+    [](const WalletTransaction& tx) { return tx.state == WalletTransactionState::DELETED; });
+
   WalletTransactions transactions;
   WalletTransfers transfers;
-
-  if (saveLevel == WalletSaveLevel::SAVE_KEYS_AND_TRANSACTIONS) {
-    filterOutTransactions(transactions, transfers, [](const WalletTransaction& tx) {
-      return tx.state == WalletTransactionState::CREATED || tx.state == WalletTransactionState::DELETED;
-    });
-
-    for (auto it = transactions.begin(); it != transactions.end(); ++it) {
-      transactions.modify(it, [](WalletTransaction& tx) {
-        tx.state = WalletTransactionState::CANCELLED;
-        tx.blockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
-      });
-    }
-  } else if (saveLevel == WalletSaveLevel::SAVE_ALL) {
-    filterOutTransactions(transactions, transfers, [](const WalletTransaction& tx) {
-      return tx.state == WalletTransactionState::DELETED;
-    });
-  }
+  WalletHistoryPages historyPages;
+  std::vector<uint64_t> newPages;
+  HistoryUpdate history = makeSnapshotTransactions(saveLevel, ownStorage, journaled, transactions, transfers, historyPages, newPages);
 
   std::string containerData;
   Common::StringOutputStream containerStream(containerData);
@@ -658,21 +766,93 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
     m_unlockTransactionsJob,
     transactions,
     transfers,
+    historyPages,
     m_uncommitedTransactions,
     const_cast<std::string&>(extra),
     m_transactionSoftLockTime
   );
 
-  s.save(containerStream, saveLevel);
+  s.save(containerStream, saveLevel, transfersSynchronizerState);
 
-  encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size());
+  // rewriting and flushing the whole mapped file is the expensive part, skip it if nothing has changed;
+  // a container of an older format is rewritten anyway, records are journaled in the current one only
+  Crypto::Hash containerDataHash = Crypto::cn_fast_hash(containerData.data(), containerData.size());
+  bool currentFormat = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix())->version == WalletSerializerV2::SERIALIZATION_VERSION;
+  if (ownStorage && storage.suffixSize() > 0 && currentFormat && m_journalEnd == m_journalBegin && containerDataHash == m_containerDataHash) {
+    m_extra = extra;
+    resetJournal(journaled);
+    m_logger(DEBUGGING) << "Container cache is not changed";
+    return;
+  }
+
+  // the snapshot is always written in the current format
+  reinterpret_cast<ContainerStoragePrefix*>(storage.prefix())->version = WalletSerializerV2::SERIALIZATION_VERSION;
+  uint64_t snapshotEnd = encryptAndSaveContainerData(storage, key, containerData.data(), containerData.size(), history,
+    ownStorage && journaled ? JOURNAL_MIN_RESERVE_SIZE : 0);
   storage.flush();
 
   m_extra = extra;
 
+  if (ownStorage) {
+    pageOutHistory(std::move(historyPages), newPages, history.size);
+    m_containerDataHash = containerDataHash;
+    resetJournal(journaled);
+    m_journalBegin = snapshotEnd;
+    m_journalEnd = m_journalBegin;
+  }
+
   m_logger(DEBUGGING) << "Container saving finished";
 }
 
+WalletGreen::HistoryUpdate WalletGreen::makeSnapshotTransactions(WalletSaveLevel saveLevel, bool ownStorage, bool journaled,
+  WalletTransactions& transactions, WalletTransfers& transfers, WalletHistoryPages& historyPages, std::vector<uint64_t>& newPages) {
+  // history pages are kept by journaled snapshots of the own storage, other snapshots of it take the history back
+  if (ownStorage && !journaled) {
+    loadAllHistory();
+  }
+
+  if (saveLevel == WalletSaveLevel::SAVE_KEYS_AND_TRANSACTIONS) {
+    filterOutTransactions(transactions, transfers, [](const WalletTransaction& tx) {
+      return tx.state == WalletTransactionState::CREATED || tx.state == WalletTransactionState::DELETED;
+    }, !ownStorage);
+
+    for (auto it = transactions.begin(); it != transactions.end(); ++it) {
+      transactions.modify(it, [](WalletTransaction& tx) {
+        tx.state = WalletTransactionState::CANCELLED;
+        tx.blockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
+      });
+    }
+  } else if (saveLevel == WalletSaveLevel::SAVE_ALL) {
+    filterOutTransactions(transactions, transfers, [](const WalletTransaction& tx) {
+      return tx.state == WalletTransactionState::DELETED;
+    }, !ownStorage);
+  }
+
+  HistoryUpdate history;
+  if (!ownStorage || !journaled) {
+    return history;
+  }
+
+  history = makeHistoryUpdate(historyPages, newPages);
+
+  // the snapshot has the transactions paged out now without their extras and transfers, the same ids as m_transactions
+  auto& index = transactions.get<RandomAccessIndex>();
+  for (uint64_t firstTransactionId : newPages) {
+    for (uint64_t id = firstTransactionId; id < firstTransactionId + historyPages[firstTransactionId].transactionCount; ++id) {
+      index.modify(std::next(index.begin(), id), [](WalletTransaction& tx) { tx.extra.clear(); });
+    }
+  }
+
+  if (!newPages.empty()) {
+    transfers.erase(std::remove_if(transfers.begin(), transfers.end(), [&historyPages](const TransactionTransferPair& pair) {
+      auto pageIt = historyPages.upper_bound(pair.first);
+      return pageIt != historyPages.begin() && pair.first < std::prev(pageIt)->first + std::prev(pageIt)->second.transactionCount;
+    }), transfers.end());
+  }
+
+  return history;
+}
+
 void WalletGreen::copyContainerStorageKeys(ContainerStorage& src, const chacha8_key& srcKey, ContainerStorage& dst, const chacha8_key& dstKey) {
   dst.reserve(src.size());
 
@@ -713,36 +893,620 @@ void WalletGreen::copyContainerStoragePrefix(ContainerStorage& src, const chacha
   incIv(dstPrefix->nextIv);
 }
 
-void WalletGreen::encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize) {
+uint64_t WalletGreen::encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize,
+  const HistoryUpdate& history, uint64_t reserveSize) {
   ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
-
   Crypto::chacha8_iv suffixIv = prefix->nextIv;
   incIv(prefix->nextIv);
 
-  BinaryArray encryptedContainer;
-  encryptedContainer.resize(containerDataSize);
-  chacha8(containerData, containerDataSize, key, suffixIv, reinterpret_cast<char*>(encryptedContainer.data()));
+  // the data is encrypted right into the mapped suffix instead of going through intermediate copies
+  std::string suffixHeader = makeContainerDataHeader(suffixIv, containerDataSize);
+  uint64_t snapshotOffset = resizeContainerSuffix(storage, history, suffixHeader.size() + containerDataSize, reserveSize);
+  std::copy(suffixHeader.begin(), suffixHeader.end(), storage.suffix() + snapshotOffset);
+  chacha8(containerData, containerDataSize, key, suffixIv, reinterpret_cast<char*>(storage.suffix() + snapshotOffset + suffixHeader.size()));
 
-  std::string suffix;
-  Common::StringOutputStream suffixStream(suffix);
+  return snapshotOffset + suffixHeader.size() + containerDataSize;
+}
+
+std::string WalletGreen::makeContainerDataHeader(const Crypto::chacha8_iv& suffixIv, size_t containerDataSize) {
+  // the layout is that of serialized suffixIv and encryptedContainer, the encrypted data follows the header
+  std::string suffixHeader;
+  Common::StringOutputStream suffixStream(suffixHeader);
   BinaryOutputStreamSerializer suffixSerializer(suffixStream);
-  suffixSerializer(suffixIv, "suffixIv");
-  suffixSerializer(encryptedContainer, "encryptedContainer");
+  Crypto::chacha8_iv iv = suffixIv;
+  suffixSerializer(iv, "suffixIv");
+  Common::writeVarint(suffixStream, containerDataSize);
+  return suffixHeader;
+}
+
+uint64_t WalletGreen::resizeContainerSuffix(ContainerStorage& storage, const HistoryUpdate& history, uint64_t dataSize, uint64_t reserveSize) {
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
+  // the history region is kept by the containers of the current format only
+  bool hasHistory = prefix->version >= WalletSerializerV2::HISTORY_VERSION;
+  assert(hasHistory || history.size == 0);
+  assert(history.offset + history.data.size() == history.size);
+
+  // the history region before history.offset is kept as it is
+  uint64_t snapshotOffset = hasHistory ? HISTORY_HEADER_SIZE + history.size : 0;
+  storage.resizeSuffix(snapshotOffset + dataSize + reserveSize);
+  if (hasHistory) {
+    std::memcpy(storage.suffix(), &history.size, sizeof(history.size));
+    std::copy(history.data.begin(), history.data.end(), storage.suffix() + HISTORY_HEADER_SIZE + history.offset);
+  }
 
-  storage.resizeSuffix(suffix.size());
-  std::copy(suffix.begin(), suffix.end(), storage.suffix());
+  // the reserve may still have the old journal, a zero record size marks the end of the new one
+  std::fill(storage.suffix() + snapshotOffset + dataSize, storage.suffix() + storage.suffixSize(), 0);
+  return snapshotOffset;
 }
 
-void WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData) {
-  Common::MemoryInputStream suffixStream(storage.suffix(), storage.suffixSize());
+uint64_t WalletGreen::loadAndDecryptContainerData(const ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData) {
+  const ContainerStoragePrefix* prefix = reinterpret_cast<const ContainerStoragePrefix*>(storage.prefix());
+  uint64_t snapshotOffset = prefix->version >= WalletSerializerV2::HISTORY_VERSION ? HISTORY_HEADER_SIZE + getHistorySize(storage) : 0;
+  if (snapshotOffset > storage.suffixSize()) {
+    throw std::runtime_error("Container history is truncated");
+  }
+
+  Common::MemoryInputStream suffixStream(storage.suffix() + snapshotOffset, storage.suffixSize() - snapshotOffset);
   BinaryInputStreamSerializer suffixSerializer(suffixStream);
   Crypto::chacha8_iv suffixIv;
-  BinaryArray encryptedContainer;
   suffixSerializer(suffixIv, "suffixIv");
-  suffixSerializer(encryptedContainer, "encryptedContainer");
 
-  containerData.resize(encryptedContainer.size());
-  chacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char*>(containerData.data()));
+  uint64_t encryptedContainerSize = Common::readVarint<uint64_t>(suffixStream);
+  if (encryptedContainerSize > storage.suffixSize() - snapshotOffset - suffixStream.getPosition()) {
+    throw std::runtime_error("Container data is truncated");
+  }
+
+  containerData.resize(encryptedContainerSize);
+  chacha8(storage.suffix() + snapshotOffset + suffixStream.getPosition(), encryptedContainerSize, key, suffixIv,
+    reinterpret_cast<char*>(containerData.data()));
+
+  return snapshotOffset + suffixStream.getPosition() + encryptedContainerSize;
+}
+
+uint64_t WalletGreen::getHistorySize(const ContainerStorage& storage) {
+  const ContainerStoragePrefix* prefix = reinterpret_cast<const ContainerStoragePrefix*>(storage.prefix());
+  if (prefix->version < WalletSerializerV2::HISTORY_VERSION || storage.suffixSize() < HISTORY_HEADER_SIZE) {
+    return 0;
+  }
+
+  uint64_t historySize;
+  std::memcpy(&historySize, storage.suffix(), sizeof(historySize));
+  return historySize;
+}
+
+std::string WalletGreen::makeContainerRecord(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* record, size_t recordSize) {
+  // the layout is that of serialized recordIv and varint size, followed by the encrypted checksum and record,
+  // a torn record fails the checksum and a zero size marks the end of the journal
+  std::string plainRecord(sizeof(Crypto::Hash), '\0');
+  plainRecord.append(static_cast<const char*>(record), recordSize);
+  Crypto::cn_fast_hash(record, recordSize, *reinterpret_cast<Crypto::Hash*>(&plainRecord[0]));
+
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
+  Crypto::chacha8_iv recordIv = prefix->nextIv;
+  incIv(prefix->nextIv);
+
+  std::string containerRecord;
+  Common::StringOutputStream recordStream(containerRecord);
+  BinaryOutputStreamSerializer recordSerializer(recordStream);
+  recordSerializer(recordIv, "recordIv");
+  Common::writeVarint(recordStream, plainRecord.size());
+
+  size_t headerSize = containerRecord.size();
+  containerRecord.resize(headerSize + plainRecord.size());
+  chacha8(plainRecord.data(), plainRecord.size(), key, recordIv, &containerRecord[headerSize]);
+  return containerRecord;
+}
+
+void WalletGreen::appendJournalRecord(ContainerStorage& storage, const Crypto::chacha8_key& key, uint64_t& journalEnd, const void* record, size_t recordSize) {
+  std::string containerRecord = makeContainerRecord(storage, key, record, recordSize);
+
+  uint64_t newJournalEnd = journalEnd + containerRecord.size();
+  if (newJournalEnd > storage.suffixSize()) {
+    // resizing copies the file, so the journal space grows with the journal
+    storage.resizeSuffix(newJournalEnd + std::max(JOURNAL_MIN_RESERVE_SIZE, storage.suffixSize() / 2));
+  }
+
+  std::copy(containerRecord.begin(), containerRecord.end(), storage.suffix() + journalEnd);
+  storage.flush();
+
+  journalEnd = newJournalEnd;
+}
+
+bool WalletGreen::readContainerRecord(const ContainerStorage& storage, const Crypto::chacha8_key& key, uint64_t& offset, BinaryArray& record) {
+  if (storage.suffixSize() - offset <= sizeof(Crypto::chacha8_iv)) {
+    return false;
+  }
+
+  Common::MemoryInputStream recordStream(storage.suffix() + offset, storage.suffixSize() - offset);
+  BinaryInputStreamSerializer recordSerializer(recordStream);
+  Crypto::chacha8_iv recordIv;
+  recordSerializer(recordIv, "recordIv");
+
+  uint64_t plainRecordSize = Common::readVarint<uint64_t>(recordStream);
+  if (plainRecordSize == 0) {
+    return false;
+  }
+
+  if (plainRecordSize < sizeof(Crypto::Hash) || plainRecordSize > storage.suffixSize() - offset - recordStream.getPosition()) {
+    throw std::runtime_error("Container record is truncated");
+  }
+
+  BinaryArray plainRecord(plainRecordSize);
+  chacha8(storage.suffix() + offset + recordStream.getPosition(), plainRecordSize, key, recordIv, reinterpret_cast<char*>(plainRecord.data()));
+
+  Crypto::Hash checksum = Crypto::cn_fast_hash(plainRecord.data() + sizeof(Crypto::Hash), plainRecordSize - sizeof(Crypto::Hash));
+  if (std::memcmp(&checksum, plainRecord.data(), sizeof(Crypto::Hash)) != 0) {
+    throw std::runtime_error("Container record checksum mismatch");
+  }
+
+  record.assign(plainRecord.begin() + sizeof(Crypto::Hash), plainRecord.end());
+  offset += recordStream.getPosition() + plainRecordSize;
+  return true;
+}
+
+std::string WalletGreen::makeJournalRecord() {
+  std::string record;
+  Common::StringOutputStream recordStream(record);
+
+  WalletSerializerV2 s(
+    *this,
+    m_viewPublicKey,
+    m_viewSecretKey,
+    m_actualBalance,
+    m_pendingBalance,
+    m_walletsContainer,
+    m_synchronizer,
+    m_unlockTransactionsJob,
+    m_transactions,
+    m_transfers,
+    m_historyPages,
+    m_uncommitedTransactions,
+    m_extra,
+    m_transactionSoftLockTime
+  );
+
+  s.saveChanges(recordStream, m_journalChanges);
+  return record;
+}
+
+void WalletGreen::resetJournal(bool enabled) {
+  m_journalEnabled = enabled;
+  m_journalChanges.clear();
+  ++m_journalGeneration;
+}
+
+void WalletGreen::writeJournalRecord() {
+  assert(m_journalEnabled);
+
+  if (m_journalChanges.empty()) {
+    m_logger(DEBUGGING) << "Container cache is not changed";
+    return;
+  }
+
+  std::string record = makeJournalRecord();
+  appendJournalRecord(m_containerStorage, m_key, m_journalEnd, record.data(), record.size());
+  m_logger(DEBUGGING) << "Journal record written, changed transactions " << m_journalChanges.transactions.size() << ", size " << record.size() <<
+    ", journal size " << m_journalEnd - m_journalBegin;
+
+  if (m_journalCompactionStarted) {
+    m_compactionJournaledTransactions.insert(m_journalChanges.transactions.begin(), m_journalChanges.transactions.end());
+  }
+
+  m_journalChanges.clear();
+
+  if (m_journalEnd - m_journalBegin > std::max(m_journalBegin, JOURNAL_MIN_COMPACTION_SIZE)) {
+    startJournalCompaction();
+  }
+}
+
+void WalletGreen::scheduleJournalWrite() {
+  if (!m_journalEnabled || m_journalWriteScheduled) {
+    return;
+  }
+
+  // changes made in one go get a single record
+  m_journalWriteScheduled = true;
+  m_dispatcher.remoteSpawn([this] {
+    System::EventLock lk(m_readyEvent);
+    m_journalWriteScheduled = false;
+
+    if (m_state == WalletState::NOT_INITIALIZED || !m_journalEnabled) {
+      return;
+    }
+
+    try {
+      writeJournalRecord();
+    } catch (const std::exception& e) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to write journal record: " << e.what();
+    }
+  });
+}
+
+void WalletGreen::startJournalCompaction() {
+  if (m_journalCompactionStarted) {
+    return;
+  }
+
+  m_journalCompactionStarted = true;
+  m_logger(DEBUGGING) << "Starting journal compaction, journal size " << m_journalEnd - m_journalBegin;
+
+  uint64_t journalGeneration = m_journalGeneration;
+  if (!m_blockchainSynchronizerStarted) {
+    std::stringstream stream;
+    m_synchronizer.save(stream);
+    auto state = std::make_shared<std::string>(stream.str());
+    m_dispatcher.remoteSpawn([this, state, journalGeneration] { compactJournal(*state, journalGeneration); });
+    return;
+  }
+
+  // The synchronizer state is taken on its working thread between two steps, so sync isn't stopped for it.
+  // Wallet data is taken after the events queued before, so it is never behind the synchronizer state
+  try {
+    m_blockchainSynchronizer.runBetweenSteps([this, journalGeneration] {
+      try {
+        std::stringstream stream;
+        m_synchronizer.save(stream);
+        auto state = std::make_shared<std::string>(stream.str());
+        m_dispatcher.remoteSpawn([this, state, journalGeneration] { compactJournal(*state, journalGeneration); });
+      } catch (...) {
+        m_dispatcher.remoteSpawn([this] { m_journalCompactionStarted = false; });
+        throw;
+      }
+    });
+  } catch (const std::exception& e) {
+    m_logger(WARNING, BRIGHT_YELLOW) << "Failed to start journal compaction: " << e.what();
+    m_journalCompactionStarted = false;
+  }
+}
+
+void WalletGreen::compactJournal(const std::string& transfersSynchronizerState, uint64_t journalGeneration) {
+  // The snapshot is taken of a copy of the wallet data, which a worker thread serializes and encrypts
+  // while the wallet goes on. The records journaled meanwhile are moved after the new snapshot
+  ContainerSnapshot snapshot;
+  HistoryUpdate history;
+  std::vector<uint64_t> newPages;
+  Crypto::chacha8_key key;
+  Crypto::chacha8_iv suffixIv;
+  uint64_t journalEnd;
+
+  {
+    System::EventLock lk(m_readyEvent);
+    if (m_state == WalletState::NOT_INITIALIZED || !m_journalEnabled || journalGeneration != m_journalGeneration) {
+      m_journalCompactionStarted = false;
+      return;
+    }
+
+    try {
+      if (std::any_of(m_transactions.begin(), m_transactions.end(), [](const WalletTransaction& tx) { return tx.state == WalletTransactionState::DELETED; })) {
+        // the snapshot isn't journaled then, it is saved as a whole
+        m_journalCompactionStarted = false;
+        saveWalletCache(m_containerStorage, m_key, WalletSaveLevel::SAVE_ALL, m_extra, &transfersSynchronizerState);
+        return;
+      }
+
+      history = makeSnapshotTransactions(WalletSaveLevel::SAVE_ALL, true, true, snapshot.transactions, snapshot.transfers, snapshot.historyPages, newPages);
+      snapshot.wallets = m_walletsContainer;
+      snapshot.unlockTransactions = m_unlockTransactionsJob;
+      snapshot.uncommitedTransactions = m_uncommitedTransactions;
+      snapshot.extra = m_extra;
+      snapshot.actualBalance = m_actualBalance;
+      snapshot.pendingBalance = m_pendingBalance;
+
+      ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(m_containerStorage.prefix());
+      suffixIv = prefix->nextIv;
+      incIv(prefix->nextIv);
+      key = m_key;
+      journalEnd = m_journalEnd;
+    } catch (const std::exception& e) {
+      m_journalCompactionStarted = false;
+      m_logger(ERROR, BRIGHT_RED) << "Failed to compact journal: " << e.what();
+      return;
+    }
+
+    m_compactionJournaledTransactions.clear();
+    m_journalCompactionFinished.clear();
+  }
+
+  Tools::ScopeExit compactionFinished([this] {
+    m_journalCompactionStarted = false;
+    m_compactionJournaledTransactions.clear();
+    m_journalCompactionFinished.set();
+  });
+
+  std::string encryptedContainerData;
+  Crypto::Hash containerDataHash;
+  try {
+    System::RemoteContext<void> context(m_dispatcher, [&] {
+      std::string containerData;
+      Common::StringOutputStream containerStream(containerData);
+
+      Crypto::PublicKey viewPublicKey = m_viewPublicKey;
+      Crypto::SecretKey viewSecretKey = m_viewSecretKey;
+      WalletSerializerV2 s(
+        *this,
+        viewPublicKey,
+        viewSecretKey,
+        snapshot.actualBalance,
+        snapshot.pendingBalance,
+        snapshot.wallets,
+        m_synchronizer,
+        snapshot.unlockTransactions,
+        snapshot.transactions,
+        snapshot.transfers,
+        snapshot.historyPages,
+        snapshot.uncommitedTransactions,
+        snapshot.extra,
+        m_transactionSoftLockTime
+      );
+
+      s.save(containerStream, WalletSaveLevel::SAVE_ALL, &transfersSynchronizerState);
+      containerDataHash = Crypto::cn_fast_hash(containerData.data(), containerData.size());
+
+      encryptedContainerData = makeContainerDataHeader(suffixIv, containerData.size());
+      size_t headerSize = encryptedContainerData.size();
+      encryptedContainerData.resize(headerSize + containerData.size());
+      chacha8(containerData.data(), containerData.size(), key, suffixIv, &encryptedContainerData[headerSize]);
+    });
+
+    context.get();
+  } catch (const std::exception& e) {
+    m_logger(ERROR, BRIGHT_RED) << "Failed to compact journal: " << e.what();
+    return;
+  }
+
+  System::EventLock lk(m_readyEvent);
+  if (m_state == WalletState::NOT_INITIALIZED || !m_journalEnabled || journalGeneration != m_journalGeneration) {
+    m_logger(DEBUGGING) << "Journal compaction is dropped, the container is saved otherwise";
+    return;
+  }
+
+  try {
+    saveJournalCompaction(snapshot, encryptedContainerData, containerDataHash, history, newPages, journalEnd);
+    m_logger(DEBUGGING) << "Journal compacted";
+  } catch (const std::exception& e) {
+    m_logger(ERROR, BRIGHT_RED) << "Failed to compact journal: " << e.what();
+  }
+}
+
+void WalletGreen::saveJournalCompaction(const ContainerSnapshot& snapshot, const std::string& encryptedContainerData, const Crypto::Hash& containerDataHash,
+  const HistoryUpdate& history, std::vector<uint64_t>& newPages, uint64_t journalEnd) {
+  WalletHistoryPages historyPages = snapshot.historyPages;
+  bool pagesKept = false;
+  for (auto pageIt = historyPages.begin(); pageIt != historyPages.end();) {
+    if (std::find(newPages.begin(), newPages.end(), pageIt->first) == newPages.end()) {
+      // a page loaded meanwhile stays resident, the journal has all of it already
+      pageIt = m_historyPages.count(pageIt->first) != 0 ? std::next(pageIt) : historyPages.erase(pageIt);
+      continue;
+    }
+
+    uint64_t lastTransactionId = pageIt->first + pageIt->second.transactionCount;
+    auto isChanged = [this, lastTransactionId](const std::set<size_t>& transactions, uint64_t firstTransactionId) {
+      auto it = transactions.lower_bound(firstTransactionId);
+      return it != transactions.end() && *it < lastTransactionId;
+    };
+
+    if (!isChanged(m_compactionJournaledTransactions, pageIt->first) && !isChanged(m_journalChanges.transactions, pageIt->first)) {
+      ++pageIt;
+      continue;
+    }
+
+    // so does a new page with transactions changed meanwhile, the journal gets the whole page, as it does when a page is loaded
+    for (uint64_t id = pageIt->first; id < lastTransactionId; ++id) {
+      m_journalChanges.transactions.insert(id);
+    }
+
+    newPages.erase(std::find(newPages.begin(), newPages.end(), pageIt->first));
+    pageIt = historyPages.erase(pageIt);
+    pagesKept = true;
+  }
+
+  std::string journal(m_containerStorage.suffix() + journalEnd, m_containerStorage.suffix() + m_journalEnd);
+  uint64_t snapshotOffset = resizeContainerSuffix(m_containerStorage, history, encryptedContainerData.size() + journal.size(), JOURNAL_MIN_RESERVE_SIZE);
+  std::copy(encryptedContainerData.begin(), encryptedContainerData.end(), m_containerStorage.suffix() + snapshotOffset);
+  std::copy(journal.begin(), journal.end(), m_containerStorage.suffix() + snapshotOffset + encryptedContainerData.size());
+  m_containerStorage.flush();
+
+  pageOutHistory(std::move(historyPages), newPages, history.size);
+  m_containerDataHash = containerDataHash;
+  m_journalBegin = snapshotOffset + encryptedContainerData.size();
+  m_journalEnd = m_journalBegin + journal.size();
+
+  if (pagesKept) {
+    writeJournalRecord();
+  }
+}
+
+bool WalletGreen::findHistoryPage(size_t transactionId, WalletHistoryPages::const_iterator& pageIt) const {
+  pageIt = m_historyPages.upper_bound(transactionId);
+  if (pageIt == m_historyPages.begin()) {
+    return false;
+  }
+
+  --pageIt;
+  return transactionId < pageIt->first + pageIt->second.transactionCount;
+}
+
+const WalletGreen::HistoryPageCache& WalletGreen::readHistoryPage(WalletHistoryPages::const_iterator pageIt) const {
+  if (m_historyCache.valid && m_historyCache.firstTransactionId == pageIt->first) {
+    return m_historyCache;
+  }
+
+  m_historyCache.valid = false;
+  m_historyCache.extras.clear();
+  m_historyCache.transfers.clear();
+
+  uint64_t offset = HISTORY_HEADER_SIZE + pageIt->second.offset;
+  BinaryArray page;
+  if (offset + pageIt->second.size > HISTORY_HEADER_SIZE + m_historySize || !readContainerRecord(m_containerStorage, m_key, offset, page)) {
+    throw std::runtime_error("History page is missing");
+  }
+
+  Common::MemoryInputStream pageStream(page.data(), page.size());
+  WalletSerializerV2::loadHistoryPage(pageStream, pageIt->first, pageIt->second.transactionCount, m_historyCache.extras, m_historyCache.transfers);
+  m_historyCache.firstTransactionId = pageIt->first;
+  m_historyCache.valid = true;
+
+  return m_historyCache;
+}
+
+void WalletGreen::loadHistoryPage(WalletHistoryPages::const_iterator pageIt) {
+  uint64_t firstTransactionId = pageIt->first;
+  uint64_t transactionCount = pageIt->second.transactionCount;
+  const HistoryPageCache& page = readHistoryPage(pageIt);
+
+  auto& index = m_transactions.get<RandomAccessIndex>();
+  for (size_t i = 0; i < transactionCount; ++i) {
+    index.modify(std::next(index.begin(), firstTransactionId + i), [&page, i](WalletTransaction& tx) { tx.extra = page.extras[i]; });
+    // the page is gone from the next snapshot, so the journal has all of it until then
+    m_journalChanges.transactions.insert(firstTransactionId + i);
+  }
+
+  auto insertIt = std::lower_bound(m_transfers.begin(), m_transfers.end(), firstTransactionId, [](const TransactionTransferPair& pair, uint64_t id) {
+    return pair.first < id;
+  });
+  m_transfers.insert(insertIt, page.transfers.begin(), page.transfers.end());
+
+  m_historyPages.erase(pageIt);
+  m_historyCache.valid = false;
+
+  m_logger(DEBUGGING) << "History page loaded, first transaction ID " << firstTransactionId << ", transaction count " << transactionCount;
+}
+
+void WalletGreen::loadTransactionHistory(size_t transactionId) {
+  WalletHistoryPages::const_iterator pageIt;
+  if (findHistoryPage(transactionId, pageIt)) {
+    loadHistoryPage(pageIt);
+  }
+}
+
+void WalletGreen::loadAllHistory() {
+  if (m_historyPages.empty()) {
+    return;
+  }
+
+  // the transfers are merged in one pass instead of being inserted a page at a time
+  WalletTransfers transfers;
+  auto transferIt = m_transfers.begin();
+  auto& index = m_transactions.get<RandomAccessIndex>();
+  for (auto pageIt = m_historyPages.begin(); pageIt != m_historyPages.end(); ++pageIt) {
+    const HistoryPageCache& page = readHistoryPage(pageIt);
+
+    auto pageTransferIt = std::lower_bound(transferIt, m_transfers.end(), pageIt->first, [](const TransactionTransferPair& pair, uint64_t id) {
+      return pair.first < id;
+    });
+    transfers.insert(transfers.end(), std::make_move_iterator(transferIt), std::make_move_iterator(pageTransferIt));
+    transfers.insert(transfers.end(), page.transfers.begin(), page.transfers.end());
+    transferIt = pageTransferIt;
+
+    for (size_t i = 0; i < pageIt->second.transactionCount; ++i) {
+      index.modify(std::next(index.begin(), pageIt->first + i), [&page, i](WalletTransaction& tx) { tx.extra = page.extras[i]; });
+      m_journalChanges.transactions.insert(pageIt->first + i);
+    }
+  }
+
+  transfers.insert(transfers.end(), std::make_move_iterator(transferIt), std::make_move_iterator(m_transfers.end()));
+  m_transfers.swap(transfers);
+
+  m_logger(DEBUGGING) << "History loaded, page count " << m_historyPages.size();
+  m_historyPages.clear();
+  m_historyCache.valid = false;
+}
+
+void WalletGreen::clearHistory() {
+  m_historyPages.clear();
+  m_historySize = 0;
+  m_historyCache = HistoryPageCache();
+}
+
+WalletGreen::HistoryUpdate WalletGreen::makeHistoryUpdate(WalletHistoryPages& historyPages, std::vector<uint64_t>& newPages) {
+  HistoryUpdate update;
+  historyPages = m_historyPages;
+
+  uint64_t liveSize = 0;
+  for (const auto& kv : m_historyPages) {
+    liveSize += kv.second.size;
+  }
+
+  // loaded pages leave their space behind, it is reclaimed once it outgrows the pages still in use
+  if (m_historySize - liveSize > liveSize) {
+    for (auto& kv : historyPages) {
+      const uint8_t* page = m_containerStorage.suffix() + HISTORY_HEADER_SIZE + kv.second.offset;
+      kv.second.offset = update.data.size();
+      update.data.append(reinterpret_cast<const char*>(page), kv.second.size);
+    }
+
+    update.offset = 0;
+  } else {
+    update.offset = m_historySize;
+  }
+
+  size_t pagedTransactionCount = m_transactions.size() > m_historyResidentTransactionCount ? m_transactions.size() - m_historyResidentTransactionCount : 0;
+  auto& index = m_transactions.get<RandomAccessIndex>();
+  for (size_t firstTransactionId = 0; firstTransactionId + m_historyPageSize <= pagedTransactionCount; firstTransactionId += m_historyPageSize) {
+    size_t lastTransactionId = firstTransactionId + m_historyPageSize;
+
+    auto pageIt = m_historyPages.lower_bound(lastTransactionId);
+    if (pageIt != m_historyPages.begin() && std::prev(pageIt)->first + std::prev(pageIt)->second.transactionCount > firstTransactionId) {
+      continue;
+    }
+
+    if (!std::all_of(std::next(index.begin(), firstTransactionId), std::next(index.begin(), lastTransactionId), [this](const WalletTransaction& tx) {
+      return tx.state == WalletTransactionState::SUCCEEDED && tx.blockHeight != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT &&
+        tx.blockHeight + m_historyConfirmations <= m_blockchain.size();
+    })) {
+      continue;
+    }
+
+    std::string page;
+    Common::StringOutputStream pageStream(page);
+    WalletSerializerV2::saveHistoryPage(pageStream, m_transactions, m_transfers, firstTransactionId, m_historyPageSize);
+    std::string record = makeContainerRecord(m_containerStorage, m_key, page.data(), page.size());
+
+    historyPages.emplace(firstTransactionId, WalletHistoryPage{ update.offset + update.data.size(), record.size(), m_historyPageSize });
+    update.data.append(record);
+    newPages.push_back(firstTransactionId);
+  }
+
+  update.size = update.offset + update.data.size();
+  return update;
+}
+
+void WalletGreen::pageOutHistory(WalletHistoryPages&& historyPages, const std::vector<uint64_t>& newPages, uint64_t historySize) {
+  auto& index = m_transactions.get<RandomAccessIndex>();
+  for (uint64_t firstTransactionId : newPages) {
+    for (uint64_t id = firstTransactionId; id < firstTransactionId + historyPages[firstTransactionId].transactionCount; ++id) {
+      index.modify(std::next(index.begin(), id), [](WalletTransaction& tx) {
+        tx.extra.clear();
+        tx.extra.shrink_to_fit();
+      });
+    }
+  }
+
+  if (!newPages.empty()) {
+    m_transfers.erase(std::remove_if(m_transfers.begin(), m_transfers.end(), [&historyPages](const TransactionTransferPair& pair) {
+      auto pageIt = historyPages.upper_bound(pair.first);
+      return pageIt != historyPages.begin() && pair.first < std::prev(pageIt)->first + std::prev(pageIt)->second.transactionCount;
+    }), m_transfers.end());
+    m_transfers.shrink_to_fit();
+
+    m_logger(DEBUGGING) << "History paged out, new page count " << newPages.size() << ", page count " << historyPages.size() <<
+      ", history size " << historySize;
+  }
+
+  m_historyPages = std::move(historyPages);
+  m_historySize = historySize;
+  m_historyCache.valid = false;
+}
+
+WalletTransaction WalletGreen::getTransactionWithHistory(size_t transactionId) const {
+  WalletTransaction transaction = m_transactions.get<RandomAccessIndex>()[transactionId];
+
+  WalletHistoryPages::const_iterator pageIt;
+  if (findHistoryPage(transactionId, pageIt)) {
+    transaction.extra = readHistoryPage(pageIt).extras[transactionId - pageIt->first];
+  }
+
+  return transaction;
 }
 
 void WalletGreen::initTransactionPool() {
@@ -851,6 +1615,7 @@ void WalletGreen::convertAndLoadWalletFile(const std::string& path, std::ifstrea
   StdInputStream stream(walletFileStream);
   s.load(m_key, stream);
   walletFileStream.close();
+  restoreTimeUnlockJobs();
 
   boost::filesystem::path bakPath = path + ".backup";
   boost::filesystem::path tmpPath = boost::filesystem::unique_path(path + ".tmp.%%%%-%%%%");
@@ -924,19 +1689,49 @@ void WalletGreen::changePassword(const std::string& oldPassword, const std::stri
   Crypto::chacha8_key newKey;
   Crypto::generate_chacha8_key(cnContext, newPassword, newKey);
 
-  m_containerStorage.atomicUpdate([this, newKey](ContainerStorage& newStorage) {
+  uint64_t journalBegin = 0;
+  uint64_t journalEnd = 0;
+  m_containerStorage.atomicUpdate([this, newKey, &journalBegin, &journalEnd](ContainerStorage& newStorage) {
     copyContainerStoragePrefix(m_containerStorage, m_key, newStorage, newKey);
     copyContainerStorageKeys(m_containerStorage, m_key, newStorage, newKey);
 
     if (m_containerStorage.suffixSize() > 0) {
+      // history pages are encrypted with the new key at the same offsets, so the snapshot is copied as it is
+      HistoryUpdate history;
+      history.size = m_historySize;
+      history.data.assign(m_historySize, '\0');
+      BinaryArray page;
+      for (const auto& kv : m_historyPages) {
+        uint64_t pageOffset = HISTORY_HEADER_SIZE + kv.second.offset;
+        if (!readContainerRecord(m_containerStorage, m_key, pageOffset, page)) {
+          throw std::runtime_error("History page is missing");
+        }
+
+        std::string record = makeContainerRecord(newStorage, newKey, page.data(), page.size());
+        assert(record.size() == kv.second.size);
+        std::copy(record.begin(), record.end(), &history.data[kv.second.offset]);
+      }
+
       BinaryArray containerData;
-      loadAndDecryptContainerData(m_containerStorage, m_key, containerData);
-      encryptAndSaveContainerData(newStorage, newKey, containerData.data(), containerData.size());
+      uint64_t offset = loadAndDecryptContainerData(m_containerStorage, m_key, containerData);
+      journalBegin = encryptAndSaveContainerData(newStorage, newKey, containerData.data(), containerData.size(), history,
+        m_journalEnabled ? JOURNAL_MIN_RESERVE_SIZE : 0);
+
+      // journal records are encrypted with the new key one by one
+      journalEnd = journalBegin;
+      BinaryArray record;
+      while (offset < m_journalEnd && readContainerRecord(m_containerStorage, m_key, offset, record)) {
+        appendJournalRecord(newStorage, newKey, journalEnd, record.data(), record.size());
+      }
     }
   });
 
+  m_journalBegin = journalBegin;
+  m_journalEnd = journalEnd;
   m_key = newKey;
   m_password = newPassword;
+  // a compaction snapshot encrypted with the old key is dropped
+  ++m_journalGeneration;
 
   m_logger(INFO, BRIGHT_WHITE) << "Container password changed";
 }
@@ -1144,40 +1939,30 @@ std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewA
   throwIfStopped();
 
   stopBlockchainSynchronizer();
+  // the journal can't hold new addresses, their history is only saved with the next snapshot
+  resetJournal(false);
 
   std::vector<std::string> addresses;
   try {
-    uint64_t minCreationTimestamp = std::numeric_limits<uint64_t>::max();
-
-    {
-      if (addressDataList.size() > 1) {
-        m_containerStorage.setAutoFlush(false);
-      }
-
-      Tools::ScopeExit exitHandler([this] {
-        if (!m_containerStorage.getAutoFlush()) {
-          m_containerStorage.setAutoFlush(true);
-          m_containerStorage.flush();
-        }
-      });
-
-      for (auto& addressData : addressDataList) {
-        assert(addressData.creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
-        std::string address = addWallet(addressData.spendPublicKey, addressData.spendSecretKey, addressData.creationTimestamp);
-        m_logger(INFO, BRIGHT_WHITE) << "New wallet added " << address << ", creation timestamp " << addressData.creationTimestamp;
-        addresses.push_back(std::move(address));
+    if (addressDataList.size() > 1) {
+      m_containerStorage.setAutoFlush(false);
+    }
 
-        minCreationTimestamp = std::min(minCreationTimestamp, addressData.creationTimestamp);
+    Tools::ScopeExit exitHandler([this] {
+      if (!m_containerStorage.getAutoFlush()) {
+        m_containerStorage.setAutoFlush(true);
+        m_containerStorage.flush();
       }
-    }
+    });
 
-    m_containerStorage.setAutoFlush(true);
     auto currentTime = static_cast<uint64_t>(time(nullptr));
-    if (minCreationTimestamp + m_currency.blockFutureTimeLimit() < currentTime) {
-      m_logger(DEBUGGING) << "Reset is required";
-      save(WalletSaveLevel::SAVE_KEYS_AND_TRANSACTIONS, m_extra);
-      shutdown();
-      load(m_path, m_password);
+    for (auto& addressData : addressDataList) {
+      assert(addressData.creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
+      // an address created in the past scans its history in the background, the others stay at the top
+      bool catchUp = addressData.creationTimestamp + m_currency.blockFutureTimeLimit() < currentTime;
+      std::string address = addWallet(addressData.spendPublicKey, addressData.spendSecretKey, addressData.creationTimestamp, catchUp);
+      m_logger(INFO, BRIGHT_WHITE) << "New wallet added " << address << ", creation timestamp " << addressData.creationTimestamp;
+      addresses.push_back(std::move(address));
     }
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to add wallets: " << e.what();
@@ -1190,7 +1975,7 @@ std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewA
   return addresses;
 }
 
-std::string WalletGreen::addWallet(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp) {
+std::string WalletGreen::addWallet(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp, bool catchUp) {
   auto& index = m_walletsContainer.get<KeysIndex>();
 
   auto trackingMode = getTrackingMode();
@@ -1222,7 +2007,7 @@ std::string WalletGreen::addWallet(const Crypto::PublicKey& spendPublicKey, cons
     sub.syncStart.height = 0;
     sub.syncStart.timestamp = std::max(creationTimestamp, ACCOUNT_CREATE_TIME_ACCURACY) - ACCOUNT_CREATE_TIME_ACCURACY;
 
-    auto& trSubscription = m_synchronizer.addSubscription(sub);
+    auto& trSubscription = catchUp ? m_synchronizer.addCatchUpSubscription(sub) : m_synchronizer.addSubscription(sub);
     ITransfersContainer* container = &trSubscription.getContainer();
 
     WalletRecord wallet;
@@ -1381,6 +2166,7 @@ void WalletGreen::deleteAddress(const std::string& address) {
   }
 
   stopBlockchainSynchronizer();
+  resetJournal(false);
 
   m_actualBalance -= it->actualBalance;
   m_pendingBalance -= it->pendingBalance;
@@ -1474,14 +2260,14 @@ WalletTransaction WalletGreen::getTransaction(size_t transactionIndex) const {
     throw std::system_error(make_error_code(MevaCoin::error::INDEX_OUT_OF_RANGE));
   }
 
-  return m_transactions.get<RandomAccessIndex>()[transactionIndex];
+  return getTransactionWithHistory(transactionIndex);
 }
 
 size_t WalletGreen::getTransactionTransferCount(size_t transactionIndex) const {
   throwIfNotInitialized();
   throwIfStopped();
 
-  auto bounds = getTransactionTransfersRange(transactionIndex);
+  auto bounds = getHistoryTransfersRange(transactionIndex);
   return static_cast<size_t>(std::distance(bounds.first, bounds.second));
 }
 
@@ -1489,7 +2275,7 @@ WalletTransfer WalletGreen::getTransactionTransfer(size_t transactionIndex, size
   throwIfNotInitialized();
   throwIfStopped();
 
-  auto bounds = getTransactionTransfersRange(transactionIndex);
+  auto bounds = getHistoryTransfersRange(transactionIndex);
 
   if (transferIndex >= static_cast<size_t>(std::distance(bounds.first, bounds.second))) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to get transfer: invalid transfer index " << transferIndex << ". Transaction index " << transactionIndex <<
@@ -1510,6 +2296,19 @@ WalletGreen::TransfersRange WalletGreen::getTransactionTransfersRange(size_t tra
   return bounds;
 }
 
+WalletGreen::TransfersRange WalletGreen::getHistoryTransfersRange(size_t transactionIndex) const {
+  WalletHistoryPages::const_iterator pageIt;
+  if (!findHistoryPage(transactionIndex, pageIt)) {
+    return getTransactionTransfersRange(transactionIndex);
+  }
+
+  const WalletTransfers& transfers = readHistoryPage(pageIt).transfers;
+  auto val = std::make_pair(transactionIndex, WalletTransfer());
+  return std::equal_range(transfers.begin(), transfers.end(), val, [] (const TransactionTransferPair& a, const TransactionTransferPair& b) {
+    return a.first < b.first;
+  });
+}
+
 size_t WalletGreen::transfer(const TransactionParameters& transactionParameters, Crypto::SecretKey& txSecretKey) {
   size_t id = WALLET_INVALID_TRANSACTION_ID;
   Tools::ScopeExit releaseContext([this, &id] {
@@ -1953,6 +2752,7 @@ void WalletGreen::rollbackUncommitedTransaction(size_t transactionId) {
 
   removeUnconfirmedTransaction(getObjectHash(m_uncommitedTransactions[transactionId]));
   m_uncommitedTransactions.erase(transactionId);
+  m_journalChanges.transactions.insert(transactionId);
 
   m_logger(INFO, BRIGHT_WHITE) << "Delayed transaction rolled back, ID " << transactionId << ", hash " << m_transactions[transactionId].hash;
 }
@@ -2431,41 +3231,124 @@ void WalletGreen::requestMixinOuts(
   uint64_t mixIn,
   std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& mixinResult) {
 
-  std::vector<uint64_t> amounts;
+  throwIfStopped();
+
+  auto requestMixinCount = mixIn + 1; //+1 to allow to skip real output
+  uint32_t height = static_cast<uint32_t>(m_blockchain.size());
+
+  std::map<uint64_t, uint64_t> demand;
   for (const auto& out: selectedTransfers) {
-    amounts.push_back(out.out.amount);
+    demand[out.out.amount] += requestMixinCount;
   }
 
-  std::error_code mixinError;
+  std::vector<uint64_t> amounts;
+  uint64_t outsCount = DECOY_RESERVOIR_BATCH;
+  // amounts the daemon returned all its outputs of, they aren't reserved
+  std::map<uint64_t, std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry>> scarceOuts;
+  for (const auto& amountDemand: demand) {
+    if (m_decoys->available(amountDemand.first, height) < amountDemand.second) {
+      amounts.push_back(amountDemand.first);
+      outsCount = std::max(outsCount, amountDemand.second);
+    }
+  }
 
-  throwIfStopped();
+  if (!amounts.empty()) {
+    std::error_code mixinError;
+    std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> requestedOuts;
+    uint64_t generation = m_decoys->generation();
 
-  auto requestMixinCount = mixIn + 1; //+1 to allow to skip real output
+    m_logger(DEBUGGING) << "Requesting random outputs";
+    try {
+      auto getRandomOutsByAmountsCompleted = std::promise<std::error_code>();
+      auto getRandomOutsByAmountsWaitFuture = getRandomOutsByAmountsCompleted.get_future();
 
-  m_logger(DEBUGGING) << "Requesting random outputs";
-  try {
-    auto getRandomOutsByAmountsCompleted = std::promise<std::error_code>();
-    auto getRandomOutsByAmountsWaitFuture = getRandomOutsByAmountsCompleted.get_future();
+      m_node.getRandomOutsByAmounts(std::move(amounts), outsCount, requestedOuts, [&getRandomOutsByAmountsCompleted, &mixinError, this](std::error_code ec) {
+       auto detachedPromise = std::move(getRandomOutsByAmountsCompleted);
+        detachedPromise.set_value(ec);
+      });
 
-    m_node.getRandomOutsByAmounts(std::move(amounts), requestMixinCount, mixinResult, [&getRandomOutsByAmountsCompleted, &mixinError, this](std::error_code ec) {
-     auto detachedPromise = std::move(getRandomOutsByAmountsCompleted);
-      detachedPromise.set_value(ec);
-    });
+      mixinError = getRandomOutsByAmountsWaitFuture.get();
+    }
+    catch (const std::exception& e) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to request random outputs: " << e.what();
+    }
+
+    if (mixinError) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to get random outputs: " << mixinError << ", " << mixinError.message();
+      throw std::system_error(mixinError);
+    }
+
+    for (auto& outsForAmount: requestedOuts) {
+      if (DecoyReservoir::hasAllOutputs(outsForAmount, outsCount)) {
+        scarceOuts[outsForAmount.amount] = std::move(outsForAmount.outs);
+        demand.erase(outsForAmount.amount);
+      }
+    }
 
-    mixinError = getRandomOutsByAmountsWaitFuture.get();
+    m_decoys->add(requestedOuts, outsCount, height, generation);
+    m_logger(DEBUGGING) << "Random outputs received";
   }
-  catch (const std::exception& e) {
-    m_logger(ERROR, BRIGHT_RED) << "Failed to request random outputs: " << e.what();
+
+  mixinResult.clear();
+  for (const auto& out: selectedTransfers) {
+    MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount outsForAmount;
+    outsForAmount.amount = out.out.amount;
+
+    auto scarceIt = scarceOuts.find(out.out.amount);
+    if (scarceIt != scarceOuts.end()) {
+      // every ring picks from all the outputs of the amount
+      ShuffleGenerator<size_t> generator(scarceIt->second.size());
+      while (!generator.empty() && outsForAmount.outs.size() < requestMixinCount) {
+        outsForAmount.outs.push_back(scarceIt->second[generator()]);
+      }
+    } else {
+      m_decoys->take(requestMixinCount, height, outsForAmount);
+    }
+
+    mixinResult.push_back(std::move(outsForAmount));
   }
 
   checkIfEnoughMixins(mixinResult, requestMixinCount);
+  refillDecoys(demand, height);
+}
 
-  if (mixinError) {
-    m_logger(ERROR, BRIGHT_RED) << "Failed to get random outputs: " << mixinError << ", " << mixinError.message();
-    throw std::system_error(mixinError);
+void WalletGreen::refillDecoys(const std::map<uint64_t, uint64_t>& demand, uint32_t height) {
+  // keep enough for the next transaction like this one, so it does not wait for the node
+  std::vector<uint64_t> amounts;
+  uint64_t outsCount = DECOY_RESERVOIR_BATCH;
+  for (const auto& amountDemand: demand) {
+    if (m_decoys->available(amountDemand.first, height) < 2 * amountDemand.second && m_decoys->beginRefill(amountDemand.first)) {
+      amounts.push_back(amountDemand.first);
+      outsCount = std::max(outsCount, 2 * amountDemand.second);
+    }
+  }
+
+  if (amounts.empty()) {
+    return;
   }
 
-  m_logger(DEBUGGING) << "Random outputs received";
+  auto decoys = m_decoys;
+  auto requestedOuts = std::make_shared<std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>>();
+  uint64_t generation = decoys->generation();
+  std::vector<uint64_t> requestedAmounts = amounts;
+
+  m_logger(DEBUGGING) << "Refilling decoys for " << amounts.size() << " amounts";
+  try {
+    m_node.getRandomOutsByAmounts(std::move(amounts), outsCount, *requestedOuts, [decoys, requestedOuts, requestedAmounts, outsCount, height, generation](std::error_code ec) {
+      if (!ec) {
+        decoys->add(*requestedOuts, outsCount, height, generation);
+      }
+
+      for (auto amount: requestedAmounts) {
+        decoys->endRefill(amount);
+      }
+    });
+  } catch (const std::exception& e) {
+    m_logger(WARNING, BRIGHT_YELLOW) << "Failed to refill decoys: " << e.what();
+    for (auto amount: requestedAmounts) {
+      decoys->endRefill(amount);
+    }
+  }
 }
 
 uint64_t WalletGreen::selectTransfers(
@@ -2646,8 +3529,9 @@ WalletTransactionWithTransfers WalletGreen::getTransaction(const Crypto::Hash& t
     throw std::system_error(make_error_code(error::OBJECT_NOT_FOUND), "Transaction not found");
   }
 
+  size_t transactionId = std::distance(m_transactions.get<RandomAccessIndex>().begin(), m_transactions.project<RandomAccessIndex>(it));
   WalletTransactionWithTransfers walletTransaction;
-  walletTransaction.transaction = *it;
+  walletTransaction.transaction = getTransactionWithHistory(transactionId);
   walletTransaction.transfers = getTransactionTransfers(*it);
 
   return walletTransaction;
@@ -2657,15 +3541,11 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(const Crypto::
   throwIfNotInitialized();
   throwIfStopped();
 
-  auto& hashIndex = m_blockchain.get<BlockHashIndex>();
-  auto it = hashIndex.find(blockHash);
-  if (it == hashIndex.end()) {
+  uint32_t blockIndex;
+  if (!findBlockIndex(blockHash, blockIndex)) {
     return std::vector<TransactionsInBlockInfo>();
   }
 
-  auto heightIt = m_blockchain.project<BlockHeightIndex>(it);
-
-  uint32_t blockIndex = static_cast<uint32_t>(std::distance(m_blockchain.get<BlockHeightIndex>().begin(), heightIt));
   return getTransactionsInBlocks(blockIndex, count);
 }
 
@@ -2676,6 +3556,35 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(uint32_t block
   return getTransactionsInBlocks(blockIndex, count);
 }
 
+bool WalletGreen::getTransactions(const Crypto::Hash& blockHash, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  blocks.clear();
+
+  uint32_t blockIndex;
+  if (!findBlockIndex(blockHash, blockIndex)) {
+    return false;
+  }
+
+  getTransactionsInBlocks(blockIndex, count, addresses, blocks);
+  return true;
+}
+
+bool WalletGreen::getTransactions(uint32_t blockIndex, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  blocks.clear();
+
+  if (blockIndex >= m_blockchain.size()) {
+    return false;
+  }
+
+  getTransactionsInBlocks(blockIndex, count, addresses, blocks);
+  return true;
+}
+
 std::vector<Crypto::Hash> WalletGreen::getBlockHashes(uint32_t blockIndex, size_t count) const {
   throwIfNotInitialized();
   throwIfStopped();
@@ -2991,6 +3900,13 @@ void WalletGreen::onSynchronizationCompleted() {
     return;
   }
 
+  if (m_blockchainSynchronizerStarted && m_synchronizer.hasCaughtUpSubscriptions()) {
+    m_logger(DEBUGGING) << "Addresses caught up with the blockchain, merge them";
+    stopBlockchainSynchronizer();
+    m_synchronizer.mergeCaughtUpSubscriptions();
+    startBlockchainSynchronizer();
+  }
+
   pushEvent(makeSyncCompletedEvent());
 }
 
@@ -3023,6 +3939,7 @@ void WalletGreen::blocksRollback(uint32_t blockIndex) {
 
   auto& blockHeightIndex = m_blockchain.get<BlockHeightIndex>();
   blockHeightIndex.erase(std::next(blockHeightIndex.begin(), blockIndex), blockHeightIndex.end());
+  m_decoys->clear();
 }
 
 void WalletGreen::onTransactionDeleteBegin(const Crypto::PublicKey& viewPublicKey, Crypto::Hash transactionHash) {
@@ -3046,13 +3963,28 @@ void WalletGreen::transactionDeleteEnd(Crypto::Hash transactionHash) {
 void WalletGreen::unlockBalances(uint32_t height) {
   auto& index = m_unlockTransactionsJob.get<BlockHeightIndex>();
   auto upper = index.upper_bound(height);
+  bool unlocked = index.begin() != upper;
+
+  for (auto it = index.begin(); it != upper; ++it) {
+    updateBalance(it->container);
+    m_journalChanges.unlockJobs.insert(it->transactionHash);
+  }
+
+  index.erase(index.begin(), upper);
 
-  if (index.begin() != upper) {
-    for (auto it = index.begin(); it != upper; ++it) {
-      updateBalance(it->container);
+  // timestamp locks are checked on sync ticks as well, there is no timer for them;
+  // they are compared with the local clock like the containers' balances, not with the top block timestamp
+  size_t released = m_timeUnlockJobs.releaseDue(height, static_cast<uint64_t>(time(nullptr)), [this](const TimeUnlockJob& job) {
+    if (job.container != nullptr) {
+      updateBalance(job.container);
+    } else {
+      for (const auto& wallet : m_walletsContainer) {
+        updateBalance(wallet.container);
+      }
     }
+  });
 
-    index.erase(index.begin(), upper);
+  if (unlocked || released > 0) {
     pushEvent(makeMoneyUnlockedEvent());
   }
 }
@@ -3110,6 +4042,8 @@ void WalletGreen::transactionUpdated(const TransactionInformation& transactionIn
   auto it = hashIndex.find(transactionInfo.transactionHash);
   if (it != hashIndex.end()) {
     transactionId = std::distance(m_transactions.get<RandomAccessIndex>().begin(), m_transactions.project<RandomAccessIndex>(it));
+    // the transfers of a paged out transaction are updated in memory
+    loadTransactionHistory(transactionId);
     updated |= updateWalletTransactionInfo(transactionId, transactionInfo, totalAmount);
   } else {
     isNew = true;
@@ -3119,7 +4053,9 @@ void WalletGreen::transactionUpdated(const TransactionInformation& transactionIn
 
   if (transactionInfo.blockHeight != MevaCoin::WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
     // In some cases a transaction can be included to a block but not removed from m_uncommitedTransactions. Fix it
-    m_uncommitedTransactions.erase(transactionId);
+    if (m_uncommitedTransactions.erase(transactionId) != 0) {
+      m_journalChanges.transactions.insert(transactionId);
+    }
   }
 
   // Update cached balance
@@ -3127,8 +4063,7 @@ void WalletGreen::transactionUpdated(const TransactionInformation& transactionIn
     updateBalance(containerAmounts.container);
 
     if (transactionInfo.blockHeight != MevaCoin::WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
-      uint32_t unlockHeight = std::max(transactionInfo.blockHeight + m_transactionSoftLockTime, static_cast<uint32_t>(transactionInfo.unlockTime));
-      insertUnlockTransactionJob(transactionInfo.transactionHash, unlockHeight, containerAmounts.container);
+      insertUnlockTransactionJob(transactionInfo.transactionHash, transactionInfo.blockHeight, transactionInfo.unlockTime, containerAmounts.container);
     }
   }
 
@@ -3157,6 +4092,18 @@ void WalletGreen::transactionUpdated(const TransactionInformation& transactionIn
 }
 
 void WalletGreen::pushEvent(const WalletEvent& event) {
+  if (event.type == WalletEventType::TRANSACTION_CREATED) {
+    m_journalChanges.transactions.insert(event.transactionCreated.transactionIndex);
+  } else if (event.type == WalletEventType::TRANSACTION_UPDATED) {
+    // a changed transaction is journaled with its extra and transfers
+    loadTransactionHistory(event.transactionUpdated.transactionIndex);
+    m_journalChanges.transactions.insert(event.transactionUpdated.transactionIndex);
+  }
+
+  if (event.type != WalletEventType::SYNC_PROGRESS_UPDATED && event.type != WalletEventType::SYNC_COMPLETED) {
+    scheduleJournalWrite();
+  }
+
   m_events.push(event);
   m_eventOccurred.set();
 }
@@ -3224,14 +4171,42 @@ void WalletGreen::transactionDeleted(ITransfersSubscription* object, const Hash&
   }
 }
 
-void WalletGreen::insertUnlockTransactionJob(const Hash& transactionHash, uint32_t blockHeight, MevaCoin::ITransfersContainer* container) {
+void WalletGreen::insertUnlockTransactionJob(const Hash& transactionHash, uint32_t blockHeight, uint64_t unlockTime, MevaCoin::ITransfersContainer* container) {
+  uint32_t unlockHeight = blockHeight + m_transactionSoftLockTime;
+  if (unlockTime < m_currency.maxBlockHeight()) {
+    unlockHeight = std::max(unlockHeight, static_cast<uint32_t>(unlockTime));
+  } else {
+    // the soft lock still expires by height, so the transaction gets both jobs
+    uint64_t allowedDelta = std::min<uint64_t>(unlockTime, m_currency.lockedTxAllowedDeltaSeconds());
+    m_timeUnlockJobs.scheduleAtTime(unlockTime - allowedDelta, { transactionHash, container });
+  }
+
   auto& index = m_unlockTransactionsJob.get<BlockHeightIndex>();
-  index.insert( { blockHeight, container, transactionHash } );
+  index.insert( { unlockHeight, container, transactionHash } );
+  m_journalChanges.unlockJobs.insert(transactionHash);
 }
 
 void WalletGreen::deleteUnlockTransactionJob(const Hash& transactionHash) {
   auto& index = m_unlockTransactionsJob.get<TransactionHashIndex>();
   index.erase(transactionHash);
+  m_journalChanges.unlockJobs.insert(transactionHash);
+  m_timeUnlockJobs.unscheduleIf([&transactionHash](const TimeUnlockJob& job) { return job.transactionHash == transactionHash; });
+}
+
+void WalletGreen::restoreTimeUnlockJobs() {
+  m_timeUnlockJobs.clear();
+
+  uint64_t now = static_cast<uint64_t>(time(nullptr));
+  for (const auto& transaction : m_transactions) {
+    if (transaction.blockHeight == WALLET_UNCONFIRMED_TRANSACTION_HEIGHT || transaction.unlockTime < m_currency.maxBlockHeight()) {
+      continue;
+    }
+
+    uint64_t allowedDelta = std::min<uint64_t>(transaction.unlockTime, m_currency.lockedTxAllowedDeltaSeconds());
+    if (transaction.unlockTime - allowedDelta > now) {
+      m_timeUnlockJobs.scheduleAtTime(transaction.unlockTime - allowedDelta, { transaction.hash, nullptr });
+    }
+  }
 }
 
 void WalletGreen::startBlockchainSynchronizer() {
@@ -3312,6 +4287,7 @@ void WalletGreen::updateBalance(MevaCoin::ITransfersContainer* container) {
       wallet.actualBalance = actual;
       wallet.pendingBalance = pending;
     });
+    m_journalChanges.balances.insert(it->spendPublicKey);
 
     m_logger(INFO, BRIGHT_WHITE) << "Wallet balance updated, address " << m_currency.accountAddressAsString({ it->spendPublicKey, m_viewPublicKey }) <<
       ", actual " << m_currency.formatAmount(it->actualBalance) <<
@@ -3672,22 +4648,25 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsInBlocks(uint32
     return result;
   }
 
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
   auto& blockHeightIndex = m_transactions.get<BlockHeightIndex>();
   uint32_t stopIndex = static_cast<uint32_t>(std::min(m_blockchain.size(), blockIndex + count));
+  result.reserve(stopIndex - blockIndex);
 
+  // one pass over the height index, it is sorted the same way as the blocks
+  auto it = blockHeightIndex.lower_bound(blockIndex);
   for (uint32_t height = blockIndex; height < stopIndex; ++height) {
     TransactionsInBlockInfo info;
     info.blockHash = m_blockchain[height];
 
-    auto lowerBound = blockHeightIndex.lower_bound(height);
-    auto upperBound = blockHeightIndex.upper_bound(height);
-    for (auto it = lowerBound; it != upperBound; ++it) {
+    for (; it != blockHeightIndex.end() && it->blockHeight == height; ++it) {
       if (it->state != WalletTransactionState::SUCCEEDED) {
         continue;
       }
 
+      size_t transactionId = std::distance(transactionIdIndex.begin(), m_transactions.project<RandomAccessIndex>(it));
       WalletTransactionWithTransfers transaction;
-      transaction.transaction = *it;
+      transaction.transaction = getTransactionWithHistory(transactionId);
 
       transaction.transfers = getTransactionTransfers(*it);
 
@@ -3700,6 +4679,63 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsInBlocks(uint32
   return result;
 }
 
+void WalletGreen::getTransactionsInBlocks(uint32_t blockIndex, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const {
+  if (count == 0) {
+    m_logger(ERROR, BRIGHT_RED) << "Bad argument: block count must be greater than zero";
+    throw std::system_error(make_error_code(error::WRONG_PARAMETERS), "blocks count must be greater than zero");
+  }
+
+  std::unordered_set<std::string> addressSet(addresses.begin(), addresses.end());
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+  auto& blockHeightIndex = m_transactions.get<BlockHeightIndex>();
+  uint32_t stopIndex = static_cast<uint32_t>(std::min(m_blockchain.size(), blockIndex + count));
+
+  // blocks without wallet transactions are never visited, unconfirmed transactions sort after any block
+  uint32_t lastBlockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
+  auto end = blockHeightIndex.lower_bound(stopIndex);
+  for (auto it = blockHeightIndex.lower_bound(blockIndex); it != end; ++it) {
+    if (it->state != WalletTransactionState::SUCCEEDED) {
+      continue;
+    }
+
+    // a block is listed even if none of its transactions touch the addresses
+    if (it->blockHeight != lastBlockHeight) {
+      lastBlockHeight = it->blockHeight;
+      blocks.emplace_back();
+      blocks.back().blockHash = m_blockchain[lastBlockHeight];
+    }
+
+    size_t transactionId = std::distance(transactionIdIndex.begin(), m_transactions.project<RandomAccessIndex>(it));
+    auto bounds = getHistoryTransfersRange(transactionId);
+    if (!addressSet.empty() && std::none_of(bounds.first, bounds.second, [&addressSet](const TransactionTransferPair& transfer) {
+      return addressSet.count(transfer.second.address) != 0;
+    })) {
+      continue;
+    }
+
+    WalletTransactionWithTransfers transaction;
+    transaction.transaction = getTransactionWithHistory(transactionId);
+    transaction.transfers.reserve(std::distance(bounds.first, bounds.second));
+    for (auto transferIt = bounds.first; transferIt != bounds.second; ++transferIt) {
+      transaction.transfers.push_back(transferIt->second);
+    }
+
+    blocks.back().transactions.emplace_back(std::move(transaction));
+  }
+}
+
+bool WalletGreen::findBlockIndex(const Crypto::Hash& blockHash, uint32_t& blockIndex) const {
+  auto& hashIndex = m_blockchain.get<BlockHashIndex>();
+  auto it = hashIndex.find(blockHash);
+  if (it == hashIndex.end()) {
+    return false;
+  }
+
+  auto heightIt = m_blockchain.project<BlockHeightIndex>(it);
+  blockIndex = static_cast<uint32_t>(std::distance(m_blockchain.get<BlockHeightIndex>().begin(), heightIt));
+  return true;
+}
+
 Crypto::Hash WalletGreen::getBlockHashByIndex(uint32_t blockIndex) const {
   assert(blockIndex < m_blockchain.size());
   return m_blockchain.get<BlockHeightIndex>()[blockIndex];
@@ -3712,7 +4748,7 @@ std::vector<WalletTransfer> WalletGreen::getTransactionTransfers(const WalletTra
   assert(it != transactionIdIndex.end());
 
   size_t transactionId = std::distance(transactionIdIndex.begin(), it);
-  auto bounds = getTransactionTransfersRange(transactionId);
+  auto bounds = getHistoryTransfersRange(transactionId);
 
   std::vector<WalletTransfer> result;
   result.reserve(std::distance(bounds.first, bounds.second));
@@ -3724,7 +4760,8 @@ std::vector<WalletTransfer> WalletGreen::getTransactionTransfers(const WalletTra
   return result;
 }
 
-void WalletGreen::filterOutTransactions(WalletTransactions& transactions, WalletTransfers& transfers, std::function<bool (const WalletTransaction&)>&& pred) const {
+void WalletGreen::filterOutTransactions(WalletTransactions& transactions, WalletTransfers& transfers, std::function<bool (const WalletTransaction&)>&& pred,
+  bool withHistory) const {
   size_t cancelledTransactions = 0;
 
   transactions.reserve(m_transactions.size());
@@ -3732,6 +4769,7 @@ void WalletGreen::filterOutTransactions(WalletTransactions& transactions, Wallet
 
   auto& index = m_transactions.get<RandomAccessIndex>();
   size_t transferIdx = 0;
+  WalletHistoryPages::const_iterator pageIt;
   for (size_t i = 0; i < m_transactions.size(); ++i) {
     const WalletTransaction& transaction = index[i];
 
@@ -3741,6 +4779,16 @@ void WalletGreen::filterOutTransactions(WalletTransactions& transactions, Wallet
       while (transferIdx < m_transfers.size() && m_transfers[transferIdx].first == i) {
         ++transferIdx;
       }
+    } else if (withHistory && findHistoryPage(i, pageIt)) {
+      const HistoryPageCache& page = readHistoryPage(pageIt);
+      WalletTransaction pagedTransaction = transaction;
+      pagedTransaction.extra = page.extras[i - pageIt->first];
+      transactions.emplace_back(std::move(pagedTransaction));
+
+      auto bounds = getHistoryTransfersRange(i);
+      for (auto it = bounds.first; it != bounds.second; ++it) {
+        transfers.emplace_back(i - cancelledTransactions, it->second);
+      }
     } else {
       transactions.emplace_back(transaction);
 
@@ -3780,11 +4828,14 @@ bool WalletGreen::isMyAddress(const std::string& addressString) const {
 void WalletGreen::deleteContainerFromUnlockTransactionJobs(const ITransfersContainer* container) {
   for (auto it = m_unlockTransactionsJob.begin(); it != m_unlockTransactionsJob.end();) {
     if (it->container == container) {
+      m_journalChanges.unlockJobs.insert(it->transactionHash);
       it = m_unlockTransactionsJob.erase(it);
     } else {
       ++it;
     }
   }
+
+  m_timeUnlockJobs.unscheduleIf([container](const TimeUnlockJob& job) { return job.container == container; });
 }
 
 std::vector<size_t> WalletGreen::deleteTransfersForAddress(const std::string& address, std::vector<size_t>& deletedTransactions) {
@@ -3800,6 +4851,9 @@ std::vector<size_t> WalletGreen::deleteTransfersForAddress(const std::string& ad
 
   std::vector<size_t> updatedTransactions;
 
+  // every transfer is looked through
+  loadAllHistory();
+
   for (size_t i = 0; i < m_transfers.size(); ++i) {
     WalletTransfer& transfer = m_transfers[i].second;
 
@@ -20,9 +20,14 @@
 
 #include "IWallet.h"
 
+#include <chrono>
+#include <map>
+#include <memory>
 #include <queue>
+#include <set>
 #include <unordered_map>
 
+#include "DecoyReservoir.h"
 #include "IFusionManager.h"
 #include "WalletIndices.h"
 
@@ -31,6 +36,7 @@
 #include <System/Event.h>
 #include "Transfers/TransfersSynchronizer.h"
 #include "Transfers/BlockchainSynchronizer.h"
+#include "Transfers/UnlockScheduler.h"
 #include "../MevaCoinConfig.h"
 
 namespace MevaCoin {
@@ -94,6 +100,8 @@ public:
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const override;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const override;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const override;
+  virtual bool getTransactions(const Crypto::Hash& blockHash, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const override;
+  virtual bool getTransactions(uint32_t blockIndex, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const override;
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const override;
   virtual uint32_t getBlockCount() const override;
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const override;
@@ -188,6 +196,35 @@ protected:
 
   typedef std::pair<WalletTransfers::const_iterator, WalletTransfers::const_iterator> TransfersRange;
 
+  // the bytes written to the history region of a container, before its snapshot
+  struct HistoryUpdate {
+    HistoryUpdate() : size(0), offset(0) {}
+
+    uint64_t size; // of the region after the update
+    uint64_t offset; // of data in the region
+    std::string data;
+  };
+
+  // A copy of the wallet data a journal compaction snapshot is made of, it is serialized off the dispatcher
+  struct ContainerSnapshot {
+    WalletsContainer wallets;
+    UnlockTransactionJobs unlockTransactions;
+    WalletTransactions transactions;
+    WalletTransfers transfers;
+    WalletHistoryPages historyPages;
+    UncommitedTransactions uncommitedTransactions;
+    std::string extra;
+    uint64_t actualBalance;
+    uint64_t pendingBalance;
+  };
+
+  struct HistoryPageCache {
+    bool valid = false;
+    uint64_t firstTransactionId = 0;
+    std::vector<std::string> extras;
+    WalletTransfers transfers;
+  };
+
   struct AddressAmounts {
     int64_t input = 0;
     int64_t output = 0;
@@ -248,7 +285,7 @@ protected:
   const WalletRecord& getWalletRecord(MevaCoin::ITransfersContainer* container) const;
 
   MevaCoin::AccountPublicAddress parseAddress(const std::string& address) const;
-  std::string addWallet(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp);
+  std::string addWallet(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp, bool catchUp);
   AccountKeys makeAccountKeys(const WalletRecord& wallet) const;
   size_t getTransactionId(const Crypto::Hash& transactionHash) const;
   void pushEvent(const WalletEvent& event);
@@ -288,6 +325,7 @@ protected:
   void requestMixinOuts(const std::vector<OutputToTransfer>& selectedTransfers,
     uint64_t mixIn,
     std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& mixinResult);
+  void refillDecoys(const std::map<uint64_t, uint64_t>& demand, uint32_t height);
 
   void prepareInputs(const std::vector<OutputToTransfer>& selectedTransfers,
     std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& mixinResult,
@@ -326,7 +364,7 @@ protected:
   bool eraseTransfersByAddress(size_t transactionId, size_t firstTransferIdx, const std::string& address, bool eraseOutputTransfers);
   bool eraseForeignTransfers(size_t transactionId, size_t firstTransferIdx, const std::unordered_set<std::string>& knownAddresses, bool eraseOutputTransfers);
   void pushBackOutgoingTransfers(size_t txId, const std::vector<WalletTransfer>& destinations);
-  void insertUnlockTransactionJob(const Crypto::Hash& transactionHash, uint32_t blockHeight, MevaCoin::ITransfersContainer* container);
+  void insertUnlockTransactionJob(const Crypto::Hash& transactionHash, uint32_t blockHeight, uint64_t unlockTime, MevaCoin::ITransfersContainer* container);
   void deleteUnlockTransactionJob(const Crypto::Hash& transactionHash);
   void startBlockchainSynchronizer();
   void stopBlockchainSynchronizer();
@@ -336,13 +374,45 @@ protected:
   void copyContainerStorageKeys(ContainerStorage& src, const Crypto::chacha8_key& srcKey, ContainerStorage& dst, const Crypto::chacha8_key& dstKey);
   static void copyContainerStoragePrefix(ContainerStorage& src, const Crypto::chacha8_key& srcKey, ContainerStorage& dst, const Crypto::chacha8_key& dstKey);
   void deleteOrphanTransactions(const std::unordered_set<Crypto::PublicKey>& deletedKeys);
-  static void encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
-  static void loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
+  // returns the suffix offset past the container data, reserveSize zeroed bytes are left after it for the journal
+  static uint64_t encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize,
+    const HistoryUpdate& history = HistoryUpdate(), uint64_t reserveSize = 0);
+  static std::string makeContainerDataHeader(const Crypto::chacha8_iv& suffixIv, size_t containerDataSize);
+  // writes the history update and returns the offset of dataSize bytes of the snapshot after it, followed by reserveSize zeroed bytes
+  static uint64_t resizeContainerSuffix(ContainerStorage& storage, const HistoryUpdate& history, uint64_t dataSize, uint64_t reserveSize);
+  // returns the suffix offset past the container data, where the journal of a V3 container begins
+  static uint64_t loadAndDecryptContainerData(const ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
+  static uint64_t getHistorySize(const ContainerStorage& storage);
+  // encrypts the record with the next IV of the storage
+  static std::string makeContainerRecord(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* record, size_t recordSize);
+  static bool readContainerRecord(const ContainerStorage& storage, const Crypto::chacha8_key& key, uint64_t& offset, BinaryArray& record);
+  static void appendJournalRecord(ContainerStorage& storage, const Crypto::chacha8_key& key, uint64_t& journalEnd, const void* record, size_t recordSize);
+  std::string makeJournalRecord();
+  void resetJournal(bool enabled);
+  void writeJournalRecord();
+  void scheduleJournalWrite();
+  void startJournalCompaction();
+  void compactJournal(const std::string& transfersSynchronizerState, uint64_t journalGeneration);
+  void saveJournalCompaction(const ContainerSnapshot& snapshot, const std::string& encryptedContainerData, const Crypto::Hash& containerDataHash,
+    const HistoryUpdate& history, std::vector<uint64_t>& newPages, uint64_t journalEnd);
+  bool findHistoryPage(size_t transactionId, WalletHistoryPages::const_iterator& pageIt) const;
+  const HistoryPageCache& readHistoryPage(WalletHistoryPages::const_iterator pageIt) const;
+  void loadHistoryPage(WalletHistoryPages::const_iterator pageIt);
+  void loadTransactionHistory(size_t transactionId);
+  void loadAllHistory();
+  void clearHistory();
+  HistoryUpdate makeHistoryUpdate(WalletHistoryPages& historyPages, std::vector<uint64_t>& newPages);
+  // the transactions and transfers a snapshot is saved with, and the history pages of the own storage
+  HistoryUpdate makeSnapshotTransactions(WalletSaveLevel saveLevel, bool ownStorage, bool journaled, WalletTransactions& transactions,
+    WalletTransfers& transfers, WalletHistoryPages& historyPages, std::vector<uint64_t>& newPages);
+  void pageOutHistory(WalletHistoryPages&& historyPages, const std::vector<uint64_t>& newPages, uint64_t historySize);
+  WalletTransaction getTransactionWithHistory(size_t transactionId) const;
   void initTransactionPool();
   void loadSpendKeys();
   void loadContainerStorage(const std::string& path);
   void loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
-  void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra);
+  void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra,
+    const std::string* transfersSynchronizerState = nullptr);
   void subscribeWallets();
 
   std::vector<OutputToTransfer> pickRandomFusionInputs(const std::vector<std::string>& addresses,
@@ -363,15 +433,22 @@ protected:
   WalletTrackingMode getTrackingMode() const;
 
   TransfersRange getTransactionTransfersRange(size_t transactionIndex) const;
+  // reads a paged out range, which is valid until another page is read
+  TransfersRange getHistoryTransfersRange(size_t transactionIndex) const;
   std::vector<TransactionsInBlockInfo> getTransactionsInBlocks(uint32_t blockIndex, size_t count) const;
+  void getTransactionsInBlocks(uint32_t blockIndex, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const;
+  bool findBlockIndex(const Crypto::Hash& blockHash, uint32_t& blockIndex) const;
   Crypto::Hash getBlockHashByIndex(uint32_t blockIndex) const;
 
   std::vector<WalletTransfer> getTransactionTransfers(const WalletTransaction& transaction) const;
-  void filterOutTransactions(WalletTransactions& transactions, WalletTransfers& transfers, std::function<bool (const WalletTransaction&)>&& pred) const;
+  // withHistory copies paged out transactions with their extras and transfers
+  void filterOutTransactions(WalletTransactions& transactions, WalletTransfers& transfers, std::function<bool (const WalletTransaction&)>&& pred,
+    bool withHistory = false) const;
   void initBlockchain(const Crypto::PublicKey& viewPublicKey);
   MevaCoin::AccountPublicAddress getChangeDestination(const std::string& changeDestinationAddress, const std::vector<std::string>& sourceAddresses) const;
 
   void deleteContainerFromUnlockTransactionJobs(const ITransfersContainer* container);
+  void restoreTimeUnlockJobs();
   std::vector<size_t> deleteTransfersForAddress(const std::string& address, std::vector<size_t>& deletedTransactions);
   void deleteFromUncommitedTransactions(const std::vector<size_t>& deletedTransactions);
 
@@ -383,9 +460,31 @@ protected:
 
   WalletsContainer m_walletsContainer;
   ContainerStorage m_containerStorage;
+  Crypto::Hash m_containerDataHash; // plain cache data currently stored in m_containerStorage suffix
+  // The journal of changes since the snapshot, records from m_journalBegin to m_journalEnd of m_containerStorage suffix.
+  // It is kept only while transaction ids match those of the snapshot and the addresses are those it was taken with
+  bool m_journalEnabled;
+  uint64_t m_journalBegin;
+  uint64_t m_journalEnd;
+  WalletJournalChanges m_journalChanges; // since the last snapshot or journal record
+  uint64_t m_journalGeneration; // changed with every reset, a compaction started before it is dropped
+  bool m_journalWriteScheduled;
+  bool m_journalCompactionStarted;
+  std::set<size_t> m_compactionJournaledTransactions; // journaled while the compaction snapshot is serialized
+  System::Event m_journalCompactionFinished;
   UnlockTransactionJobs m_unlockTransactionsJob;
+  // transactions locked until a timestamp, not saved in the cache but restored from m_transactions on load
+  UnlockScheduler<TimeUnlockJob> m_timeUnlockJobs;
   WalletTransactions m_transactions;
   WalletTransfers m_transfers; //sorted
+  // Old transactions paged out to the history region of m_containerStorage suffix, that is m_historySize bytes
+  // after the region size. They have no extra in m_transactions and no transfers in m_transfers
+  WalletHistoryPages m_historyPages;
+  uint64_t m_historySize;
+  size_t m_historyResidentTransactionCount; // the latest transactions are never paged out
+  size_t m_historyPageSize; // in transactions
+  uint32_t m_historyConfirmations; // a page is written once all its transactions have as many
+  mutable HistoryPageCache m_historyCache; // the page read last
   mutable std::unordered_map<size_t, bool> m_fusionTxsCache; // txIndex -> isFusion
   UncommitedTransactions m_uncommitedTransactions;
 
@@ -414,6 +513,8 @@ protected:
   uint32_t m_transactionSoftLockTime;
 
   BlockHashesContainer m_blockchain;
+  // shared with the refill requests still running at the node
+  std::shared_ptr<DecoyReservoir> m_decoys;
 
   friend std::ostream& operator<<(std::ostream& os, MevaCoin::WalletGreen::WalletState state);
   friend std::ostream& operator<<(std::ostream& os, MevaCoin::WalletGreen::WalletTrackingMode mode);
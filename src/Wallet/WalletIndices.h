@@ -18,10 +18,13 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "ITransfersContainer.h"
 #include "IWallet.h"
+#include "crypto/crypto.h"
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -83,6 +86,15 @@ struct UnlockTransactionJob {
   Crypto::Hash transactionHash;
 };
 
+struct TimeUnlockJob {
+  Crypto::Hash transactionHash;
+  MevaCoin::ITransfersContainer* container; // nullptr updates all containers
+
+  bool operator==(const TimeUnlockJob& other) const {
+    return transactionHash == other.transactionHash && container == other.container;
+  }
+};
+
 typedef boost::multi_index_container <
   UnlockTransactionJob,
   boost::multi_index::indexed_by <
@@ -113,6 +125,35 @@ typedef std::pair<size_t, MevaCoin::WalletTransfer> TransactionTransferPair;
 typedef std::vector<TransactionTransferPair> WalletTransfers;
 typedef std::map<size_t, MevaCoin::Transaction> UncommitedTransactions;
 
+// A page of old transactions, whose extras and transfers are kept in the container file only
+struct WalletHistoryPage {
+  uint64_t offset; // in the history region of the container suffix
+  uint64_t size;
+  uint64_t transactionCount;
+};
+
+// by the id of the first transaction of a page
+typedef std::map<uint64_t, WalletHistoryPage> WalletHistoryPages;
+
+// What has changed since the last journal record of a container, the next record holds just that
+struct WalletJournalChanges {
+  std::set<size_t> transactions; // with their transfers and uncommited transactions
+  std::unordered_set<Crypto::PublicKey> balances; // by wallet spend public key
+  std::unordered_set<Crypto::Hash> unlockJobs; // by transaction hash
+  bool extra = false;
+
+  bool empty() const {
+    return transactions.empty() && balances.empty() && unlockJobs.empty() && !extra;
+  }
+
+  void clear() {
+    transactions.clear();
+    balances.clear();
+    unlockJobs.clear();
+    extra = false;
+  }
+};
+
 typedef boost::multi_index_container<
   Crypto::Hash,
   boost::multi_index::indexed_by <
@@ -18,6 +18,7 @@
 
 #include "WalletSerializationV2.h"
 
+#include "Common/MemoryStreamBuffer.h"
 #include "MevaCoinCore/MevaCoinSerialization.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
@@ -117,6 +118,33 @@ void serialize(WalletTransferDtoV2& value, MevaCoin::ISerializer& serializer) {
   serializer(value.type, "type");
 }
 
+MevaCoin::WalletTransaction makeTransaction(WalletTransactionDtoV2& dto) {
+  MevaCoin::WalletTransaction tx;
+  tx.state = dto.state;
+  tx.timestamp = dto.timestamp;
+  tx.blockHeight = dto.blockHeight;
+  tx.hash = dto.hash;
+  tx.totalAmount = dto.totalAmount;
+  tx.fee = dto.fee;
+  tx.creationTime = dto.creationTime;
+  tx.unlockTime = dto.unlockTime;
+  tx.extra = std::move(dto.extra);
+  tx.isBase = dto.isBase;
+  if (dto.secretKey)
+    tx.secretKey = reinterpret_cast<const Crypto::SecretKey&>(dto.secretKey.get());
+
+  return tx;
+}
+
+MevaCoin::WalletTransfer makeTransfer(WalletTransferDtoV2& dto) {
+  MevaCoin::WalletTransfer tr;
+  tr.address = std::move(dto.address);
+  tr.amount = dto.amount;
+  tr.type = static_cast<MevaCoin::WalletTransferType>(dto.type);
+
+  return tr;
+}
+
 }
 
 namespace MevaCoin {
@@ -132,6 +160,7 @@ WalletSerializerV2::WalletSerializerV2(
   UnlockTransactionJobs& unlockTransactions,
   WalletTransactions& transactions,
   WalletTransfers& transfers,
+  WalletHistoryPages& historyPages,
   UncommitedTransactions& uncommitedTransactions,
   std::string& extra,
   uint32_t transactionSoftLockTime
@@ -144,6 +173,7 @@ WalletSerializerV2::WalletSerializerV2(
   m_unlockTransactions(unlockTransactions),
   m_transactions(transactions),
   m_transfers(transfers),
+  m_historyPages(historyPages),
   m_uncommitedTransactions(uncommitedTransactions),
   m_extra(extra),
   m_transactionSoftLockTime(transactionSoftLockTime)
@@ -156,6 +186,7 @@ void WalletSerializerV2::load(Common::IInputStream& source, uint8_t version) {
   uint8_t saveLevelValue;
   s(saveLevelValue, "saveLevel");
   WalletSaveLevel saveLevel = static_cast<WalletSaveLevel>(saveLevelValue);
+  m_saveLevel = saveLevel;
 
   loadKeyListAndBalances(s, saveLevel == WalletSaveLevel::SAVE_ALL);
 
@@ -171,9 +202,13 @@ void WalletSerializerV2::load(Common::IInputStream& source, uint8_t version) {
   }
 
   s(m_extra, "extra");
+
+  if (version >= HISTORY_VERSION) {
+    loadHistoryPages(s);
+  }
 }
 
-void WalletSerializerV2::save(Common::IOutputStream& destination, WalletSaveLevel saveLevel) {
+void WalletSerializerV2::save(Common::IOutputStream& destination, WalletSaveLevel saveLevel, const std::string* transfersSynchronizerState) {
   MevaCoin::BinaryOutputStreamSerializer s(destination);
 
   uint8_t saveLevelValue = static_cast<uint8_t>(saveLevel);
@@ -187,12 +222,115 @@ void WalletSerializerV2::save(Common::IOutputStream& destination, WalletSaveLeve
   }
 
   if (saveLevel == WalletSaveLevel::SAVE_ALL) {
-    saveTransfersSynchronizer(s);
+    saveTransfersSynchronizer(s, transfersSynchronizerState);
     saveUnlockTransactionsJobs(s);
     s(m_uncommitedTransactions, "uncommitedTransactions");
   }
 
   s(m_extra, "extra");
+  saveHistoryPages(s);
+}
+
+void WalletSerializerV2::loadChanges(Common::IInputStream& source, uint8_t version) {
+  MevaCoin::BinaryInputStreamSerializer s(source);
+
+  uint64_t transactionCount = 0;
+  s(transactionCount, "transactionCount");
+
+  if (version < DELTA_JOURNAL_VERSION) {
+    // the key list of the latest record is the one to compare with the container keys
+    m_addedKeys.clear();
+    loadKeyListAndBalances(s, true);
+  } else {
+    loadChangedBalances(s);
+  }
+
+  uint64_t changedCount = 0;
+  s(changedCount, "changedTransactionCount");
+  for (uint64_t i = 0; i < changedCount; ++i) {
+    loadChangedTransaction(s, version);
+  }
+
+  if (m_transactions.size() != transactionCount) {
+    throw std::runtime_error("Journal record doesn't match the transaction count");
+  }
+
+  if (version < DELTA_JOURNAL_VERSION) {
+    m_unlockTransactions.clear();
+    loadUnlockTransactionsJobs(s);
+    s(m_uncommitedTransactions, "uncommitedTransactions");
+    s(m_extra, "extra");
+    return;
+  }
+
+  loadChangedUnlockTransactionsJobs(s);
+
+  bool extraChanged = false;
+  s(extraChanged, "extraChanged");
+  if (extraChanged) {
+    s(m_extra, "extra");
+  }
+}
+
+void WalletSerializerV2::saveChanges(Common::IOutputStream& destination, const WalletJournalChanges& changes) {
+  MevaCoin::BinaryOutputStreamSerializer s(destination);
+
+  uint64_t transactionCount = m_transactions.size();
+  s(transactionCount, "transactionCount");
+
+  saveChangedBalances(s, changes.balances);
+
+  uint64_t changedCount = changes.transactions.size();
+  s(changedCount, "changedTransactionCount");
+  for (size_t transactionId : changes.transactions) {
+    saveChangedTransaction(s, transactionId);
+  }
+
+  saveChangedUnlockTransactionsJobs(s, changes.unlockJobs);
+
+  bool extraChanged = changes.extra;
+  s(extraChanged, "extraChanged");
+  if (extraChanged) {
+    s(m_extra, "extra");
+  }
+}
+
+void WalletSerializerV2::saveHistoryPage(Common::IOutputStream& destination, const WalletTransactions& transactions, const WalletTransfers& transfers,
+  size_t firstTransactionId, size_t transactionCount) {
+  MevaCoin::BinaryOutputStreamSerializer s(destination);
+
+  auto isLess = [](const TransactionTransferPair& pair, size_t id) { return pair.first < id; };
+  auto transferIt = std::lower_bound(transfers.begin(), transfers.end(), firstTransactionId, isLess);
+
+  for (size_t txId = firstTransactionId; txId < firstTransactionId + transactionCount; ++txId) {
+    s(const_cast<std::string&>(transactions.get<RandomAccessIndex>()[txId].extra), "extra");
+
+    auto last = std::find_if(transferIt, transfers.end(), [txId](const TransactionTransferPair& pair) { return pair.first != txId; });
+    uint64_t transferCount = std::distance(transferIt, last);
+    s(transferCount, "transferCount");
+    for (; transferIt != last; ++transferIt) {
+      WalletTransferDtoV2 dto(transferIt->second);
+      s(dto, "transfer");
+    }
+  }
+}
+
+void WalletSerializerV2::loadHistoryPage(Common::IInputStream& source, size_t firstTransactionId, size_t transactionCount,
+  std::vector<std::string>& extras, WalletTransfers& transfers) {
+  MevaCoin::BinaryInputStreamSerializer s(source);
+
+  extras.resize(transactionCount);
+  for (size_t i = 0; i < transactionCount; ++i) {
+    s(extras[i], "extra");
+
+    uint64_t transferCount = 0;
+    s(transferCount, "transferCount");
+    for (uint64_t j = 0; j < transferCount; ++j) {
+      WalletTransferDtoV2 dto;
+      s(dto, "transfer");
+      transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(firstTransactionId + i), std::forward_as_tuple(makeTransfer(dto)));
+    }
+  }
 }
 
 std::unordered_set<Crypto::PublicKey>& WalletSerializerV2::addedKeys() {
@@ -203,6 +341,10 @@ std::unordered_set<Crypto::PublicKey>& WalletSerializerV2::deletedKeys() {
   return m_deletedKeys;
 }
 
+WalletSaveLevel WalletSerializerV2::saveLevel() const {
+  return m_saveLevel;
+}
+
 void WalletSerializerV2::loadKeyListAndBalances(MevaCoin::ISerializer& serializer, bool saveCache) {
   size_t walletCount;
   serializer(walletCount, "walletCount");
@@ -270,21 +412,7 @@ void WalletSerializerV2::loadTransactions(MevaCoin::ISerializer& serializer) {
     WalletTransactionDtoV2 dto;
     serializer(dto, "transaction");
 
-    WalletTransaction tx;
-    tx.state = dto.state;
-    tx.timestamp = dto.timestamp;
-    tx.blockHeight = dto.blockHeight;
-    tx.hash = dto.hash;
-    tx.totalAmount = dto.totalAmount;
-    tx.fee = dto.fee;
-    tx.creationTime = dto.creationTime;
-    tx.unlockTime = dto.unlockTime;
-    tx.extra = dto.extra;
-    tx.isBase = dto.isBase;
-    if (dto.secretKey)
-      tx.secretKey = reinterpret_cast<const Crypto::SecretKey&>(dto.secretKey.get());
-
-    m_transactions.get<RandomAccessIndex>().emplace_back(std::move(tx));
+    m_transactions.get<RandomAccessIndex>().emplace_back(makeTransaction(dto));
   }
 }
 
@@ -311,12 +439,7 @@ void WalletSerializerV2::loadTransfers(MevaCoin::ISerializer& serializer) {
     WalletTransferDtoV2 dto;
     serializer(dto, "transfer");
 
-    WalletTransfer tr;
-    tr.address = dto.address;
-    tr.amount = dto.amount;
-    tr.type = static_cast<WalletTransferType>(dto.type);
-
-    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(std::move(tr)));
+    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(makeTransfer(dto)));
   }
 }
 
@@ -334,15 +457,55 @@ void WalletSerializerV2::saveTransfers(MevaCoin::ISerializer& serializer) {
   }
 }
 
+void WalletSerializerV2::loadHistoryPages(MevaCoin::ISerializer& serializer) {
+  uint64_t count = 0;
+  serializer(count, "historyPageCount");
+
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t firstTransactionId = 0;
+    WalletHistoryPage page;
+    serializer(firstTransactionId, "firstTransactionId");
+    serializer(page.transactionCount, "transactionCount");
+    serializer(page.offset, "offset");
+    serializer(page.size, "size");
+
+    if (firstTransactionId + page.transactionCount > m_transactions.size()) {
+      throw std::runtime_error("History page is out of the transaction list");
+    }
+
+    m_historyPages.emplace(firstTransactionId, page);
+  }
+}
+
+void WalletSerializerV2::saveHistoryPages(MevaCoin::ISerializer& serializer) {
+  uint64_t count = m_historyPages.size();
+  serializer(count, "historyPageCount");
+
+  for (const auto& kv : m_historyPages) {
+    uint64_t firstTransactionId = kv.first;
+    WalletHistoryPage page = kv.second;
+    serializer(firstTransactionId, "firstTransactionId");
+    serializer(page.transactionCount, "transactionCount");
+    serializer(page.offset, "offset");
+    serializer(page.size, "size");
+  }
+}
+
 void WalletSerializerV2::loadTransfersSynchronizer(MevaCoin::ISerializer& serializer) {
   std::string transfersSynchronizerData;
   serializer(transfersSynchronizerData, "transfersSynchronizer");
 
-  std::stringstream stream(transfersSynchronizerData);
+  Common::MemoryStreamBuffer buffer(transfersSynchronizerData.data(), transfersSynchronizerData.size());
+  std::istream stream(&buffer);
   m_synchronizer.load(stream);
 }
 
-void WalletSerializerV2::saveTransfersSynchronizer(MevaCoin::ISerializer& serializer) {
+void WalletSerializerV2::saveTransfersSynchronizer(MevaCoin::ISerializer& serializer, const std::string* transfersSynchronizerState) {
+  if (transfersSynchronizerState != nullptr) {
+    serializer(const_cast<std::string&>(*transfersSynchronizerState), "transfersSynchronizer");
+    return;
+  }
+
   std::stringstream stream;
   m_synchronizer.save(stream);
   stream.flush();
@@ -397,4 +560,183 @@ void WalletSerializerV2::saveUnlockTransactionsJobs(MevaCoin::ISerializer& seria
   }
 }
 
+void WalletSerializerV2::loadChangedBalances(MevaCoin::ISerializer& serializer) {
+  auto& index = m_walletsContainer.get<KeysIndex>();
+
+  uint64_t count = 0;
+  serializer(count, "changedBalanceCount");
+  for (uint64_t i = 0; i < count; ++i) {
+    Crypto::PublicKey spendPublicKey;
+    uint64_t actualBalance;
+    uint64_t pendingBalance;
+    serializer(spendPublicKey, "spendPublicKey");
+    serializer(actualBalance, "actualBalance");
+    serializer(pendingBalance, "pendingBalance");
+
+    // the key list doesn't change while a container is journaled, a wallet deleted since is in m_deletedKeys already
+    auto it = index.find(spendPublicKey);
+    if (it == index.end()) {
+      continue;
+    }
+
+    m_actualBalance = m_actualBalance - it->actualBalance + actualBalance;
+    m_pendingBalance = m_pendingBalance - it->pendingBalance + pendingBalance;
+    index.modify(it, [actualBalance, pendingBalance](WalletRecord& wallet) {
+      wallet.actualBalance = actualBalance;
+      wallet.pendingBalance = pendingBalance;
+    });
+  }
+}
+
+void WalletSerializerV2::saveChangedBalances(MevaCoin::ISerializer& serializer, const std::unordered_set<Crypto::PublicKey>& changedBalances) {
+  auto& index = m_walletsContainer.get<KeysIndex>();
+
+  std::vector<WalletRecord> wallets;
+  for (const auto& spendPublicKey : changedBalances) {
+    auto it = index.find(spendPublicKey);
+    if (it != index.end()) {
+      wallets.push_back(*it);
+    }
+  }
+
+  uint64_t count = wallets.size();
+  serializer(count, "changedBalanceCount");
+  for (auto& wallet : wallets) {
+    serializer(wallet.spendPublicKey, "spendPublicKey");
+    serializer(wallet.actualBalance, "actualBalance");
+    serializer(wallet.pendingBalance, "pendingBalance");
+  }
+}
+
+void WalletSerializerV2::loadChangedTransaction(MevaCoin::ISerializer& serializer, uint8_t version) {
+  uint64_t txId = 0;
+  serializer(txId, "transactionId");
+
+  WalletTransactionDtoV2 dto;
+  serializer(dto, "transaction");
+
+  // a paged out transaction is journaled with the rest of its page, when it is changed the whole page is resident
+  auto pageIt = m_historyPages.upper_bound(txId);
+  if (pageIt != m_historyPages.begin() && txId < std::prev(pageIt)->first + std::prev(pageIt)->second.transactionCount) {
+    m_historyPages.erase(std::prev(pageIt));
+  }
+
+  auto& index = m_transactions.get<RandomAccessIndex>();
+  if (txId < index.size()) {
+    index.replace(std::next(index.begin(), txId), makeTransaction(dto));
+  } else if (txId == index.size()) {
+    index.emplace_back(makeTransaction(dto));
+  } else {
+    throw std::runtime_error("Journal record has a transaction out of order");
+  }
+
+  auto isLess = [](const TransactionTransferPair& pair, uint64_t id) { return pair.first < id; };
+  auto isGreater = [](uint64_t id, const TransactionTransferPair& pair) { return id < pair.first; };
+  auto first = std::lower_bound(m_transfers.begin(), m_transfers.end(), txId, isLess);
+  auto last = std::upper_bound(first, m_transfers.end(), txId, isGreater);
+  auto insertIt = m_transfers.erase(first, last);
+
+  uint64_t transferCount = 0;
+  serializer(transferCount, "transferCount");
+
+  std::vector<TransactionTransferPair> transfers;
+  transfers.reserve(transferCount);
+  for (uint64_t i = 0; i < transferCount; ++i) {
+    WalletTransferDtoV2 transferDto;
+    serializer(transferDto, "transfer");
+    transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(makeTransfer(transferDto)));
+  }
+
+  m_transfers.insert(insertIt, std::make_move_iterator(transfers.begin()), std::make_move_iterator(transfers.end()));
+
+  if (version >= DELTA_JOURNAL_VERSION) {
+    m_uncommitedTransactions.erase(txId);
+
+    bool uncommited = false;
+    serializer(uncommited, "uncommited");
+    if (uncommited) {
+      serializer(m_uncommitedTransactions[txId], "uncommitedTransaction");
+    }
+  }
+}
+
+void WalletSerializerV2::saveChangedTransaction(MevaCoin::ISerializer& serializer, size_t transactionId) {
+  uint64_t txId = transactionId;
+  serializer(txId, "transactionId");
+
+  WalletTransactionDtoV2 dto(m_transactions.get<RandomAccessIndex>()[transactionId]);
+  serializer(dto, "transaction");
+
+  auto isLess = [](const TransactionTransferPair& pair, size_t id) { return pair.first < id; };
+  auto isGreater = [](size_t id, const TransactionTransferPair& pair) { return id < pair.first; };
+  auto first = std::lower_bound(m_transfers.begin(), m_transfers.end(), transactionId, isLess);
+  auto last = std::upper_bound(first, m_transfers.end(), transactionId, isGreater);
+
+  uint64_t transferCount = std::distance(first, last);
+  serializer(transferCount, "transferCount");
+  for (auto it = first; it != last; ++it) {
+    WalletTransferDtoV2 transferDto(it->second);
+    serializer(transferDto, "transfer");
+  }
+
+  auto uncommitedIt = m_uncommitedTransactions.find(transactionId);
+  bool uncommited = uncommitedIt != m_uncommitedTransactions.end();
+  serializer(uncommited, "uncommited");
+  if (uncommited) {
+    serializer(uncommitedIt->second, "uncommitedTransaction");
+  }
+}
+
+void WalletSerializerV2::loadChangedUnlockTransactionsJobs(MevaCoin::ISerializer& serializer) {
+  auto& index = m_unlockTransactions.get<TransactionHashIndex>();
+  auto& walletsIndex = m_walletsContainer.get<KeysIndex>();
+
+  uint64_t count = 0;
+  serializer(count, "changedUnlockTransactionsJobsCount");
+  for (uint64_t i = 0; i < count; ++i) {
+    // the jobs of a transaction are replaced with those it has now
+    Crypto::Hash transactionHash;
+    serializer(transactionHash, "transactionHash");
+    index.erase(transactionHash);
+
+    uint64_t jobsCount = 0;
+    serializer(jobsCount, "unlockTransactionsJobsCount");
+    for (uint64_t j = 0; j < jobsCount; ++j) {
+      UnlockTransactionJobDtoV2 dto;
+      serializer(dto, "unlockTransactionsJob");
+
+      auto walletIt = walletsIndex.find(dto.walletSpendPublicKey);
+      if (walletIt != walletsIndex.end()) {
+        index.insert({ dto.blockHeight, walletIt->container, dto.transactionHash });
+      }
+    }
+  }
+}
+
+void WalletSerializerV2::saveChangedUnlockTransactionsJobs(MevaCoin::ISerializer& serializer, const std::unordered_set<Crypto::Hash>& changedJobs) {
+  auto& index = m_unlockTransactions.get<TransactionHashIndex>();
+  auto& wallets = m_walletsContainer.get<TransfersContainerIndex>();
+
+  uint64_t count = changedJobs.size();
+  serializer(count, "changedUnlockTransactionsJobsCount");
+  for (const auto& hash : changedJobs) {
+    Crypto::Hash transactionHash = hash;
+    serializer(transactionHash, "transactionHash");
+
+    auto range = index.equal_range(transactionHash);
+    uint64_t jobsCount = std::distance(range.first, range.second);
+    serializer(jobsCount, "unlockTransactionsJobsCount");
+    for (auto it = range.first; it != range.second; ++it) {
+      auto containerIt = wallets.find(it->container);
+      assert(containerIt != wallets.end());
+
+      UnlockTransactionJobDtoV2 dto;
+      dto.blockHeight = it->blockHeight;
+      dto.transactionHash = it->transactionHash;
+      dto.walletSpendPublicKey = containerIt->spendPublicKey;
+      serializer(dto, "unlockTransactionsJob");
+    }
+  }
+}
+
 } //namespace MevaCoin
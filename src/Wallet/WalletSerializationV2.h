@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <set>
+
 #include "Common/IInputStream.h"
 #include "Common/IOutputStream.h"
 #include "Serialization/ISerializer.h"
@@ -38,19 +40,41 @@ public:
     UnlockTransactionJobs& unlockTransactions,
     WalletTransactions& transactions,
     WalletTransfers& transfers,
+    WalletHistoryPages& historyPages,
     UncommitedTransactions& uncommitedTransactions,
     std::string& extra,
     uint32_t transactionSoftLockTime
   );
 
   void load(Common::IInputStream& source, uint8_t version);
-  void save(Common::IOutputStream& destination, WalletSaveLevel saveLevel);
+  // transfersSynchronizerState, if given, is a snapshot previously taken with m_synchronizer.save()
+  void save(Common::IOutputStream& destination, WalletSaveLevel saveLevel, const std::string* transfersSynchronizerState = nullptr);
+
+  // A journal record of a V3 container: the changed transactions with their transfers and uncommited transactions,
+  // the changed wallet balances, the unlock jobs of the changed transaction hashes and the extra, if it is changed.
+  // Records are replayed over the snapshot in order, those of a container older than DELTA_JOURNAL_VERSION hold
+  // the key list and balances, unlock jobs, uncommited transactions and extra as a whole
+  void loadChanges(Common::IInputStream& source, uint8_t version);
+  void saveChanges(Common::IOutputStream& destination, const WalletJournalChanges& changes);
+
+  // A history page: the extras and transfers of transactionCount transactions from firstTransactionId on
+  static void saveHistoryPage(Common::IOutputStream& destination, const WalletTransactions& transactions, const WalletTransfers& transfers,
+    size_t firstTransactionId, size_t transactionCount);
+  static void loadHistoryPage(Common::IInputStream& source, size_t firstTransactionId, size_t transactionCount,
+    std::vector<std::string>& extras, WalletTransfers& transfers);
 
   std::unordered_set<Crypto::PublicKey>& addedKeys();
   std::unordered_set<Crypto::PublicKey>& deletedKeys();
+  WalletSaveLevel saveLevel() const;
 
   static const uint8_t MIN_VERSION = 6;
-  static const uint8_t SERIALIZATION_VERSION = 6;
+  static const uint8_t SERIALIZATION_VERSION = 9;
+  // containers of this version and above may have journal records after the snapshot
+  static const uint8_t JOURNAL_VERSION = 7;
+  // containers of this version and above have the history region before the snapshot, indexed at the end of it
+  static const uint8_t HISTORY_VERSION = 8;
+  // journal records of containers of this version and above hold only what has changed since the record before
+  static const uint8_t DELTA_JOURNAL_VERSION = 9;
 
 private:
   void loadKeyListAndBalances(MevaCoin::ISerializer& serializer, bool saveCache);
@@ -63,11 +87,23 @@ private:
   void saveTransfers(MevaCoin::ISerializer& serializer);
 
   void loadTransfersSynchronizer(MevaCoin::ISerializer& serializer);
-  void saveTransfersSynchronizer(MevaCoin::ISerializer& serializer);
+  void saveTransfersSynchronizer(MevaCoin::ISerializer& serializer, const std::string* transfersSynchronizerState);
 
   void loadUnlockTransactionsJobs(MevaCoin::ISerializer& serializer);
   void saveUnlockTransactionsJobs(MevaCoin::ISerializer& serializer);
 
+  void loadHistoryPages(MevaCoin::ISerializer& serializer);
+  void saveHistoryPages(MevaCoin::ISerializer& serializer);
+
+  void loadChangedBalances(MevaCoin::ISerializer& serializer);
+  void saveChangedBalances(MevaCoin::ISerializer& serializer, const std::unordered_set<Crypto::PublicKey>& changedBalances);
+
+  void loadChangedTransaction(MevaCoin::ISerializer& serializer, uint8_t version);
+  void saveChangedTransaction(MevaCoin::ISerializer& serializer, size_t transactionId);
+
+  void loadChangedUnlockTransactionsJobs(MevaCoin::ISerializer& serializer);
+  void saveChangedUnlockTransactionsJobs(MevaCoin::ISerializer& serializer, const std::unordered_set<Crypto::Hash>& changedJobs);
+
   ITransfersObserver& m_transfersObserver;
   uint64_t& m_actualBalance;
   uint64_t& m_pendingBalance;
@@ -76,12 +112,14 @@ private:
   UnlockTransactionJobs& m_unlockTransactions;
   WalletTransactions& m_transactions;
   WalletTransfers& m_transfers;
+  WalletHistoryPages& m_historyPages;
   UncommitedTransactions& m_uncommitedTransactions;
   std::string& m_extra;
   uint32_t m_transactionSoftLockTime;
 
   std::unordered_set<Crypto::PublicKey> m_addedKeys;
   std::unordered_set<Crypto::PublicKey> m_deletedKeys;
+  WalletSaveLevel m_saveLevel = WalletSaveLevel::SAVE_ALL;
 };
 
 } //namespace MevaCoin
@@ -51,6 +51,239 @@ static uint64_t load_4(const unsigned char *in)
   return result;
 }
 
+#if defined(CRYPTO_OPS_FE51)
+
+/* Radix 2^51 field arithmetic */
+
+/*
+An element is h[0]+2^51 h[1]+2^102 h[2]+2^153 h[3]+2^204 h[4] with unsigned limbs.
+fe_add leaves the carries in place and fe_sub adds 2*p before subtracting, so
+the limbs coming out of either stay below 2^54, which fe_mul and fe_sq accept.
+Products are accumulated in unsigned __int128 and reduced with 2^255 = 19.
+*/
+
+typedef unsigned __int128 fe_uint128;
+
+#define FE_MASK51 ((uint64_t) 0x7ffffffffffff)
+
+static uint64_t load_8(const unsigned char *in) {
+  uint64_t result;
+  result = (uint64_t) in[0];
+  result |= ((uint64_t) in[1]) << 8;
+  result |= ((uint64_t) in[2]) << 16;
+  result |= ((uint64_t) in[3]) << 24;
+  result |= ((uint64_t) in[4]) << 32;
+  result |= ((uint64_t) in[5]) << 40;
+  result |= ((uint64_t) in[6]) << 48;
+  result |= ((uint64_t) in[7]) << 56;
+  return result;
+}
+
+static void fe_0(fe h) {
+  h[0] = 0;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+static void fe_1(fe h) {
+  h[0] = 1;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+/* h = f + g, without carries */
+
+static void fe_add(fe h, const fe f, const fe g) {
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+}
+
+/* h = f - g, computed as f + 2 * p - g after carrying g below 2^51 */
+
+static void fe_sub(fe h, const fe f, const fe g) {
+  uint64_t h0 = g[0];
+  uint64_t h1 = g[1];
+  uint64_t h2 = g[2];
+  uint64_t h3 = g[3];
+  uint64_t h4 = g[4];
+
+  h1 += h0 >> 51; h0 &= FE_MASK51;
+  h2 += h1 >> 51; h1 &= FE_MASK51;
+  h3 += h2 >> 51; h2 &= FE_MASK51;
+  h4 += h3 >> 51; h3 &= FE_MASK51;
+  h0 += 19 * (h4 >> 51); h4 &= FE_MASK51;
+
+  h[0] = (f[0] + 0xfffffffffffda) - h0;
+  h[1] = (f[1] + 0xffffffffffffe) - h1;
+  h[2] = (f[2] + 0xffffffffffffe) - h2;
+  h[3] = (f[3] + 0xffffffffffffe) - h3;
+  h[4] = (f[4] + 0xffffffffffffe) - h4;
+}
+
+static void fe_neg(fe h, const fe f) {
+  fe zero;
+  fe_0(zero);
+  fe_sub(h, zero, f);
+}
+
+/* Replace f with g if b == 1, keep it if b == 0, in constant time */
+
+static void fe_cmov(fe f, const fe g, unsigned int b) {
+  uint64_t mask = (uint64_t) 0 - (uint64_t) b;
+  f[0] ^= (f[0] ^ g[0]) & mask;
+  f[1] ^= (f[1] ^ g[1]) & mask;
+  f[2] ^= (f[2] ^ g[2]) & mask;
+  f[3] ^= (f[3] ^ g[3]) & mask;
+  f[4] ^= (f[4] ^ g[4]) & mask;
+}
+
+static void fe_copy(fe h, const fe f) {
+  h[0] = f[0];
+  h[1] = f[1];
+  h[2] = f[2];
+  h[3] = f[3];
+  h[4] = f[4];
+}
+
+/* Carries the five double-width columns of a product into h, limbs below 2^51 + 2^13 */
+
+static void fe_carry_wide(fe h, fe_uint128 r0, fe_uint128 r1, fe_uint128 r2, fe_uint128 r3, fe_uint128 r4) {
+  uint64_t h0, h1, h2, h3, h4, carry;
+
+  r1 += (uint64_t) (r0 >> 51); h0 = (uint64_t) r0 & FE_MASK51;
+  r2 += (uint64_t) (r1 >> 51); h1 = (uint64_t) r1 & FE_MASK51;
+  r3 += (uint64_t) (r2 >> 51); h2 = (uint64_t) r2 & FE_MASK51;
+  r4 += (uint64_t) (r3 >> 51); h3 = (uint64_t) r3 & FE_MASK51;
+  carry = (uint64_t) (r4 >> 51); h4 = (uint64_t) r4 & FE_MASK51;
+
+  h0 += 19 * carry;
+  h1 += h0 >> 51; h0 &= FE_MASK51;
+
+  h[0] = h0;
+  h[1] = h1;
+  h[2] = h2;
+  h[3] = h3;
+  h[4] = h4;
+}
+
+/* h = f * g, can overlap h with f or g */
+
+static void fe_mul(fe h, const fe f, const fe g) {
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+  uint64_t f1_19 = 19 * f1, f2_19 = 19 * f2, f3_19 = 19 * f3, f4_19 = 19 * f4;
+  fe_uint128 r0, r1, r2, r3, r4;
+
+  r0 = (fe_uint128) f0 * g0 + (fe_uint128) f1_19 * g4 + (fe_uint128) f2_19 * g3 + (fe_uint128) f3_19 * g2 + (fe_uint128) f4_19 * g1;
+  r1 = (fe_uint128) f0 * g1 + (fe_uint128) f1 * g0 + (fe_uint128) f2_19 * g4 + (fe_uint128) f3_19 * g3 + (fe_uint128) f4_19 * g2;
+  r2 = (fe_uint128) f0 * g2 + (fe_uint128) f1 * g1 + (fe_uint128) f2 * g0 + (fe_uint128) f3_19 * g4 + (fe_uint128) f4_19 * g3;
+  r3 = (fe_uint128) f0 * g3 + (fe_uint128) f1 * g2 + (fe_uint128) f2 * g1 + (fe_uint128) f3 * g0 + (fe_uint128) f4_19 * g4;
+  r4 = (fe_uint128) f0 * g4 + (fe_uint128) f1 * g3 + (fe_uint128) f2 * g2 + (fe_uint128) f3 * g1 + (fe_uint128) f4 * g0;
+
+  fe_carry_wide(h, r0, r1, r2, r3, r4);
+}
+
+/* Computes f^2 as five double-width columns */
+
+static void fe_sq_wide(const fe f, fe_uint128 r[5]) {
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1;
+  uint64_t f1_38 = 38 * f1, f2_38 = 38 * f2, f3_38 = 38 * f3;
+  uint64_t f3_19 = 19 * f3, f4_19 = 19 * f4;
+
+  r[0] = (fe_uint128) f0 * f0 + (fe_uint128) f1_38 * f4 + (fe_uint128) f2_38 * f3;
+  r[1] = (fe_uint128) f0_2 * f1 + (fe_uint128) f2_38 * f4 + (fe_uint128) f3_19 * f3;
+  r[2] = (fe_uint128) f0_2 * f2 + (fe_uint128) f1 * f1 + (fe_uint128) f3_38 * f4;
+  r[3] = (fe_uint128) f0_2 * f3 + (fe_uint128) f1_2 * f2 + (fe_uint128) f4_19 * f4;
+  r[4] = (fe_uint128) f0_2 * f4 + (fe_uint128) f1_2 * f3 + (fe_uint128) f2 * f2;
+}
+
+/* h = f * f, can overlap h with f */
+
+static void fe_sq(fe h, const fe f) {
+  fe_uint128 r[5];
+  fe_sq_wide(f, r);
+  fe_carry_wide(h, r[0], r[1], r[2], r[3], r[4]);
+}
+
+/* h = 2 * f * f, can overlap h with f */
+
+static void fe_sq2(fe h, const fe f) {
+  fe_uint128 r[5];
+  fe_sq_wide(f, r);
+  fe_carry_wide(h, r[0] << 1, r[1] << 1, r[2] << 1, r[3] << 1, r[4] << 1);
+}
+
+/* Writes the canonical little-endian encoding of h, 0 <= h < p */
+
+static void fe_tobytes(unsigned char *s, const fe h) {
+  uint64_t t[5];
+  uint64_t q;
+  int i;
+
+  t[0] = h[0];
+  t[1] = h[1];
+  t[2] = h[2];
+  t[3] = h[3];
+  t[4] = h[4];
+
+  /* Two carry passes leave 0 <= t < 2^255 with every limb below 2^51 */
+  for (i = 0; i < 2; ++i) {
+    t[1] += t[0] >> 51; t[0] &= FE_MASK51;
+    t[2] += t[1] >> 51; t[1] &= FE_MASK51;
+    t[3] += t[2] >> 51; t[2] &= FE_MASK51;
+    t[4] += t[3] >> 51; t[3] &= FE_MASK51;
+    t[0] += 19 * (t[4] >> 51); t[4] &= FE_MASK51;
+  }
+
+  /* q = 1 if t >= p, then t - q * p = t + 19 * q - 2^255 q */
+  q = (t[0] + 19) >> 51;
+  q = (t[1] + q) >> 51;
+  q = (t[2] + q) >> 51;
+  q = (t[3] + q) >> 51;
+  q = (t[4] + q) >> 51;
+
+  t[0] += 19 * q;
+  t[1] += t[0] >> 51; t[0] &= FE_MASK51;
+  t[2] += t[1] >> 51; t[1] &= FE_MASK51;
+  t[3] += t[2] >> 51; t[2] &= FE_MASK51;
+  t[4] += t[3] >> 51; t[3] &= FE_MASK51;
+  t[4] &= FE_MASK51;
+
+  for (i = 0; i < 8; ++i) {
+    s[i] = (unsigned char) ((t[0] | (t[1] << 51)) >> (8 * i));
+    s[i + 8] = (unsigned char) (((t[1] >> 13) | (t[2] << 38)) >> (8 * i));
+    s[i + 16] = (unsigned char) (((t[2] >> 26) | (t[3] << 25)) >> (8 * i));
+    s[i + 24] = (unsigned char) (((t[3] >> 39) | (t[4] << 12)) >> (8 * i));
+  }
+}
+
+/* Reads 255 bits, ignoring the top bit of s[31] */
+
+static void fe_frombytes(fe h, const unsigned char *s) {
+  h[0] = load_8(s) & FE_MASK51;
+  h[1] = (load_8(s + 6) >> 3) & FE_MASK51;
+  h[2] = (load_8(s + 12) >> 6) & FE_MASK51;
+  h[3] = (load_8(s + 19) >> 1) & FE_MASK51;
+  h[4] = (load_8(s + 24) >> 12) & FE_MASK51;
+}
+
+/* Reads all 256 bits as a number modulo p */
+
+static void fe_frombytes_mod(fe h, const unsigned char *s) {
+  fe_frombytes(h, s);
+  h[4] |= (uint64_t) (s[31] >> 7) << 51;
+}
+
+#else
+
 /* From fe_0.c */
 
 /*
@@ -239,6 +472,8 @@ static void fe_copy(fe h, const fe f) {
   h[9] = f9;
 }
 
+#endif
+
 /* From fe_invert.c */
 
 static void fe_invert(fe out, const fe z) {
@@ -326,6 +561,8 @@ static int fe_isnonzero(const fe f) {
     s[27] | s[28] | s[29] | s[30] | s[31]) - 1) >> 8) + 1;
 }
 
+#if !defined(CRYPTO_OPS_FE51)
+
 /* From fe_mul.c */
 
 /*
@@ -1106,6 +1343,69 @@ static void fe_tobytes(unsigned char *s, const fe h) {
   s[31] = h9 >> 18;
 }
 
+/* From fe_frombytes.c, modified */
+
+/*
+Reads 255 bits, ignoring the top bit of s[31], or all 256 bits modulo p
+when top is 16777215.
+*/
+
+static void fe_frombytes_top(fe h, const unsigned char *s, uint64_t top) {
+  int64_t h0 = load_4(s);
+  int64_t h1 = load_3(s + 4) << 6;
+  int64_t h2 = load_3(s + 7) << 5;
+  int64_t h3 = load_3(s + 10) << 3;
+  int64_t h4 = load_3(s + 13) << 2;
+  int64_t h5 = load_4(s + 16);
+  int64_t h6 = load_3(s + 20) << 7;
+  int64_t h7 = load_3(s + 23) << 5;
+  int64_t h8 = load_3(s + 26) << 4;
+  int64_t h9 = (load_3(s + 29) & top) << 2;
+  int64_t carry0;
+  int64_t carry1;
+  int64_t carry2;
+  int64_t carry3;
+  int64_t carry4;
+  int64_t carry5;
+  int64_t carry6;
+  int64_t carry7;
+  int64_t carry8;
+  int64_t carry9;
+
+  carry9 = (h9 + (int64_t) (1<<24)) >> 25; h0 += carry9 * 19; h9 -= carry9 << 25;
+  carry1 = (h1 + (int64_t) (1<<24)) >> 25; h2 += carry1; h1 -= carry1 << 25;
+  carry3 = (h3 + (int64_t) (1<<24)) >> 25; h4 += carry3; h3 -= carry3 << 25;
+  carry5 = (h5 + (int64_t) (1<<24)) >> 25; h6 += carry5; h5 -= carry5 << 25;
+  carry7 = (h7 + (int64_t) (1<<24)) >> 25; h8 += carry7; h7 -= carry7 << 25;
+
+  carry0 = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry0; h0 -= carry0 << 26;
+  carry2 = (h2 + (int64_t) (1<<25)) >> 26; h3 += carry2; h2 -= carry2 << 26;
+  carry4 = (h4 + (int64_t) (1<<25)) >> 26; h5 += carry4; h4 -= carry4 << 26;
+  carry6 = (h6 + (int64_t) (1<<25)) >> 26; h7 += carry6; h6 -= carry6 << 26;
+  carry8 = (h8 + (int64_t) (1<<25)) >> 26; h9 += carry8; h8 -= carry8 << 26;
+
+  h[0] = (int32_t) h0;
+  h[1] = (int32_t) h1;
+  h[2] = (int32_t) h2;
+  h[3] = (int32_t) h3;
+  h[4] = (int32_t) h4;
+  h[5] = (int32_t) h5;
+  h[6] = (int32_t) h6;
+  h[7] = (int32_t) h7;
+  h[8] = (int32_t) h8;
+  h[9] = (int32_t) h9;
+}
+
+static void fe_frombytes(fe h, const unsigned char *s) {
+  fe_frombytes_top(h, s, 8388607);
+}
+
+static void fe_frombytes_mod(fe h, const unsigned char *s) {
+  fe_frombytes_top(h, s, 16777215);
+}
+
+#endif
+
 /* From ge_add.c */
 
 void ge_add(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q) {
@@ -1179,16 +1479,23 @@ B is the Ed25519 base point (x,4/5) with x positive.
 */
 
 void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_base_precomp_vartime(r, a, Ai, b);
+}
+
+/* Same with A already expanded by ge_dsm_precomp */
+
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b) {
   signed char aslide[256];
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
   int i;
 
   slide(aslide, a);
   slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
 
   ge_p2_0(r);
 
@@ -1226,61 +1533,18 @@ int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
   fe v;
   fe vxx;
   fe check;
+  int i;
 
-  /* From fe_frombytes.c */
-
-  int64_t h0 = load_4(s);
-  int64_t h1 = load_3(s + 4) << 6;
-  int64_t h2 = load_3(s + 7) << 5;
-  int64_t h3 = load_3(s + 10) << 3;
-  int64_t h4 = load_3(s + 13) << 2;
-  int64_t h5 = load_4(s + 16);
-  int64_t h6 = load_3(s + 20) << 7;
-  int64_t h7 = load_3(s + 23) << 5;
-  int64_t h8 = load_3(s + 26) << 4;
-  int64_t h9 = (load_3(s + 29) & 8388607) << 2;
-  int64_t carry0;
-  int64_t carry1;
-  int64_t carry2;
-  int64_t carry3;
-  int64_t carry4;
-  int64_t carry5;
-  int64_t carry6;
-  int64_t carry7;
-  int64_t carry8;
-  int64_t carry9;
-
-  /* Validate the number to be canonical */
-  if (h9 == 33554428 && h8 == 268435440 && h7 == 536870880 && h6 == 2147483520 &&
-    h5 == 4294967295 && h4 == 67108860 && h3 == 134217720 && h2 == 536870880 &&
-    h1 == 1073741760 && h0 >= 4294967277) {
-    return -1;
+  /* Validate the number to be canonical, that is below 2^255 - 19 */
+  if ((s[31] & 0x7f) == 0x7f && s[0] >= 0xed) {
+    for (i = 1; i < 31 && s[i] == 0xff; ++i) {
+    }
+    if (i == 31) {
+      return -1;
+    }
   }
 
-  carry9 = (h9 + (int64_t) (1<<24)) >> 25; h0 += carry9 * 19; h9 -= carry9 << 25;
-  carry1 = (h1 + (int64_t) (1<<24)) >> 25; h2 += carry1; h1 -= carry1 << 25;
-  carry3 = (h3 + (int64_t) (1<<24)) >> 25; h4 += carry3; h3 -= carry3 << 25;
-  carry5 = (h5 + (int64_t) (1<<24)) >> 25; h6 += carry5; h5 -= carry5 << 25;
-  carry7 = (h7 + (int64_t) (1<<24)) >> 25; h8 += carry7; h7 -= carry7 << 25;
-
-  carry0 = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry0; h0 -= carry0 << 26;
-  carry2 = (h2 + (int64_t) (1<<25)) >> 26; h3 += carry2; h2 -= carry2 << 26;
-  carry4 = (h4 + (int64_t) (1<<25)) >> 26; h5 += carry4; h4 -= carry4 << 26;
-  carry6 = (h6 + (int64_t) (1<<25)) >> 26; h7 += carry6; h6 -= carry6 << 26;
-  carry8 = (h8 + (int64_t) (1<<25)) >> 26; h9 += carry8; h8 -= carry8 << 26;
-
-  h->Y[0] = (int32_t) h0;
-  h->Y[1] = (int32_t) h1;
-  h->Y[2] = (int32_t) h2;
-  h->Y[3] = (int32_t) h3;
-  h->Y[4] = (int32_t) h4;
-  h->Y[5] = (int32_t) h5;
-  h->Y[6] = (int32_t) h6;
-  h->Y[7] = (int32_t) h7;
-  h->Y[8] = (int32_t) h8;
-  h->Y[9] = (int32_t) h9;
-
-  /* End fe_frombytes.c */
+  fe_frombytes(h->Y, s);
 
   fe_1(h->Z);
   fe_sq(u, h->Y);
@@ -1603,6 +1867,42 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* Same as ge_tobytes for count points, sharing one inversion (Montgomery's trick).
+   s receives 32 * count bytes, scratch must hold count elements. */
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, fe *scratch, size_t count) {
+  fe recip;
+  fe zinv;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (count == 0) {
+    return;
+  }
+
+  /* scratch[i] = Z0 * ... * Zi */
+  fe_copy(scratch[0], h[0].Z);
+  for (i = 1; i < count; ++i) {
+    fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+  }
+
+  fe_invert(recip, scratch[count - 1]);
+  for (i = count; i-- > 0;) {
+    if (i > 0) {
+      fe_mul(zinv, recip, scratch[i - 1]);
+      fe_mul(recip, recip, h[i].Z);
+    } else {
+      fe_copy(zinv, recip);
+    }
+
+    fe_mul(x, h[i].X, zinv);
+    fe_mul(y, h[i].Y, zinv);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -1986,16 +2286,21 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
 }
 
 void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b, const ge_dsmp Bi) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_precomp_vartime2(r, a, Ai, b, Bi);
+}
+
+void ge_double_scalarmult_precomp_vartime2(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b, const ge_dsmp Bi) {
   signed char aslide[256];
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
   int i;
 
   slide(aslide, a);
   slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
 
   ge_p2_0(r);
 
@@ -2039,53 +2344,7 @@ void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s) {
   fe u, v, w, x, y, z;
   unsigned char sign;
 
-  /* From fe_frombytes.c */
-
-  int64_t h0 = load_4(s);
-  int64_t h1 = load_3(s + 4) << 6;
-  int64_t h2 = load_3(s + 7) << 5;
-  int64_t h3 = load_3(s + 10) << 3;
-  int64_t h4 = load_3(s + 13) << 2;
-  int64_t h5 = load_4(s + 16);
-  int64_t h6 = load_3(s + 20) << 7;
-  int64_t h7 = load_3(s + 23) << 5;
-  int64_t h8 = load_3(s + 26) << 4;
-  int64_t h9 = load_3(s + 29) << 2;
-  int64_t carry0;
-  int64_t carry1;
-  int64_t carry2;
-  int64_t carry3;
-  int64_t carry4;
-  int64_t carry5;
-  int64_t carry6;
-  int64_t carry7;
-  int64_t carry8;
-  int64_t carry9;
-
-  carry9 = (h9 + (int64_t) (1<<24)) >> 25; h0 += carry9 * 19; h9 -= carry9 << 25;
-  carry1 = (h1 + (int64_t) (1<<24)) >> 25; h2 += carry1; h1 -= carry1 << 25;
-  carry3 = (h3 + (int64_t) (1<<24)) >> 25; h4 += carry3; h3 -= carry3 << 25;
-  carry5 = (h5 + (int64_t) (1<<24)) >> 25; h6 += carry5; h5 -= carry5 << 25;
-  carry7 = (h7 + (int64_t) (1<<24)) >> 25; h8 += carry7; h7 -= carry7 << 25;
-
-  carry0 = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry0; h0 -= carry0 << 26;
-  carry2 = (h2 + (int64_t) (1<<25)) >> 26; h3 += carry2; h2 -= carry2 << 26;
-  carry4 = (h4 + (int64_t) (1<<25)) >> 26; h5 += carry4; h4 -= carry4 << 26;
-  carry6 = (h6 + (int64_t) (1<<25)) >> 26; h7 += carry6; h6 -= carry6 << 26;
-  carry8 = (h8 + (int64_t) (1<<25)) >> 26; h9 += carry8; h8 -= carry8 << 26;
-
-  u[0] = (int32_t) h0;
-  u[1] = (int32_t) h1;
-  u[2] = (int32_t) h2;
-  u[3] = (int32_t) h3;
-  u[4] = (int32_t) h4;
-  u[5] = (int32_t) h5;
-  u[6] = (int32_t) h6;
-  u[7] = (int32_t) h7;
-  u[8] = (int32_t) h8;
-  u[9] = (int32_t) h9;
-
-  /* End fe_frombytes.c */
+  fe_frombytes_mod(u, s);
 
   fe_sq2(v, u); /* 2 * u^2 */
   fe_1(w);
@@ -18,13 +18,25 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
 /* From fe.h */
 
+/* Field elements are five 51-bit limbs multiplied through unsigned __int128 where the
+   compiler has it, and ref10's ten 25.5-bit limbs otherwise. Define CRYPTO_OPS_FE32 to
+   force the portable representation. */
+
+#if defined(__SIZEOF_INT128__) && !defined(CRYPTO_OPS_FE32)
+#define CRYPTO_OPS_FE51
+typedef uint64_t fe[5];
+#else
 typedef int32_t fe[10];
+#endif
 
 /* From ge.h */
 
@@ -71,6 +83,7 @@ typedef ge_cached ge_dsmp[8];
 extern const ge_precomp ge_Bi[8];
 void ge_dsm_precomp(ge_dsmp r, const ge_p3 *s);
 void ge_double_scalarmult_base_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *);
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *);
 
 /* From ge_frombytes.c, modified */
 
@@ -124,6 +137,7 @@ void sc_reduce(unsigned char *);
 
 void ge_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
 void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
+void ge_double_scalarmult_precomp_vartime2(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_mul8(ge_p1p1 *, const ge_p2 *);
 extern const fe fe_ma2;
 extern const fe fe_ma;
@@ -132,6 +146,7 @@ extern const fe fe_fffb2;
 extern const fe fe_fffb3;
 extern const fe fe_fffb4;
 void ge_fromfe_frombytes_vartime(ge_p2 *, const unsigned char *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, fe *, size_t);
 void sc_0(unsigned char *);
 void sc_reduce32(unsigned char *);
 void sc_add(unsigned char *, const unsigned char *, const unsigned char *);
@@ -113,6 +113,39 @@ namespace Crypto {
     return true;
   }
 
+  bool crypto_ops::generate_consecutive_keys(const SecretKey &first, size_t count, SecretKey *secs, PublicKey *pubs) {
+    static const unsigned char one[32] = { 1 };
+    if (sc_check(reinterpret_cast<const unsigned char*>(&first)) != 0) {
+      return false;
+    }
+    if (count == 0) {
+      return true;
+    }
+
+    ge_p3 base;
+    ge_cached baseCached;
+    ge_scalarmult_base(&base, one);
+    ge_p3_to_cached(&baseCached, &base);
+
+    ge_p3 point;
+    std::vector<ge_p2> points(count);
+    ge_scalarmult_base(&point, reinterpret_cast<const unsigned char*>(&first));
+    secs[0] = first;
+    for (size_t i = 0; i < count; ++i) {
+      ge_p3_to_p2(&points[i], &point);
+      if (i + 1 < count) {
+        ge_p1p1 sum;
+        ge_add(&sum, &point, &baseCached);
+        ge_p1p1_to_p3(&point, &sum);
+        sc_add(reinterpret_cast<unsigned char*>(&secs[i + 1]), reinterpret_cast<const unsigned char*>(&secs[i]), one);
+      }
+    }
+
+    std::unique_ptr<fe[]> scratch(new fe[count]);
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(pubs), points.data(), scratch.get(), count);
+    return true;
+  }
+
   bool crypto_ops::secret_key_mult_public_key(const SecretKey &sec, const PublicKey &pub, PublicKey &result) {
     if (sc_check(&sec) != 0) {
       return false;
@@ -144,6 +177,50 @@ namespace Crypto {
     return true;
   }
 
+  // Points of the batch that are valid are compressed together with a single field inversion
+  static void points_tobytes(const std::vector<ge_p2> &points, const bool *valid, size_t count, unsigned char *out) {
+    std::vector<ge_p2> batch;
+    batch.reserve(points.size());
+    for (size_t i = 0; i < count; ++i) {
+      if (valid[i]) {
+        batch.push_back(points[i]);
+      }
+    }
+
+    if (batch.empty()) {
+      return;
+    }
+
+    std::unique_ptr<fe[]> scratch(new fe[batch.size()]);
+    std::vector<unsigned char> bytes(32 * batch.size());
+    ge_tobytes_batch(bytes.data(), batch.data(), scratch.get(), batch.size());
+
+    for (size_t i = 0, j = 0; i < count; ++i) {
+      if (valid[i]) {
+        memcpy(out + 32 * i, bytes.data() + 32 * j, 32);
+        ++j;
+      }
+    }
+  }
+
+  void crypto_ops::generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &key2, KeyDerivation *derivations, bool *valid) {
+    static_assert(sizeof(KeyDerivation) == 32, "Unexpected key derivation size");
+    bool secretValid = sc_check(reinterpret_cast<const unsigned char*>(&key2)) == 0;
+    std::vector<ge_p2> points(count);
+    for (size_t i = 0; i < count; ++i) {
+      ge_p3 point;
+      ge_p1p1 point3;
+      valid[i] = secretValid && ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&keys[i])) == 0;
+      if (valid[i]) {
+        ge_scalarmult(&points[i], reinterpret_cast<const unsigned char*>(&key2), &point);
+        ge_mul8(&point3, &points[i]);
+        ge_p1p1_to_p2(&points[i], &point3);
+      }
+    }
+
+    points_tobytes(points, valid, count, reinterpret_cast<unsigned char*>(derivations));
+  }
+
   static void derivation_to_scalar(const KeyDerivation &derivation, size_t output_index, EllipticCurveScalar &res) {
     struct {
       KeyDerivation derivation;
@@ -267,6 +344,29 @@ namespace Crypto {
     return true;
   }
 
+  void crypto_ops::underive_public_keys(const KeyDerivation *derivations, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *valid) {
+    static_assert(sizeof(PublicKey) == 32, "Unexpected public key size");
+    std::vector<ge_p2> points(count);
+    for (size_t i = 0; i < count; ++i) {
+      EllipticCurveScalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      valid[i] = ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(&derived_keys[i])) == 0;
+      if (valid[i]) {
+        derivation_to_scalar(derivations[i], output_indexes[i], scalar);
+        ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+        ge_p3_to_cached(&point3, &point2);
+        ge_sub(&point4, &point1, &point3);
+        ge_p1p1_to_p2(&points[i], &point4);
+      }
+    }
+
+    points_tobytes(points, valid, count, reinterpret_cast<unsigned char*>(bases));
+  }
+
   bool crypto_ops::underive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &derived_key, const uint8_t* suffix, size_t suffixLength, PublicKey &base) {
     EllipticCurveScalar scalar;
@@ -634,4 +734,72 @@ namespace Crypto {
     return sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) == 0;
   }
 
+  bool crypto_ops::prepare_ring_key(const PublicKey &pub, RingKey &key) {
+    ge_p3 point;
+    if (ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&pub)) != 0) {
+      return false;
+    }
+
+    ge_dsm_precomp(key.key, &point);
+    hash_to_ec(pub, point);
+    ge_dsm_precomp(key.hashPoint, &point);
+    return true;
+  }
+
+  void crypto_ops::check_ring_signatures(const RingSignatureCheck *checks, size_t count, bool *results) {
+    // a and b of every member of every ring, in ring order
+    std::vector<ge_p2> points;
+    std::vector<EllipticCurveScalar> sums(count);
+    for (size_t i = 0; i < count; ++i) {
+      const RingSignatureCheck &check = checks[i];
+      ge_p3 image_unp;
+      ge_dsmp image_pre;
+      results[i] = ge_frombytes_vartime(&image_unp, reinterpret_cast<const unsigned char*>(check.image)) == 0;
+      for (size_t j = 0; j < check.keysCount && results[i]; ++j) {
+        const unsigned char *c = reinterpret_cast<const unsigned char*>(&check.signatures[j]);
+        results[i] = sc_check(c) == 0 && sc_check(c + 32) == 0;
+      }
+
+      if (!results[i]) {
+        continue;
+      }
+
+      ge_dsm_precomp(image_pre, &image_unp);
+      sc_0(reinterpret_cast<unsigned char*>(&sums[i]));
+      for (size_t j = 0; j < check.keysCount; ++j) {
+        const unsigned char *c = reinterpret_cast<const unsigned char*>(&check.signatures[j]);
+        ge_p2 a;
+        ge_p2 b;
+        ge_double_scalarmult_base_precomp_vartime(&a, c, check.keys[j]->key, c + 32);
+        ge_double_scalarmult_precomp_vartime2(&b, c + 32, check.keys[j]->hashPoint, c, image_pre);
+        points.push_back(a);
+        points.push_back(b);
+        sc_add(reinterpret_cast<unsigned char*>(&sums[i]), reinterpret_cast<unsigned char*>(&sums[i]), c);
+      }
+    }
+
+    std::unique_ptr<fe[]> scratch(new fe[points.size()]);
+    std::vector<EllipticCurvePoint> bytes(points.size());
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(bytes.data()), points.data(), scratch.get(), points.size());
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (!results[i]) {
+        continue;
+      }
+
+      const RingSignatureCheck &check = checks[i];
+      std::vector<uint8_t> buffer(rs_comm_size(check.keysCount));
+      rs_comm *const buf = reinterpret_cast<rs_comm *>(buffer.data());
+      buf->h = *check.prefixHash;
+      memcpy(buf->ab, bytes.data() + offset, 2 * check.keysCount * sizeof(EllipticCurvePoint));
+      offset += 2 * check.keysCount;
+
+      EllipticCurveScalar h;
+      hash_to_scalar(buf, rs_comm_size(check.keysCount), h);
+      sc_sub(reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&sums[i]));
+      results[i] = sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) == 0;
+    }
+  }
+
 }
@@ -35,6 +35,24 @@
 
 namespace Crypto {
 
+  /* What ring signature checks need from a ring member that only depends on its public key:
+     the key and its hash_to_ec point, both expanded for double scalar multiplication.
+   */
+  struct RingKey {
+    ge_dsmp key;
+    ge_dsmp hashPoint;
+  };
+
+  /* One ring signature of a batch, keys and signatures hold keysCount entries.
+   */
+  struct RingSignatureCheck {
+    const Hash *prefixHash;
+    const KeyImage *image;
+    const RingKey *const *keys;
+    size_t keysCount;
+    const Signature *signatures;
+  };
+
   class crypto_ops {
     crypto_ops();
     crypto_ops(const crypto_ops &);
@@ -51,10 +69,14 @@ namespace Crypto {
     friend bool check_key(const PublicKey &);
     static bool secret_key_to_public_key(const SecretKey &, PublicKey &);
     friend bool secret_key_to_public_key(const SecretKey &, PublicKey &);
+    static bool generate_consecutive_keys(const SecretKey &, size_t, SecretKey *, PublicKey *);
+    friend bool generate_consecutive_keys(const SecretKey &, size_t, SecretKey *, PublicKey *);
     static bool secret_key_mult_public_key(const SecretKey &, const PublicKey &, PublicKey &);
     friend bool secret_key_mult_public_key(const SecretKey &, const PublicKey &, PublicKey &);
     static bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
     friend bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
+    static void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
+    friend void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
     static bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
@@ -71,6 +93,8 @@ namespace Crypto {
     friend void derive_secret_key(const KeyDerivation &, size_t, const SecretKey &, const uint8_t*, size_t, SecretKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
+    static void underive_public_keys(const KeyDerivation *, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
+    friend void underive_public_keys(const KeyDerivation *, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
@@ -95,6 +119,10 @@ namespace Crypto {
       const PublicKey *const *, size_t, const Signature *);
     friend bool check_ring_signature(const Hash &, const KeyImage &,
       const PublicKey *const *, size_t, const Signature *);
+    static bool prepare_ring_key(const PublicKey &, RingKey &);
+    friend bool prepare_ring_key(const PublicKey &, RingKey &);
+    static void check_ring_signatures(const RingSignatureCheck *, size_t, bool *);
+    friend void check_ring_signatures(const RingSignatureCheck *, size_t, bool *);
   };
 
   void hash_to_scalar(const void *data, size_t length, EllipticCurveScalar &res);
@@ -125,6 +153,14 @@ namespace Crypto {
     return crypto_ops::secret_key_to_public_key(sec, pub);
   }
 
+  /* Key pairs for the secret keys first, first + 1, ..., first + count - 1. Each public key is the previous one plus
+   * the base point, and all of them are compressed with a single field inversion, which is far cheaper than count
+   * calls of secret_key_to_public_key. Returns false if first is not a valid secret key.
+   */
+  inline bool generate_consecutive_keys(const SecretKey &first, size_t count, SecretKey *secs, PublicKey *pubs) {
+    return crypto_ops::generate_consecutive_keys(first, count, secs, pubs);
+  }
+
   /* Multiply secret key to public key
  */
   inline bool secret_key_mult_public_key(const SecretKey &sec, const PublicKey &pub, PublicKey &result) {
@@ -141,6 +177,12 @@ namespace Crypto {
     return crypto_ops::generate_key_derivation(key1, key2, derivation);
   }
 
+  /* Batched generate_key_derivation for many transaction keys and one secret key, valid[i] tells whether derivations[i] was generated.
+   */
+  inline void generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &key2, KeyDerivation *derivations, bool *valid) {
+    crypto_ops::generate_key_derivations(keys, count, key2, derivations, valid);
+  }
+
   inline bool derive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &base, const uint8_t* prefix, size_t prefixLength, PublicKey &derived_key) {
     return crypto_ops::derive_public_key(derivation, output_index, base, prefix, prefixLength, derived_key);
@@ -180,6 +222,13 @@ namespace Crypto {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* Batched underive_public_key, the i-th key is underived with derivations[i] and output_indexes[i].
+   */
+  inline void underive_public_keys(const KeyDerivation *derivations, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *valid) {
+    crypto_ops::underive_public_keys(derivations, output_indexes, derived_keys, count, bases, valid);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
@@ -229,6 +278,17 @@ namespace Crypto {
     return crypto_ops::check_ring_signature(prefix_hash, image, pubs, pubs_count, sig);
   }
 
+  /* Ring signature checks from prepared ring members. prepare_ring_key fails if the key is not a valid point.
+     check_ring_signatures evaluates all rings of the batch before compressing their points with a single
+     field inversion, results[i] gives the outcome of checks[i].
+   */
+  inline bool prepare_ring_key(const PublicKey &pub, RingKey &key) {
+    return crypto_ops::prepare_ring_key(pub, key);
+  }
+  inline void check_ring_signatures(const RingSignatureCheck *checks, size_t count, bool *results) {
+    crypto_ops::check_ring_signatures(checks, count, results);
+  }
+
   /* Variants with vector<const PublicKey *> parameters.
    */
   inline void generate_ring_signature(const Hash &prefix_hash, const KeyImage &image,
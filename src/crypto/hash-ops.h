@@ -64,6 +64,7 @@ enum {
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+void cn_fast_hash_multi(const void *const *data, const size_t *lengths, size_t count, char *hashes);
 
 void cn_slow_hash(const void *data, size_t length, char *hash);
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <string>
 
 #include <CryptoTypes.h>
 #include "generic-ops.h"
@@ -44,11 +45,17 @@ namespace Crypto {
     return h;
   }
 
+  // hashes count independent messages at once, hashes[i] receives the hash of data[i]
+  inline void cn_fast_hash_multi(const void *const *data, const size_t *lengths, size_t count, Hash *hashes) {
+    cn_fast_hash_multi(data, lengths, count, reinterpret_cast<char *>(hashes));
+  }
+
+  // The scratchpads themselves are kept per thread by cn_slow_hash and y_slow_hash,
+  // see scratchpad.h, so a context no longer maps memory of its own.
   class cn_context {
   public:
 
-    cn_context();
-    ~cn_context();
+    cn_context() = default;
 #if !defined(_MSC_VER) || _MSC_VER >= 1800
     cn_context(const cn_context &) = delete;
     void operator=(const cn_context &) = delete;
@@ -56,7 +63,6 @@ namespace Crypto {
 
   private:
 
-    void *data;
     friend inline void cn_slow_hash(cn_context &, const void *, size_t, Hash &);
   };
 
@@ -79,6 +85,17 @@ namespace Crypto {
     return true;
   }
 
+  // Allocates the calling thread's y_slow_hash scratchpad now instead of on its first real hash
+  inline bool y_slow_hash_prepare() {
+    Hash seed = {};
+    Hash hash;
+    return y_slow_hash(seed.data, sizeof(seed), seed, hash);
+  }
+
+  // What the scratchpads allocated so far were placed on, for startup logs
+  std::string scratchpad_report();
+  std::string thread_scratchpad_report();
+
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
@@ -17,57 +17,84 @@ const uint64_t keccakf_rndc[24] =
     0x8000000000008080, 0x0000000080000001, 0x8000000080008008
 };
 
-const int keccakf_rotc[24] = 
-{
-    1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14, 
-    27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
-};
+// one round on the state a, with b, c and d as scratch; unrolled so that the
+// state can live in registers, and written for any type with 64-bit lanes
 
-const int keccakf_piln[24] = 
-{
-    10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4, 
-    15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1 
-};
+#define KECCAK_ROUND(a, b, c, d, rc) { \
+    c[0] = a[0] ^ a[5] ^ a[10] ^ a[15] ^ a[20]; \
+    c[1] = a[1] ^ a[6] ^ a[11] ^ a[16] ^ a[21]; \
+    c[2] = a[2] ^ a[7] ^ a[12] ^ a[17] ^ a[22]; \
+    c[3] = a[3] ^ a[8] ^ a[13] ^ a[18] ^ a[23]; \
+    c[4] = a[4] ^ a[9] ^ a[14] ^ a[19] ^ a[24]; \
+    d[0] = c[4] ^ ROTL64(c[1], 1); \
+    d[1] = c[0] ^ ROTL64(c[2], 1); \
+    d[2] = c[1] ^ ROTL64(c[3], 1); \
+    d[3] = c[2] ^ ROTL64(c[4], 1); \
+    d[4] = c[3] ^ ROTL64(c[0], 1); \
+    b[0] = a[0] ^ d[0]; \
+    b[10] = ROTL64(a[1] ^ d[1], 1); \
+    b[20] = ROTL64(a[2] ^ d[2], 62); \
+    b[5] = ROTL64(a[3] ^ d[3], 28); \
+    b[15] = ROTL64(a[4] ^ d[4], 27); \
+    b[16] = ROTL64(a[5] ^ d[0], 36); \
+    b[1] = ROTL64(a[6] ^ d[1], 44); \
+    b[11] = ROTL64(a[7] ^ d[2], 6); \
+    b[21] = ROTL64(a[8] ^ d[3], 55); \
+    b[6] = ROTL64(a[9] ^ d[4], 20); \
+    b[7] = ROTL64(a[10] ^ d[0], 3); \
+    b[17] = ROTL64(a[11] ^ d[1], 10); \
+    b[2] = ROTL64(a[12] ^ d[2], 43); \
+    b[12] = ROTL64(a[13] ^ d[3], 25); \
+    b[22] = ROTL64(a[14] ^ d[4], 39); \
+    b[23] = ROTL64(a[15] ^ d[0], 41); \
+    b[8] = ROTL64(a[16] ^ d[1], 45); \
+    b[18] = ROTL64(a[17] ^ d[2], 15); \
+    b[3] = ROTL64(a[18] ^ d[3], 21); \
+    b[13] = ROTL64(a[19] ^ d[4], 8); \
+    b[14] = ROTL64(a[20] ^ d[0], 18); \
+    b[24] = ROTL64(a[21] ^ d[1], 2); \
+    b[9] = ROTL64(a[22] ^ d[2], 61); \
+    b[19] = ROTL64(a[23] ^ d[3], 56); \
+    b[4] = ROTL64(a[24] ^ d[4], 14); \
+    a[0] = b[0] ^ (~b[1] & b[2]); \
+    a[1] = b[1] ^ (~b[2] & b[3]); \
+    a[2] = b[2] ^ (~b[3] & b[4]); \
+    a[3] = b[3] ^ (~b[4] & b[0]); \
+    a[4] = b[4] ^ (~b[0] & b[1]); \
+    a[5] = b[5] ^ (~b[6] & b[7]); \
+    a[6] = b[6] ^ (~b[7] & b[8]); \
+    a[7] = b[7] ^ (~b[8] & b[9]); \
+    a[8] = b[8] ^ (~b[9] & b[5]); \
+    a[9] = b[9] ^ (~b[5] & b[6]); \
+    a[10] = b[10] ^ (~b[11] & b[12]); \
+    a[11] = b[11] ^ (~b[12] & b[13]); \
+    a[12] = b[12] ^ (~b[13] & b[14]); \
+    a[13] = b[13] ^ (~b[14] & b[10]); \
+    a[14] = b[14] ^ (~b[10] & b[11]); \
+    a[15] = b[15] ^ (~b[16] & b[17]); \
+    a[16] = b[16] ^ (~b[17] & b[18]); \
+    a[17] = b[17] ^ (~b[18] & b[19]); \
+    a[18] = b[18] ^ (~b[19] & b[15]); \
+    a[19] = b[19] ^ (~b[15] & b[16]); \
+    a[20] = b[20] ^ (~b[21] & b[22]); \
+    a[21] = b[21] ^ (~b[22] & b[23]); \
+    a[22] = b[22] ^ (~b[23] & b[24]); \
+    a[23] = b[23] ^ (~b[24] & b[20]); \
+    a[24] = b[24] ^ (~b[20] & b[21]); \
+    a[0] ^= (rc); \
+}
 
 // update the state with given number of rounds
 
 void keccakf(uint64_t st[25], int rounds)
 {
-    int i, j, round;
-    uint64_t t, bc[5];
-
-    for (round = 0; round < rounds; round++) {
-
-        // Theta
-        for (i = 0; i < 5; i++)     
-            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
-
-        for (i = 0; i < 5; i++) {
-            t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
-            for (j = 0; j < 25; j += 5)
-                st[j + i] ^= t;
-        }
-
-        // Rho Pi
-        t = st[1];
-        for (i = 0; i < 24; i++) {
-            j = keccakf_piln[i];
-            bc[0] = st[j];
-            st[j] = ROTL64(t, keccakf_rotc[i]);
-            t = bc[0];
-        }
-
-        //  Chi
-        for (j = 0; j < 25; j += 5) {
-            for (i = 0; i < 5; i++)
-                bc[i] = st[j + i];
-            for (i = 0; i < 5; i++)
-                st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
-        }
+    uint64_t a[25], b[25], c[5], d[5];
+    int round;
 
-        //  Iota
-        st[0] ^= keccakf_rndc[round];
-    }
+    memcpy(a, st, sizeof(a));
+    for (round = 0; round < rounds; round++)
+        KECCAK_ROUND(a, b, c, d, keccakf_rndc[round]);
+    memcpy(st, a, sizeof(a));
 }
 
 // compute a keccak hash (md) of given byte length from "in"
@@ -117,3 +144,120 @@ void keccak1600(const uint8_t *in, int inlen, uint8_t *md)
 {
     keccak(in, inlen, md, sizeof(state_t));
 }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+// four states side by side, one per 64-bit element, permuted with AVX2
+#define KECCAK_LANES 4
+
+typedef uint64_t keccak_lanes_t __attribute__((vector_size(32)));
+
+__attribute__((target("avx2")))
+static void keccakf_lanes(keccak_lanes_t st[25])
+{
+    keccak_lanes_t a[25], b[25], c[5], d[5];
+    int round;
+
+    memcpy(a, st, sizeof(a));
+    for (round = 0; round < KECCAK_ROUNDS; round++)
+        KECCAK_ROUND(a, b, c, d, keccakf_rndc[round]);
+    memcpy(st, a, sizeof(a));
+}
+
+// every lane takes the next message as soon as it has finished its own, so
+// messages of different lengths keep all lanes busy
+
+__attribute__((target("avx2")))
+static void keccak_lanes(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t *md, int mdlen)
+{
+    keccak_lanes_t st[25];
+    const uint8_t *pos[KECCAK_LANES];
+    size_t left[KECCAK_LANES], job[KECCAK_LANES];
+    int active[KECCAK_LANES], last[KECCAK_LANES];
+    uint8_t temp[KECCAK_LANES][144];
+    uint64_t out[25], word;
+    size_t next = 0;
+    int i, k, busy, rsiz, rsizw;
+
+    const int HASH_DATA_AREA = 136;
+
+    rsiz = sizeof(state_t) == mdlen ? HASH_DATA_AREA : 200 - 2 * mdlen;
+    rsizw = rsiz / 8;
+
+    memset(st, 0, sizeof(st));
+    for (k = 0; k < KECCAK_LANES; k++) {
+        active[k] = next < count;
+        if (active[k]) {
+            job[k] = next;
+            pos[k] = in[next];
+            left[k] = inlen[next];
+            next++;
+        }
+    }
+
+    do {
+        for (k = 0; k < KECCAK_LANES; k++) {
+            const uint8_t *block = pos[k];
+            if (!active[k])
+                continue;
+
+            // last block and padding
+            last[k] = left[k] < (size_t) rsiz;
+            if (last[k]) {
+                if (left[k] > 0)
+                    memcpy(temp[k], pos[k], left[k]);
+                temp[k][left[k]] = 1;
+                memset(temp[k] + left[k] + 1, 0, rsiz - left[k] - 1);
+                temp[k][rsiz - 1] |= 0x80;
+                block = temp[k];
+            } else {
+                pos[k] += rsiz;
+                left[k] -= rsiz;
+            }
+
+            for (i = 0; i < rsizw; i++) {
+                memcpy(&word, block + i * 8, sizeof(word));
+                st[i][k] ^= word;
+            }
+        }
+
+        keccakf_lanes(st);
+
+        busy = 0;
+        for (k = 0; k < KECCAK_LANES; k++) {
+            if (active[k] && last[k]) {
+                for (i = 0; i < 25; i++) {
+                    out[i] = st[i][k];
+                    st[i][k] = 0;
+                }
+                memcpy(md + job[k] * mdlen, out, mdlen);
+
+                active[k] = next < count;
+                if (active[k]) {
+                    job[k] = next;
+                    pos[k] = in[next];
+                    left[k] = inlen[next];
+                    next++;
+                }
+            }
+            busy |= active[k];
+        }
+    } while (busy);
+}
+
+#endif
+
+void keccak_multi(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t *md, int mdlen)
+{
+    size_t i;
+
+#ifdef KECCAK_LANES
+    if (count > 1 && __builtin_cpu_supports("avx2")) {
+        keccak_lanes(in, inlen, count, md, mdlen);
+        return;
+    }
+#endif
+
+    for (i = 0; i < count; i++)
+        keccak(in[i], (int) inlen[i], md + i * mdlen, mdlen);
+}
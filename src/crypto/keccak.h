@@ -23,4 +23,8 @@ void keccakf(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t *in, int inlen, uint8_t *md);
 
+// hash count independent messages, writing mdlen bytes per message to md;
+// several messages are permuted at once where the CPU allows it
+void keccak_multi(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t *md, int mdlen);
+
 #endif
@@ -0,0 +1,255 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdlib.h>
+
+#include "scratchpad.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/* linux/mempolicy.h: allocate on the node of the CPU that faults the page in,
+ * regardless of the policy the process was started with (numactl --interleave) */
+#define MPOL_LOCAL 4
+
+#if defined(_MSC_VER)
+#define THREADV __declspec(thread)
+#define STATS_ADD(field, value) InterlockedExchangeAdd64((volatile LONG64 *)&(field), (LONG64)(value))
+#define STATS_LOAD(field) InterlockedCompareExchange64((volatile LONG64 *)&(field), 0, 0)
+#else
+#define THREADV __thread
+#define STATS_ADD(field, value) __atomic_fetch_add(&(field), (uint64_t)(value), __ATOMIC_RELAXED)
+#define STATS_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#endif
+
+static scratchpad_stats_t stats;
+
+static THREADV int thread_allocated = 0;
+static THREADV enum scratchpad_pages thread_pages;
+static THREADV size_t thread_size;
+static THREADV int thread_node;
+
+static size_t round_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+#if defined(_WIN32)
+
+static BOOL set_lock_pages_privilege(void)
+{
+    struct
+    {
+        DWORD count;
+        LUID_AND_ATTRIBUTES privilege[1];
+    } info;
+
+    HANDLE token;
+    BOOL result;
+    if(!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token))
+        return FALSE;
+
+    info.count = 1;
+    info.privilege[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    result = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &(info.privilege[0].Luid)) &&
+             AdjustTokenPrivileges(token, FALSE, (PTOKEN_PRIVILEGES) &info, 0, NULL, NULL) &&
+             GetLastError() == ERROR_SUCCESS;
+
+    CloseHandle(token);
+    return result;
+}
+
+/* Windows places pages on the node of the thread that touches them first,
+ * and commits large pages at allocation time on the caller's node */
+static void *map_scratchpad(size_t size, size_t *mapped_size, enum scratchpad_pages *pages, int *numa_local)
+{
+    SIZE_T large_page = GetLargePageMinimum();
+    void *base;
+
+    *numa_local = 0;
+    if(large_page != 0 && size >= large_page && set_lock_pages_privilege())
+    {
+        size_t rounded = round_up(size, large_page);
+        base = VirtualAlloc(NULL, rounded, MEM_LARGE_PAGES | MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if(base != NULL)
+        {
+            *mapped_size = rounded;
+            *pages = SCRATCHPAD_HUGE_PAGES;
+            return base;
+        }
+    }
+
+    base = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    *mapped_size = size;
+    *pages = SCRATCHPAD_NORMAL_PAGES;
+    return base;
+}
+
+static int current_node(void)
+{
+    return -1;
+}
+
+#else
+
+static int bind_to_local_node(void *base, size_t size)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    return syscall(SYS_mbind, base, size, MPOL_LOCAL, NULL, 0, 0) == 0;
+#else
+    (void) base;
+    (void) size;
+    return 0;
+#endif
+}
+
+static int current_node(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if(syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+        return (int) node;
+#endif
+    return -1;
+}
+
+static void *map_scratchpad(size_t size, size_t *mapped_size, enum scratchpad_pages *pages, int *numa_local)
+{
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t length = round_up(size, page_size);
+    uint8_t *raw, *base;
+
+#if defined(MAP_HUGETLB)
+    if(size >= HUGE_PAGE_SIZE)
+    {
+        /* munmap fails on huge page mappings whose length is not a multiple of the huge page size */
+        size_t rounded = round_up(size, HUGE_PAGE_SIZE);
+        base = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(base != MAP_FAILED)
+        {
+            *numa_local = bind_to_local_node(base, rounded);
+            *mapped_size = rounded;
+            *pages = SCRATCHPAD_HUGE_PAGES;
+            return base;
+        }
+    }
+#endif
+
+#if defined(MADV_HUGEPAGE)
+    if(size >= HUGE_PAGE_SIZE)
+    {
+        /* Over-map, then trim so that the start is huge page aligned and every whole
+         * 2 MB extent of the scratchpad can be backed by one transparent huge page */
+        raw = mmap(NULL, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw != MAP_FAILED)
+        {
+            base = (uint8_t *) round_up((size_t) raw, HUGE_PAGE_SIZE);
+            if(base != raw)
+                munmap(raw, base - raw);
+            if(raw + length + HUGE_PAGE_SIZE != base + length)
+                munmap(base + length, raw + HUGE_PAGE_SIZE - base);
+
+            *numa_local = bind_to_local_node(base, length);
+            *mapped_size = length;
+            *pages = madvise(base, length, MADV_HUGEPAGE) == 0 ? SCRATCHPAD_TRANSPARENT_PAGES : SCRATCHPAD_NORMAL_PAGES;
+            return base;
+        }
+    }
+#endif
+
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if(base == MAP_FAILED)
+        return NULL;
+
+    *numa_local = bind_to_local_node(base, length);
+    *mapped_size = length;
+    *pages = SCRATCHPAD_NORMAL_PAGES;
+    return base;
+}
+
+#endif
+
+void *scratchpad_alloc(size_t size, size_t *mapped_size)
+{
+    enum scratchpad_pages pages;
+    int numa_local = 0;
+    size_t i;
+    volatile uint8_t *base = map_scratchpad(size, mapped_size, &pages, &numa_local);
+    if(base == NULL)
+        return NULL;
+
+    /* Fault the pages in now, from this thread, so they land on its node */
+    for(i = 0; i < size; i += 4096)
+        base[i] = 0;
+
+    STATS_ADD(stats.count[pages], 1);
+    STATS_ADD(stats.bytes[pages], *mapped_size);
+    if(numa_local)
+        STATS_ADD(stats.numa_local, 1);
+
+    thread_allocated = 1;
+    thread_pages = pages;
+    thread_size = *mapped_size;
+    thread_node = current_node();
+    return (void *) base;
+}
+
+int scratchpad_free(void *base, size_t mapped_size)
+{
+    if(base == NULL)
+        return 0;
+
+#if defined(_WIN32)
+    (void) mapped_size;
+    return VirtualFree(base, 0, MEM_RELEASE) ? 0 : -1;
+#else
+    return munmap(base, mapped_size);
+#endif
+}
+
+void scratchpad_get_stats(scratchpad_stats_t *result)
+{
+    int i;
+    for(i = 0; i < SCRATCHPAD_PAGE_KINDS; i++)
+    {
+        result->count[i] = STATS_LOAD(stats.count[i]);
+        result->bytes[i] = STATS_LOAD(stats.bytes[i]);
+    }
+    result->numa_local = STATS_LOAD(stats.numa_local);
+}
+
+int scratchpad_thread_info(enum scratchpad_pages *pages, size_t *size, int *node)
+{
+    if(!thread_allocated)
+        return 0;
+
+    *pages = thread_pages;
+    *size = thread_size;
+    *node = thread_node;
+    return 1;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* What backs a scratchpad, best first */
+enum scratchpad_pages {
+  SCRATCHPAD_HUGE_PAGES,        /* explicit huge pages (MAP_HUGETLB, MEM_LARGE_PAGES) */
+  SCRATCHPAD_TRANSPARENT_PAGES, /* huge-page aligned and advised to the kernel (MADV_HUGEPAGE) */
+  SCRATCHPAD_NORMAL_PAGES,
+  SCRATCHPAD_PAGE_KINDS
+};
+
+typedef struct {
+  uint64_t count[SCRATCHPAD_PAGE_KINDS];
+  uint64_t bytes[SCRATCHPAD_PAGE_KINDS];
+  uint64_t numa_local;   /* allocations bound to the node of the allocating thread */
+} scratchpad_stats_t;
+
+/**
+ * Allocates size bytes for a memory-hard hash, trying huge pages first and
+ * falling back to transparent huge pages and then to normal pages.  The pages
+ * are placed on the NUMA node of the calling thread and faulted in before
+ * returning, so the thread that hashes should be the one that allocates.
+ * mapped_size receives the number of bytes to pass to scratchpad_free, which
+ * may be larger than size.  Returns NULL if no memory could be obtained.
+ */
+void *scratchpad_alloc(size_t size, size_t *mapped_size);
+int scratchpad_free(void *base, size_t mapped_size);
+
+/* Totals over every scratchpad allocated by the process so far */
+void scratchpad_get_stats(scratchpad_stats_t *stats);
+
+/**
+ * Describes the latest scratchpad allocated by the calling thread.  Returns 0
+ * and leaves the arguments untouched if the thread has not allocated one.
+ * node is -1 when the NUMA node is unknown.
+ */
+int scratchpad_thread_info(enum scratchpad_pages *pages, size_t *size, int *node);
+
+#ifdef __cplusplus
+}
+#endif
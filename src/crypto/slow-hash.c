@@ -39,6 +39,7 @@
 #include "oaes_lib.h"
 #include "aesb.h"
 #include "keccak.h"
+#include "scratchpad.h"
 
 #define MEMORY         (1 << 21) // 2MB scratchpad
 #define ITER           (1 << 20)
@@ -65,15 +66,6 @@ union cn_slow_hash_state
 };
 #pragma pack(pop)
 
-static inline void aligned_free(void* ptr)
-{
-#ifdef _MSC_VER
-  _aligned_free(ptr);
-#else
-  free(ptr);
-#endif
-}
-
 #if !defined NO_AES && (defined(__x86_64__) || (defined(_MSC_VER) && defined(_WIN64)))
 // Optimised code below, uses x86-specific intrinsics, SSE2, AES-NI
 // Fall back to more portable code is down at the bottom
@@ -100,7 +92,6 @@ static inline void aligned_free(void* ptr)
 #endif
 #else
 #include <wmmintrin.h>
-#include <sys/mman.h>
 #define STATIC static
 #define INLINE inline
 #if !defined(RDATA_ALIGN16)
@@ -165,7 +156,7 @@ static inline void aligned_free(void* ptr)
   _b = _c; \
 
 THREADV uint8_t *hp_state = NULL;
-THREADV int hp_allocated = 0;
+THREADV size_t hp_size = 0;
 
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
@@ -399,43 +390,12 @@ STATIC INLINE void aes_pseudo_round_xor(const uint8_t *in, uint8_t *out,
     }
 }
 
-#if defined(_MSC_VER) || defined(__MINGW32__)
-BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
-{
-    struct
-    {
-        DWORD count;
-        LUID_AND_ATTRIBUTES privilege[1];
-    } info;
-
-    HANDLE token;
-    if(!OpenProcessToken(hProcess, TOKEN_ADJUST_PRIVILEGES, &token))
-        return FALSE;
-
-    info.count = 1;
-    info.privilege[0].Attributes = bEnable ? SE_PRIVILEGE_ENABLED : 0;
-
-    if(!LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &(info.privilege[0].Luid)))
-        return FALSE;
-
-    if(!AdjustTokenPrivileges(token, FALSE, (PTOKEN_PRIVILEGES) &info, 0, NULL, NULL))
-        return FALSE;
-
-    if (GetLastError() != ERROR_SUCCESS)
-        return FALSE;
-
-    CloseHandle(token);
-
-    return TRUE;
-
-}
-#endif
-
 /**
  * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
  *
  * This function tries to allocate the 2MB scratch buffer using a single
- * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
+ * 2MB "huge page" (instead of the usual 4KB page sizes) through
+ * scratchpad_alloc, on the NUMA node of the calling thread, to reduce TLB misses
  * during the random accesses to the scratch buffer.  This is one of the
  * important speed optimizations needed to make CryptoNight faster.
  *
@@ -448,28 +408,7 @@ void slow_hash_allocate_state(void)
     if(hp_state != NULL)
         return;
 
-#if defined(_MSC_VER) || defined(__MINGW32__)
-    SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-#else
-#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
-  defined(__DragonFly__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
-#else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
-#endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
-#endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
-    {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
-    }
+    hp_state = (uint8_t *) scratchpad_alloc(MEMORY, &hp_size);
 }
 
 /**
@@ -481,19 +420,9 @@ void slow_hash_free_state(void)
     if(hp_state == NULL)
         return;
 
-    if(!hp_allocated)
-        free(hp_state);
-    else
-    {
-#if defined(_MSC_VER) || defined(__MINGW32__)
-        VirtualFree(hp_state, 0, MEM_RELEASE);
-#else
-        munmap(hp_state, MEMORY);
-#endif
-    }
-
+    scratchpad_free(hp_state, hp_size);
     hp_state = NULL;
-    hp_allocated = 0;
+    hp_size = 0;
 }
 
 /**
@@ -664,28 +593,15 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
 
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
 #ifdef __aarch64__
-#include <sys/mman.h>
 THREADV uint8_t *hp_state = NULL;
-THREADV int hp_malloced = 0;
+THREADV size_t hp_size = 0;
 
 void slow_hash_allocate_state(void)
 {
     if(hp_state != NULL)
         return;
 
-#ifndef	MAP_HUGETLB
-#define	MAP_HUGETLB	0
-#endif
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
-
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
-    if(hp_state == NULL)
-    {
-        hp_malloced = 1;
-        hp_state = (uint8_t *) malloc(MEMORY);
-    }
+    hp_state = (uint8_t *) scratchpad_alloc(MEMORY, &hp_size);
 }
 
 void slow_hash_free_state(void)
@@ -693,12 +609,9 @@ void slow_hash_free_state(void)
     if(hp_state == NULL)
         return;
 
-    if (hp_malloced)
-        free(hp_state);
-    else
-        munmap(hp_state, MEMORY);
+    scratchpad_free(hp_state, hp_size);
     hp_state = NULL;
-    hp_malloced = 0;
+    hp_size = 0;
 }
 #else
 void slow_hash_allocate_state(void)
@@ -890,7 +803,6 @@ STATIC INLINE void aes_pseudo_round_xor(const uint8_t *in, uint8_t *out, const u
 void cn_slow_hash(const void *data, size_t length, char *hash)
 {
     RDATA_ALIGN16 uint8_t expandedKey[240];
-    RDATA_ALIGN16 uint8_t hp_state[MEMORY];
 
     uint8_t text[INIT_SIZE_BYTE];
     RDATA_ALIGN16 uint64_t a[2];
@@ -908,6 +820,10 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
         hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
     };
 
+    int bLocalStateAllocation = (hp_state == NULL);
+    if (bLocalStateAllocation)
+        slow_hash_allocate_state();
+
     /* CryptoNight Step 1:  Use Keccak1600 to initialize the 'state' (and 'text') buffers from the data. */
 
     hash_process(&state.hs, data, length);
@@ -970,7 +886,8 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
     hash_permutation(&state.hs);
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
 
-	aligned_free(hp_state);
+    if (bLocalStateAllocation)
+        slow_hash_free_state();
 }
 
 #else /* aarch64 && crypto */
@@ -1103,7 +1020,8 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
         hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
     };
 
-    uint8_t *long_state = (uint8_t*)malloc(MEMORY);
+    size_t long_state_size;
+    uint8_t *long_state = (uint8_t*)scratchpad_alloc(MEMORY, &long_state_size);
 
     hash_process(&state.hs, data, length);
     memcpy(text, state.init, INIT_SIZE_BYTE);
@@ -1165,7 +1083,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
     hash_permutation(&state.hs);
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
 
-	free(long_state);
+	scratchpad_free(long_state, long_state_size);
 }
 
 #endif /* !aarch64 || !crypto */
@@ -1238,7 +1156,8 @@ static void xor_blocks(uint8_t* a, const uint8_t* b) {
 }
 
 void cn_slow_hash(const void *data, size_t length, char *hash) {
-  uint8_t* long_state = (uint8_t*)malloc(MEMORY);
+  size_t long_state_size;
+  uint8_t* long_state = (uint8_t*)scratchpad_alloc(MEMORY, &long_state_size);
   union cn_slow_hash_state state;
   uint8_t text[INIT_SIZE_BYTE];
   uint8_t a[AES_BLOCK_SIZE];
@@ -1306,7 +1225,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash) {
   /*memcpy(hash, &state, 32);*/
   extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
   oaes_free((OAES_CTX **) &aes_ctx);
-  free(long_state);
+  scratchpad_free(long_state, long_state_size);
 }
 
 #endif
@@ -16,62 +16,60 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <assert.h>
-#include <exception>
-#include <new>
+#include <sstream>
 
 #include "hash.h"
-
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <sys/mman.h>
-#endif
-
-using std::bad_alloc;
+#include "scratchpad.h"
 
 namespace Crypto {
 
-  enum {
-    MAP_SIZE = SLOW_HASH_CONTEXT_SIZE + ((-SLOW_HASH_CONTEXT_SIZE) & 0xfff)
-  };
-
-#ifdef _WIN32
+  namespace {
 
-  cn_context::cn_context() {
-    data = VirtualAlloc(nullptr, MAP_SIZE, MEM_COMMIT, PAGE_READWRITE);
-    if (data == nullptr) {
-      throw std::bad_alloc();
+    const char* pagesName(scratchpad_pages pages) {
+      switch (pages) {
+      case SCRATCHPAD_HUGE_PAGES: return "huge pages";
+      case SCRATCHPAD_TRANSPARENT_PAGES: return "transparent huge pages";
+      default: return "normal pages";
+      }
     }
-  }
 
-  cn_context::~cn_context() {
-    if (!VirtualFree(data, 0, MEM_RELEASE)) {
-      assert(false);
+    std::string formatSize(uint64_t bytes) {
+      std::ostringstream ss;
+      ss << (bytes + (1 << 19)) / (1 << 20) << " MiB";
+      return ss.str();
     }
+
   }
 
-#else
+  std::string scratchpad_report() {
+    scratchpad_stats_t stats;
+    scratchpad_get_stats(&stats);
 
-  cn_context::cn_context() {
-#if !defined(__APPLE__) && !defined(__FreeBSD__)
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
-#else
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
-#endif
-    if (data == MAP_FAILED) {
-      throw bad_alloc();
+    std::ostringstream ss;
+    for (int i = 0; i < SCRATCHPAD_PAGE_KINDS; ++i) {
+      ss << (i == 0 ? "" : ", ") << stats.count[i] << " on " << pagesName(static_cast<scratchpad_pages>(i))
+         << " (" << formatSize(stats.bytes[i]) << ")";
     }
-    mlock(data, MAP_SIZE);
+
+    ss << ", " << stats.numa_local << " bound to the local NUMA node";
+    return ss.str();
   }
 
-  cn_context::~cn_context() {
-    if (munmap(data, MAP_SIZE) != 0) {
-      assert(false);
-      std::terminate();
+  std::string thread_scratchpad_report() {
+    scratchpad_pages pages;
+    size_t size;
+    int node;
+    if (!scratchpad_thread_info(&pages, &size, &node)) {
+      return "none allocated";
     }
-  }
 
-#endif
+    std::ostringstream ss;
+    ss << formatSize(size) << " on " << pagesName(pages);
+    if (node >= 0) {
+      ss << ", NUMA node " << node;
+    }
+
+    return ss.str();
+  }
 
 }
@@ -28,6 +28,31 @@
 
 #include "hash-ops.h"
 
+enum {
+  TREE_HASH_BATCH = 64
+};
+
+// hashes count consecutive pairs of hashes into count hashes; a whole batch is
+// read before it is written, so hashes may point into pairs for in-place levels
+static void tree_hash_pairs(const char *pairs, size_t count, char *hashes) {
+  const void *data[TREE_HASH_BATCH];
+  size_t lengths[TREE_HASH_BATCH];
+  char batch[TREE_HASH_BATCH][HASH_SIZE];
+  size_t i, n;
+  while (count > 0) {
+    n = count < TREE_HASH_BATCH ? count : TREE_HASH_BATCH;
+    for (i = 0; i < n; ++i) {
+      data[i] = pairs + 2 * i * HASH_SIZE;
+      lengths[i] = 2 * HASH_SIZE;
+    }
+    cn_fast_hash_multi(data, lengths, n, batch[0]);
+    memcpy(hashes, batch, n * HASH_SIZE);
+    pairs += 2 * n * HASH_SIZE;
+    hashes += n * HASH_SIZE;
+    count -= n;
+  }
+}
+
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
   assert(count > 0);
   if (count == 1) {
@@ -44,15 +69,13 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
     char *ints = calloc(cnt, HASH_SIZE);
     assert(ints);
     memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
-    for (i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j) {
-      cn_fast_hash(hashes[i], 2 * HASH_SIZE, ints + j * HASH_SIZE);
-    }
-    assert(i == count);
+    i = 2 * cnt - count;
+    j = 2 * cnt - count;
+    tree_hash_pairs(hashes[i], cnt - j, ints + j * HASH_SIZE);
+    assert(i + 2 * (cnt - j) == count);
     while (cnt > 2) {
       cnt >>= 1;
-      for (i = 0, j = 0; j < cnt; i += 2, ++j) {
-        cn_fast_hash(ints + i * HASH_SIZE, 2 * HASH_SIZE, ints + j * HASH_SIZE);
-      }
+      tree_hash_pairs(ints, cnt, ints);
     }
     cn_fast_hash(ints, 2 * HASH_SIZE, root_hash);
     free(ints);
@@ -88,18 +111,16 @@ void tree_branch(const char (*hashes)[HASH_SIZE], size_t count, char (*branch)[H
   assert(depth == tree_depth(count));
   ints = alloca((cnt - 1) * HASH_SIZE);
   memcpy(ints, hashes + 1, (2 * cnt - count - 1) * HASH_SIZE);
-  for (i = 2 * cnt - count, j = 2 * cnt - count - 1; j < cnt - 1; i += 2, ++j) {
-    cn_fast_hash(hashes[i], 2 * HASH_SIZE, ints[j]);
-  }
-  assert(i == count);
+  i = 2 * cnt - count;
+  j = 2 * cnt - count - 1;
+  tree_hash_pairs(hashes[i], cnt - 1 - j, ints[j]);
+  assert(i + 2 * (cnt - 1 - j) == count);
   while (depth > 0) {
     assert(cnt == 1ULL << depth);
     cnt >>= 1;
     --depth;
     memcpy(branch[depth], ints[0], HASH_SIZE);
-    for (i = 1, j = 0; j < cnt - 1; i += 2, ++j) {
-      cn_fast_hash(ints[i], 2 * HASH_SIZE, ints[j]);
-    }
+    tree_hash_pairs(ints[1], cnt - 1, ints[0]);
   }
 }
 
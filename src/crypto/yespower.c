@@ -44,6 +44,15 @@
 #define _YESPOWER_OPT_C_PASS_ 1
 #endif
 
+/*
+ * The build notes below are about the instruction sets the compiler targets.
+ * Builds that pick the code at run time (YESPOWER_DISPATCH and the variants it
+ * includes this file from) target several on purpose, so they don't get them.
+ */
+#if !defined(YESPOWER_VARIANT) && !defined(YESPOWER_DISPATCH)
+#define YESPOWER_BUILD_NOTES
+#endif
+
 #if _YESPOWER_OPT_C_PASS_ == 1
 /*
  * AVX and especially XOP speed up Salsa20 a lot, but needlessly result in
@@ -51,6 +60,7 @@
  * no slowdown from the prefixes is generally observed on AMD CPUs supporting
  * XOP, some slowdown is sometimes observed on Intel CPUs with AVX.
  */
+#ifdef YESPOWER_BUILD_NOTES
 #ifdef __XOP__
 #ifdef __GNUC__
 #warning "Note: XOP is enabled.  That's great."
@@ -83,6 +93,7 @@
 #pragma message("Note: building generic code for non-x86.  That's OK.")
 #endif
 #endif
+#endif /* YESPOWER_BUILD_NOTES */
 
 /*
  * The SSE4 code version has fewer instructions than the generic SSE2 version,
@@ -107,6 +118,8 @@
 #include <emmintrin.h>
 #ifdef __XOP__
 #include <x86intrin.h>
+#elif defined(__AVX512VL__)
+#include <immintrin.h>
 #endif
 #elif defined(__SSE__)
 #include <xmmintrin.h>
@@ -122,73 +135,22 @@
 #include "blake256.h"
 
 #include "yespower.h"
+#include "scratchpad.h"
 
-#ifdef __unix__
-#include <sys/mman.h>
-#endif
-
-#define HUGEPAGE_THRESHOLD      (12 * 1024 * 1024)
-
-#ifdef __x86_64__
-#define HUGEPAGE_SIZE           (2 * 1024 * 1024)
-#else
-#undef HUGEPAGE_SIZE
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define YESPOWER_TLS_CLEANUP
 #endif
 
 static void *alloc_region(yespower_region_t *region, size_t size)
 {
-    size_t base_size = size;
-    uint8_t *base, *aligned;
-#ifdef MAP_ANON
-    int flags =
-#ifdef MAP_NOCORE
-        MAP_NOCORE |
-#endif
-        MAP_ANON | MAP_PRIVATE;
-#if defined(MAP_HUGETLB) && defined(HUGEPAGE_SIZE)
-    size_t new_size = size;
-    const size_t hugepage_mask = (size_t)HUGEPAGE_SIZE - 1;
-    if (size >= HUGEPAGE_THRESHOLD && size + hugepage_mask >= size) {
-        flags |= MAP_HUGETLB;
-/*
- * Linux's munmap() fails on MAP_HUGETLB mappings if size is not a multiple of
- * huge page size, so let's round up to huge page size here.
- */
-        new_size = size + hugepage_mask;
-        new_size &= ~hugepage_mask;
-    }
-    base = mmap(NULL, new_size, PROT_READ | PROT_WRITE, flags, -1, 0);
-    if (base != MAP_FAILED) {
-        base_size = new_size;
-    } else if (flags & MAP_HUGETLB) {
-        flags &= ~MAP_HUGETLB;
-        base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
-    }
+    size_t base_size = 0;
+    void *base = scratchpad_alloc(size, &base_size);
 
-#else
-    base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
-#endif
-    if (base == MAP_FAILED)
-        base = NULL;
-    aligned = base;
-#elif defined(HAVE_POSIX_MEMALIGN)
-    if ((errno = posix_memalign((void **)&base, 64, size)) != 0)
-        base = NULL;
-    aligned = base;
-#else
-    base = aligned = NULL;
-    if (size + 63 < size) {
-        errno = ENOMEM;
-    } else if ((base = malloc(size + 63)) != NULL) {
-        aligned = base + 63;
-        aligned -= (uintptr_t)aligned & 63;
-    }
-#endif
-    region->base = base;
-    region->aligned = aligned;
+    region->base = region->aligned = base;
     region->base_size = base ? base_size : 0;
     region->aligned_size = base ? size : 0;
-    return aligned;
+    return base;
 }
 
 static inline void init_region(yespower_region_t *region)
@@ -200,12 +162,8 @@ static inline void init_region(yespower_region_t *region)
 static int free_region(yespower_region_t *region)
 {
     if (region->base) {
-#ifdef MAP_ANON
-        if (munmap(region->base, region->base_size))
+        if (scratchpad_free(region->base, region->base_size))
             return -1;
-#else
-        free(region->base);
-#endif
     }
     init_region(region);
     return 0;
@@ -285,6 +243,9 @@ static inline void salsa20_simd_unshuffle(const salsa20_blk_t *Bin,
 #ifdef __XOP__
 #define ARX(out, in1, in2, s) \
     out = _mm_xor_si128(out, _mm_roti_epi32(_mm_add_epi32(in1, in2), s));
+#elif defined(__AVX512VL__)
+#define ARX(out, in1, in2, s) \
+    out = _mm_xor_si128(out, _mm_rol_epi32(_mm_add_epi32(in1, in2), s));
 #else
 #define ARX(out, in1, in2, s) { \
     __m128i tmp = _mm_add_epi32(in1, in2); \
@@ -636,11 +597,13 @@ static volatile uint64_t Smask2var = Smask2;
 /* 64-bit without AVX.  This relies on out-of-order execution and register
  * renaming.  It may actually be fastest on CPUs with AVX(2) as well - e.g.,
  * it runs great on Haswell. */
+#ifdef YESPOWER_BUILD_NOTES
 #ifdef __GNUC__
 #warning "Note: using x86-64 inline assembly for pwxform.  That's great."
 #else
 #pragma message("Note: using x86-64 inline assembly for pwxform.  That's great.")
 #endif
+#endif
 #undef MAYBE_MEMORY_BARRIER
 #define MAYBE_MEMORY_BARRIER \
     __asm__("" : : : "memory");
@@ -1093,7 +1056,13 @@ static void smix2(uint8_t *B, size_t r, uint32_t N, uint32_t Nloop,
  * The array V must be aligned to a multiple of 64 bytes, and arrays B and XY
  * to a multiple of at least 16 bytes (aligning them to 64 bytes as well saves
  * cache lines, but it might also result in cache bank conflicts).
+ *
+ * yespower() only computes yespower 1.0, so the yescrypt 0.5 smix of the first
+ * pass is not called.
  */
+#if _YESPOWER_OPT_C_PASS_ == 1 && defined(__GNUC__)
+__attribute__((unused))
+#endif
 static void smix(uint8_t *B, size_t r, uint32_t N,
     salsa20_blk_t *V, salsa20_blk_t *XY, pwxform_ctx_t *ctx)
 {
@@ -1132,14 +1101,22 @@ static void smix(uint8_t *B, size_t r, uint32_t N,
 #undef smix
 
 /**
- * yespower(local, src, srclen, params, dst):
+ * yespower_generic(local, src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
  * local is the thread-local data structure, allowing to preserve and reuse a
  * memory allocation across calls, thereby reducing its overhead.
  *
+ * When this file is included by one of the yespower-<isa>.c wrappers, which are
+ * built with wider instruction sets enabled, YESPOWER_VARIANT names the copy of
+ * this function they provide to yespower() below.
+ *
  * Return 0 on success; or -1 on error.
  */
-int yespower(yespower_local_t *local,
+#ifdef YESPOWER_VARIANT
+int YESPOWER_VARIANT(yespower_local_t *local,
+#else
+int yespower_generic(yespower_local_t *local,
+#endif
     const uint8_t *src, size_t srclen,
     const yespower_params_t *params,
     yespower_binary_t *dst)
@@ -1210,6 +1187,51 @@ fail:
     return -1;
 }
 
+#ifndef YESPOWER_VARIANT
+/**
+ * yespower(local, src, srclen, params, dst):
+ * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target",
+ * with the fastest build of the code that the running CPU supports.  Release
+ * binaries are built for a generic target, so the choice is made at run time.
+ * Only rotate instructions (AVX-512VL, XOP) are worth a separate build, the
+ * VEX encoding alone does not speed up pwxform (see the note on AVX above).
+ *
+ * Return 0 on success; or -1 on error.
+ */
+int yespower(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params,
+    yespower_binary_t *dst)
+{
+#ifdef YESPOWER_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vl"))
+        return yespower_avx512(local, src, srclen, params, dst);
+    if (__builtin_cpu_supports("xop"))
+        return yespower_xop(local, src, srclen, params, dst);
+#endif
+    return yespower_generic(local, src, srclen, params, dst);
+}
+
+#ifdef YESPOWER_TLS_CLEANUP
+/*
+ * Scratchpads may sit on huge pages, which are a limited pool, so give them
+ * back when a thread that hashed exits instead of leaking them with its TLS.
+ */
+static pthread_key_t tls_key;
+static pthread_once_t tls_key_once = PTHREAD_ONCE_INIT;
+
+static void tls_free(void *local)
+{
+    free_region((yespower_local_t *)local);
+}
+
+static void tls_key_init(void)
+{
+    pthread_key_create(&tls_key, tls_free);
+}
+#endif
+
 /**
  * yespower_tls(src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
@@ -1230,6 +1252,10 @@ int yespower_tls(const uint8_t *src, size_t srclen,
 
     if (!initialized) {
         init_region(&local);
+#ifdef YESPOWER_TLS_CLEANUP
+        pthread_once(&tls_key_once, tls_key_init);
+        pthread_setspecific(tls_key, &local);
+#endif
         initialized = 1;
     }
 
@@ -1246,4 +1272,5 @@ int yespower_free_local(yespower_local_t *local)
 {
     return free_region(local);
 }
+#endif /* !YESPOWER_VARIANT */
 #endif
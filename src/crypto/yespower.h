@@ -107,6 +107,27 @@ extern int yespower(yespower_local_t *local,
     const uint8_t *src, size_t srclen,
     const yespower_params_t *params, yespower_binary_t *dst);
 
+/**
+ * yespower_generic(local, src, srclen, params, dst):
+ * yespower_avx512(local, src, srclen, params, dst):
+ * yespower_xop(local, src, srclen, params, dst):
+ * The builds yespower() chooses from, callable directly to test each of them.
+ * yespower_generic() is built for the configured target.  The other two exist
+ * with YESPOWER_DISPATCH only and must only be called on CPUs that support
+ * AVX-512VL or XOP respectively.
+ */
+extern int yespower_generic(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params, yespower_binary_t *dst);
+#ifdef YESPOWER_DISPATCH
+extern int yespower_avx512(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params, yespower_binary_t *dst);
+extern int yespower_xop(yespower_local_t *local,
+    const uint8_t *src, size_t srclen,
+    const yespower_params_t *params, yespower_binary_t *dst);
+#endif
+
 /**
  * yespower_tls(src, srclen, params, dst):
  * Compute yespower(src[0 .. srclen - 1], N, r), to be checked for "< target".
@@ -150,6 +150,7 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(gen_tx_txout_to_key_has_invalid_key);
     GENERATE_AND_PLAY(gen_tx_output_with_zero_amount);
     GENERATE_AND_PLAY(gen_tx_signatures_are_invalid);
+    GENERATE_AND_PLAY(gen_tx_signatures_rechecked_after_checkpoint_zone);
     GENERATE_AND_PLAY_EX(GenerateTransactionWithZeroFee(false));
     GENERATE_AND_PLAY_EX(GenerateTransactionWithZeroFee(true));
 
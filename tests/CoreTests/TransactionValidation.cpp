@@ -682,6 +682,51 @@ bool gen_tx_signatures_are_invalid::generate(std::vector<test_event_entry>& even
   return true;
 }
 
+gen_tx_signatures_rechecked_after_checkpoint_zone::gen_tx_signatures_rechecked_after_checkpoint_zone()
+{
+  REGISTER_CALLBACK_METHOD(gen_tx_signatures_rechecked_after_checkpoint_zone, enter_checkpoint_zone);
+  REGISTER_CALLBACK_METHOD(gen_tx_signatures_rechecked_after_checkpoint_zone, leave_checkpoint_zone);
+}
+
+bool gen_tx_signatures_rechecked_after_checkpoint_zone::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner_account);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+  MAKE_NEXT_BLOCK(events, blk_1, blk_0, miner_account);
+  REWIND_BLOCKS(events, blk_1r, blk_1, miner_account);
+
+  MAKE_TX(events, tx_0, miner_account, miner_account, MK_COINS(1), blk_1r);
+  events.pop_back();
+
+  // Inputs are not checked in the checkpoint zone, so the pool takes a forged signature
+  tx_0.signatures[0][0] = tx_0.signatures[0][0] == Crypto::Signature() ? Crypto::Signature{ { 1 } } : Crypto::Signature();
+  DO_CALLBACK(events, "enter_checkpoint_zone");
+  events.push_back(tx_0);
+
+  // Once the chain is past the zone the block carrying it has to check the signature again
+  DO_CALLBACK(events, "leave_checkpoint_zone");
+  DO_CALLBACK(events, "mark_invalid_block");
+  MAKE_NEXT_BLOCK_TX1(events, blk_2, blk_1r, miner_account, tx_0);
+
+  return true;
+}
+
+bool gen_tx_signatures_rechecked_after_checkpoint_zone::enter_checkpoint_zone(MevaCoin::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  Checkpoints checkpoints(m_logger);
+  checkpoints.add_checkpoint(1000, "0000000000000000000000000000000000000000000000000000000000000000");
+  c.set_checkpoints(std::move(checkpoints));
+  return true;
+}
+
+bool gen_tx_signatures_rechecked_after_checkpoint_zone::leave_checkpoint_zone(MevaCoin::core& c, size_t /*ev_index*/, const std::vector<test_event_entry>& /*events*/)
+{
+  c.set_checkpoints(Checkpoints(m_logger));
+  return true;
+}
+
 GenerateTransactionWithZeroFee::GenerateTransactionWithZeroFee(bool keptByBlock) : m_keptByBlock(keptByBlock) {
 }
 
@@ -141,6 +141,16 @@ struct gen_tx_signatures_are_invalid : public get_tx_validation_base
   bool generate(std::vector<test_event_entry>& events) const;
 };
 
+struct gen_tx_signatures_rechecked_after_checkpoint_zone : public get_tx_validation_base
+{
+  gen_tx_signatures_rechecked_after_checkpoint_zone();
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+  bool enter_checkpoint_zone(MevaCoin::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool leave_checkpoint_zone(MevaCoin::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+};
+
 struct GenerateTransactionWithZeroFee : public get_tx_validation_base
 {
   explicit GenerateTransactionWithZeroFee(bool keptByBlock);
@@ -30,6 +30,27 @@ using namespace MevaCoin;
 #define CHECK_AND_ASSERT_MES(expr, fail_ret_val, message)   do{if(!(expr)) {std::cerr << message << std::endl; return fail_ret_val;};}while(0)
 #endif
 
+namespace {
+
+// the miner searches through its blockchain handler, the generator hashes blocks itself
+bool findNonce(Crypto::cn_context& context, Block& blk, const difficulty_type& diffic) {
+  for (uint32_t nonce = 0; nonce < std::numeric_limits<uint32_t>::max(); ++nonce) {
+    blk.nonce = nonce;
+    Crypto::Hash hash;
+    if (!get_block_longhash(context, blk, hash)) {
+      return false;
+    }
+
+    if (check_hash(hash, diffic)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}
+
 
 void test_generator::getBlockchain(std::vector<BlockInfo>& blockchain, const Crypto::Hash& head, size_t n) const {
   Crypto::Hash curr = head;
@@ -74,7 +95,8 @@ void test_generator::addBlock(const MevaCoin::Block& blk, size_t tsxSize, uint64
   const size_t blockSize = tsxSize + getObjectBinarySize(blk.baseTransaction);
   int64_t emissionChange;
   uint64_t blockReward;
-  m_currency.getBlockReward(blk.majorVersion, Common::medianValue(blockSizes), blockSize, alreadyGeneratedCoins, fee, blockReward, emissionChange);
+  uint32_t height = boost::get<BaseInput>(blk.baseTransaction.inputs.front()).blockIndex;
+  m_currency.getBlockReward(blk.majorVersion, height, Common::medianValue(blockSizes), blockSize, alreadyGeneratedCoins, fee, blockReward, emissionChange);
   m_blocksInfo[get_block_hash(blk)] = BlockInfo(blk.previousBlockHash, alreadyGeneratedCoins + emissionChange, blockSize);
 }
 
@@ -106,8 +128,9 @@ bool test_generator::constructBlock(MevaCoin::Block& blk, uint32_t height, const
   blk.baseTransaction = boost::value_initialized<Transaction>();
   size_t targetBlockSize = txsSize + getObjectBinarySize(blk.baseTransaction);
   while (true) {
+    Crypto::SecretKey txKey;
     if (!m_currency.constructMinerTx(blk.majorVersion, height, Common::medianValue(blockSizes), alreadyGeneratedCoins, targetBlockSize,
-      totalFee, minerAcc.getAccountKeys().address, blk.baseTransaction, BinaryArray(), 10)) {
+      totalFee, minerAcc.getAccountKeys().address, blk.baseTransaction, txKey, BinaryArray(), 10)) {
       return false;
     }
 
@@ -160,7 +183,7 @@ bool test_generator::constructBlock(MevaCoin::Block& blk, uint32_t height, const
   // Nonce search...
   blk.nonce = 0;
   Crypto::cn_context context;
-  while (!miner::find_nonce_for_given_block(context, blk, getTestDifficulty())) {
+  while (!findNonce(context, blk, getTestDifficulty())) {
     blk.timestamp++;
   }
 
@@ -215,8 +238,9 @@ bool test_generator::constructBlockManually(Block& blk, const Block& prevBlock,
     blk.baseTransaction = boost::value_initialized<Transaction>();
     size_t currentBlockSize = txsSizes + getObjectBinarySize(blk.baseTransaction);
     // TODO: This will work, until size of constructed block is less then m_currency.blockGrantedFullRewardZone()
+    Crypto::SecretKey txKey;
     if (!m_currency.constructMinerTx(blk.majorVersion, height, Common::medianValue(blockSizes), alreadyGeneratedCoins, currentBlockSize, 0,
-        minerAcc.getAccountKeys().address, blk.baseTransaction, BinaryArray(), 1)) {
+        minerAcc.getAccountKeys().address, blk.baseTransaction, txKey, BinaryArray(), 1)) {
       return false;
     }
   }
@@ -293,7 +317,7 @@ bool test_generator::constructMaxSizeBlock(MevaCoin::Block& blk, const MevaCoin:
 void fillNonce(MevaCoin::Block& blk, const difficulty_type& diffic) {
   blk.nonce = 0;
   Crypto::cn_context context;
-  while (!miner::find_nonce_for_given_block(context, blk, diffic)) {
+  while (!findNonce(context, blk, diffic)) {
     blk.timestamp++;
   }
 }
@@ -314,7 +338,7 @@ bool constructMinerTxManually(const MevaCoin::Currency& currency, uint8_t blockM
   // This will work, until size of constructed block is less then currency.blockGrantedFullRewardZone()
   int64_t emissionChange;
   uint64_t blockReward;
-  if (!currency.getBlockReward(blockMajorVersion, 0, 0, alreadyGeneratedCoins, fee, blockReward, emissionChange)) {
+  if (!currency.getBlockReward(blockMajorVersion, height, 0, 0, alreadyGeneratedCoins, fee, blockReward, emissionChange)) {
     std::cerr << "Block is too big" << std::endl;
     return false;
   }
@@ -338,8 +362,9 @@ bool constructMinerTxManually(const MevaCoin::Currency& currency, uint8_t blockM
 bool constructMinerTxBySize(const MevaCoin::Currency& currency, MevaCoin::Transaction& baseTransaction, uint8_t blockMajorVersion, uint32_t height,
                             uint64_t alreadyGeneratedCoins, const MevaCoin::AccountPublicAddress& minerAddress,
                             std::vector<size_t>& blockSizes, size_t targetTxSize, size_t targetBlockSize, uint64_t fee/* = 0*/) {
+  Crypto::SecretKey txKey;
   if (!currency.constructMinerTx(blockMajorVersion, height, Common::medianValue(blockSizes), alreadyGeneratedCoins, targetBlockSize,
-      fee, minerAddress, baseTransaction, MevaCoin::BinaryArray(), 1)) {
+      fee, minerAddress, baseTransaction, txKey, MevaCoin::BinaryArray(), 1)) {
     return false;
   }
 
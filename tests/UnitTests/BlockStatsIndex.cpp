@@ -0,0 +1,116 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "MevaCoinCore/BlockStatsIndex.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+// height h: difficulty 100 + h, reward 10 * (h + 1), h transactions
+BlockStatsIndex makeIndex(uint32_t count) {
+  BlockStatsIndex index;
+  uint64_t cumulativeDifficulty = 0;
+  uint64_t generatedCoins = 0;
+  for (uint32_t h = 0; h < count; ++h) {
+    cumulativeDifficulty += 100 + h;
+    generatedCoins += 10 * (h + 1);
+    index.push(1000 + h * 60, 200 + h, cumulativeDifficulty, generatedCoins, h);
+  }
+
+  return index;
+}
+
+}
+
+TEST(BlockStatsIndex, getDerivesPerBlockValues) {
+  BlockStatsIndex index = makeIndex(10);
+  ASSERT_EQ(10, index.size());
+
+  BlockStats stats;
+  ASSERT_TRUE(index.get(0, stats));
+  ASSERT_EQ(100, stats.difficulty);
+  ASSERT_EQ(10, stats.reward);
+
+  ASSERT_TRUE(index.get(7, stats));
+  ASSERT_EQ(1000 + 7 * 60, stats.timestamp);
+  ASSERT_EQ(207, stats.blockSize);
+  ASSERT_EQ(107, stats.difficulty);
+  ASSERT_EQ(80, stats.reward);
+  ASSERT_EQ(7, stats.transactionsCount);
+
+  ASSERT_FALSE(index.get(10, stats));
+
+  index.pop();
+  ASSERT_FALSE(index.get(9, stats));
+}
+
+TEST(BlockStatsIndex, getRangesDownsamples) {
+  BlockStatsIndex index = makeIndex(100);
+
+  auto ranges = index.getRanges(10, 49, 4);
+  ASSERT_EQ(4, ranges.size());
+  ASSERT_EQ(10, ranges[0].startHeight);
+  ASSERT_EQ(19, ranges[0].endHeight);
+  ASSERT_EQ(40, ranges[3].startHeight);
+  ASSERT_EQ(49, ranges[3].endHeight);
+
+  ASSERT_EQ(110, ranges[0].difficulty.min);
+  ASSERT_EQ(119, ranges[0].difficulty.max);
+  ASSERT_EQ(114, ranges[0].difficulty.avg);
+  ASSERT_EQ(10, ranges[0].transactionsCount.min);
+  ASSERT_EQ(19, ranges[0].transactionsCount.max);
+  ASSERT_EQ(1000 + 10 * 60, ranges[0].startTimestamp);
+  ASSERT_EQ(1000 + 19 * 60, ranges[0].endTimestamp);
+
+  // more buckets than heights gives one bucket per height
+  ranges = index.getRanges(0, 2, 10);
+  ASSERT_EQ(3, ranges.size());
+  ASSERT_EQ(ranges[1].startHeight, ranges[1].endHeight);
+
+  ASSERT_TRUE(index.getRanges(50, 100, 10).empty());
+  ASSERT_TRUE(index.getRanges(5, 4, 10).empty());
+}
+
+TEST(BlockStatsIndex, serialization) {
+  BlockStatsIndex index = makeIndex(50);
+
+  std::vector<uint8_t> data;
+  Common::VectorOutputStream output(data);
+  BinaryOutputStreamSerializer out(output);
+  index.serialize(out);
+
+  BlockStatsIndex loaded;
+  Common::MemoryInputStream input(data.data(), data.size());
+  BinaryInputStreamSerializer in(input);
+  loaded.serialize(in);
+
+  ASSERT_EQ(index.size(), loaded.size());
+  BlockStats expected;
+  BlockStats actual;
+  ASSERT_TRUE(index.get(33, expected));
+  ASSERT_TRUE(loaded.get(33, actual));
+  ASSERT_EQ(expected.difficulty, actual.difficulty);
+  ASSERT_EQ(expected.reward, actual.reward);
+  ASSERT_EQ(expected.timestamp, actual.timestamp);
+}
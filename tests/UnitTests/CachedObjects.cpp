@@ -0,0 +1,77 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "MevaCoinCore/CachedBlock.h"
+#include "MevaCoinCore/CachedTransaction.h"
+#include "MevaCoinCore/Currency.h"
+#include "MevaCoinCore/MevaCoinFormatUtils.h"
+#include "MevaCoinCore/MevaCoinTools.h"
+#include "Logging/ConsoleLogger.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+class CachedObjectsTest : public ::testing::Test {
+public:
+  CachedObjectsTest() : m_currency(CurrencyBuilder(m_logger).currency()) {
+  }
+
+protected:
+  Logging::ConsoleLogger m_logger;
+  Currency m_currency;
+};
+
+}
+
+TEST_F(CachedObjectsTest, transactionMatchesSerialization) {
+  const Transaction& transaction = m_currency.genesisBlock().baseTransaction;
+  CachedTransaction cachedTransaction(transaction);
+
+  ASSERT_EQ(getObjectHash(transaction), cachedTransaction.getTransactionHash());
+  ASSERT_EQ(getObjectHash(static_cast<const TransactionPrefix&>(transaction)), cachedTransaction.getTransactionPrefixHash());
+  ASSERT_EQ(toBinaryArray(transaction), cachedTransaction.getTransactionBinaryArray());
+  ASSERT_EQ(getObjectBinarySize(transaction), cachedTransaction.getTransactionBinarySize());
+}
+
+TEST_F(CachedObjectsTest, transactionKeepsGivenHashAndSize) {
+  Crypto::Hash hash = Crypto::cn_fast_hash("hash", 4);
+  CachedTransaction cachedTransaction(Transaction(m_currency.genesisBlock().baseTransaction), hash, 12345);
+
+  ASSERT_EQ(hash, cachedTransaction.getTransactionHash());
+  ASSERT_EQ(12345u, cachedTransaction.getTransactionBinarySize());
+}
+
+TEST_F(CachedObjectsTest, blockMatchesFormatUtils) {
+  Block block = m_currency.genesisBlock();
+  for (uint8_t version : { BLOCK_MAJOR_VERSION_1, BLOCK_MAJOR_VERSION_4, BLOCK_MAJOR_VERSION_5 }) {
+    block.majorVersion = version;
+    block.transactionHashes.push_back(Crypto::cn_fast_hash(&version, sizeof(version)));
+    CachedBlock cachedBlock(block);
+
+    BinaryArray hashingBlob;
+    ASSERT_TRUE(get_block_hashing_blob(block, hashingBlob));
+    ASSERT_EQ(hashingBlob, cachedBlock.getBlockHashingBinaryArray());
+    ASSERT_EQ(get_block_hash(block), cachedBlock.getBlockHash());
+    ASSERT_EQ(get_tx_tree_hash(block), cachedBlock.getTransactionTreeHash());
+    ASSERT_EQ(getObjectHash(block.baseTransaction), cachedBlock.getBaseTransactionHash());
+  }
+}
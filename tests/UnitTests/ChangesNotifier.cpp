@@ -0,0 +1,84 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <future>
+
+#include "Rpc/ChangesNotifier.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+void waitForWaiters(const ChangesNotifier& notifier, size_t count) {
+  while (notifier.waiters() != count) {
+    std::this_thread::yield();
+  }
+}
+
+}
+
+TEST(ChangesNotifier, returnsAtOnceIfChangedSinceRevisionWasTaken) {
+  ChangesNotifier notifier(1);
+  uint64_t revision = notifier.revision();
+  notifier.notify();
+
+  ASSERT_EQ(ChangesNotifier::WaitResult::Changed, notifier.waitForChange(revision, std::chrono::seconds(10)));
+}
+
+TEST(ChangesNotifier, timesOutWithoutChanges) {
+  ChangesNotifier notifier(1);
+  ASSERT_EQ(ChangesNotifier::WaitResult::TimedOut, notifier.waitForChange(notifier.revision(), std::chrono::milliseconds(10)));
+  ASSERT_EQ(0, notifier.waiters());
+}
+
+TEST(ChangesNotifier, notifyWakesWaiter) {
+  ChangesNotifier notifier(1);
+  uint64_t revision = notifier.revision();
+  auto result = std::async(std::launch::async, [&] { return notifier.waitForChange(revision, std::chrono::seconds(30)); });
+
+  waitForWaiters(notifier, 1);
+  notifier.notify();
+
+  ASSERT_EQ(ChangesNotifier::WaitResult::Changed, result.get());
+}
+
+TEST(ChangesNotifier, refusesWaitersOverLimit) {
+  ChangesNotifier notifier(1);
+  uint64_t revision = notifier.revision();
+  auto result = std::async(std::launch::async, [&] { return notifier.waitForChange(revision, std::chrono::seconds(30)); });
+
+  waitForWaiters(notifier, 1);
+  ASSERT_EQ(ChangesNotifier::WaitResult::Busy, notifier.waitForChange(revision, std::chrono::seconds(30)));
+
+  notifier.notify();
+  ASSERT_EQ(ChangesNotifier::WaitResult::Changed, result.get());
+}
+
+TEST(ChangesNotifier, stopReleasesWaiters) {
+  ChangesNotifier notifier(2);
+  uint64_t revision = notifier.revision();
+  auto result = std::async(std::launch::async, [&] { return notifier.waitForChange(revision, std::chrono::seconds(30)); });
+
+  waitForWaiters(notifier, 1);
+  notifier.stop();
+
+  ASSERT_EQ(ChangesNotifier::WaitResult::Stopped, result.get());
+  ASSERT_EQ(ChangesNotifier::WaitResult::Stopped, notifier.waitForChange(notifier.revision(), std::chrono::seconds(30)));
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "crypto/crypto.h"
+
+TEST(ConsecutiveKeys, matchSingleKeyGeneration) {
+  const size_t count = 50;
+  Crypto::PublicKey firstPublicKey;
+  Crypto::SecretKey firstSecretKey;
+  Crypto::generate_keys(firstPublicKey, firstSecretKey);
+
+  std::vector<Crypto::SecretKey> secretKeys(count);
+  std::vector<Crypto::PublicKey> publicKeys(count);
+  ASSERT_TRUE(Crypto::generate_consecutive_keys(firstSecretKey, count, secretKeys.data(), publicKeys.data()));
+  ASSERT_EQ(firstSecretKey, secretKeys[0]);
+  ASSERT_EQ(firstPublicKey, publicKeys[0]);
+
+  for (size_t i = 1; i < count; ++i) {
+    Crypto::SecretKey expectedSecretKey = secretKeys[i - 1];
+    ++expectedSecretKey.data[0];
+    Crypto::PublicKey expectedPublicKey;
+    ASSERT_TRUE(Crypto::secret_key_to_public_key(secretKeys[i], expectedPublicKey));
+    ASSERT_EQ(expectedPublicKey, publicKeys[i]) << "key " << i;
+    if (secretKeys[i - 1].data[0] != 0xff) {
+      ASSERT_EQ(expectedSecretKey, secretKeys[i]) << "key " << i;
+    }
+  }
+}
+
+TEST(ConsecutiveKeys, rejectInvalidSecretKey) {
+  Crypto::SecretKey invalid;
+  std::fill(std::begin(invalid.data), std::end(invalid.data), 0xff);
+  Crypto::SecretKey secretKey;
+  Crypto::PublicKey publicKey;
+  ASSERT_FALSE(Crypto::generate_consecutive_keys(invalid, 1, &secretKey, &publicKey));
+}
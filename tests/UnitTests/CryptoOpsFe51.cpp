@@ -0,0 +1,203 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "crypto/crypto-ops.h"
+#include "crypto/random.h"
+#include "CryptoOpsRef10.h"
+
+#if defined(CRYPTO_OPS_FE51)
+
+namespace {
+
+typedef std::array<unsigned char, 32> Bytes;
+
+Bytes randomBytes() {
+  Bytes bytes;
+  Random::randomBytes(bytes.size(), bytes.data());
+  return bytes;
+}
+
+Bytes randomScalar() {
+  Bytes scalar = randomBytes();
+  sc_reduce32(scalar.data());
+  return scalar;
+}
+
+// p - 1 + delta, little endian, delta may push it to or past p and up to 2^255 - 1
+Bytes nearP(int delta) {
+  Bytes bytes;
+  bytes.fill(0xff);
+  bytes[31] = 0x7f;
+  bytes[0] = static_cast<unsigned char>(0xec + delta);
+  return bytes;
+}
+
+// field elements where reduction and carries matter: 0, 1, p - 1, p, p + 1, 2^255 - 1, and the same with bit 255 set
+std::vector<Bytes> edgeFieldElements() {
+  std::vector<Bytes> values;
+  Bytes zero = {};
+  Bytes one = {};
+  one[0] = 1;
+  values.push_back(zero);
+  values.push_back(one);
+  values.push_back(nearP(0));
+  values.push_back(nearP(1));
+  values.push_back(nearP(2));
+  values.push_back(nearP(19));
+
+  size_t count = values.size();
+  for (size_t i = 0; i < count; ++i) {
+    Bytes high = values[i];
+    high[31] |= 0x80;
+    values.push_back(high);
+  }
+
+  return values;
+}
+
+int decompress(unsigned char *out, const unsigned char *point) {
+  ge_p3 p;
+  int result = ge_frombytes_vartime(&p, point);
+  if (result == 0) {
+    ge_p3_tobytes(out, &p);
+  }
+
+  return result;
+}
+
+void hashToPoint(unsigned char *out, const unsigned char *fieldElement) {
+  ge_p2 p;
+  ge_fromfe_frombytes_vartime(&p, fieldElement);
+  ge_tobytes(out, &p);
+}
+
+void scalarmultBase(unsigned char *out, const unsigned char *scalar) {
+  ge_p3 p;
+  ge_scalarmult_base(&p, scalar);
+  ge_p3_tobytes(out, &p);
+}
+
+int scalarmult(unsigned char *out, const unsigned char *scalar, const unsigned char *point) {
+  ge_p3 p;
+  ge_p2 r;
+  int result = ge_frombytes_vartime(&p, point);
+  if (result == 0) {
+    ge_scalarmult(&r, scalar, &p);
+    ge_tobytes(out, &r);
+  }
+
+  return result;
+}
+
+int doubleScalarmultBase(unsigned char *out, const unsigned char *a, const unsigned char *point, const unsigned char *b) {
+  ge_p3 p;
+  ge_p2 r;
+  int result = ge_frombytes_vartime(&p, point);
+  if (result == 0) {
+    ge_double_scalarmult_base_vartime(&r, a, &p, b);
+    ge_tobytes(out, &r);
+  }
+
+  return result;
+}
+
+void expectDecompressMatches(const Bytes& input) {
+  Bytes fe51 = {};
+  Bytes ref10 = {};
+  int fe51Result = decompress(fe51.data(), input.data());
+  ASSERT_EQ(ref10_decompress(ref10.data(), input.data()), fe51Result);
+  ASSERT_EQ(0, memcmp(fe51.data(), ref10.data(), fe51.size()));
+}
+
+void expectHashToPointMatches(const Bytes& input) {
+  Bytes fe51;
+  Bytes ref10;
+  hashToPoint(fe51.data(), input.data());
+  ref10_hash_to_point(ref10.data(), input.data());
+  ASSERT_EQ(0, memcmp(fe51.data(), ref10.data(), fe51.size()));
+}
+
+}
+
+TEST(CryptoOpsFe51, decompressMatchesRef10OnEdgeCases) {
+  for (const Bytes& value : edgeFieldElements()) {
+    expectDecompressMatches(value);
+  }
+}
+
+TEST(CryptoOpsFe51, nonCanonicalEncodingsAreRejected) {
+  Bytes fe51;
+  Bytes ref10;
+  for (int delta = 1; delta <= 19; ++delta) {
+    ASSERT_NE(0, decompress(fe51.data(), nearP(delta).data())) << delta;
+    ASSERT_NE(0, ref10_decompress(ref10.data(), nearP(delta).data())) << delta;
+  }
+}
+
+TEST(CryptoOpsFe51, decompressMatchesRef10OnRandomInputs) {
+  for (size_t i = 0; i < 2000; ++i) {
+    expectDecompressMatches(randomBytes());
+  }
+}
+
+TEST(CryptoOpsFe51, hashToPointMatchesRef10) {
+  for (const Bytes& value : edgeFieldElements()) {
+    expectHashToPointMatches(value);
+  }
+
+  for (size_t i = 0; i < 2000; ++i) {
+    expectHashToPointMatches(randomBytes());
+  }
+}
+
+TEST(CryptoOpsFe51, scalarMultiplicationsMatchRef10) {
+  Bytes zero = {};
+  for (size_t i = 0; i < 200; ++i) {
+    Bytes a = i == 0 ? zero : randomScalar();
+    Bytes b = randomScalar();
+
+    Bytes fe51Base;
+    Bytes ref10Base;
+    scalarmultBase(fe51Base.data(), a.data());
+    ref10_scalarmult_base(ref10Base.data(), a.data());
+    ASSERT_EQ(0, memcmp(fe51Base.data(), ref10Base.data(), fe51Base.size())) << i;
+
+    Bytes point;
+    scalarmultBase(point.data(), b.data());
+
+    Bytes fe51Point;
+    Bytes ref10Point;
+    ASSERT_EQ(0, scalarmult(fe51Point.data(), a.data(), point.data()));
+    ASSERT_EQ(0, ref10_scalarmult(ref10Point.data(), a.data(), point.data()));
+    ASSERT_EQ(0, memcmp(fe51Point.data(), ref10Point.data(), fe51Point.size())) << i;
+
+    Bytes fe51Double;
+    Bytes ref10Double;
+    ASSERT_EQ(0, doubleScalarmultBase(fe51Double.data(), a.data(), point.data(), b.data()));
+    ASSERT_EQ(0, ref10_double_scalarmult_base(ref10Double.data(), a.data(), point.data(), b.data()));
+    ASSERT_EQ(0, memcmp(fe51Double.data(), ref10Double.data(), fe51Double.size())) << i;
+  }
+}
+
+#endif
@@ -0,0 +1,112 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#define CRYPTO_OPS_FE32
+
+/* keep the symbols apart from the ones of the Crypto library */
+#define ge_add ref10_ge_add
+#define ge_double_scalarmult_base_precomp_vartime ref10_ge_double_scalarmult_base_precomp_vartime
+#define ge_double_scalarmult_base_vartime ref10_ge_double_scalarmult_base_vartime
+#define ge_double_scalarmult_precomp_vartime ref10_ge_double_scalarmult_precomp_vartime
+#define ge_double_scalarmult_precomp_vartime2 ref10_ge_double_scalarmult_precomp_vartime2
+#define ge_dsm_precomp ref10_ge_dsm_precomp
+#define ge_frombytes_vartime ref10_ge_frombytes_vartime
+#define ge_fromfe_frombytes_vartime ref10_ge_fromfe_frombytes_vartime
+#define ge_mul8 ref10_ge_mul8
+#define ge_p1p1_to_p2 ref10_ge_p1p1_to_p2
+#define ge_p1p1_to_p3 ref10_ge_p1p1_to_p3
+#define ge_p2_dbl ref10_ge_p2_dbl
+#define ge_p3_to_cached ref10_ge_p3_to_cached
+#define ge_p3_to_p2 ref10_ge_p3_to_p2
+#define ge_p3_tobytes ref10_ge_p3_tobytes
+#define ge_scalarmult ref10_ge_scalarmult
+#define ge_scalarmult_base ref10_ge_scalarmult_base
+#define ge_sub ref10_ge_sub
+#define ge_tobytes ref10_ge_tobytes
+#define ge_tobytes_batch ref10_ge_tobytes_batch
+#define sc_0 ref10_sc_0
+#define sc_add ref10_sc_add
+#define sc_check ref10_sc_check
+#define sc_isnonzero ref10_sc_isnonzero
+#define sc_mul ref10_sc_mul
+#define sc_mulsub ref10_sc_mulsub
+#define sc_reduce ref10_sc_reduce
+#define sc_reduce32 ref10_sc_reduce32
+#define sc_sub ref10_sc_sub
+#define ge_base ref10_ge_base
+#define ge_Bi ref10_ge_Bi
+#define fe_d ref10_fe_d
+#define fe_d2 ref10_fe_d2
+#define fe_sqrtm1 ref10_fe_sqrtm1
+#define fe_ma ref10_fe_ma
+#define fe_ma2 ref10_fe_ma2
+#define fe_fffb1 ref10_fe_fffb1
+#define fe_fffb2 ref10_fe_fffb2
+#define fe_fffb3 ref10_fe_fffb3
+#define fe_fffb4 ref10_fe_fffb4
+
+#include "crypto/crypto-ops.c"
+#include "crypto/crypto-ops-data.c"
+
+#include "CryptoOpsRef10.h"
+
+int ref10_decompress(unsigned char *out, const unsigned char *point) {
+  ge_p3 p;
+  int result = ge_frombytes_vartime(&p, point);
+  if (result == 0) {
+    ge_p3_tobytes(out, &p);
+  }
+
+  return result;
+}
+
+void ref10_hash_to_point(unsigned char *out, const unsigned char *fieldElement) {
+  ge_p2 p;
+  ge_fromfe_frombytes_vartime(&p, fieldElement);
+  ge_tobytes(out, &p);
+}
+
+void ref10_scalarmult_base(unsigned char *out, const unsigned char *scalar) {
+  ge_p3 p;
+  ge_scalarmult_base(&p, scalar);
+  ge_p3_tobytes(out, &p);
+}
+
+int ref10_scalarmult(unsigned char *out, const unsigned char *scalar, const unsigned char *point) {
+  ge_p3 p;
+  ge_p2 r;
+  int result = ge_frombytes_vartime(&p, point);
+  if (result == 0) {
+    ge_scalarmult(&r, scalar, &p);
+    ge_tobytes(out, &r);
+  }
+
+  return result;
+}
+
+int ref10_double_scalarmult_base(unsigned char *out, const unsigned char *a, const unsigned char *point, const unsigned char *b) {
+  ge_p3 p;
+  ge_p2 r;
+  int result = ge_frombytes_vartime(&p, point);
+  if (result == 0) {
+    ge_double_scalarmult_base_vartime(&r, a, &p, b);
+    ge_tobytes(out, &r);
+  }
+
+  return result;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* crypto-ops built with ref10's ten-limb field elements, for comparing the radix 2^51
+   build against. Points and scalars are passed encoded, the functions that decode a
+   point return the result of ge_frombytes_vartime. */
+
+int ref10_decompress(unsigned char *out, const unsigned char *point);
+void ref10_hash_to_point(unsigned char *out, const unsigned char *fieldElement);
+void ref10_scalarmult_base(unsigned char *out, const unsigned char *scalar);
+int ref10_scalarmult(unsigned char *out, const unsigned char *scalar, const unsigned char *point);
+int ref10_double_scalarmult_base(unsigned char *out, const unsigned char *a, const unsigned char *point, const unsigned char *b);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,103 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+#include "Wallet/DecoyReservoir.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+const size_t REQUESTED_COUNT = 2;
+
+// random outputs as the daemon picks them, not in index order
+DecoyReservoir::OutsForAmount makeOuts(uint64_t amount, uint64_t firstIndex, size_t count) {
+  DecoyReservoir::OutsForAmount outs;
+  outs.amount = amount;
+  for (size_t i = 0; i < count; ++i) {
+    DecoyReservoir::OutEntry entry;
+    entry.global_amount_index = firstIndex + count - 1 - i;
+    outs.outs.push_back(entry);
+  }
+
+  return outs;
+}
+
+}
+
+TEST(DecoyReservoir, handsOutEachOutputOnce) {
+  DecoyReservoir reservoir(10);
+  reservoir.add({ makeOuts(100, 0, 5), makeOuts(200, 0, 2) }, REQUESTED_COUNT, 1, reservoir.generation());
+
+  DecoyReservoir::OutsForAmount first;
+  first.amount = 100;
+  ASSERT_EQ(3, reservoir.take(3, 1, first));
+  ASSERT_EQ(2, reservoir.available(100, 1));
+
+  DecoyReservoir::OutsForAmount second;
+  second.amount = 100;
+  ASSERT_EQ(2, reservoir.take(3, 1, second));
+  for (const auto& out : second.outs) {
+    ASSERT_TRUE(std::none_of(first.outs.begin(), first.outs.end(), [&out](const DecoyReservoir::OutEntry& used) { return used.global_amount_index == out.global_amount_index; }));
+  }
+
+  ASSERT_EQ(2, reservoir.available(200, 1));
+}
+
+TEST(DecoyReservoir, skipsDuplicatesWithinRing) {
+  DecoyReservoir reservoir(10);
+  reservoir.add({ makeOuts(100, 0, 3), makeOuts(100, 2, 3) }, REQUESTED_COUNT, 1, reservoir.generation());
+
+  DecoyReservoir::OutsForAmount outs;
+  outs.amount = 100;
+  ASSERT_EQ(5, reservoir.take(6, 1, outs));
+  ASSERT_EQ(1, reservoir.available(100, 1));
+}
+
+TEST(DecoyReservoir, dropsExpiredAndClearedOutputs) {
+  DecoyReservoir reservoir(10);
+  reservoir.add({ makeOuts(100, 0, 2) }, REQUESTED_COUNT, 1, reservoir.generation());
+  reservoir.add({ makeOuts(100, 10, 2) }, REQUESTED_COUNT, 5, reservoir.generation());
+  ASSERT_EQ(2, reservoir.available(100, 12));
+
+  uint64_t generation = reservoir.generation();
+  reservoir.clear();
+  reservoir.add({ makeOuts(100, 0, 2) }, REQUESTED_COUNT, 12, generation);
+  ASSERT_EQ(0, reservoir.available(100, 12));
+
+  ASSERT_TRUE(reservoir.beginRefill(100));
+  ASSERT_FALSE(reservoir.beginRefill(100));
+  reservoir.endRefill(100);
+  ASSERT_TRUE(reservoir.beginRefill(100));
+}
+
+TEST(DecoyReservoir, keepsNoOutputsOfScarceAmounts) {
+  DecoyReservoir::OutsForAmount ordered = makeOuts(200, 0, 3);
+  std::reverse(ordered.outs.begin(), ordered.outs.end());
+  ASSERT_TRUE(DecoyReservoir::hasAllOutputs(ordered, REQUESTED_COUNT));
+  ASSERT_TRUE(DecoyReservoir::hasAllOutputs(makeOuts(300, 0, 1), REQUESTED_COUNT));
+  ASSERT_FALSE(DecoyReservoir::hasAllOutputs(makeOuts(100, 0, 3), REQUESTED_COUNT));
+
+  DecoyReservoir reservoir(10);
+  reservoir.add({ makeOuts(100, 0, 3), ordered, makeOuts(300, 0, 1) }, REQUESTED_COUNT, 1, reservoir.generation());
+  ASSERT_EQ(3, reservoir.available(100, 1));
+  ASSERT_EQ(0, reservoir.available(200, 1));
+  ASSERT_EQ(0, reservoir.available(300, 1));
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "MevaCoinCore/MevaCoinTools.h"
+#include "crypto/hash.h"
+
+using namespace MevaCoin;
+
+TEST(FastHashMulti, matchesSingleHashes) {
+  std::vector<BinaryArray> blobs;
+  for (size_t size = 0; size < 700; size += 7) {
+    BinaryArray blob(size);
+    for (size_t i = 0; i < size; ++i) {
+      blob[i] = static_cast<uint8_t>(i * 31 + size);
+    }
+
+    blobs.push_back(blob);
+  }
+
+  std::vector<Crypto::Hash> hashes;
+  getBinaryArrayHashes(blobs, hashes);
+  ASSERT_EQ(blobs.size(), hashes.size());
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    ASSERT_EQ(getBinaryArrayHash(blobs[i]), hashes[i]) << "blob " << i;
+  }
+}
+
+TEST(FastHashMulti, treeHashMatchesPairwiseHashing) {
+  std::vector<Crypto::Hash> leaves(5);
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    leaves[i] = Crypto::cn_fast_hash(&i, sizeof(i));
+  }
+
+  auto pair = [](const Crypto::Hash& a, const Crypto::Hash& b) {
+    Crypto::Hash both[2] = { a, b };
+    return Crypto::cn_fast_hash(both, sizeof(both));
+  };
+
+  // five leaves: the last two are paired first, then a full tree of four
+  Crypto::Hash expected = pair(pair(leaves[0], leaves[1]), pair(leaves[2], pair(leaves[3], leaves[4])));
+  Crypto::Hash root;
+  Crypto::tree_hash(leaves.data(), leaves.size(), root);
+  ASSERT_EQ(expected, root);
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "HTTP/HttpCompression.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+std::string makePayload() {
+  std::string payload;
+  for (int i = 0; i < 1000; ++i) {
+    payload += "{\"height\":" + std::to_string(i) + ",\"hash\":\"0123456789abcdef\"},";
+  }
+
+  return payload;
+}
+
+}
+
+TEST(HttpCompression, selectsPreferredEncoding) {
+  if (!isHttpCompressionSupported()) {
+    ASSERT_EQ(HttpContentEncoding::Identity, selectContentEncoding("gzip, deflate"));
+    return;
+  }
+
+  ASSERT_EQ(HttpContentEncoding::Identity, selectContentEncoding(""));
+  ASSERT_EQ(HttpContentEncoding::Identity, selectContentEncoding("br"));
+  ASSERT_EQ(HttpContentEncoding::Gzip, selectContentEncoding("gzip, deflate"));
+  ASSERT_EQ(HttpContentEncoding::Deflate, selectContentEncoding("deflate"));
+  ASSERT_EQ(HttpContentEncoding::Deflate, selectContentEncoding("gzip;q=0.5, deflate"));
+  ASSERT_EQ(HttpContentEncoding::Identity, selectContentEncoding("gzip;q=0, deflate;q=0"));
+  ASSERT_EQ(HttpContentEncoding::Gzip, selectContentEncoding("*"));
+}
+
+TEST(HttpCompression, parsesContentEncoding) {
+  HttpContentEncoding encoding;
+  ASSERT_TRUE(parseContentEncoding("", encoding));
+  ASSERT_EQ(HttpContentEncoding::Identity, encoding);
+  ASSERT_FALSE(parseContentEncoding("br", encoding));
+
+  if (isHttpCompressionSupported()) {
+    ASSERT_TRUE(parseContentEncoding(" GZIP ", encoding));
+    ASSERT_EQ(HttpContentEncoding::Gzip, encoding);
+  }
+}
+
+TEST(HttpCompression, roundTrip) {
+  if (!isHttpCompressionSupported()) {
+    return;
+  }
+
+  std::string payload = makePayload();
+  for (auto encoding : { HttpContentEncoding::Gzip, HttpContentEncoding::Deflate }) {
+    std::string compressed;
+    ASSERT_TRUE(compressHttpContent(payload, encoding, compressed));
+    ASSERT_LT(compressed.size(), payload.size());
+
+    std::string decompressed;
+    ASSERT_TRUE(decompressHttpContent(compressed, encoding, decompressed, payload.size()));
+    ASSERT_EQ(payload, decompressed);
+
+    ASSERT_FALSE(decompressHttpContent(compressed, encoding, decompressed, payload.size() - 1));
+    ASSERT_FALSE(decompressHttpContent(compressed.substr(0, compressed.size() / 2), encoding, decompressed, payload.size()));
+  }
+}
@@ -22,6 +22,7 @@
 #include "Wallet/WalletErrors.h"
 
 #include <functional>
+#include <future>
 #include <thread>
 #include <iterator>
 #include <cassert>
@@ -131,6 +132,25 @@ void INodeTrivialRefreshStub::doGetNewBlocks(std::vector<Crypto::Hash> knownBloc
   callback(std::error_code());
 }
 
+void INodeDummyStub::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.resize(transactionHashes.size());
+
+  for (size_t i = 0; i < transactionHashes.size(); ++i) {
+    std::promise<std::error_code> promise;
+    std::future<std::error_code> future = promise.get_future();
+    getTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices[i], [&promise](std::error_code ec) { promise.set_value(ec); });
+
+    std::error_code ec = future.get();
+    if (ec) {
+      callback(ec);
+      return;
+    }
+  }
+
+  callback(std::error_code());
+}
+
 void INodeTrivialRefreshStub::getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback)
 {
   m_asyncCounter.addAsyncContext();
@@ -45,12 +45,31 @@ public:
   virtual uint64_t getLastLocalBlockTimestamp() const override { return 0; }
   virtual MevaCoin::BlockHeaderInfo getLastLocalBlockHeaderInfo() const override { return MevaCoin::BlockHeaderInfo(); }
   virtual uint64_t getMinimalFee() const override { return 0; };
+  virtual uint64_t getNextDifficulty() const override { return 0; };
+  virtual uint64_t getNextReward() const override { return 0; };
+  virtual uint64_t getAlreadyGeneratedCoins() const override { return 0; };
+  virtual uint32_t getNodeHeight() const override { return 0; };
+  virtual uint64_t getTransactionsCount() const override { return 0; };
+  virtual uint64_t getTransactionsPoolSize() const override { return 0; };
+  virtual uint64_t getAltBlocksCount() const override { return 0; };
+  virtual uint64_t getOutConnectionsCount() const override { return 0; };
+  virtual uint64_t getIncConnectionsCount() const override { return 0; };
+  virtual uint64_t getRpcConnectionsCount() const override { return 0; };
+  virtual uint64_t getWhitePeerlistSize() const override { return 0; };
+  virtual uint64_t getGreyPeerlistSize() const override { return 0; };
+  virtual std::string getNodeVersion() const override { return std::string(); };
+  virtual std::string feeAddress() const override { return std::string(); };
+  virtual uint64_t feeAmount() const override { return 0; };
+  virtual void setRootCert(const std::string& path) override {};
+  virtual void disableVerify() override {};
   
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<MevaCoin::block_complete_entry>& newBlocks, uint32_t& height, const Callback& callback) override { callback(std::error_code()); };
 
   virtual void relayTransaction(const MevaCoin::Transaction& transaction, const Callback& callback) override { callback(std::error_code()); };
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<MevaCoin::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override { callback(std::error_code()); };
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override { callback(std::error_code()); };
+  // resolved through getTransactionOutsGlobalIndices, so stubs overriding it serve both
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& known_pool_tx_ids, Crypto::Hash known_block_id, bool& is_bc_actual,
           std::vector<std::unique_ptr<MevaCoin::ITransactionReader>>& new_txs, std::vector<Crypto::Hash>& deleted_tx_ids, const Callback& callback) override {
     is_bc_actual = true; callback(std::error_code());
@@ -62,9 +81,13 @@ public:
   virtual void getBlocks(const std::vector<Crypto::Hash>& blockHashes, std::vector<MevaCoin::BlockDetails>& blocks, const Callback& callback) override { callback(std::error_code()); };
   virtual void getBlocks(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<MevaCoin::BlockDetails>& blocks, uint32_t& blocksNumberWithinTimestamps, const Callback& callback) override { callback(std::error_code()); };
   virtual void getTransactions(const std::vector<Crypto::Hash>& transactionHashes, std::vector<MevaCoin::TransactionDetails>& transactions, const Callback& callback) override { callback(std::error_code()); };
+  virtual void getBlock(const uint32_t blockHeight, MevaCoin::BlockDetails& block, const Callback& callback) override { callback(std::error_code()); };
+  virtual void getTransaction(const Crypto::Hash& transactionHash, MevaCoin::Transaction& transaction, const Callback& callback) override { callback(std::error_code()); };
   virtual void getTransactionsByPaymentId(const Crypto::Hash& paymentId, std::vector<MevaCoin::TransactionDetails>& transactions, const Callback& callback) override { callback(std::error_code()); };
   virtual void getPoolTransactions(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t transactionsNumberLimit, std::vector<MevaCoin::TransactionDetails>& transactions, uint64_t& transactionsNumberWithinTimestamps, const Callback& callback) override { callback(std::error_code()); };
+  virtual void getBlockTimestamp(uint32_t height, uint64_t& timestamp, const Callback& callback) override { callback(std::error_code()); };
   virtual void isSynchronized(bool& syncStatus, const Callback& callback) override { callback(std::error_code()); };
+  virtual void getConnections(std::vector<MevaCoin::p2pConnection>& connections, const Callback& callback) override { callback(std::error_code()); };
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MevaCoin::MultisignatureOutput& out, const Callback& callback) override { callback(std::error_code()); }
 
   void updateObservers();
@@ -0,0 +1,99 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "Rpc/PaymentScanner.h"
+#include "MevaCoinCore/Account.h"
+#include "MevaCoinCore/TransactionExtra.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+void addOutput(Transaction& tx, const Crypto::SecretKey& txSecretKey, const AccountPublicAddress& address, uint64_t amount) {
+  Crypto::KeyDerivation derivation;
+  ASSERT_TRUE(Crypto::generate_key_derivation(address.viewPublicKey, txSecretKey, derivation));
+
+  KeyOutput target;
+  ASSERT_TRUE(Crypto::derive_public_key(derivation, tx.outputs.size(), address.spendPublicKey, target.key));
+
+  TransactionOutput output;
+  output.amount = amount;
+  output.target = target;
+  tx.outputs.push_back(output);
+}
+
+}
+
+TEST(PaymentScanner, findsOwnOutputs) {
+  AccountBase merchant;
+  merchant.generate();
+  AccountBase other;
+  other.generate();
+
+  KeyPair txKeys = generateKeyPair();
+  Transaction tx;
+  addTransactionPublicKeyToExtra(tx.extra, txKeys.publicKey);
+  addOutput(tx, txKeys.secretKey, merchant.getAccountKeys().address, 100);
+  addOutput(tx, txKeys.secretKey, other.getAccountKeys().address, 50);
+  addOutput(tx, txKeys.secretKey, merchant.getAccountKeys().address, 20);
+
+  PaymentScanner scanner(2, 16);
+
+  std::vector<PaymentScanJob> jobs;
+  for (int i = 0; i < 20; ++i) {
+    const AccountKeys& keys = (i % 2 == 0 ? merchant : other).getAccountKeys();
+    PaymentScanJob job;
+    job.transaction = &tx;
+    job.viewSecretKey = keys.viewSecretKey;
+    job.spendPublicKey = keys.address.spendPublicKey;
+    jobs.push_back(job);
+  }
+
+  scanner.scan(jobs);
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    ASSERT_FALSE(jobs[i].derivationFailed);
+    ASSERT_EQ(i % 2 == 0 ? 120 : 50, jobs[i].received);
+  }
+
+  // wrong spend key with the right view key finds nothing
+  jobs.resize(1);
+  jobs[0].spendPublicKey = other.getAccountKeys().address.spendPublicKey;
+  scanner.scan(jobs);
+  ASSERT_EQ(0, jobs[0].received);
+}
+
+TEST(PaymentScanner, scansInlineWithoutThreads) {
+  AccountBase merchant;
+  merchant.generate();
+
+  KeyPair txKeys = generateKeyPair();
+  Transaction tx;
+  addTransactionPublicKeyToExtra(tx.extra, txKeys.publicKey);
+  addOutput(tx, txKeys.secretKey, merchant.getAccountKeys().address, 7);
+
+  PaymentScanner scanner(0, 0);
+
+  std::vector<PaymentScanJob> jobs(1);
+  jobs[0].transaction = &tx;
+  jobs[0].viewSecretKey = merchant.getAccountKeys().viewSecretKey;
+  jobs[0].spendPublicKey = merchant.getAccountKeys().address.spendPublicKey;
+
+  scanner.scan(jobs);
+  ASSERT_EQ(7, jobs[0].received);
+}
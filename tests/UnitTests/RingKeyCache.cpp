@@ -0,0 +1,85 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+#include "MevaCoinCore/RingKeyCache.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+Crypto::PublicKey newKey() {
+  Crypto::PublicKey pub;
+  Crypto::SecretKey sec;
+  Crypto::generate_keys(pub, sec);
+  return pub;
+}
+
+}
+
+TEST(RingKeyCache, returnsPreparedKeyAndReusesIt) {
+  RingKeyCache cache(64);
+  Crypto::PublicKey key = newKey();
+
+  auto first = cache.get(key);
+  ASSERT_NE(nullptr, first);
+
+  Crypto::RingKey expected;
+  ASSERT_TRUE(Crypto::prepare_ring_key(key, expected));
+  ASSERT_EQ(0, memcmp(&expected, first.get(), sizeof(expected)));
+
+  ASSERT_EQ(first, cache.get(key));
+  ASSERT_EQ(1, cache.size());
+}
+
+TEST(RingKeyCache, doesNotCacheInvalidKeys) {
+  RingKeyCache cache(64);
+  Crypto::PublicKey key;
+  memset(&key, 0xff, sizeof(key));
+
+  ASSERT_EQ(nullptr, cache.get(key));
+  ASSERT_EQ(0, cache.size());
+}
+
+TEST(RingKeyCache, evictsLeastRecentlyUsedKeys) {
+  // 16 shards of one entry each
+  RingKeyCache cache(16);
+  Crypto::PublicKey hot = newKey();
+  auto hotEntry = cache.get(hot);
+
+  for (size_t i = 0; i < 200; ++i) {
+    Crypto::PublicKey cold = newKey();
+    if (cold.data[0] % 16 != hot.data[0] % 16) {
+      ASSERT_NE(nullptr, cache.get(cold));
+    }
+  }
+
+  ASSERT_EQ(hotEntry, cache.get(hot));
+  ASSERT_LE(cache.size(), 16);
+
+  Crypto::PublicKey sameShard;
+  do {
+    sameShard = newKey();
+  } while (sameShard.data[0] % 16 != hot.data[0] % 16);
+
+  cache.get(sameShard);
+  ASSERT_NE(hotEntry, cache.get(hot));
+}
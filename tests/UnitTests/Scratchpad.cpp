@@ -0,0 +1,84 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <thread>
+
+#include "crypto/hash.h"
+#include "crypto/scratchpad.h"
+
+TEST(Scratchpad, allocatesUsableMemory) {
+  scratchpad_stats_t before;
+  scratchpad_get_stats(&before);
+
+  const size_t size = 3 * 1024 * 1024 + 123;
+  size_t mappedSize = 0;
+  uint8_t* pad = static_cast<uint8_t*>(scratchpad_alloc(size, &mappedSize));
+  ASSERT_NE(nullptr, pad);
+  ASSERT_GE(mappedSize, size);
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(pad) % 64);
+
+  memset(pad, 0x5a, size);
+  ASSERT_EQ(0x5a, pad[0]);
+  ASSERT_EQ(0x5a, pad[size - 1]);
+
+  scratchpad_pages pages;
+  size_t threadSize = 0;
+  int node = -2;
+  ASSERT_EQ(1, scratchpad_thread_info(&pages, &threadSize, &node));
+  ASSERT_EQ(mappedSize, threadSize);
+  ASSERT_GE(node, -1);
+
+  scratchpad_stats_t after;
+  scratchpad_get_stats(&after);
+  ASSERT_EQ(before.count[pages] + 1, after.count[pages]);
+  ASSERT_EQ(before.bytes[pages] + mappedSize, after.bytes[pages]);
+
+  ASSERT_EQ(0, scratchpad_free(pad, mappedSize));
+}
+
+TEST(Scratchpad, threadInfoIsPerThread) {
+  int allocated = -1;
+  std::thread([&allocated] {
+    scratchpad_pages pages;
+    size_t size;
+    int node;
+    allocated = scratchpad_thread_info(&pages, &size, &node);
+  }).join();
+
+  ASSERT_EQ(0, allocated);
+}
+
+TEST(Scratchpad, slowHashIsUnchangedAcrossThreads) {
+  const char message[] = "scratchpad";
+  Crypto::Hash seed = {};
+  Crypto::Hash first;
+  Crypto::Hash second;
+  ASSERT_TRUE(Crypto::y_slow_hash(message, sizeof(message), seed, first));
+
+  bool result = false;
+  std::thread([&] {
+    result = Crypto::y_slow_hash_prepare() && Crypto::y_slow_hash(message, sizeof(message), seed, second);
+  }).join();
+
+  ASSERT_TRUE(result);
+  ASSERT_EQ(0, memcmp(&first, &second, sizeof(first)));
+  ASSERT_NE("none allocated", Crypto::thread_scratchpad_report());
+}
@@ -134,3 +134,84 @@ TEST(KVSerialize, BigCollection) {
   ASSERT_TRUE(MevaCoin::loadFromBinaryKeyValue(ts2, buf));
   EXPECT_EQ(ts1, ts2);
 }
+
+namespace {
+
+struct WideSection {
+  std::vector<uint32_t> values;
+
+  void serialize(ISerializer& s) {
+    for (size_t i = 0; i < values.size(); ++i) {
+      s(values[i], "v" + std::to_string(i));
+    }
+  }
+};
+
+}
+
+TEST(KVSerialize, SectionWithManyFields) {
+  WideSection ws1;
+  for (uint32_t i = 0; i < 300; ++i) {
+    ws1.values.push_back(i * 7);
+  }
+
+  WideSection ws2;
+  ws2.values.resize(ws1.values.size());
+
+  std::string buf = MevaCoin::storeToBinaryKeyValue(ws1);
+  ASSERT_TRUE(MevaCoin::loadFromBinaryKeyValue(ws2, buf));
+  EXPECT_EQ(ws1.values, ws2.values);
+}
+
+TEST(KVSerialize, OutOfOrderRead) {
+  TestStruct ts1;
+  ts1.u8 = 7;
+  ts1.u32 = 77;
+  ts1.u64 = 777;
+  ts1.root.name = "root";
+
+  std::string buf = MevaCoin::storeToBinaryKeyValue(ts1);
+
+  KVBinaryInputStreamSerializer s(buf.data(), buf.size());
+  uint64_t u64 = 0;
+  uint8_t u8 = 0;
+  uint64_t u32 = 0;
+  ASSERT_TRUE(s(u64, "u64"));
+  ASSERT_TRUE(s(u8, "u8"));
+  ASSERT_TRUE(s(u32, "u32"));
+  EXPECT_EQ(ts1.u64, u64);
+  EXPECT_EQ(ts1.u8, u8);
+  EXPECT_EQ(ts1.u32, u32);
+  EXPECT_FALSE(s(u64, "missing"));
+}
+
+TEST(KVSerialize, BinaryViewPointsIntoBuffer) {
+  TestElement element;
+  element.name = "view";
+  element.nonce = 1;
+  for (size_t i = 0; i < element.blob.size(); ++i) {
+    element.blob[i] = static_cast<uint8_t>(i);
+  }
+
+  std::string buf = MevaCoin::storeToBinaryKeyValue(element);
+
+  KVBinaryInputStreamSerializer s(buf.data(), buf.size());
+  Common::StringView view;
+  ASSERT_TRUE(s.binaryView(view, "blob"));
+  ASSERT_EQ(element.blob.size(), view.getSize());
+  EXPECT_GE(view.getData(), buf.data());
+  EXPECT_LE(view.getData() + view.getSize(), buf.data() + buf.size());
+  EXPECT_EQ(0, memcmp(element.blob.data(), view.getData(), view.getSize()));
+}
+
+TEST(KVSerialize, TruncatedInputIsRejected) {
+  TestStruct ts1;
+  ts1.root.name = "hello";
+  ts1.vec1.resize(16);
+
+  std::string buf = MevaCoin::storeToBinaryKeyValue(ts1);
+
+  TestStruct ts2;
+  EXPECT_FALSE(MevaCoin::loadFromBinaryKeyValue(ts2, buf.substr(0, buf.size() - 1)));
+  EXPECT_FALSE(MevaCoin::loadFromBinaryKeyValue(ts2, buf.substr(0, buf.size() / 2)));
+}
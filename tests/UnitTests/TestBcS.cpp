@@ -21,6 +21,7 @@
 #include "Transfers/TransfersConsumer.h"
 
 #include "crypto/hash.h"
+#include "crypto/random.h"
 #include "MevaCoinCore/TransactionApi.h"
 #include "MevaCoinCore/MevaCoinFormatUtils.h"
 #include "MevaCoinCore/MevaCoinTools.h"
@@ -30,6 +31,9 @@
 #include "TestBlockchainGenerator.h"
 #include "EventWaiter.h"
 
+#include <future>
+#include <thread>
+
 using namespace Crypto;
 using namespace MevaCoin;
 
@@ -41,6 +45,12 @@ Transaction createTx(ITransactionReader& tx) {
 
   return outTx;
 }
+
+Hash generateHash() {
+  Hash hash;
+  Random::randomBytes(sizeof(hash.data), hash.data);
+  return hash;
+}
 }
 
 class INodeNonTrivialRefreshStub : public INodeTrivialRefreshStub {
@@ -143,13 +153,12 @@ public:
     m_blockchain.resize(height);
   }
 
-  virtual bool onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) override {
+  virtual uint32_t onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) override {
     //assert(m_blockchain.size() == startHeight);
-    while (count--) {
-      m_blockchain.push_back(blocks->blockHash);
-      ++blocks;
+    for (uint32_t i = 0; i < count; ++i) {
+      m_blockchain.push_back(blocks[i].blockHash);
     }
-    return true;
+    return count;
   }
 
   const std::vector<Hash>& getBlockchain() const {
@@ -217,13 +226,14 @@ public:
     }
   }
 
-  void startSync() {
+  std::error_code startSync() {
     syncCompleted = std::promise<std::error_code>();
     syncCompletedFuture = syncCompleted.get_future();
     m_sync.addObserver(this);
     m_sync.start();
-    syncCompletedFuture.get();
+    std::error_code result = syncCompletedFuture.get();
     m_sync.removeObserver(this);
+    return result;
   }
 
   void refreshSync() {
@@ -325,6 +335,52 @@ TEST_F(BcSTest, getConsumerStateStartStop) {
   EXPECT_NE(nullptr, m_sync.getConsumerState(&c));
 }
 
+TEST_F(BcSTest, runBetweenStepsStoppedThrow) {
+  addConsumers();
+  ASSERT_ANY_THROW(m_sync.runBetweenSteps([] {}));
+}
+
+TEST_F(BcSTest, runBetweenStepsRightAfterStart) {
+  addConsumers();
+  m_sync.start();
+
+  bool taskRun = false;
+  auto future = m_sync.runBetweenSteps([&taskRun] { taskRun = true; });
+
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+  ASSERT_NO_THROW(future.get());
+  EXPECT_TRUE(taskRun);
+  m_sync.stop();
+}
+
+TEST_F(BcSTest, runBetweenStepsGetsConsumerStateWithoutStop) {
+  addConsumers();
+  generator.generateEmptyBlocks(10);
+  ASSERT_FALSE(startSync());
+
+  IStreamSerializable* state = nullptr;
+  auto future = m_sync.runBetweenSteps([this, &state] {
+    state = m_sync.getConsumerState(m_consumers.front().get());
+  });
+
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+  ASSERT_NO_THROW(future.get());
+  EXPECT_NE(nullptr, state);
+  ASSERT_ANY_THROW(m_sync.getConsumerState(m_consumers.front().get()));
+  m_sync.stop();
+}
+
+TEST_F(BcSTest, runBetweenStepsPassesTaskError) {
+  addConsumers();
+  ASSERT_FALSE(startSync());
+
+  auto future = m_sync.runBetweenSteps([] { throw std::runtime_error("task error"); });
+
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+  ASSERT_THROW(future.get(), std::runtime_error);
+  m_sync.stop();
+}
+
 TEST_F(BcSTest, startWithoutConsumersThrow) {
   ASSERT_ANY_THROW(m_sync.start());
 }
@@ -624,7 +680,7 @@ TEST_F(BcSTest, firstPoolSynchronizationCheck) {
 
 TEST_F(BcSTest, firstPoolSynchronizationCheckNonActual) {
   addConsumers(2);
-  m_consumers.front()->addPoolTransaction(Crypto::rand<Crypto::Hash>());
+  m_consumers.front()->addPoolTransaction(generateHash());
 
   int requestsCount = 0;
 
@@ -659,7 +715,7 @@ TEST_F(BcSTest, firstPoolSynchronizationCheckNonActual) {
 
 TEST_F(BcSTest, firstPoolSynchronizationCheckGetPoolErr) {
   addConsumers(2);
-  m_consumers.front()->addPoolTransaction(Crypto::rand<Crypto::Hash>());
+  m_consumers.front()->addPoolTransaction(generateHash());
 
   int requestsCount = 0;
 
@@ -987,8 +1043,8 @@ public:
 
   FunctorialBlockhainConsumerStub(const Hash& genesisBlockHash) : ConsumerStub(genesisBlockHash), onBlockchainDetachFunctor([](uint32_t) {}) {}
 
-  virtual bool onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) override {
-    return onNewBlocksFunctor(blocks, startHeight, count);
+  virtual uint32_t onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) override {
+    return onNewBlocksFunctor(blocks, startHeight, count) ? count : 0;
   }
 
   virtual void onBlockchainDetach(uint32_t height) override {
@@ -999,6 +1055,44 @@ public:
   std::function<void(uint32_t)> onBlockchainDetachFunctor;
 };
 
+TEST_F(BcSTest, poolSynchronizationDuringCatchUp) {
+  addConsumers(1);
+  generator.generateEmptyBlocks(1100);
+  m_node.setGetNewBlocksLimit(100);
+
+  ASSERT_FALSE(startSync());
+  m_sync.stop();
+
+  addConsumers(1);
+  const size_t chainSize = generator.getBlockchain().size();
+
+  std::vector<size_t> laggingHeightsOnPoolSync;
+  m_node.getPoolSymmetricDifferenceFunctor = [&](const std::vector<Hash>&, Hash, bool&, std::vector<std::unique_ptr<ITransactionReader>>&, std::vector<Hash>&, const INode::Callback&) {
+    laggingHeightsOnPoolSync.push_back(m_consumers.back()->getBlockchain().size());
+    return true;
+  };
+
+  IBlockchainSynchronizerFunctorialObserver o1;
+  EventWaiter e;
+  o1.syncFunc = [&](std::error_code ec) {
+    if (!ec && m_consumers.back()->getBlockchain().size() == chainSize) {
+      e.notify();
+    }
+  };
+
+  m_sync.addObserver(&o1);
+  m_sync.start();
+  e.wait();
+  m_sync.stop();
+  m_sync.removeObserver(&o1);
+  o1.syncFunc = [](std::error_code) {};
+
+  checkSyncedBlockchains();
+  // the consumer at the top syncs the pool between catch-up requests
+  ASSERT_LE(2, laggingHeightsOnPoolSync.size());
+  EXPECT_GT(chainSize, laggingHeightsOnPoolSync.front());
+}
+
 TEST_F(BcSTest, checkINodeError) {
   addConsumers(1);
   IBlockchainSynchronizerFunctorialObserver o1;
@@ -1276,17 +1370,17 @@ TEST_F(BcSTest, checkBlocksRerequestingOnError) {
 
   generator.generateEmptyBlocks(20);
   m_node.setGetNewBlocksLimit(10);
-  
-  std::atomic<int> requestsCount(0);
-  std::list<Hash> firstlyKnownBlockIdsTaken;
-  std::list<Hash> secondlyKnownBlockIdsTaken;
+
+  // the next batch is prefetched while the current one is processed, so consumer calls and requests are counted apart
+  size_t consumerCalls = 0;
+  std::vector<std::vector<Hash>> requests;
 
   std::vector<Hash> firstlyReceivedBlocks;
   std::vector<Hash> secondlyReceivedBlocks;
 
-
   c.onNewBlocksFunctor = [&](const CompleteBlock* blocks, uint32_t, size_t count) -> bool {
-    if (requestsCount == 2) {
+    ++consumerCalls;
+    if (consumerCalls == 2) {
       for (size_t i = 0; i < count; ++i) {
         firstlyReceivedBlocks.push_back(blocks[i].blockHash);
       }
@@ -1294,43 +1388,257 @@ TEST_F(BcSTest, checkBlocksRerequestingOnError) {
       return false;
     }
 
-    if (requestsCount == 3) {
+    if (consumerCalls == 3) {
       for (size_t i = 0; i < count; ++i) {
         secondlyReceivedBlocks.push_back(blocks[i].blockHash);
       }
     }
 
-    return true;   
+    return true;
   };
 
   m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const INode::Callback& callback) -> bool {
-    ++requestsCount;
+    requests.push_back(knownBlockIds);
+    return true;
+  };
 
-    if (requestsCount == 2) {
-      firstlyKnownBlockIdsTaken.assign(knownBlockIds.begin(), knownBlockIds.end());
-    }
+  m_sync.addObserver(&o1);
+  m_sync.addConsumer(&c);
+  m_sync.start();
+  e.wait();
+  m_sync.stop();
 
-    if (requestsCount == 3) {
-      secondlyKnownBlockIdsTaken.assign(knownBlockIds.begin(), knownBlockIds.end());
-    }
+  size_t firstRunRequests = requests.size();
+
+  m_sync.start();
+  e.wait();
+  m_sync.stop();
+  m_sync.removeObserver(&o1);
+  o1.syncFunc = [](std::error_code) {};
+
+  // the failed batch was received in reply to the second request
+  ASSERT_LT(firstRunRequests, requests.size());
+  EXPECT_EQ(requests[1].front(), requests[firstRunRequests].front());
+  EXPECT_EQ(firstlyReceivedBlocks, secondlyReceivedBlocks);
+}
+
+TEST_F(BcSTest, prefetchedBlocksContinueProcessedBatch) {
+  addConsumers(1);
+  generator.generateEmptyBlocks(20);
+  m_node.setGetNewBlocksLimit(5);
+
+  // a prefetch is requested before the consumer gets the batch it continues
+  std::vector<std::vector<Hash>> requests;
+  std::vector<bool> prefetches;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t, std::vector<BlockShortEntry>&, uint32_t&, const INode::Callback&) -> bool {
+    const auto& consumerBlockchain = m_consumers.front()->getBlockchain();
+    requests.push_back(knownBlockIds);
+    prefetches.push_back(std::find(consumerBlockchain.begin(), consumerBlockchain.end(), knownBlockIds.front()) == consumerBlockchain.end());
+    return true;
+  };
+
+  ASSERT_FALSE(startSync());
+  m_sync.stop();
+
+  checkSyncedBlockchains();
+
+  // every full batch is followed by a prefetch and every request continues the one before,
+  // the batch reaching the top of the node chain isn't followed by one
+  ASSERT_LE(3, requests.size());
+  for (size_t i = 1; i < requests.size(); ++i) {
+    EXPECT_NE(requests[i - 1].front(), requests[i].front());
+  }
+
+  EXPECT_LT(0, std::count(prefetches.begin(), prefetches.end(), true));
+  EXPECT_FALSE(prefetches.back());
+}
+
+TEST_F(BcSTest, prefetchedBlocksDiscardedOnAnchorMismatch) {
+  FunctorialBlockhainConsumerStub c(m_currency.genesisBlockHash());
+  IBlockchainSynchronizerFunctorialObserver o1;
+  EventWaiter e;
+  std::error_code errc;
+  o1.syncFunc = [&](std::error_code ec) {
+    errc = ec;
+    e.notify();
+  };
+
+  generator.generateEmptyBlocks(20);
 
+  std::vector<std::vector<Hash>> requests;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t, std::vector<BlockShortEntry>&, uint32_t&, const INode::Callback&) -> bool {
+    requests.push_back(knownBlockIds);
     return true;
   };
 
+  std::vector<uint32_t> startHeights;
+  c.onNewBlocksFunctor = [&](const CompleteBlock*, uint32_t startHeight, size_t) -> bool {
+    startHeights.push_back(startHeight);
+    // the first batch fails, so the consumer doesn't end at the prefetch anchor
+    return startHeights.size() > 1;
+  };
+
   m_sync.addObserver(&o1);
   m_sync.addConsumer(&c);
   m_sync.start();
   e.wait();
+  ASSERT_TRUE(errc);
+
+  m_node.sendLocalBlockchainUpdated();
+  e.wait();
+  m_sync.stop();
+  m_sync.removeObserver(&o1);
+  o1.syncFunc = [](std::error_code) {};
+
+  EXPECT_FALSE(errc);
+  ASSERT_LE(3, requests.size());
+  EXPECT_EQ(m_currency.genesisBlockHash(), requests[2].front());
+  ASSERT_LE(2, startHeights.size());
+  EXPECT_EQ(startHeights[0], startHeights[1]);
+}
+
+TEST_F(BcSTest, prefetchedBlocksAfterReorgDetachConsumers) {
+  addConsumers(1);
+  generator.generateEmptyBlocks(20);
+
+  std::vector<std::vector<Hash>> requests;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t, std::vector<BlockShortEntry>&, uint32_t&, const INode::Callback&) -> bool {
+    requests.push_back(knownBlockIds);
+    if (requests.size() == 2) {
+      // the prefetch is answered from the new chain, starting below the anchor
+      m_node.startAlternativeChain(2);
+      generator.generateEmptyBlocks(25);
+    }
+
+    return true;
+  };
+
+  ASSERT_FALSE(startSync());
+  m_sync.stop();
+
+  checkSyncedBlockchains();
+  ASSERT_LE(3, requests.size());
+  EXPECT_EQ(get_block_hash(generator.getBlockchain()[4]), requests[2].front());
+}
+
+TEST_F(BcSTest, prefetchedBlocksDiscardedOnError) {
+  addConsumers(1);
+  generator.generateEmptyBlocks(20);
+
+  std::vector<std::vector<Hash>> requests;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t, std::vector<BlockShortEntry>&, uint32_t&, const INode::Callback& callback) -> bool {
+    requests.push_back(knownBlockIds);
+    if (requests.size() == 2) {
+      callback(std::make_error_code(std::errc::connection_reset));
+      return false;
+    }
+
+    return true;
+  };
+
+  ASSERT_FALSE(startSync());
+  m_sync.stop();
+
+  checkSyncedBlockchains();
+  ASSERT_LE(3, requests.size());
+  EXPECT_EQ(requests[1].front(), requests[2].front());
+}
+
+TEST_F(BcSTest, prefetchedBlocksDiscardedIfOnlyCommonBlockReturned) {
+  addConsumers(1);
+  generator.generateEmptyBlocks(9);
+  m_node.setGetNewBlocksLimit(5);
+
+  std::vector<std::vector<Hash>> requests;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const INode::Callback& callback) -> bool {
+    requests.push_back(knownBlockIds);
+    if (requests.size() == 2) {
+      // the prefetch gets the common block only, as from a node whose chain lags behind its reported height
+      const auto& blockchain = generator.getBlockchain();
+      auto commonIt = std::find_if(blockchain.begin(), blockchain.end(), [&](const Block& b) { return get_block_hash(b) == knownBlockIds.front(); });
+      BlockShortEntry entry;
+      entry.blockHash = knownBlockIds.front();
+      entry.hasBlock = false;
+      newBlocks.push_back(entry);
+      startHeight = static_cast<uint32_t>(std::distance(blockchain.begin(), commonIt));
+      callback(std::error_code());
+      return false;
+    }
+
+    return true;
+  };
+
+  ASSERT_FALSE(startSync());
   m_sync.stop();
 
+  checkSyncedBlockchains();
+  ASSERT_LE(3, requests.size());
+  EXPECT_EQ(requests[1].front(), requests[2].front());
+}
+
+TEST_F(BcSTest, prefetchedBlocksInFlightOutliveStop) {
+  FunctorialBlockhainConsumerStub c(m_currency.genesisBlockHash());
+  IBlockchainSynchronizerFunctorialObserver o1;
+  EventWaiter e;
+  o1.syncFunc = [&](std::error_code ec) {
+    if (!ec) {
+      e.notify();
+    }
+  };
+
+  generator.generateEmptyBlocks(20);
+
+  std::vector<std::vector<Hash>> requests;
+  INode::Callback pendingCallback;
+  std::vector<BlockShortEntry>* pendingBlocks = nullptr;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>& knownBlockIds, uint64_t, std::vector<BlockShortEntry>& newBlocks, uint32_t&, const INode::Callback& callback) -> bool {
+    requests.push_back(knownBlockIds);
+    if (requests.size() == 2) {
+      // keep the prefetch in flight
+      pendingCallback = callback;
+      pendingBlocks = &newBlocks;
+      return false;
+    }
+
+    return true;
+  };
+
+  EventWaiter processing;
+  std::promise<void> resume;
+  std::shared_future<void> resumed = resume.get_future().share();
+  c.onNewBlocksFunctor = [&](const CompleteBlock*, uint32_t, size_t) -> bool {
+    if (requests.size() == 2) {
+      processing.notify();
+      resumed.wait();
+    }
+
+    return true;
+  };
+
+  m_sync.addObserver(&o1);
+  m_sync.addConsumer(&c);
+  m_sync.start();
+  processing.wait();
+
+  auto stopped = std::async(std::launch::async, [this] { m_sync.stop(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  resume.set_value();
+  stopped.get();
+
+  ASSERT_TRUE(static_cast<bool>(pendingCallback));
+  // the dropped request completes into buffers it still owns
+  pendingBlocks->resize(2);
+  pendingCallback(std::error_code());
+  pendingCallback = nullptr;
+
   m_sync.start();
   e.wait();
   m_sync.stop();
   m_sync.removeObserver(&o1);
   o1.syncFunc = [](std::error_code) {};
 
-  EXPECT_EQ(firstlyKnownBlockIdsTaken, secondlyKnownBlockIdsTaken);
-  EXPECT_EQ(firstlyReceivedBlocks, secondlyReceivedBlocks);
+  ASSERT_LE(3, requests.size());
+  EXPECT_EQ(requests[1].front(), requests[2].front());
 }
 
 TEST_F(BcSTest, checkTxOrder) {
@@ -0,0 +1,118 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include "Transfers/OutputsScanner.h"
+#include "MevaCoinCore/TransactionApi.h"
+#include "TransactionApiHelpers.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+// addresses of one wallet share the view key
+AccountKeys generateWalletAddress(const AccountKeys& first) {
+  AccountKeys keys = first;
+  Crypto::generate_keys(keys.address.spendPublicKey, keys.spendSecretKey);
+  return keys;
+}
+
+}
+
+TEST(OutputsScanner, batchedDerivationsMatchSingle) {
+  const size_t count = 17;
+  AccountKeys keys = generateAccountKeys();
+
+  std::vector<Crypto::PublicKey> transactionKeys(count);
+  for (auto& key : transactionKeys) {
+    Crypto::SecretKey secret;
+    Crypto::generate_keys(key, secret);
+  }
+
+  // not a point, has to be reported invalid without breaking the batch
+  transactionKeys[5] = Crypto::PublicKey();
+  while (Crypto::check_key(transactionKeys[5])) {
+    ++transactionKeys[5].data[0];
+  }
+
+  std::vector<Crypto::KeyDerivation> derivations(count);
+  std::unique_ptr<bool[]> valid(new bool[count]);
+  Crypto::generate_key_derivations(transactionKeys.data(), count, keys.viewSecretKey, derivations.data(), valid.get());
+
+  std::vector<size_t> indexes(count);
+  std::vector<Crypto::PublicKey> derivedKeys(count);
+  for (size_t i = 0; i < count; ++i) {
+    Crypto::KeyDerivation expected;
+    ASSERT_EQ(Crypto::generate_key_derivation(transactionKeys[i], keys.viewSecretKey, expected), valid[i]);
+    if (valid[i]) {
+      ASSERT_EQ(expected, derivations[i]);
+      indexes[i] = i;
+      ASSERT_TRUE(Crypto::derive_public_key(derivations[i], i, keys.address.spendPublicKey, derivedKeys[i]));
+    } else {
+      derivedKeys[i] = transactionKeys[i];
+    }
+  }
+
+  std::vector<Crypto::PublicKey> bases(count);
+  Crypto::underive_public_keys(derivations.data(), indexes.data(), derivedKeys.data(), count, bases.data(), valid.get());
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_EQ(i != 5, valid[i]);
+    if (valid[i]) {
+      ASSERT_EQ(keys.address.spendPublicKey, bases[i]);
+    }
+  }
+}
+
+TEST(OutputsScanner, findsOutputsOfAllAddresses) {
+  AccountKeys first = generateAccountKeys();
+  AccountKeys second = generateWalletAddress(first);
+  AccountKeys foreign = generateAccountKeys();
+  std::unordered_set<Crypto::PublicKey> spendKeys = { first.address.spendPublicKey, second.address.spendPublicKey };
+
+  std::vector<std::unique_ptr<ITransaction>> transactions;
+  for (int i = 0; i < 4; ++i) {
+    transactions.push_back(createTransaction());
+  }
+
+  transactions[0]->addOutput(10, first.address);
+  transactions[0]->addOutput(20, foreign.address);
+  transactions[0]->addOutput(30, second.address);
+  transactions[1]->addOutput(40, foreign.address);
+  transactions[2]->addOutput(50, second.address);
+  transactions[2]->addOutput(60, second.address);
+
+  std::vector<const ITransactionReader*> readers;
+  for (const auto& tx : transactions) {
+    readers.push_back(tx.get());
+  }
+
+  std::vector<OwnedOutputs> outputs;
+  findMyOutputs(readers, first.viewSecretKey, spendKeys, outputs);
+  ASSERT_EQ(4, outputs.size());
+
+  ASSERT_EQ(2, outputs[0].size());
+  ASSERT_EQ(std::vector<uint32_t>{ 0 }, outputs[0][first.address.spendPublicKey]);
+  ASSERT_EQ(std::vector<uint32_t>{ 2 }, outputs[0][second.address.spendPublicKey]);
+  ASSERT_TRUE(outputs[1].empty());
+  ASSERT_EQ((std::vector<uint32_t>{ 0, 1 }), outputs[2][second.address.spendPublicKey]);
+  ASSERT_TRUE(outputs[3].empty());
+
+  OwnedOutputs single;
+  findMyOutputs(*transactions[2], first.viewSecretKey, spendKeys, single);
+  ASSERT_EQ(outputs[2], single);
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+
+#include "crypto/crypto.h"
+
+using namespace Crypto;
+
+namespace {
+
+struct Ring {
+  Hash prefixHash;
+  KeyImage image;
+  std::vector<PublicKey> keys;
+  std::vector<Signature> signatures;
+
+  std::vector<const PublicKey*> keyPointers() const {
+    std::vector<const PublicKey*> pointers;
+    for (const auto& key : keys) {
+      pointers.push_back(&key);
+    }
+
+    return pointers;
+  }
+};
+
+Ring makeRing(size_t size, size_t realIndex) {
+  Ring ring;
+  Random::randomBytes(sizeof(ring.prefixHash.data), ring.prefixHash.data);
+  SecretKey realSecret;
+  for (size_t i = 0; i < size; ++i) {
+    PublicKey key;
+    SecretKey secret;
+    generate_keys(key, secret);
+    ring.keys.push_back(key);
+    if (i == realIndex) {
+      realSecret = secret;
+    }
+  }
+
+  generate_key_image(ring.keys[realIndex], realSecret, ring.image);
+  ring.signatures.resize(size);
+  generate_ring_signature(ring.prefixHash, ring.image, ring.keyPointers(), realSecret, realIndex, ring.signatures.data());
+  return ring;
+}
+
+// checks every ring with check_ring_signatures in one batch
+std::vector<bool> checkBatch(const std::vector<Ring>& rings) {
+  std::vector<std::vector<RingKey>> ringKeys(rings.size());
+  std::vector<std::vector<const RingKey*>> keyPointers(rings.size());
+  std::vector<RingSignatureCheck> checks;
+  for (size_t i = 0; i < rings.size(); ++i) {
+    ringKeys[i].resize(rings[i].keys.size());
+    for (size_t j = 0; j < rings[i].keys.size(); ++j) {
+      EXPECT_TRUE(prepare_ring_key(rings[i].keys[j], ringKeys[i][j]));
+      keyPointers[i].push_back(&ringKeys[i][j]);
+    }
+
+    checks.push_back(RingSignatureCheck{ &rings[i].prefixHash, &rings[i].image, keyPointers[i].data(), rings[i].keys.size(), rings[i].signatures.data() });
+  }
+
+  std::unique_ptr<bool[]> results(new bool[checks.size()]);
+  check_ring_signatures(checks.data(), checks.size(), results.get());
+  return std::vector<bool>(results.get(), results.get() + checks.size());
+}
+
+bool checkSingle(const Ring& ring) {
+  return check_ring_signature(ring.prefixHash, ring.image, ring.keyPointers(), ring.signatures.data());
+}
+
+}
+
+TEST(RingSignatures, batchMatchesSingleChecks) {
+  std::vector<Ring> rings;
+  for (size_t size = 1; size <= 12; ++size) {
+    rings.push_back(makeRing(size, size / 2));
+  }
+
+  // tampered rings: other message, other key image, changed scalar, out of range scalar, swapped members
+  rings[1].prefixHash.data[0] ^= 1;
+  rings[3].image = makeRing(1, 0).image;
+  rings[5].signatures[2].c.data[10] ^= 0x40;
+  std::fill(std::begin(rings[7].signatures[0].r.data), std::end(rings[7].signatures[0].r.data), 0xff);
+  std::swap(rings[9].keys[0], rings[9].keys[1]);
+
+  std::vector<bool> batch = checkBatch(rings);
+  ASSERT_EQ(rings.size(), batch.size());
+  for (size_t i = 0; i < rings.size(); ++i) {
+    bool tampered = i == 1 || i == 3 || i == 5 || i == 7 || i == 9;
+    ASSERT_EQ(!tampered, checkSingle(rings[i])) << i;
+    ASSERT_EQ(checkSingle(rings[i]), batch[i]) << i;
+  }
+}
+
+TEST(RingSignatures, invalidKeyImageFailsOnlyItsRing) {
+  std::vector<Ring> rings{ makeRing(3, 0), makeRing(4, 3), makeRing(2, 1) };
+  rings[1].image = KeyImage();
+  while (check_key(reinterpret_cast<const PublicKey&>(rings[1].image))) {
+    ++rings[1].image.data[0];
+  }
+
+  ASSERT_EQ((std::vector<bool>{ true, false, true }), checkBatch(rings));
+  ASSERT_FALSE(checkSingle(rings[1]));
+}
+
+TEST(RingSignatures, prepareRejectsInvalidKey) {
+  PublicKey key = PublicKey();
+  while (check_key(key)) {
+    ++key.data[0];
+  }
+
+  RingKey ringKey;
+  ASSERT_FALSE(prepare_ring_key(key, ringKey));
+}
@@ -430,3 +430,95 @@ TEST_F(TransfersApi, sameTrackingKey) {
   }
 
 }
+
+TEST_F(TransfersApi, catchUpSubscriptionJoinsMainConsumer) {
+  addPaymentAccounts(2);
+  m_transfersSync.addSubscription(createSubscription(0));
+
+  generateMoneyForAccount(1);
+  generator.generateEmptyBlocks(10);
+
+  startSync();
+
+  m_sync.stop();
+  auto& sub = m_transfersSync.addCatchUpSubscription(createSubscription(1));
+  ASSERT_FALSE(m_transfersSync.hasCaughtUpSubscriptions());
+
+  startSync();
+
+  ASSERT_NE(0, sub.getContainer().balance(ITransfersContainer::IncludeAll));
+  ASSERT_TRUE(m_transfersSync.hasCaughtUpSubscriptions());
+
+  m_sync.stop();
+  m_transfersSync.mergeCaughtUpSubscriptions();
+  ASSERT_FALSE(m_transfersSync.hasCaughtUpSubscriptions());
+  ASSERT_EQ(&sub, m_transfersSync.getSubscription(m_accounts[1].address));
+
+  uint64_t balance = sub.getContainer().balance(ITransfersContainer::IncludeAll);
+  generateMoneyForAccount(1);
+  generator.generateEmptyBlocks(1);
+
+  startSync();
+
+  ASSERT_GT(sub.getContainer().balance(ITransfersContainer::IncludeAll), balance);
+}
+
+TEST_F(TransfersApi, catchUpSubscriptionFarBehind) {
+  addPaymentAccounts(2);
+  auto& mainSub = m_transfersSync.addSubscription(createSubscription(0));
+
+  generateMoneyForAccount(1);
+  generator.generateEmptyBlocks(1200);
+
+  startSync();
+
+  m_sync.stop();
+  auto& sub = m_transfersSync.addCatchUpSubscription(createSubscription(1));
+
+  generateMoneyForAccount(0);
+
+  startSync();
+
+  ASSERT_NE(0, sub.getContainer().balance(ITransfersContainer::IncludeAll));
+  ASSERT_NE(0, mainSub.getContainer().balance(ITransfersContainer::IncludeAll));
+  ASSERT_TRUE(m_transfersSync.hasCaughtUpSubscriptions());
+}
+
+TEST_F(TransfersApi, catchUpSubscriptionState) {
+  addPaymentAccounts(2);
+  m_transfersSync.addSubscription(createSubscription(0));
+
+  generateMoneyForAccount(1);
+  generator.generateEmptyBlocks(10);
+
+  startSync();
+
+  m_sync.stop();
+  m_transfersSync.addCatchUpSubscription(createSubscription(1));
+
+  std::stringstream memstm;
+  m_transfersSync.save(memstm);
+
+  BlockchainSynchronizer bsync2(m_node, m_logger, m_currency.genesisBlockHash());
+  TransfersSyncronizer sync2(m_currency, m_logger, bsync2, m_node);
+
+  for (size_t i = 0; i < m_accounts.size(); ++i) {
+    sync2.addSubscription(createSubscription(i));
+  }
+
+  sync2.load(memstm);
+  ASSERT_FALSE(sync2.hasCaughtUpSubscriptions());
+
+  startSync();
+
+  syncCompleted = std::promise<std::error_code>();
+  syncCompletedFuture = syncCompleted.get_future();
+  bsync2.addObserver(this);
+  bsync2.start();
+  syncCompletedFuture.get();
+  bsync2.removeObserver(this);
+
+  ASSERT_TRUE(sync2.hasCaughtUpSubscriptions());
+  ASSERT_NE(0, sync2.getSubscription(m_accounts[1].address)->getContainer().balance(ITransfersContainer::IncludeAll));
+  ASSERT_TRUE(compareStates(m_transfersSync, sync2));
+}
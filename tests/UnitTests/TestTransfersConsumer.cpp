@@ -51,6 +51,12 @@ AccountKeys getAccountKeysWithViewKey(const PublicKey& publicViewKey, const Secr
   return accountKeys;
 }
 
+Hash generateHash() {
+  Hash hash;
+  Random::randomBytes(sizeof(hash.data), hash.data);
+  return hash;
+}
+
 class TransfersConsumerTest : public ::testing::Test {
 public:
   TransfersConsumerTest();
@@ -564,6 +570,71 @@ TEST_F(TransfersConsumerTest, onNewBlocks_getTransactionOutsGlobalIndicesIsPrope
   ASSERT_EQ(expectedHash, node.hash);
 }
 
+TEST_F(TransfersConsumerTest, onNewBlocks_requestsGlobalIndicesOfOwnedTransactionsInBulk) {
+  class INodeBulkGlobalIndicesStub: public INodeDummyStub {
+  public:
+    virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash,
+      std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override {
+      ++singleCalls;
+      callback(std::make_error_code(std::errc::operation_not_supported));
+    };
+
+    virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+      std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override {
+      bulkCalls.push_back(transactionHashes);
+      outsGlobalIndices.clear();
+      for (size_t i = 0; i < transactionHashes.size(); ++i) {
+        outsGlobalIndices.push_back({ static_cast<uint32_t>(10 + i) });
+      }
+      callback(std::error_code());
+    };
+
+    size_t singleCalls = 0;
+    std::vector<std::vector<Crypto::Hash>> bulkCalls;
+  };
+
+  INodeBulkGlobalIndicesStub node;
+  TransfersConsumer consumer(m_currency, node, m_logger, m_accountKeys.viewSecretKey);
+  auto& container = addSubscription(consumer).getContainer();
+
+  // signed, so that every transaction gets its own hash
+  auto buildTransaction = [](uint64_t amount, const AccountKeys& receiver) {
+    TestTransactionBuilder builder;
+    builder.addTestInput(10000);
+    builder.addTestKeyOutput(amount, 0, receiver);
+    return std::shared_ptr<ITransactionReader>(builder.build().release());
+  };
+
+  auto owned1 = buildTransaction(900, m_accountKeys);
+  auto foreign = buildTransaction(800, generateAccountKeys());
+  auto owned2 = buildTransaction(700, m_accountKeys);
+
+  CompleteBlock blocks[2];
+  blocks[0].block = MevaCoin::Block();
+  blocks[0].block->timestamp = 0;
+  blocks[0].transactions.push_back(owned1);
+  blocks[0].transactions.push_back(foreign);
+  blocks[1].block = MevaCoin::Block();
+  blocks[1].block->timestamp = 0;
+  blocks[1].transactions.push_back(owned2);
+
+  ASSERT_TRUE(consumer.onNewBlocks(&blocks[0], 1, 2));
+
+  ASSERT_EQ(0, node.singleCalls);
+  ASSERT_EQ(1, node.bulkCalls.size());
+  ASSERT_EQ(2, node.bulkCalls[0].size());
+  ASSERT_EQ(owned1->getTransactionHash(), node.bulkCalls[0][0]);
+  ASSERT_EQ(owned2->getTransactionHash(), node.bulkCalls[0][1]);
+
+  auto outs1 = container.getTransactionOutputs(owned1->getTransactionHash(), ITransfersContainer::IncludeAll);
+  ASSERT_EQ(1, outs1.size());
+  ASSERT_EQ(10, outs1[0].globalOutputIndex);
+
+  auto outs2 = container.getTransactionOutputs(owned2->getTransactionHash(), ITransfersContainer::IncludeAll);
+  ASSERT_EQ(1, outs2.size());
+  ASSERT_EQ(11, outs2[0].globalOutputIndex);
+}
+
 TEST_F(TransfersConsumerTest, onNewBlocks_getTransactionOutsGlobalIndicesIsNotCalled) {
   class INodeGlobalIndicesStub: public INodeDummyStub {
   public:
@@ -725,7 +796,7 @@ TEST_F(TransfersConsumerTest, onNewBlocks_checkTransactionInformation) {
   std::shared_ptr<ITransaction> tx(createTransaction());
   addTestInput(*tx, 10000);
   addTestKeyOutput(*tx, 1000, 2, m_accountKeys);
-  Hash paymentId = Crypto::rand<Hash>();
+  Hash paymentId = generateHash();
   uint64_t unlockTime = 10;
   tx->setPaymentId(paymentId);
   tx->setUnlockTime(unlockTime);
@@ -880,8 +951,8 @@ TEST_F(TransfersConsumerTest, onPoolUpdated_deleteTransactionNotDeleted) {
   sub.addObserver(&observer);
 
   std::vector<Crypto::Hash> deleted = { 
-    Crypto::rand<Crypto::Hash>(), 
-    Crypto::rand<Crypto::Hash>() 
+    generateHash(),
+    generateHash()
   };
 
   m_consumer.onPoolUpdated({}, deleted);
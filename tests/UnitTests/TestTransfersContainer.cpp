@@ -20,6 +20,7 @@
 #include "IWalletLegacy.h"
 
 #include "crypto/crypto.h"
+#include "crypto/random.h"
 #include "MevaCoinCore/Account.h"
 #include "MevaCoinCore/Currency.h"
 #include "MevaCoinCore/TransactionApi.h"
@@ -532,7 +533,9 @@ class TransfersContainer_deleteUnconfirmedTransaction : public TransfersContaine
 TEST_F(TransfersContainer_deleteUnconfirmedTransaction, tryDeleteNonExistingTx) {
   addTransaction();
   ASSERT_EQ(1, container.transactionsCount());
-  ASSERT_FALSE(container.deleteUnconfirmedTransaction(Crypto::rand<Crypto::Hash>()));
+  Crypto::Hash unknownHash;
+  Random::randomBytes(sizeof(unknownHash.data), unknownHash.data);
+  ASSERT_FALSE(container.deleteUnconfirmedTransaction(unknownHash));
   ASSERT_EQ(1, container.transactionsCount());
 }
 
@@ -603,7 +606,9 @@ TEST_F(TransfersContainer_markTransactionConfirmed, nonExistingTransaction) {
   addTransaction();
   ASSERT_EQ(1, container.transactionsCount());
   ASSERT_EQ(TEST_OUTPUT_AMOUNT, container.balance(ITransfersContainer::IncludeAllLocked));
-  ASSERT_FALSE(markConfirmed(Crypto::rand<Hash>()));
+  Hash unknownHash;
+  Random::randomBytes(sizeof(unknownHash.data), unknownHash.data);
+  ASSERT_FALSE(markConfirmed(unknownHash));
   ASSERT_EQ(1, container.transactionsCount());
   ASSERT_EQ(TEST_OUTPUT_AMOUNT, container.balance(ITransfersContainer::IncludeAllLocked));
 }
@@ -1001,6 +1006,44 @@ TEST_F(TransfersContainer_balance, filtersByStateAndKeySimultaneously) {
   ASSERT_EQ(AMOUNT_1 + AMOUNT_2, container.balance(ITransfersContainer::IncludeStateUnlocked | ITransfersContainer::IncludeTypeKey));
 }
 
+TEST_F(TransfersContainer_balance, matchesOutputsWhileHeightChanges) {
+  auto expectBalanceMatchesOutputs = [this] {
+    for (uint32_t flags : std::vector<uint32_t>{ ITransfersContainer::IncludeAll, ITransfersContainer::IncludeKeyUnlocked, ITransfersContainer::IncludeKeyNotUnlocked,
+      ITransfersContainer::IncludeAllLocked, ITransfersContainer::IncludeTypeAll | ITransfersContainer::IncludeStateSoftLocked }) {
+      std::vector<TransactionOutputInformation> outputs;
+      container.getOutputs(outputs, flags);
+
+      uint64_t amount = 0;
+      for (const auto& output : outputs) {
+        amount += output.amount;
+      }
+
+      EXPECT_EQ(amount, container.balance(flags)) << "flags " << flags;
+    }
+  };
+
+  TestTransactionBuilder lockedTx;
+  lockedTx.setUnlockTime(TEST_BLOCK_HEIGHT + 10);
+  lockedTx.addTestInput(AMOUNT_1 + 1);
+  auto outInfo = lockedTx.addTestKeyOutput(AMOUNT_1, TEST_TRANSACTION_OUTPUT_GLOBAL_INDEX, account);
+  ASSERT_TRUE(container.addTransaction(blockInfo(TEST_BLOCK_HEIGHT), *lockedTx.build(), { outInfo }));
+
+  auto tx = addTransaction(TEST_BLOCK_HEIGHT + 1, AMOUNT_2);
+  addTransaction(WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT, AMOUNT_1);
+  expectBalanceMatchesOutputs();
+
+  for (uint32_t height = TEST_BLOCK_HEIGHT + 2; height < TEST_BLOCK_HEIGHT + 20; ++height) {
+    container.advanceHeight(height);
+    expectBalanceMatchesOutputs();
+  }
+
+  addSpendingTransaction(tx->getTransactionHash(), TEST_BLOCK_HEIGHT + 20, TEST_TRANSACTION_OUTPUT_GLOBAL_INDEX + 1, AMOUNT_2 - 1);
+  expectBalanceMatchesOutputs();
+
+  container.detach(TEST_BLOCK_HEIGHT + 1);
+  expectBalanceMatchesOutputs();
+}
+
 
 //--------------------------------------------------------------------------- 
 // TransfersContainer_getOutputs
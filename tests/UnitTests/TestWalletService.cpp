@@ -30,8 +30,10 @@
 #include "PaymentGate/WalletService.h"
 #include "PaymentGate/WalletServiceErrorCategory.h"
 #include "INodeStubs.h"
+#include "TransactionApiHelpers.h"
 #include "Wallet/IFusionManager.h"
 #include "Wallet/WalletErrors.h"
+#include "crypto/random.h"
 
 using namespace MevaCoin;
 using namespace PaymentService;
@@ -54,25 +56,34 @@ struct IWalletBaseStub : public MevaCoin::IWallet, public MevaCoin::IFusionManag
 
   virtual void initialize(const std::string& path, const std::string& password) override { }
   virtual void initializeWithViewKey(const std::string& path, const std::string& password, const Crypto::SecretKey& viewSecretKey) override { }
-  virtual void initializeWithViewKeyAndTimestamp(const std::string& path, const std::string& password, const Crypto::SecretKey& viewSecretKey, const uint64_t& creationTimestamp) override { }
+  virtual void initializeWithViewKey(const std::string& path, const std::string& password, const Crypto::SecretKey& viewSecretKey, const uint64_t& creationTimestamp) override { }
+  virtual void initializeWithViewKey(const std::string& path, const std::string& password, const Crypto::SecretKey& viewSecretKey, const uint32_t scanHeight) override { }
   virtual void load(const std::string& path, const std::string& password, std::string& extra) override { }
   virtual void load(const std::string& path, const std::string& password) override { }
   virtual void shutdown() override { }
 
   virtual void changePassword(const std::string& oldPassword, const std::string& newPassword) override { }
   virtual void save(WalletSaveLevel saveLevel = WalletSaveLevel::SAVE_ALL, const std::string& extra = "") override { }
+  virtual void reset(const uint64_t scanHeight) override { }
   virtual void exportWallet(const std::string& path, bool encrypt = true, WalletSaveLevel saveLevel = WalletSaveLevel::SAVE_ALL, const std::string& extra = "") override { }
 
   virtual size_t getAddressCount() const override { return 0; }
   virtual std::string getAddress(size_t index) const override { return ""; }
+  virtual bool isMyAddress(const std::string& address) const override { return false; }
+  virtual AccountPublicAddress getAccountPublicAddress(size_t index) const override { return AccountPublicAddress(); }
   virtual KeyPair getAddressSpendKey(size_t index) const override { return KeyPair(); }
   virtual KeyPair getAddressSpendKey(const std::string& address) const override { return KeyPair(); }
   virtual KeyPair getViewKey() const override { return KeyPair(); }
   virtual std::string createAddress() override { return ""; }
   virtual std::string createAddress(const Crypto::SecretKey& spendSecretKey, bool reset) override { return ""; }
-  virtual std::string createAddress(const Crypto::PublicKey& spendPublicKey) override { return ""; }
+  virtual std::string createAddress(const Crypto::PublicKey& spendPublicKey, bool reset) override { return ""; }
+  virtual std::string createAddress(const Crypto::SecretKey& spendSecretKey, const uint64_t& creationTimestamp) override { return ""; }
+  virtual std::string createAddress(const Crypto::PublicKey& spendPublicKey, const uint64_t& creationTimestamp) override { return ""; }
+  virtual std::string createAddress(const Crypto::SecretKey& spendSecretKey, const uint32_t scanHeight) override { return ""; }
+  virtual std::string createAddress(const Crypto::PublicKey& spendPublicKey, const uint32_t scanHeight) override { return ""; }
   virtual std::vector<std::string> createAddressList(const std::vector<Crypto::SecretKey>& spendSecretKeys, bool reset) override { return std::vector<std::string>(); }
-  virtual std::string createAddressWithTimestamp(const Crypto::SecretKey& spendSecretKey, const uint64_t& creationTimestamp) override { return ""; }
+  virtual std::vector<std::string> createAddressList(const std::vector<Crypto::SecretKey>& spendSecretKeys, const std::vector<uint64_t>& creationTimestamps) override { return std::vector<std::string>(); }
+  virtual std::vector<std::string> createAddressList(const std::vector<Crypto::SecretKey>& spendSecretKeys, const std::vector<uint32_t>& scanHeights) override { return std::vector<std::string>(); }
   virtual void deleteAddress(const std::string& address) override { }
 
   virtual uint64_t getActualBalance() const override { return 0; }
@@ -82,18 +93,34 @@ struct IWalletBaseStub : public MevaCoin::IWallet, public MevaCoin::IFusionManag
 
   virtual size_t getTransactionCount() const override { return 0; }
   virtual WalletTransaction getTransaction(size_t transactionIndex) const override { return WalletTransaction(); }
+  virtual Crypto::SecretKey getTransactionSecretKey(size_t transactionIndex) const override { return Crypto::SecretKey(); }
+  virtual Crypto::SecretKey getTransactionSecretKey(Crypto::Hash& transactionHash) const override { return Crypto::SecretKey(); }
+  virtual bool getTransactionProof(const Crypto::Hash& transactionHash, const MevaCoin::AccountPublicAddress& destinationAddress, const Crypto::SecretKey& txKey, std::string& transactionProof) override { return false; }
   virtual size_t getTransactionTransferCount(size_t transactionIndex) const override { return 0; }
   virtual WalletTransfer getTransactionTransfer(size_t transactionIndex, size_t transferIndex) const override { return WalletTransfer(); }
 
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const override { return WalletTransactionWithTransfers(); }
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const override { return {}; }
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const override { return {}; }
+  virtual bool getTransactions(const Crypto::Hash& blockHash, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const override {
+    blocks = filterByAddresses(getTransactions(blockHash, count), addresses);
+    return !blocks.empty();
+  }
+  virtual bool getTransactions(uint32_t blockIndex, size_t count, const std::vector<std::string>& addresses, std::vector<TransactionsInBlockInfo>& blocks) const override {
+    blocks = filterByAddresses(getTransactions(blockIndex, count), addresses);
+    return !blocks.empty();
+  }
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const override { return {}; }
   virtual uint32_t getBlockCount() const override { return 0; }
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const override { return {}; }
   virtual std::vector<size_t> getDelayedTransactionIds() const override { return {}; }
+  virtual std::vector<TransactionOutputInformation> getTransfers(size_t index, uint32_t flags) const override { return {}; }
+
+  virtual std::string getReserveProof(const uint64_t &reserve, const std::string& address, const std::string &message) override { return ""; }
+  virtual std::string signMessage(const std::string &message, const std::string& address) override { return ""; }
+  virtual bool verifyMessage(const std::string &message, const std::string& address, const std::string &signature) override { return false; }
 
-  virtual size_t transfer(const TransactionParameters& sendingTransaction) override { return 0; }
+  virtual size_t transfer(const TransactionParameters& sendingTransaction, Crypto::SecretKey &txSecretKey) override { return 0; }
 
   virtual size_t makeTransaction(const TransactionParameters& sendingTransaction) override { return 0; }
   virtual void commitTransaction(size_t transactionId) override { }
@@ -144,6 +171,31 @@ protected:
     }
   }
 
+  // same contract as WalletGreen: blocks without transactions are skipped,
+  // listed blocks keep only the transactions touching one of the addresses
+  static std::vector<TransactionsInBlockInfo> filterByAddresses(const std::vector<TransactionsInBlockInfo>& blocks, const std::vector<std::string>& addresses) {
+    std::vector<TransactionsInBlockInfo> result;
+    for (const auto& block: blocks) {
+      if (block.transactions.empty()) {
+        continue;
+      }
+
+      TransactionsInBlockInfo item;
+      item.blockHash = block.blockHash;
+      for (const auto& transaction: block.transactions) {
+        if (addresses.empty() || std::any_of(transaction.transfers.begin(), transaction.transfers.end(), [&addresses](const WalletTransfer& transfer) {
+          return std::find(addresses.begin(), addresses.end(), transfer.address) != addresses.end();
+        })) {
+          item.transactions.push_back(transaction);
+        }
+      }
+
+      result.push_back(std::move(item));
+    }
+
+    return result;
+  }
+
   bool m_stopped = false;
   System::Event m_eventOccurred;
   std::queue<WalletEvent> m_events;
@@ -208,8 +260,8 @@ struct WalletCreateAddressStub: public IWalletBaseStub {
 
   virtual std::string createAddress() override { return address; }
   virtual std::string createAddress(const Crypto::SecretKey& spendSecretKey, bool reset) override { return address; }
-  virtual std::string createAddress(const Crypto::PublicKey& spendPublicKey) override { return address; }
-  virtual std::string createAddressWithTimestamp(const Crypto::SecretKey& spendSecretKey, const uint64_t& creationTimestamp) override { return address; }
+  virtual std::string createAddress(const Crypto::PublicKey& spendPublicKey, bool reset) override { return address; }
+  virtual std::string createAddress(const Crypto::SecretKey& spendSecretKey, const uint64_t& creationTimestamp) override { return address; }
 
   std::string address = "correctAddress";
 };
@@ -522,9 +574,9 @@ class WalletServiceTest_getTransactions : public WalletServiceTest {
   virtual void SetUp() override;
 protected:
   std::vector<TransactionsInBlockInfo> testTransactions;
-  const std::string RANDOM_ADDRESS1 = "288DiQfYSxDNQoWpR6cy94i2AWyGnxo1L1MF2ZiXg58h9P52o576CSDcJp7ZceSXSUQ7u8aTF1MigQXzAtqRZ3Uq58Sne8x";
-  const std::string RANDOM_ADDRESS2 = "29PQ8VbzPi163kG59w5V8PR9A6watydfYAvwFcDS74KhDEyU9CGgqsDH719oeLbpAa4xtPsgfQ6Bv9RmKs1XZWudV6q6cmU";
-  const std::string RANDOM_ADDRESS3 = "23E4CVgzJok9zXnrKzvHgbKvMXZnAgsB9FA1pkAppR6d42dWMEuJjsfcJp7ZceSXSUQ7u8aTF1MigQXzAtqRZ3Uq5AHHbzZ";
+  const std::string RANDOM_ADDRESS1 = currency.accountAddressAsString(generateAccountKeys().address);
+  const std::string RANDOM_ADDRESS2 = currency.accountAddressAsString(generateAccountKeys().address);
+  const std::string RANDOM_ADDRESS3 = currency.accountAddressAsString(generateAccountKeys().address);
   const std::string TRANSACTION_EXTRA = "022100dededededededededededededededededededededededededededededededede";
   const std::string PAYMENT_ID = "dededededededededededededededededededededededededededededededede";
 };
@@ -615,6 +667,25 @@ TEST_F(WalletServiceTest_getTransactions, addressesFilter_existentAndNonExistent
   ASSERT_EQ(Common::podToHex(testTransactions[0].transactions[0].transaction.hash), transactions[0].transactions[0].transactionHash);
 }
 
+TEST_F(WalletServiceTest_getTransactions, addressesFilter_skipsBlocksWithoutTransactions) {
+  WalletGetTransactionsStub wallet(dispatcher);
+  TransactionsInBlockInfo emptyBlock;
+  emptyBlock.blockHash = generateRandomHash();
+  wallet.transactions.push_back(emptyBlock);
+  wallet.transactions.insert(wallet.transactions.end(), testTransactions.begin(), testTransactions.end());
+
+  auto service = createWalletService(wallet);
+
+  std::vector<TransactionsInBlockRpcInfo> transactions;
+  auto ec = service->getTransactions({RANDOM_ADDRESS2}, 0, 2, "", transactions);
+
+  ASSERT_FALSE(ec);
+
+  ASSERT_EQ(1, transactions.size());
+  ASSERT_EQ(Common::podToHex(testTransactions[0].blockHash), transactions[0].blockHash);
+  ASSERT_EQ(1, transactions[0].transactions.size());
+}
+
 TEST_F(WalletServiceTest_getTransactions, paymentIdFilter_existentReturnsTransaction) {
   WalletGetTransactionsStub wallet(dispatcher);
   wallet.transactions = testTransactions;
@@ -778,7 +849,7 @@ struct WalletTransferStub : public IWalletBaseStub {
   WalletTransferStub(System::Dispatcher& dispatcher, const Crypto::Hash& hash) : IWalletBaseStub(dispatcher), hash(hash) {
   }
 
-  virtual size_t transfer(const TransactionParameters& sendingTransaction) override {
+  virtual size_t transfer(const TransactionParameters& sendingTransaction, Crypto::SecretKey& txSecretKey) override {
     params = sendingTransaction;
     return 0;
   }
@@ -814,7 +885,8 @@ TEST_F(WalletServiceTest_sendTransaction, passesCorrectParameters) {
   auto service = createWalletService(wallet);
 
   std::string hash;
-  auto ec = service->sendTransaction(request, hash);
+  std::string secretKey;
+  auto ec = service->sendTransaction(request, hash, secretKey);
 
   ASSERT_FALSE(ec);
   ASSERT_EQ(Common::podToHex(wallet.hash), hash);
@@ -826,7 +898,8 @@ TEST_F(WalletServiceTest_sendTransaction, incorrectSourceAddress) {
   request.sourceAddresses.push_back("wrong address");
 
   std::string hash;
-  auto ec = service->sendTransaction(request, hash);
+  std::string secretKey;
+  auto ec = service->sendTransaction(request, hash, secretKey);
   ASSERT_EQ(make_error_code(MevaCoin::error::BAD_ADDRESS), ec);
 }
 
@@ -835,7 +908,8 @@ TEST_F(WalletServiceTest_sendTransaction, incorrectTransferAddress) {
   request.transfers.push_back(WalletRpcOrder{"wrong address", 12131});
 
   std::string hash;
-  auto ec = service->sendTransaction(request, hash);
+  std::string secretKey;
+  auto ec = service->sendTransaction(request, hash, secretKey);
   ASSERT_EQ(make_error_code(MevaCoin::error::BAD_ADDRESS), ec);
 }
 
@@ -1034,7 +1108,7 @@ public:
   const size_t TEST_TOTAL_OUTPUT_COUNT = 823632;
 
   FusionManagerStub(System::Dispatcher& dispatcher) : IWalletBaseStub(dispatcher) {
-    testTransactionHash = Crypto::rand<Crypto::Hash>();
+    Random::randomBytes(sizeof(testTransactionHash.data), testTransactionHash.data);
   }
 
   virtual WalletTransaction getTransaction(size_t transactionIndex) const override {
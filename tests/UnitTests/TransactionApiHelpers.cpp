@@ -145,7 +145,9 @@ size_t TestTransactionBuilder::addFakeMultisignatureInput(uint64_t amount, uint3
     accs.push_back(generateAccount());
   }
 
-  msigInputs[idx] = MsigInfo{ Crypto::rand<PublicKey>(), 0, std::move(accs) };
+  PublicKey transactionKey;
+  Random::randomBytes(sizeof(transactionKey.data), transactionKey.data);
+  msigInputs[idx] = MsigInfo{ transactionKey, 0, std::move(accs) };
   return idx;
 }
 
@@ -62,7 +62,9 @@ namespace {
   }
   
   KeyImage generateKeyImage() {
-    return Crypto::rand<KeyImage>();
+    KeyImage keyImage;
+    Random::randomBytes(sizeof(keyImage.data), keyImage.data);
+    return keyImage;
   }
 
   KeyImage generateKeyImage(const AccountKeys& keys, size_t idx, const PublicKey& txPubKey) {
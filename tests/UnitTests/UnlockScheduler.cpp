@@ -0,0 +1,74 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "Transfers/UnlockScheduler.h"
+
+using namespace MevaCoin;
+
+TEST(UnlockScheduler, releasesOnlyDueItemsInOrder) {
+  UnlockScheduler<int> scheduler;
+  scheduler.scheduleAtHeight(20, 2);
+  scheduler.scheduleAtHeight(10, 1);
+  scheduler.scheduleAtHeight(30, 3);
+  scheduler.scheduleAtTime(1000, 4);
+
+  std::vector<int> released;
+  auto release = [&released](int item) { released.push_back(item); };
+
+  ASSERT_EQ(0, scheduler.releaseDue(9, 999, release));
+  ASSERT_EQ(2, scheduler.releaseDue(20, 999, release));
+  ASSERT_EQ((std::vector<int>{ 1, 2 }), released);
+
+  ASSERT_EQ(1, scheduler.releaseDue(20, 1000, release));
+  ASSERT_EQ(4, released.back());
+  ASSERT_EQ(1, scheduler.size());
+}
+
+TEST(UnlockScheduler, releasedTimeLockCanBeRescheduledByHeight) {
+  UnlockScheduler<int> scheduler;
+  scheduler.scheduleAtTime(1000, 1);
+
+  std::vector<int> released;
+  size_t count = scheduler.releaseDue(50, 1000, [&](int item) {
+    released.push_back(item);
+    if (item == 1) {
+      scheduler.scheduleAtHeight(50, 2);
+    }
+  });
+
+  ASSERT_EQ(2, count);
+  ASSERT_EQ((std::vector<int>{ 1, 2 }), released);
+  ASSERT_TRUE(scheduler.empty());
+}
+
+TEST(UnlockScheduler, unschedulesSingleDuplicate) {
+  UnlockScheduler<int> scheduler;
+  scheduler.scheduleAtHeight(10, 1);
+  scheduler.scheduleAtHeight(10, 1);
+  scheduler.scheduleAtTime(10, 1);
+
+  ASSERT_TRUE(scheduler.unscheduleAtHeight(10, 1));
+  ASSERT_FALSE(scheduler.unscheduleAtHeight(11, 1));
+  ASSERT_EQ(2, scheduler.size());
+
+  ASSERT_EQ(2, scheduler.unscheduleIf([](int item) { return item == 1; }));
+  ASSERT_TRUE(scheduler.empty());
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include "MevaCoinCore/VerifiedTransactionCache.h"
+
+using namespace MevaCoin;
+
+namespace {
+
+Crypto::Hash hashOf(uint8_t n) {
+  Crypto::Hash hash = NULL_HASH;
+  hash.data[0] = n;
+  return hash;
+}
+
+BlockInfo blockAt(uint32_t height) {
+  BlockInfo block;
+  block.height = height;
+  block.id = hashOf(static_cast<uint8_t>(100 + height));
+  return block;
+}
+
+}
+
+TEST(VerifiedTransactionCache, takeReturnsEntryOnce) {
+  VerifiedTransactionCache cache(10);
+  cache.add(hashOf(1), blockAt(5));
+  cache.add(hashOf(1), blockAt(7));
+
+  BlockInfo block;
+  ASSERT_TRUE(cache.take(hashOf(1), block));
+  ASSERT_EQ(7, block.height);
+  ASSERT_EQ(blockAt(7).id, block.id);
+  ASSERT_FALSE(cache.take(hashOf(1), block));
+  ASSERT_EQ(0, cache.size());
+}
+
+TEST(VerifiedTransactionCache, evictsOldestEntries) {
+  VerifiedTransactionCache cache(3);
+  for (uint8_t i = 0; i < 5; ++i) {
+    cache.add(hashOf(i), blockAt(i));
+  }
+
+  BlockInfo block;
+  ASSERT_EQ(3, cache.size());
+  ASSERT_FALSE(cache.take(hashOf(0), block));
+  ASSERT_FALSE(cache.take(hashOf(1), block));
+  ASSERT_TRUE(cache.take(hashOf(4), block));
+  ASSERT_EQ(4, block.height);
+}
+
+TEST(VerifiedTransactionCache, takenEntriesDoNotCountTowardsCapacity) {
+  VerifiedTransactionCache cache(3);
+  for (uint8_t i = 0; i < 3; ++i) {
+    cache.add(hashOf(i), blockAt(i));
+  }
+
+  BlockInfo block;
+  ASSERT_TRUE(cache.take(hashOf(1), block));
+  cache.add(hashOf(3), blockAt(3));
+
+  ASSERT_EQ(3, cache.size());
+  ASSERT_TRUE(cache.take(hashOf(0), block));
+  ASSERT_TRUE(cache.take(hashOf(2), block));
+  ASSERT_TRUE(cache.take(hashOf(3), block));
+}
+
+TEST(VerifiedTransactionCache, takeIfInChainSkipsChecksOnlyForBlocksStillInChain) {
+  VerifiedTransactionCache cache(10);
+  cache.add(hashOf(1), blockAt(2));
+  cache.add(hashOf(2), blockAt(4));
+  cache.add(hashOf(3), blockAt(6));
+
+  // block 4 was replaced by a reorg, block 6 is beyond the chain
+  auto blockIdByHeight = [](uint32_t height) { return height == 4 ? hashOf(200) : blockAt(height).id; };
+
+  ASSERT_TRUE(cache.takeIfInChain(hashOf(1), 6, blockIdByHeight));
+  ASSERT_FALSE(cache.takeIfInChain(hashOf(2), 6, blockIdByHeight));
+  ASSERT_FALSE(cache.takeIfInChain(hashOf(3), 6, blockIdByHeight));
+  ASSERT_FALSE(cache.takeIfInChain(hashOf(4), 6, blockIdByHeight));
+
+  // entries are consumed whether or not they were still valid
+  ASSERT_EQ(0, cache.size());
+  ASSERT_FALSE(cache.takeIfInChain(hashOf(1), 6, blockIdByHeight));
+}
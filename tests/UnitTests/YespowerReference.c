@@ -0,0 +1,28 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+/* yespower built without SIMD, the reference the SSE2, AVX-512VL and XOP builds are checked against */
+
+#undef __SSE__
+#undef __SSE2__
+#undef __AVX__
+#undef __AVX512VL__
+#undef __XOP__
+
+#define YESPOWER_VARIANT yespower_reference
+#include "crypto/yespower.c"
@@ -0,0 +1,103 @@
+// Copyright (c) 2016-2023, The Karbo developers
+//
+// This file is part of Karbo.
+//
+// Karbo is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Karbo is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Karbo.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "crypto/yespower.h"
+
+extern "C" int yespower_reference(yespower_local_t *local, const uint8_t *src, size_t srclen,
+  const yespower_params_t *params, yespower_binary_t *dst);
+
+namespace {
+
+typedef int (*YespowerFunction)(yespower_local_t*, const uint8_t*, size_t, const yespower_params_t*, yespower_binary_t*);
+
+struct Input {
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> seed;
+};
+
+// block hashing blobs are around 80 bytes and seeded with a block hash, as in y_slow_hash
+std::vector<Input> fixedInputs() {
+  std::vector<Input> inputs;
+  for (size_t size : { 0, 1, 76, 80, 200 }) {
+    Input input;
+    for (size_t i = 0; i < size; ++i) {
+      input.data.push_back(static_cast<uint8_t>(i * 7 + size));
+    }
+
+    input.seed.assign(32, static_cast<uint8_t>(size));
+    inputs.push_back(input);
+  }
+
+  return inputs;
+}
+
+void expectMatchesReference(YespowerFunction function) {
+  yespower_local_t local;
+  yespower_init_local(&local);
+  for (const Input& input : fixedInputs()) {
+    yespower_params_t params = { 2048, 32, input.seed.data(), input.seed.size() };
+
+    yespower_binary_t expected;
+    yespower_binary_t actual;
+    ASSERT_EQ(0, yespower_reference(&local, input.data.data(), input.data.size(), &params, &expected));
+    ASSERT_EQ(0, function(&local, input.data.data(), input.data.size(), &params, &actual));
+    ASSERT_EQ(0, memcmp(&expected, &actual, sizeof(expected))) << "input size " << input.data.size();
+  }
+
+  yespower_free_local(&local);
+}
+
+}
+
+TEST(YespowerVariants, genericMatchesReference) {
+  expectMatchesReference(yespower_generic);
+}
+
+TEST(YespowerVariants, dispatchedMatchesReference) {
+  expectMatchesReference(yespower);
+}
+
+#ifdef YESPOWER_DISPATCH
+
+TEST(YespowerVariants, avx512MatchesReference) {
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx512vl")) {
+    std::cout << "AVX-512VL is not supported by this CPU, skipped" << std::endl;
+    return;
+  }
+
+  expectMatchesReference(yespower_avx512);
+}
+
+TEST(YespowerVariants, xopMatchesReference) {
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("xop")) {
+    std::cout << "XOP is not supported by this CPU, skipped" << std::endl;
+    return;
+  }
+
+  expectMatchesReference(yespower_xop);
+}
+
+#endif